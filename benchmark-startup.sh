@@ -0,0 +1,40 @@
+#!/bin/bash
+
+# MDV-Qt Startup Benchmark
+# Runs each given build several times and reports the median time to the
+# first frame, as printed by --startup-trace. Pass two binaries to compare
+# builds, e.g. before and after a change:
+#   ./benchmark-startup.sh old/mdviewer build/mdviewer
+
+set -e  # Exit on any error
+
+RUNS="${RUNS:-10}"
+
+if [ $# -eq 0 ]; then
+    echo "Usage: $0 <mdviewer binary> [<mdviewer binary> ...]"
+    exit 1
+fi
+
+echo "MDV-Qt Startup Benchmark"
+echo "========================"
+
+for BINARY in "$@"; do
+    if [ ! -x "$BINARY" ]; then
+        echo "Not an executable: $BINARY"
+        exit 1
+    fi
+
+    TIMES=()
+    for ((i = 0; i < RUNS; i++)); do
+        TIME=$("$BINARY" --startup-trace --quit-after-startup 2>&1 \
+            | awk '/ first frame$/ { print $1 }')
+        if [ -z "$TIME" ]; then
+            echo "$BINARY did not report a first frame"
+            exit 1
+        fi
+        TIMES+=("$TIME")
+    done
+
+    MEDIAN=$(printf '%s\n' "${TIMES[@]}" | sort -n | awk '{ v[NR] = $1 } END { print v[int((NR + 1) / 2)] }')
+    echo "$BINARY: first frame after $MEDIAN ms (median of $RUNS runs)"
+done
@@ -0,0 +1,166 @@
+// QmlSingletons.h
+#ifndef QMLSINGLETONS_H
+#define QMLSINGLETONS_H
+
+#include <QObject>
+#include <QQmlEngine>
+
+#include "core/DocumentManager.h"
+#include "core/DocumentFinder.h"
+#include "core/FileExplorerModel.h"
+#include "core/MarkdownRenderer.h"
+#include "core/EditorManager.h"
+#include "core/ThemeManager.h"
+#include "core/DocumentLinker.h"
+#include "core/DocumentLinksModel.h"
+#include "core/BacklinksModel.h"
+#include "core/Prefetcher.h"
+#include "core/HierarchyModel.h"
+#include "core/ServiceRegistry.h"
+#include "core/FuzzyFinderModel.h"
+#include "core/SearchResultsModel.h"
+#include "core/RegexSearchModel.h"
+
+// The core objects are created in main() with their dependencies and
+// exposed to the MdViewer QML module as typed singletons. Unlike context
+// properties, their types are known when the QML is compiled ahead of time.
+template<typename T>
+class QmlSingleton
+{
+public:
+    static void setInstance(T *instance) { s_instance = instance; }
+
+    static T *create(QQmlEngine *, QJSEngine *engine)
+    {
+        Q_ASSERT(s_instance);
+        Q_ASSERT(engine->thread() == s_instance->thread());
+        // Owned by the application, not by the engine
+        QJSEngine::setObjectOwnership(s_instance, QJSEngine::CppOwnership);
+        return s_instance;
+    }
+
+private:
+    inline static T *s_instance = nullptr;
+};
+
+struct DocumentManagerSingleton : QmlSingleton<DocumentManager>
+{
+    Q_GADGET
+    QML_FOREIGN(DocumentManager)
+    QML_NAMED_ELEMENT(DocumentManager)
+    QML_SINGLETON
+};
+
+struct DocumentFinderSingleton : QmlSingleton<DocumentFinder>
+{
+    Q_GADGET
+    QML_FOREIGN(DocumentFinder)
+    QML_NAMED_ELEMENT(DocumentFinder)
+    QML_SINGLETON
+};
+
+struct FileSystemModelSingleton : QmlSingleton<FileExplorerModel>
+{
+    Q_GADGET
+    QML_FOREIGN(FileExplorerModel)
+    QML_NAMED_ELEMENT(FileSystemModel)
+    QML_SINGLETON
+};
+
+struct MarkdownRendererSingleton : QmlSingleton<MarkdownRenderer>
+{
+    Q_GADGET
+    QML_FOREIGN(MarkdownRenderer)
+    QML_NAMED_ELEMENT(MarkdownRenderer)
+    QML_SINGLETON
+};
+
+struct EditorManagerSingleton : QmlSingleton<EditorManager>
+{
+    Q_GADGET
+    QML_FOREIGN(EditorManager)
+    QML_NAMED_ELEMENT(EditorManager)
+    QML_SINGLETON
+};
+
+struct ThemeManagerSingleton : QmlSingleton<ThemeManager>
+{
+    Q_GADGET
+    QML_FOREIGN(ThemeManager)
+    QML_NAMED_ELEMENT(ThemeManager)
+    QML_SINGLETON
+};
+
+struct DocumentLinkerSingleton : QmlSingleton<DocumentLinker>
+{
+    Q_GADGET
+    QML_FOREIGN(DocumentLinker)
+    QML_NAMED_ELEMENT(DocumentLinker)
+    QML_SINGLETON
+};
+
+struct DocumentLinksSingleton : QmlSingleton<DocumentLinksModel>
+{
+    Q_GADGET
+    QML_FOREIGN(DocumentLinksModel)
+    QML_NAMED_ELEMENT(DocumentLinks)
+    QML_SINGLETON
+};
+
+struct BacklinksSingleton : QmlSingleton<BacklinksModel>
+{
+    Q_GADGET
+    QML_FOREIGN(BacklinksModel)
+    QML_NAMED_ELEMENT(Backlinks)
+    QML_SINGLETON
+};
+
+struct PrefetcherSingleton : QmlSingleton<Prefetcher>
+{
+    Q_GADGET
+    QML_FOREIGN(Prefetcher)
+    QML_NAMED_ELEMENT(Prefetcher)
+    QML_SINGLETON
+};
+
+struct DocumentHierarchySingleton : QmlSingleton<HierarchyModel>
+{
+    Q_GADGET
+    QML_FOREIGN(HierarchyModel)
+    QML_NAMED_ELEMENT(DocumentHierarchy)
+    QML_SINGLETON
+};
+
+struct FuzzyFinderSingleton : QmlSingleton<FuzzyFinderModel>
+{
+    Q_GADGET
+    QML_FOREIGN(FuzzyFinderModel)
+    QML_NAMED_ELEMENT(FuzzyFinder)
+    QML_SINGLETON
+};
+
+struct FullTextSearchSingleton : QmlSingleton<SearchResultsModel>
+{
+    Q_GADGET
+    QML_FOREIGN(SearchResultsModel)
+    QML_NAMED_ELEMENT(FullTextSearch)
+    QML_SINGLETON
+};
+
+struct RegexSearchSingleton : QmlSingleton<RegexSearchModel>
+{
+    Q_GADGET
+    QML_FOREIGN(RegexSearchModel)
+    QML_NAMED_ELEMENT(RegexSearch)
+    QML_SINGLETON
+};
+
+struct ServicesSingleton : QmlSingleton<ServiceRegistry>
+{
+    Q_GADGET
+    QML_FOREIGN(ServiceRegistry)
+    QML_NAMED_ELEMENT(Services)
+    QML_SINGLETON
+};
+
+#endif // QMLSINGLETONS_H
@@ -63,7 +63,7 @@ Item {
                     icon.source: "qrc:/icons/view-refresh.svg"
                     icon.width: 16
                     icon.height: 16
-                    onClicked: fileSystemModel.refresh()
+                    onClicked: FileSystemModel.refresh()
                     ToolTip.text: "Refresh file list"
                     ToolTip.visible: hovered
                 }
@@ -78,28 +78,193 @@ Item {
                     text: "Markdown Only"
                     checkable: true
                     checked: true
-                    onClicked: fileSystemModel.markdownOnly = checked
+                    onClicked: FileSystemModel.markdownOnly = checked
                     ToolTip.text: "Show only markdown files"
                     ToolTip.visible: hovered
                 }
             }
         }
         
-        // Search field for filtering files
-        TextField {
-            id: searchField
+        // Search by file name, through the contents of workspace files, or
+        // with a regular expression
+        RowLayout {
             Layout.fillWidth: true
-            placeholderText: "Search files..."
-            background: Rectangle {
-                border.color: "#cccccc"
-                border.width: 1
-                radius: 3
-                color: "#ffffff"
+            spacing: 4
+            
+            TextField {
+                id: searchField
+                Layout.fillWidth: true
+                placeholderText: ["Search files...", "Search contents...", "Regular expression..."][searchMode.currentIndex]
+                background: Rectangle {
+                    border.color: RegexSearch.errorString !== "" && searchMode.currentIndex === 2 ? "#e74c3c" : "#cccccc"
+                    border.width: 1
+                    radius: 3
+                    color: "#ffffff"
+                }
+                
+                onTextChanged: fileExplorer.updateSearch()
+                
+                Keys.onReturnPressed: {
+                    var results = fileExplorer.activeResults()
+                    if (results.count > 0) {
+                        fileExplorer.fileOpened(results.model.filePath(Math.max(0, results.currentIndex)));
+                    }
+                }
+                Keys.onEscapePressed: RegexSearch.cancel()
+                Keys.onDownPressed: fileExplorer.activeResults().incrementCurrentIndex()
+                Keys.onUpPressed: fileExplorer.activeResults().decrementCurrentIndex()
+            }
+            
+            ComboBox {
+                id: searchMode
+                model: ["Files", "Contents", "Regex"]
+                implicitContentWidthPolicy: ComboBox.WidestText
+                onActivated: fileExplorer.updateSearch()
             }
+        }
+        
+        // Fuzzy search results take the place of the tree while searching
+        ListView {
+            id: searchResults
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+            visible: searchField.text.length > 0 && searchMode.currentIndex === 0
+            clip: true
+            model: FuzzyFinder
             
-            onTextChanged: {
-                // Implement filtering based on search text
-                fileSystemModel.filterRegExp = new RegExp(text, "i");
+            delegate: ItemDelegate {
+                required property string fileName
+                required property string directory
+                required property string filePath
+                
+                width: ListView.view.width
+                highlighted: ListView.isCurrentItem
+                
+                contentItem: Column {
+                    Label {
+                        text: fileName
+                    }
+                    Label {
+                        text: directory
+                        font.pixelSize: 11
+                        color: "#888888"
+                        elide: Text.ElideMiddle
+                        width: parent.width
+                    }
+                }
+                
+                onClicked: fileExplorer.fileOpened(filePath)
+            }
+        }
+        
+        // Full-text results, filled in as they stream from the index
+        ListView {
+            id: contentResults
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+            visible: searchField.text.length > 0 && searchMode.currentIndex === 1
+            clip: true
+            model: FullTextSearch
+            
+            footer: BusyIndicator {
+                width: ListView.view.width
+                height: running ? 32 : 0
+                running: FullTextSearch.searching
+            }
+            
+            delegate: ItemDelegate {
+                required property string fileName
+                required property string filePath
+                required property string snippetHtml
+                
+                width: ListView.view.width
+                highlighted: ListView.isCurrentItem
+                
+                contentItem: Column {
+                    Label {
+                        text: fileName
+                    }
+                    Label {
+                        text: snippetHtml
+                        textFormat: Text.StyledText
+                        font.pixelSize: 11
+                        color: "#666666"
+                        wrapMode: Text.Wrap
+                        maximumLineCount: 3
+                        elide: Text.ElideRight
+                        width: parent.width
+                    }
+                }
+                
+                onClicked: fileExplorer.fileOpened(filePath)
+            }
+        }
+        
+        // Regex matches, one row per line, streamed in batches
+        ListView {
+            id: regexResults
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+            visible: searchField.text.length > 0 && searchMode.currentIndex === 2
+            clip: true
+            model: RegexSearch
+            
+            header: Label {
+                width: ListView.view.width
+                padding: 4
+                text: RegexSearch.searching ? "Searching..." : RegexSearch.summary
+                font.pixelSize: 11
+                color: RegexSearch.errorString !== "" ? "#e74c3c" : "#888888"
+                elide: Text.ElideRight
+            }
+            
+            delegate: ItemDelegate {
+                required property string fileName
+                required property string filePath
+                required property int line
+                required property string textHtml
+                
+                width: ListView.view.width
+                highlighted: ListView.isCurrentItem
+                
+                contentItem: Column {
+                    Label {
+                        text: fileName + ":" + line
+                        font.pixelSize: 11
+                        color: "#888888"
+                    }
+                    Label {
+                        text: textHtml
+                        textFormat: Text.StyledText
+                        font.family: "monospace"
+                        elide: Text.ElideRight
+                        width: parent.width
+                    }
+                }
+                
+                onClicked: fileExplorer.fileOpened(filePath)
+            }
+        }
+        
+        // Progress of long operations such as deleting a large folder
+        ProgressBar {
+            id: operationProgressBar
+            Layout.fillWidth: true
+            visible: false
+            from: 0
+        }
+        
+        Connections {
+            target: FileSystemModel
+            
+            function onOperationProgress(path, done, total) {
+                operationProgressBar.to = total;
+                operationProgressBar.value = done;
+                operationProgressBar.visible = done < total;
+            }
+            
+            function onFileOperationFinished(operation, path, success) {
+                operationProgressBar.visible = false;
             }
         }
         
@@ -108,6 +273,7 @@ Item {
             id: scrollView
             Layout.fillWidth: true
             Layout.fillHeight: true
+            visible: searchField.text.length === 0
             
             ListView {
                 id: directoryTree
@@ -121,7 +287,6 @@ Item {
                     itemIndex: index
                     listView: ListView.view
                     modelData: model
-                    fileSystemModel: fileSystemModel
 
                     onClicked: function(mouse) {
                         ListView.view.currentIndex = index;
@@ -134,7 +299,7 @@ Item {
                             }
                         } else {
                             // Open file
-                            if (fileSystemModel.isMarkdownFile(model.filePath)) {
+                            if (FileSystemModel.isMarkdownFile(model.filePath)) {
                                 fileExplorer.fileOpened(model.filePath)
                             }
                         }
@@ -194,7 +359,7 @@ Item {
                                 (contextMenu.currentItem.isFolder ? 
                                     contextMenu.currentItem.filePath : 
                                     Qt.QDir.fromNativeSeparators(contextMenu.currentItem.filePath).split('/').slice(0, -1).join('/')) :
-                                fileSystemModel.rootPath
+                                FileSystemModel.rootPath
                 createNewFile(parentPath)
             }
         }
@@ -206,7 +371,7 @@ Item {
                                 (contextMenu.currentItem.isFolder ? 
                                     contextMenu.currentItem.filePath : 
                                     Qt.QDir.fromNativeSeparators(contextMenu.currentItem.filePath).split('/').slice(0, -1).join('/')) :
-                                fileSystemModel.rootPath
+                                FileSystemModel.rootPath
                 createNewFolder(parentPath)
             }
         }
@@ -235,7 +400,7 @@ Item {
             }
             
             Label {
-                text: "File will be created in: " + (contextMenu.currentItem?.filePath || fileSystemModel.rootPath)
+                text: "File will be created in: " + (contextMenu.currentItem?.filePath || FileSystemModel.rootPath)
                 Layout.fillWidth: true
                 wrapMode: Text.Wrap
                 font.pixelSize: 10
@@ -248,11 +413,11 @@ Item {
                            (contextMenu.currentItem.isFolder ? 
                                contextMenu.currentItem.filePath : 
                                Qt.QDir.fromNativeSeparators(contextMenu.currentItem.filePath).split('/').slice(0, -1).join('/')) :
-                           fileSystemModel.rootPath
+                           FileSystemModel.rootPath
             
             if (newFileName.text.trim() !== "") {
                 var newFilePath = parentPath + "/" + newFileName.text.trim()
-                fileSystemModel.createFile(parentPath, newFileName.text.trim())
+                FileSystemModel.createFile(parentPath, newFileName.text.trim())
                 newFileName.text = ""
             }
         }
@@ -281,7 +446,7 @@ Item {
             }
             
             Label {
-                text: "Folder will be created in: " + (contextMenu.currentItem?.filePath || fileSystemModel.rootPath)
+                text: "Folder will be created in: " + (contextMenu.currentItem?.filePath || FileSystemModel.rootPath)
                 Layout.fillWidth: true
                 wrapMode: Text.Wrap
                 font.pixelSize: 10
@@ -294,10 +459,10 @@ Item {
                            (contextMenu.currentItem.isFolder ? 
                                contextMenu.currentItem.filePath : 
                                Qt.QDir.fromNativeSeparators(contextMenu.currentItem.filePath).split('/').slice(0, -1).join('/')) :
-                           fileSystemModel.rootPath
+                           FileSystemModel.rootPath
             
             if (newFolderName.text.trim() !== "") {
-                fileSystemModel.createDirectory(parentPath, newFolderName.text.trim())
+                FileSystemModel.createDirectory(parentPath, newFolderName.text.trim())
                 newFolderName.text = ""
             }
         }
@@ -341,7 +506,7 @@ Item {
             if (renameField.text.trim() !== "" && renameDialog.currentPath !== "") {
                 var currentDir = Qt.QDir.fromNativeSeparators(renameDialog.currentPath).split('/').slice(0, -1).join('/')
                 var newPath = currentDir + "/" + renameField.text.trim()
-                fileSystemModel.renameFile(renameDialog.currentPath, newPath)
+                FileSystemModel.renameFile(renameDialog.currentPath, newPath)
             }
         }
     }
@@ -378,14 +543,26 @@ Item {
         
         onAccepted: {
             if (deleteDialog.currentPath !== "") {
-                fileSystemModel.deleteFile(deleteDialog.currentPath)
+                FileSystemModel.deleteFile(deleteDialog.currentPath)
             }
         }
     }
     
+    // Hands the search text to the model of the selected mode only
+    function updateSearch() {
+        var mode = searchMode.currentIndex
+        FuzzyFinder.query = mode === 0 ? searchField.text : ""
+        FullTextSearch.query = mode === 1 ? searchField.text : ""
+        RegexSearch.pattern = mode === 2 ? searchField.text : ""
+    }
+    
+    function activeResults() {
+        return [searchResults, contentResults, regexResults][searchMode.currentIndex]
+    }
+    
     // Functions for creating new files and folders
     function createNewFile(parentPath) {
-        var path = parentPath || (contextMenu.currentItem?.filePath || fileSystemModel.rootPath)
+        var path = parentPath || (contextMenu.currentItem?.filePath || FileSystemModel.rootPath)
         if (contextMenu.currentItem && !contextMenu.currentItem.isFolder) {
             path = Qt.QDir.fromNativeSeparators(contextMenu.currentItem.filePath).split('/').slice(0, -1).join('/')
         }
@@ -393,7 +570,7 @@ Item {
     }
     
     function createNewFolder(parentPath) {
-        var path = parentPath || (contextMenu.currentItem?.filePath || fileSystemModel.rootPath)
+        var path = parentPath || (contextMenu.currentItem?.filePath || FileSystemModel.rootPath)
         if (contextMenu.currentItem && !contextMenu.currentItem.isFolder) {
             path = Qt.QDir.fromNativeSeparators(contextMenu.currentItem.filePath).split('/').slice(0, -1).join('/')
         }
@@ -0,0 +1,152 @@
+// LinkPanel.qml
+import QtQuick
+import QtQuick.Controls
+import QtQuick.Layouts
+
+Item {
+    id: linkPanel
+
+    signal fileOpened(string filePath)
+
+    // Links of the current document, updated as it is edited
+    Binding {
+        target: DocumentLinks
+        property: "documentId"
+        value: DocumentManager.currentDocumentId
+    }
+
+    // Other documents linking to it, from the workspace link graph
+    Binding {
+        target: Backlinks
+        property: "documentPath"
+        value: DocumentManager.currentDocument
+    }
+
+    ColumnLayout {
+        anchors.fill: parent
+
+        RowLayout {
+            Layout.fillWidth: true
+
+            Label {
+                text: "Links"
+                font.bold: true
+                Layout.fillWidth: true
+                color: "#2c3e50"
+            }
+
+            Label {
+                text: DocumentLinks.brokenCount > 0
+                      ? DocumentLinks.count + " (" + DocumentLinks.brokenCount + " broken)"
+                      : DocumentLinks.count
+                font.pixelSize: 11
+                color: DocumentLinks.brokenCount > 0 ? "#e74c3c" : "#888888"
+            }
+        }
+
+        ListView {
+            id: linkList
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+            clip: true
+            model: DocumentLinks
+
+            ScrollBar.vertical: ScrollBar { }
+
+            delegate: ItemDelegate {
+                id: linkItem
+
+                required property string linkText
+                required property string fileName
+                required property string targetPath
+                required property string anchor
+                required property string kind
+                required property int line
+                required property int column
+                required property bool exists
+
+                width: ListView.view.width
+
+                contentItem: Column {
+                    Label {
+                        text: linkItem.linkText !== "" ? linkItem.linkText : linkItem.fileName
+                        elide: Text.ElideRight
+                        width: parent.width
+                        color: linkItem.exists ? "#2c3e50" : "#e74c3c"
+                    }
+                    Label {
+                        text: (kind === "anchor" ? "#" + anchor
+                               : fileName + (anchor !== "" ? "#" + anchor : ""))
+                              + "  " + kind + ", " + line + ":" + (column + 1)
+                        font.pixelSize: 11
+                        color: "#888888"
+                        elide: Text.ElideRight
+                        width: parent.width
+                    }
+                }
+
+                onClicked: {
+                    if (kind === "file" && exists) {
+                        linkPanel.fileOpened(targetPath)
+                    }
+                }
+            }
+        }
+
+        RowLayout {
+            Layout.fillWidth: true
+
+            Label {
+                text: "Backlinks"
+                font.bold: true
+                Layout.fillWidth: true
+                color: "#2c3e50"
+            }
+
+            Label {
+                text: Backlinks.count
+                font.pixelSize: 11
+                color: "#888888"
+            }
+        }
+
+        ListView {
+            id: backlinkList
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+            clip: true
+            model: Backlinks
+
+            ScrollBar.vertical: ScrollBar { }
+
+            delegate: ItemDelegate {
+                id: backlinkItem
+
+                required property string linkText
+                required property string fileName
+                required property string sourcePath
+                required property int line
+
+                width: ListView.view.width
+
+                contentItem: Column {
+                    Label {
+                        text: backlinkItem.fileName
+                        elide: Text.ElideRight
+                        width: parent.width
+                        color: "#2c3e50"
+                    }
+                    Label {
+                        text: backlinkItem.linkText + "  " + backlinkItem.line
+                        font.pixelSize: 11
+                        color: "#888888"
+                        elide: Text.ElideRight
+                        width: parent.width
+                    }
+                }
+
+                onClicked: linkPanel.fileOpened(sourcePath)
+            }
+        }
+    }
+}
@@ -13,6 +13,38 @@ ApplicationWindow {
     
     // iOS-7 inspired styling
     color: "#ffffff"
+
+    // Created by the first "Check Links"
+    property QtObject linkChecker: null
+
+    ListModel {
+        id: openTabs
+    }
+
+    Connections {
+        target: DocumentManager
+        function onDocumentOpened(documentId, filePath, content) {
+            mainWindow.addTab(documentId, filePath)
+        }
+        function onDocumentPlaceholderOpened(documentId, filePath) {
+            mainWindow.addTab(documentId, filePath)
+        }
+        function onDocumentClosed(documentId) {
+            var row = mainWindow.tabRow(documentId)
+            if (row >= 0) {
+                openTabs.remove(row)
+            }
+        }
+        function onCurrentDocumentChanged() {
+            mainWindow.showDocument(DocumentManager.currentDocumentId)
+        }
+        function onDocumentLoaded(documentId) {
+            mainWindow.showDocument(documentId)
+        }
+        function onDocumentReloaded(documentId) {
+            mainWindow.showDocument(documentId)
+        }
+    }
     
     // Main content
     header: ToolBar {
@@ -28,7 +60,7 @@ ApplicationWindow {
             
             ToolButton {
                 text: "New"
-                onClicked: documentManager.newDocument()
+                onClicked: DocumentManager.newDocument()
             }
             
             ToolButton {
@@ -38,7 +70,7 @@ ApplicationWindow {
             
             ToolButton {
                 text: "Save"
-                onClicked: documentManager.saveCurrent()
+                onClicked: DocumentManager.saveCurrent()
             }
             
             ToolButton {
@@ -48,7 +80,16 @@ ApplicationWindow {
             
             ToolButton {
                 text: "Export PDF"
-                onClicked: pdfExporter.exportCurrentToPdf()
+                onClicked: Services.service("pdfExporter").exportCurrentToPdf()
+            }
+            
+            ToolButton {
+                text: mainWindow.linkChecker && mainWindow.linkChecker.running
+                      ? "Checking Links..." : "Check Links"
+                onClicked: {
+                    mainWindow.linkChecker = Services.service("linkChecker")
+                    mainWindow.linkChecker.checkWorkspace()
+                }
             }
             
             Rectangle { 
@@ -84,14 +125,40 @@ ApplicationWindow {
         anchors.fill: parent
         orientation: Qt.Horizontal
         
-        // File Explorer Panel
-        FileExplorer {
-            id: fileExplorer
+        // File Explorer Panel, with the document hierarchy of the same folder
+        ColumnLayout {
             SplitView.preferredWidth: 250
             SplitView.minimumWidth: 200
-            
-            onFileOpened: filePath => {
-                documentManager.openDocument(filePath);
+            spacing: 0
+
+            TabBar {
+                id: sidebarTabs
+                Layout.fillWidth: true
+
+                TabButton { text: "Files" }
+                TabButton { text: "Hierarchy" }
+            }
+
+            StackLayout {
+                Layout.fillWidth: true
+                Layout.fillHeight: true
+                currentIndex: sidebarTabs.currentIndex
+
+                FileExplorer {
+                    id: fileExplorer
+
+                    onFileOpened: filePath => {
+                        DocumentManager.openDocument(filePath);
+                    }
+                }
+
+                DocumentHierarchyView {
+                    id: hierarchyView
+
+                    onFileOpened: filePath => {
+                        DocumentManager.openDocument(filePath);
+                    }
+                }
             }
         }
         
@@ -100,24 +167,38 @@ ApplicationWindow {
             id: tabAreaView
             SplitView.fillWidth: true
 
-            // Simple tab implementation
+            // One tab per open document; restored tabs appear before their
+            // text is read and load when activated
             Row {
                 id: tabBar
                 width: parent.width
                 height: 30
                 spacing: 1
 
-                // This would be populated dynamically in a real implementation
-                Rectangle {
-                    width: 100
-                    height: 30
-                    color: "#ffffff"
-                    border.color: "#e0e0e0"
-                    border.width: 1
-                    Text {
-                        anchors.centerIn: parent
-                        text: "Document.md"
-                        color: "#2c3e50"
+                Repeater {
+                    model: openTabs
+
+                    Rectangle {
+                        required property int documentId
+                        required property string filePath
+
+                        width: 140
+                        height: 30
+                        color: documentId === DocumentManager.currentDocumentId ? "#ffffff" : "#f4f4f4"
+                        border.color: "#e0e0e0"
+                        border.width: 1
+                        Text {
+                            anchors.fill: parent
+                            anchors.margins: 6
+                            verticalAlignment: Text.AlignVCenter
+                            text: filePath.substring(filePath.lastIndexOf("/") + 1)
+                            elide: Text.ElideMiddle
+                            color: "#2c3e50"
+                        }
+                        MouseArea {
+                            anchors.fill: parent
+                            onClicked: DocumentManager.activateDocument(documentId)
+                        }
                     }
                 }
             }
@@ -129,16 +210,46 @@ ApplicationWindow {
                 anchors.right: parent.right
                 anchors.bottom: parent.bottom
 
-                // Default content - simple text area for now
+                // Shown until a document is open
                 TextArea {
                     id: defaultEditor
                     anchors.fill: parent
+                    visible: !documentEditor.visible
                     text: "# Welcome to MDV-Qt\n\nYour markdown viewer application.\n\nOpen a .md file from the file explorer to get started."
                     font.family: "Monospace"
                     font.pixelSize: 14
                     selectByMouse: true
                     wrapMode: TextArea.Wrap
                 }
+
+                MarkdownEditor {
+                    id: documentEditor
+                    anchors.fill: parent
+                    visible: documentId >= 0
+
+                    onContentEdited: (documentId, position, removedLength, insertedText) => {
+                        DocumentManager.applyEdit(documentId, position, removedLength, insertedText);
+                    }
+
+                    onContentModified: (documentId, content) => {
+                        DocumentManager.updateDocumentContent(documentId, content);
+                    }
+
+                    onViewStateChanged: (documentId, cursorPosition, scrollPosition) => {
+                        DocumentManager.setViewState(documentId, cursorPosition, scrollPosition);
+                    }
+                }
+            }
+        }
+        
+        // Links of the current document
+        LinkPanel {
+            id: linkPanel
+            SplitView.preferredWidth: 220
+            SplitView.minimumWidth: 160
+            
+            onFileOpened: filePath => {
+                DocumentManager.openDocument(filePath);
             }
         }
     }
@@ -149,17 +260,74 @@ ApplicationWindow {
         title: "Open Markdown File"
         folder: Labs.StandardPaths.writableLocation(Labs.StandardPaths.DocumentsLocation)
         nameFilters: ["Markdown files (*.md *.markdown)", "All files (*)"]
-        onAccepted: documentManager.openDocument(fileDialog.file.toString().replace("file://", ""))
+        onAccepted: DocumentManager.openDocument(fileDialog.file.toString().replace("file://", ""))
         onRejected: console.log("File open dialog closed")
     }
 
+    // Broken links found by the last workspace check
+    Connections {
+        target: mainWindow.linkChecker
+        function onFinished(reportPath, brokenCount) {
+            linkCheckDialog.open()
+        }
+    }
+
+    Dialog {
+        id: linkCheckDialog
+        title: mainWindow.linkChecker
+               ? mainWindow.linkChecker.brokenCount + " broken links in "
+                 + mainWindow.linkChecker.documentCount + " documents"
+               : ""
+        anchors.centerIn: parent
+        width: Math.min(mainWindow.width * 0.8, 700)
+        height: Math.min(mainWindow.height * 0.8, 500)
+        modal: true
+        standardButtons: Dialog.Close
+
+        ListView {
+            anchors.fill: parent
+            clip: true
+            model: mainWindow.linkChecker ? mainWindow.linkChecker.issues : []
+
+            ScrollBar.vertical: ScrollBar { }
+
+            delegate: ItemDelegate {
+                required property var modelData
+
+                width: ListView.view.width
+
+                contentItem: Column {
+                    Label {
+                        text: modelData.target + (modelData.anchor !== "" ? "#" + modelData.anchor : "")
+                        elide: Text.ElideMiddle
+                        width: parent.width
+                        color: "#e74c3c"
+                    }
+                    Label {
+                        text: modelData.source + ":" + modelData.line + ":" + modelData.column
+                              + "  " + modelData.problem
+                        font.pixelSize: 11
+                        color: "#888888"
+                        elide: Text.ElideMiddle
+                        width: parent.width
+                    }
+                }
+
+                onClicked: {
+                    linkCheckDialog.close()
+                    DocumentManager.openDocument(modelData.source)
+                }
+            }
+        }
+    }
+
     // Save as dialog
     Labs.FileDialog {
         id: saveAsDialog
         title: "Save Markdown File As"
         folder: Labs.StandardPaths.writableLocation(Labs.StandardPaths.DocumentsLocation)
         nameFilters: ["Markdown files (*.md *.markdown)", "All files (*)"]
-        onAccepted: documentManager.saveDocumentAs(saveAsDialog.file.toString().replace("file://", ""))
+        onAccepted: DocumentManager.saveDocumentAs(saveAsDialog.file.toString().replace("file://", ""))
         onRejected: console.log("Save as dialog closed")
     }
     
@@ -169,19 +337,42 @@ ApplicationWindow {
         // For now, we'll just log the mode change
         console.log("Setting editor mode to:", mode);
     }
-    
-    // Component for markdown document tabs
-    Component {
-        id: documentTab
-        
-        MarkdownEditor {
-            id: editor
-            filePath: tabFilePath
-            content: tabContent
-            
-            onContentChanged: (filePath, content) => {
-                documentManager.updateDocumentContent(filePath, content);
+
+    function tabRow(documentId) {
+        for (var i = 0; i < openTabs.count; ++i) {
+            if (openTabs.get(i).documentId === documentId) {
+                return i
             }
         }
+        return -1
+    }
+
+    function addTab(documentId, filePath) {
+        if (tabRow(documentId) < 0) {
+            openTabs.append({ documentId: documentId, filePath: filePath })
+        }
+    }
+
+    // Puts the current document into the editor. Released or restored text
+    // is read back first and shown when documentLoaded arrives.
+    function showDocument(documentId) {
+        if (documentId !== DocumentManager.currentDocumentId) {
+            return
+        }
+        if (documentId < 0) {
+            documentEditor.documentId = -1
+            return
+        }
+        if (!DocumentManager.isDocumentLoaded(documentId)) {
+            return
+        }
+        var text = DocumentManager.getDocumentContent(documentId)
+        documentEditor.documentId = documentId
+        documentEditor.filePath = DocumentManager.documentPath(documentId)
+        if (documentEditor.content === text) {
+            documentEditor.loadContent()
+        } else {
+            documentEditor.content = text
+        }
     }
-}
\ No newline at end of file
+}
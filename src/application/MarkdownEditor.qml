@@ -7,11 +7,14 @@ Item {
     id: markdownEditor
     
     signal fileOpened(string filePath)
-    signal contentModified(string filePath, string content)
+    signal contentModified(int documentId, string content)
+    signal contentEdited(int documentId, int position, int removedLength, string insertedText)
+    signal viewStateChanged(int documentId, int cursorPosition, real scrollPosition)
     
     // Properties
+    property int documentId: -1
     property string filePath: ""
-    property string content: ""
+    property string content: ""       // Text as loaded; edits go to the store, not back here
     property int currentMode: 0  // 0: View only, 1: Edit only, 2: Split view
     property alias showToolbar: toolbar.visible
     
@@ -20,6 +23,11 @@ Item {
     readonly property bool isEditMode: currentMode === 1
     readonly property bool isSplitMode: currentMode === 2
     
+    // Set while the text areas are written from here rather than by typing
+    property bool loadingContent: false
+    // Text the preview is rendered from, refreshed once typing pauses
+    property string previewSource: ""
+    
     // Main layout
     ColumnLayout {
         anchors.fill: parent
@@ -135,6 +143,69 @@ Item {
             }
         }
         
+        // Find and replace in this document, backed by DocumentFinder
+        RowLayout {
+            id: findBar
+            Layout.fillWidth: true
+            Layout.margins: 4
+            visible: false
+            spacing: 4
+            
+            TextField {
+                id: findField
+                Layout.fillWidth: true
+                placeholderText: "Find"
+                onTextChanged: DocumentFinder.pattern = text
+                Keys.onReturnPressed: (event) => markdownEditor.findMatch(event.modifiers & Qt.ShiftModifier)
+                Keys.onEscapePressed: markdownEditor.closeFind()
+            }
+            
+            TextField {
+                id: replaceField
+                Layout.fillWidth: true
+                placeholderText: "Replace with"
+            }
+            
+            Label {
+                text: DocumentFinder.scanning ? "..."
+                      : DocumentFinder.matchCount === 0 ? "No matches"
+                      : (DocumentFinder.currentIndex + 1) + " of " + DocumentFinder.matchCount
+                color: "#888888"
+            }
+            
+            ToolButton {
+                text: "\u2191"
+                onClicked: markdownEditor.findMatch(true)
+            }
+            
+            ToolButton {
+                text: "\u2193"
+                onClicked: markdownEditor.findMatch(false)
+            }
+            
+            CheckBox {
+                text: "Aa"
+                checked: DocumentFinder.caseSensitive
+                onToggled: DocumentFinder.caseSensitive = checked
+            }
+            
+            Button {
+                text: "Replace All"
+                enabled: DocumentFinder.matchCount > 0 && !markdownEditor.isViewMode
+                onClicked: markdownEditor.replaceAll()
+            }
+            
+            ToolButton {
+                text: "\u2715"
+                onClicked: markdownEditor.closeFind()
+            }
+        }
+        
+        Shortcut {
+            sequence: StandardKey.Find
+            onActivated: markdownEditor.openFind()
+        }
+        
         // Main content area
         Item {
             Layout.fillWidth: true
@@ -172,19 +243,25 @@ Item {
                 
                 TextArea {
                     id: editTextArea
-                    text: markdownEditor.content
                     font.family: "Consolas, Monaco, 'Courier New', monospace"
                     font.pixelSize: 14
                     wrapMode: TextArea.Wrap
                     selectByMouse: true
                     
-                    // Update content when text changes
-                    onTextChanged: {
-                        if (markdownEditor.content !== text) {
-                            markdownEditor.content = text
-                            contentModified(markdownEditor.filePath, text)
-                        }
+                    // Text and selection before the next change, used to derive edits
+                    property string lastText: ""
+                    property int lastLength: 0
+                    property int lastSelectionStart: 0
+                    property int lastSelectionEnd: 0
+                    
+                    onCursorPositionChanged: {
+                        markdownEditor.rememberSelection(this);
+                        markdownEditor.reportViewState(this, editScrollView);
                     }
+                    onSelectionStartChanged: markdownEditor.rememberSelection(this)
+                    onSelectionEndChanged: markdownEditor.rememberSelection(this)
+                    
+                    onTextChanged: markdownEditor.textAreaChanged(this, splitEditTextArea)
                 }
             }
             
@@ -203,19 +280,25 @@ Item {
                     
                     TextArea {
                         id: splitEditTextArea
-                        text: markdownEditor.content
                         font.family: "Consolas, Monaco, 'Courier New', monospace"
                         font.pixelSize: 14
                         wrapMode: TextArea.Wrap
                         selectByMouse: true
                         
-                        // Update content when text changes
-                        onTextChanged: {
-                            if (markdownEditor.content !== text) {
-                                markdownEditor.content = text
-                                contentModified(markdownEditor.filePath, text)
-                            }
+                        // Text and selection before the next change, used to derive edits
+                        property string lastText: ""
+                        property int lastLength: 0
+                        property int lastSelectionStart: 0
+                        property int lastSelectionEnd: 0
+                        
+                        onCursorPositionChanged: {
+                            markdownEditor.rememberSelection(this);
+                            markdownEditor.reportViewState(this, splitEditScrollView);
                         }
+                        onSelectionStartChanged: markdownEditor.rememberSelection(this)
+                        onSelectionEndChanged: markdownEditor.rememberSelection(this)
+                        
+                        onTextChanged: markdownEditor.textAreaChanged(this, editTextArea)
                     }
                 }
                 
@@ -243,7 +326,7 @@ Item {
     readonly property string contentAsHtml: {
         // In a real implementation, we'd call the MarkdownRenderer
         // For now, we'll create a simple HTML representation
-        var html = markdownEditor.content
+        var html = markdownEditor.previewSource
             .replace(/&/g, '&amp;')
             .replace(/</g, '&lt;')
             .replace(/>/g, '&gt;')
@@ -262,6 +345,138 @@ Item {
         return '<div style="font-family: -apple-system, BlinkMacSystemFont, \'Segoe UI\', Roboto, sans-serif; padding: 20px; color: #2c3e50;">' + html + '</div>';
     }
     
+    Timer {
+        id: previewTimer
+        interval: 150
+        onTriggered: markdownEditor.previewSource = editTextArea.text
+    }
+    
+    // Put freshly loaded content into both text areas without reporting it
+    // as an edit
+    function loadContent() {
+        loadingContent = true;
+        editTextArea.text = content;
+        splitEditTextArea.text = content;
+        loadingContent = false;
+        previewTimer.stop();
+        previewSource = content;
+        restoreViewState();
+    }
+    
+    // Put the cursor and scroll position back where the document was left,
+    // once the text has been laid out
+    function restoreViewState() {
+        if (documentId < 0) {
+            return;
+        }
+        var id = documentId;
+        var state = DocumentManager.viewState(id);
+        var cursor = Math.min(state.cursorPosition, editTextArea.length);
+        loadingContent = true;
+        editTextArea.cursorPosition = cursor;
+        splitEditTextArea.cursorPosition = cursor;
+        loadingContent = false;
+        Qt.callLater(function() {
+            if (markdownEditor.documentId !== id) {
+                return;
+            }
+            viewOnlyScrollView.ScrollBar.vertical.position = state.scrollPosition;
+            editScrollView.ScrollBar.vertical.position = state.scrollPosition;
+            splitEditScrollView.ScrollBar.vertical.position = state.scrollPosition;
+        });
+    }
+    
+    // A keystroke is reported to the store as an edit and mirrored into the
+    // other text area, without copying the whole text
+    function textAreaChanged(area, mirror) {
+        if (!loadingContent) {
+            var edit = reportEdit(area);
+            loadingContent = true;
+            applyToArea(mirror, edit.position, edit.removed, edit.text);
+            loadingContent = false;
+            previewTimer.restart();
+        }
+        area.lastText = area.text;
+        area.lastLength = area.length;
+        rememberSelection(area);
+    }
+    
+    function applyToArea(area, position, removedLength, text) {
+        if (removedLength > 0) {
+            area.remove(position, position + removedLength);
+        }
+        if (text.length > 0) {
+            area.insert(position, text);
+        }
+    }
+    
+    // Track the selection so the next text change can be turned into an edit
+    function rememberSelection(area) {
+        if (area.length !== area.lastLength) {
+            return;  // Text change still pending, keep the pre-change state
+        }
+        area.lastSelectionStart = area.selectionStart;
+        area.lastSelectionEnd = area.selectionEnd;
+    }
+    
+    function reportViewState(area, scrollView) {
+        if (loadingContent) {
+            return;
+        }
+        viewStateChanged(documentId, area.cursorPosition, scrollView.ScrollBar.vertical.position);
+    }
+    
+    // Derive (position, removedLength, insertedText) from the pre-change
+    // selection and the new cursor position, and check it against the text
+    // before the change. Replacements of equal length and input method
+    // commits don't follow the selection; those are found by trimming the
+    // common prefix and suffix of the old and new text. Returns the edit.
+    function reportEdit(area) {
+        var before = area.lastText;
+        var after = area.text;
+        var delta = after.length - before.length;
+        var cursor = area.cursorPosition;
+        var position = area.lastSelectionStart;
+        var removed = area.lastSelectionEnd - area.lastSelectionStart;
+        var inserted = 0;
+        
+        if (removed > 0 || delta > 0) {
+            inserted = cursor - position;
+            removed = inserted - delta;
+        } else if (cursor < position) {
+            position = cursor;  // Backspace
+            removed = -delta;
+        } else {
+            removed = -delta;   // Delete
+        }
+        
+        if (position < 0 || removed < 0 || inserted < 0
+                || position + inserted > after.length
+                || position + removed > before.length
+                || before.substring(0, position) !== after.substring(0, position)
+                || before.substring(position + removed) !== after.substring(position + inserted)) {
+            var end = Math.min(before.length, after.length);
+            position = 0;
+            while (position < end && before.charCodeAt(position) === after.charCodeAt(position)) {
+                ++position;
+            }
+            var suffix = 0;
+            while (suffix < end - position
+                   && before.charCodeAt(before.length - 1 - suffix)
+                      === after.charCodeAt(after.length - 1 - suffix)) {
+                ++suffix;
+            }
+            removed = before.length - suffix - position;
+            inserted = after.length - suffix - position;
+        }
+        
+        var text = after.substring(position, position + inserted);
+        if (removed > 0 || inserted > 0) {
+            contentEdited(markdownEditor.documentId, position, removed, text);
+        }
+        return { position: position, removed: removed, text: text };
+    }
+    
     // Function to toggle editor mode
     function toggleEditorMode() {
         if (currentMode === 0) {  // View mode
@@ -354,9 +569,91 @@ Item {
         }
     }
     
+    // Read ahead the documents linked from the visible part of the text.
+    // The range is estimated from the scroll position, which also works
+    // for the rendered view.
+    function prefetchVisibleLinks(scrollView) {
+        if (documentId !== DocumentLinks.documentId || !scrollView.visible) {
+            return;
+        }
+        var bar = scrollView.ScrollBar.vertical;
+        var from = Math.floor(bar.position * previewSource.length);
+        var to = Math.ceil((bar.position + bar.size) * previewSource.length);
+        Prefetcher.setViewportTargets(DocumentLinks.targetsInRange(from, to));
+    }
+    
+    Connections {
+        target: viewOnlyScrollView.ScrollBar.vertical
+        function onPositionChanged() { markdownEditor.prefetchVisibleLinks(viewOnlyScrollView) }
+    }
+    
+    Connections {
+        target: editScrollView.ScrollBar.vertical
+        function onPositionChanged() { markdownEditor.prefetchVisibleLinks(editScrollView) }
+    }
+    
+    Connections {
+        target: splitEditScrollView.ScrollBar.vertical
+        function onPositionChanged() { markdownEditor.prefetchVisibleLinks(splitEditScrollView) }
+    }
+    
+    Connections {
+        target: DocumentLinks
+        function onCountChanged() {
+            markdownEditor.prefetchVisibleLinks(isViewMode ? viewOnlyScrollView
+                                                : isEditMode ? editScrollView
+                                                : splitEditScrollView)
+        }
+    }
+    
+    // The text area that edits are shown in, or null in view mode
+    function activeTextArea() {
+        return isEditMode ? editTextArea : isSplitMode ? splitEditTextArea : null;
+    }
+    
+    function openFind() {
+        DocumentFinder.documentId = documentId;
+        DocumentFinder.pattern = findField.text;
+        findBar.visible = true;
+        findField.forceActiveFocus();
+        findField.selectAll();
+    }
+    
+    function closeFind() {
+        findBar.visible = false;
+        DocumentFinder.pattern = "";
+    }
+    
+    function findMatch(backwards) {
+        var area = activeTextArea();
+        var from = area ? (backwards ? area.selectionStart : area.selectionEnd) : 0;
+        var position = backwards ? DocumentFinder.findPrevious(from)
+                                 : DocumentFinder.findNext(from);
+        if (position >= 0 && area) {
+            area.select(position, position + DocumentFinder.matchLength());
+        }
+    }
+    
+    // The store takes the replacement as one edit; the text areas are
+    // updated to match without reporting the change back
+    function replaceAll() {
+        var edit = DocumentFinder.replaceAll(replaceField.text);
+        if (edit.count === undefined) {
+            return;
+        }
+        loadingContent = true;
+        applyToArea(editTextArea, edit.position, edit.removedLength, edit.text);
+        applyToArea(splitEditTextArea, edit.position, edit.removedLength, edit.text);
+        loadingContent = false;
+        previewSource = editTextArea.text;
+    }
+    
     // Update content when file changes
+    onContentChanged: loadContent()
+    
     Component.onCompleted: {
         // Initialize with view mode
         currentMode = 0;
+        loadContent();
     }
 }
\ No newline at end of file
@@ -8,7 +8,6 @@ Item {
     height: 32
 
     property var modelData: null
-    property var fileSystemModel: null
     property bool isCurrentItem: false
     property int itemIndex: -1
     property var listView: null  // Reference to the parent ListView
@@ -77,7 +76,7 @@ Item {
             source: modelData.isFolder ?
                    (treeItemDelegate.listView && treeItemDelegate.listView.isExpanded(treeItemDelegate.itemIndex) ?
                        "qrc:/icons/folder-open.svg" : "qrc:/icons/folder.svg") :
-                   (fileSystemModel.isMarkdownFile(modelData.filePath) ?
+                   (FileSystemModel.isMarkdownFile(modelData.filePath) ?
                        "qrc:/icons/markdown.svg" : "qrc:/icons/document.svg")
             width: 16
             height: 16
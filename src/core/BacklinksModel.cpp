@@ -0,0 +1,79 @@
+// BacklinksModel.cpp
+#include "BacklinksModel.h"
+#include <QFileInfo>
+#include <algorithm>
+
+BacklinksModel::BacklinksModel(DocumentLinker *linker, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_linker(linker)
+{
+    connect(m_linker, &DocumentLinker::backlinksChanged, this, &BacklinksModel::refresh);
+}
+
+void BacklinksModel::setDocumentPath(const QString &documentPath)
+{
+    if (m_documentPath == documentPath) {
+        return;
+    }
+    m_documentPath = documentPath;
+    emit documentPathChanged();
+    refresh();
+}
+
+int BacklinksModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+QVariant BacklinksModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size()) {
+        return QVariant();
+    }
+
+    const DocumentLinker::LinkInfo &link = m_rows.at(index.row());
+    switch (role) {
+        case Qt::DisplayRole:
+        case TextRole:
+            return link.linkText;
+        case SourcePathRole:
+            return link.sourcePath;
+        case FileNameRole:
+            return QFileInfo(link.sourcePath).fileName();
+        case LineRole:
+            return link.line;
+        case ColumnRole:
+            return link.column;
+        default:
+            return QVariant();
+    }
+}
+
+QHash<int, QByteArray> BacklinksModel::roleNames() const
+{
+    return {
+        {SourcePathRole, "sourcePath"},
+        {FileNameRole, "fileName"},
+        {TextRole, "linkText"},
+        {LineRole, "line"},
+        {ColumnRole, "column"}
+    };
+}
+
+void BacklinksModel::refresh()
+{
+    QList<DocumentLinker::LinkInfo> rows;
+    if (!m_documentPath.isEmpty()) {
+        rows = m_linker->findBacklinks(m_documentPath);
+    }
+    // Grouped by source, in source order
+    std::stable_sort(rows.begin(), rows.end(),
+                     [](const DocumentLinker::LinkInfo &a, const DocumentLinker::LinkInfo &b) {
+        return a.sourcePath < b.sourcePath;
+    });
+
+    beginResetModel();
+    m_rows = rows;
+    endResetModel();
+    emit countChanged();
+}
@@ -0,0 +1,50 @@
+// BacklinksModel.h
+#ifndef BACKLINKSMODEL_H
+#define BACKLINKSMODEL_H
+
+#include <QAbstractListModel>
+#include <QList>
+
+#include "DocumentLinker.h"
+
+// The links from other workspace documents to one document, for the link
+// panel. They are read from the link graph, which is created the first
+// time a document path is set, and follow it as documents change.
+class BacklinksModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QString documentPath READ documentPath WRITE setDocumentPath
+                   NOTIFY documentPathChanged)
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+
+public:
+    enum Roles {
+        SourcePathRole = Qt::UserRole + 1,
+        FileNameRole,
+        TextRole,
+        LineRole,
+        ColumnRole
+    };
+
+    explicit BacklinksModel(DocumentLinker *linker, QObject *parent = nullptr);
+
+    QString documentPath() const { return m_documentPath; }
+    void setDocumentPath(const QString &documentPath);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void documentPathChanged();
+    void countChanged();
+
+private:
+    DocumentLinker *m_linker;
+    QString m_documentPath;
+    QList<DocumentLinker::LinkInfo> m_rows;
+
+    void refresh();
+};
+
+#endif // BACKLINKSMODEL_H
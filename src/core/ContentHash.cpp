@@ -0,0 +1,71 @@
+// ContentHash.cpp
+#include "ContentHash.h"
+#include <cstring>
+
+namespace {
+constexpr quint64 kMul1 = 0x87c37b91114253d5ULL;
+constexpr quint64 kMul2 = 0x4cf5ad432745937fULL;
+
+inline quint64 rotl(quint64 value, int shift)
+{
+    return (value << shift) | (value >> (64 - shift));
+}
+
+inline quint64 mix(quint64 key)
+{
+    key *= kMul1;
+    key = rotl(key, 31);
+    key *= kMul2;
+    return key;
+}
+
+// Final avalanche so that single-bit differences spread over the result
+inline quint64 finalize(quint64 hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+}
+
+namespace ContentHash {
+
+quint64 of(const void *data, qsizetype size, quint64 seed)
+{
+    const uchar *bytes = static_cast<const uchar *>(data);
+    quint64 hash = seed ^ (quint64(size) * kMul1);
+
+    // Eight bytes at a time; memcpy keeps the loads alignment-safe and
+    // compiles down to a single load
+    qsizetype blocks = size / 8;
+    for (qsizetype i = 0; i < blocks; ++i) {
+        quint64 key;
+        std::memcpy(&key, bytes + i * 8, sizeof(key));
+        hash ^= mix(key);
+        hash = rotl(hash, 27) * 5 + 0x52dce729;
+    }
+
+    quint64 tail = 0;
+    const uchar *rest = bytes + blocks * 8;
+    for (qsizetype i = size & 7; i > 0; --i) {
+        tail = (tail << 8) | rest[i - 1];
+    }
+    hash ^= mix(tail);
+
+    return finalize(hash);
+}
+
+quint64 of(QStringView text)
+{
+    return of(text.utf16(), text.size() * qsizetype(sizeof(char16_t)));
+}
+
+quint64 of(const QByteArray &data)
+{
+    return of(data.constData(), data.size());
+}
+
+}
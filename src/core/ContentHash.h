@@ -0,0 +1,18 @@
+// ContentHash.h
+#ifndef CONTENTHASH_H
+#define CONTENTHASH_H
+
+#include <QByteArray>
+#include <QStringView>
+
+// Fast non-cryptographic 64-bit hash used to tell whether document text
+// matches what was last loaded from or written to disk
+namespace ContentHash {
+
+quint64 of(const void *data, qsizetype size, quint64 seed = 0);
+quint64 of(QStringView text);
+quint64 of(const QByteArray &data);
+
+}
+
+#endif // CONTENTHASH_H
@@ -0,0 +1,231 @@
+// DocumentFinder.cpp
+#include "DocumentFinder.h"
+#include <QStringMatcher>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+
+DocumentFinder::DocumentFinder(DocumentStore *store, QObject *parent)
+    : QObject(parent)
+    , m_store(store)
+    , m_documentId(DocumentStore::InvalidId)
+    , m_caseSensitivity(Qt::CaseInsensitive)
+    , m_revision(0)
+    , m_currentIndex(-1)
+    , m_scanning(false)
+    , m_scanGeneration(0)
+{
+    connect(m_store, &DocumentStore::documentEdited, this, &DocumentFinder::onDocumentEdited);
+    connect(m_store, &DocumentStore::documentClosed, this, [this](int documentId) {
+        if (documentId == m_documentId) {
+            setDocumentId(DocumentStore::InvalidId);
+        }
+    });
+}
+
+void DocumentFinder::setDocumentId(int documentId)
+{
+    if (m_documentId == documentId) {
+        return;
+    }
+    m_documentId = documentId;
+    emit documentIdChanged();
+    scan();
+}
+
+void DocumentFinder::setPattern(const QString &pattern)
+{
+    if (m_pattern == pattern) {
+        return;
+    }
+    m_pattern = pattern;
+    emit patternChanged();
+    scan();
+}
+
+void DocumentFinder::setCaseSensitive(bool caseSensitive)
+{
+    Qt::CaseSensitivity caseSensitivity = caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    if (m_caseSensitivity == caseSensitivity) {
+        return;
+    }
+    m_caseSensitivity = caseSensitivity;
+    emit patternChanged();
+    scan();
+}
+
+int DocumentFinder::findNext(int position)
+{
+    if (!ensureCurrent()) {
+        return -1;
+    }
+    auto it = std::lower_bound(m_matches.cbegin(), m_matches.cend(), qsizetype(position));
+    setCurrentIndex(it == m_matches.cend() ? 0 : int(it - m_matches.cbegin()));
+    return matchPosition(m_currentIndex);
+}
+
+int DocumentFinder::findPrevious(int position)
+{
+    if (!ensureCurrent()) {
+        return -1;
+    }
+    auto it = std::lower_bound(m_matches.cbegin(), m_matches.cend(), qsizetype(position));
+    int index = int(it - m_matches.cbegin()) - 1;
+    setCurrentIndex(index < 0 ? m_matches.size() - 1 : index);
+    return matchPosition(m_currentIndex);
+}
+
+int DocumentFinder::matchPosition(int index) const
+{
+    return index >= 0 && index < m_matches.size() ? int(m_matches.at(index)) : -1;
+}
+
+QVariantMap DocumentFinder::replaceAll(const QString &replacement)
+{
+    if (!ensureCurrent()) {
+        return QVariantMap();
+    }
+
+    qsizetype length = m_pattern.size();
+    qsizetype first = m_matches.first();
+    qsizetype last = first;
+    for (qsizetype match : std::as_const(m_matches)) {
+        if (match >= last + length) {
+            last = match;
+        }
+    }
+    QString original = m_store->textRange(m_documentId, first, last + length - first);
+
+    // Build the replaced span once instead of mutating the text per match
+    QString text;
+    text.reserve(original.size());
+    qsizetype copied = 0;
+    int count = 0;
+    for (qsizetype match : std::as_const(m_matches)) {
+        qsizetype offset = match - first;
+        if (offset < copied) {
+            continue;
+        }
+        text += QStringView(original).mid(copied, offset - copied);
+        text += replacement;
+        copied = offset + length;
+        ++count;
+    }
+
+    if (!m_store->applyEdit(m_documentId, first, original.size(), text)) {
+        return QVariantMap();
+    }
+    return {
+        {"position", int(first)},
+        {"removedLength", int(original.size())},
+        {"text", text},
+        {"count", count}
+    };
+}
+
+QVector<qsizetype> DocumentFinder::findAll(QStringView text, const QString &pattern,
+                                           Qt::CaseSensitivity caseSensitivity, qsizetype base)
+{
+    QVector<qsizetype> matches;
+    if (pattern.isEmpty()) {
+        return matches;
+    }
+
+    // Boyer-Moore over the snapshot or range, without copying the text
+    QStringMatcher matcher(pattern, caseSensitivity);
+    for (qsizetype at = matcher.indexIn(text); at >= 0; at = matcher.indexIn(text, at + 1)) {
+        matches.append(base + at);
+    }
+    return matches;
+}
+
+void DocumentFinder::scan()
+{
+    ++m_scanGeneration;
+    m_matches.clear();
+    setCurrentIndex(-1);
+
+    if (m_pattern.isEmpty() || !m_store->isOpen(m_documentId)) {
+        m_scanning = false;
+        emit matchesChanged();
+        return;
+    }
+
+    m_scanning = true;
+    emit matchesChanged();
+
+    DocumentSnapshot snapshot = m_store->snapshot(m_documentId);
+    quint64 generation = m_scanGeneration;
+    QtConcurrent::run([snapshot, pattern = m_pattern, caseSensitivity = m_caseSensitivity]() {
+        return findAll(snapshot.text(), pattern, caseSensitivity);
+    }).then(this, [this, generation, snapshot](const QVector<qsizetype> &matches) {
+        if (generation != m_scanGeneration) {
+            return;
+        }
+        // Edited while scanning; the edits were not tracked
+        if (m_store->revision(m_documentId) != snapshot.revision()) {
+            scan();
+            return;
+        }
+        m_matches = matches;
+        m_revision = snapshot.revision();
+        m_scanning = false;
+        emit matchesChanged();
+    });
+}
+
+void DocumentFinder::onDocumentEdited(int documentId, quint64 revision, qsizetype position,
+                                      qsizetype removedLength, qsizetype insertedLength)
+{
+    if (documentId != m_documentId || m_scanning || m_pattern.isEmpty()) {
+        return;
+    }
+    if (revision != m_revision + 1) {
+        scan();
+        return;
+    }
+    m_revision = revision;
+
+    // Matches overlapping the removed range are gone; those behind it move
+    qsizetype length = m_pattern.size();
+    qsizetype delta = insertedLength - removedLength;
+    auto begin = std::upper_bound(m_matches.begin(), m_matches.end(), position - length);
+    auto end = std::lower_bound(begin, m_matches.end(), position + removedLength);
+    for (auto it = end; it != m_matches.end(); ++it) {
+        *it += delta;
+    }
+    qsizetype firstAffected = begin - m_matches.begin();
+    m_matches.erase(begin, end);
+
+    // Only matches touching the inserted text can be new
+    qsizetype from = qMax<qsizetype>(0, position - length + 1);
+    qsizetype to = qMin(m_store->length(m_documentId), position + insertedLength + length - 1);
+    if (to - from >= length) {
+        QVector<qsizetype> found = findAll(m_store->textRange(m_documentId, from, to - from),
+                                           m_pattern, m_caseSensitivity, from);
+        m_matches.insert(firstAffected, found.size(), 0);
+        std::copy(found.cbegin(), found.cend(), m_matches.begin() + firstAffected);
+    }
+
+    if (m_currentIndex >= m_matches.size()) {
+        setCurrentIndex(m_matches.isEmpty() ? -1 : m_matches.size() - 1);
+    }
+    emit matchesChanged();
+}
+
+bool DocumentFinder::ensureCurrent()
+{
+    if (!m_scanning && m_store->isOpen(m_documentId)
+        && m_store->revision(m_documentId) != m_revision) {
+        // Changed without an edit, e.g. reloaded from disk
+        scan();
+    }
+    return !m_scanning && !m_matches.isEmpty();
+}
+
+void DocumentFinder::setCurrentIndex(int index)
+{
+    if (m_currentIndex != index) {
+        m_currentIndex = index;
+        emit currentIndexChanged();
+    }
+}
@@ -0,0 +1,86 @@
+// DocumentFinder.h
+#ifndef DOCUMENTFINDER_H
+#define DOCUMENTFINDER_H
+
+#include <QObject>
+#include <QVariantMap>
+#include <QVector>
+
+#include "DocumentStore.h"
+
+// Find and replace within one open document. The offsets of every
+// occurrence of the pattern are kept sorted, so counting is free and
+// moving to the next or previous match is a binary search. The first scan
+// runs on a snapshot off the GUI thread; after that, each edit only
+// rescans the text around the changed range and shifts the offsets
+// behind it.
+//
+// Occurrences may overlap ("aa" occurs three times in "aaaa"); replacing
+// takes them left to right and skips those overlapping a replaced one.
+class DocumentFinder : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int documentId READ documentId WRITE setDocumentId NOTIFY documentIdChanged)
+    Q_PROPERTY(QString pattern READ pattern WRITE setPattern NOTIFY patternChanged)
+    Q_PROPERTY(bool caseSensitive READ caseSensitive WRITE setCaseSensitive NOTIFY patternChanged)
+    Q_PROPERTY(int matchCount READ matchCount NOTIFY matchesChanged)
+    Q_PROPERTY(int currentIndex READ currentIndex NOTIFY currentIndexChanged)
+    Q_PROPERTY(bool scanning READ isScanning NOTIFY matchesChanged)
+
+public:
+    explicit DocumentFinder(DocumentStore *store, QObject *parent = nullptr);
+
+    int documentId() const { return m_documentId; }
+    void setDocumentId(int documentId);
+
+    QString pattern() const { return m_pattern; }
+    void setPattern(const QString &pattern);
+    bool caseSensitive() const { return m_caseSensitivity == Qt::CaseSensitive; }
+    void setCaseSensitive(bool caseSensitive);
+
+    int matchCount() const { return m_matches.size(); }
+    int currentIndex() const { return m_currentIndex; }
+    bool isScanning() const { return m_scanning; }
+
+    // Select the first match at or after, or the last one before, a
+    // position, wrapping around. Return the offset of the match or -1.
+    Q_INVOKABLE int findNext(int position);
+    Q_INVOKABLE int findPrevious(int position);
+    Q_INVOKABLE int matchPosition(int index) const;
+    Q_INVOKABLE int matchLength() const { return m_pattern.size(); }
+
+    // Replaces every non-overlapping match with a single edit of the store
+    // spanning the first to the last match. Returns the edit
+    // (position, removedLength, text) and the number of replacements, so
+    // an editor can apply the same change to its own copy of the text.
+    Q_INVOKABLE QVariantMap replaceAll(const QString &replacement);
+
+    static QVector<qsizetype> findAll(QStringView text, const QString &pattern,
+                                      Qt::CaseSensitivity caseSensitivity, qsizetype base = 0);
+
+signals:
+    void documentIdChanged();
+    void patternChanged();
+    void matchesChanged();
+    void currentIndexChanged();
+
+private:
+    DocumentStore *m_store;
+    int m_documentId;
+    QString m_pattern;
+    Qt::CaseSensitivity m_caseSensitivity;
+
+    QVector<qsizetype> m_matches;  // Ascending offsets
+    quint64 m_revision;            // The matches are valid for this revision
+    int m_currentIndex;
+    bool m_scanning;
+    quint64 m_scanGeneration;
+
+    void scan();
+    void onDocumentEdited(int documentId, quint64 revision, qsizetype position,
+                          qsizetype removedLength, qsizetype insertedLength);
+    bool ensureCurrent();
+    void setCurrentIndex(int index);
+};
+
+#endif // DOCUMENTFINDER_H
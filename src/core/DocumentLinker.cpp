@@ -1,8 +1,7 @@
 // DocumentLinker.cpp
 #include "DocumentLinker.h"
+#include "WorkspaceWatcher.h"
 #include <QFile>
-#include <QTextStream>
-#include <QRegularExpression>
 #include <QDir>
 #include <QFileInfo>
 #include <QDebug>
@@ -10,114 +9,59 @@
 DocumentLinker::DocumentLinker(QObject *parent)
     : QObject(parent)
     , m_navigationIndex(0)
+    , m_store(nullptr)
 {
 }
 
 QList<DocumentLinker::LinkInfo> DocumentLinker::findInternalLinks(const QString &documentPath) const
 {
-    QList<LinkInfo> links;
-    
-    QFile file(documentPath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return links;
+    // The file of an open document may be behind its unsaved edits. A
+    // document whose text is released and being read back uses the file.
+    int documentId = m_store ? m_store->documentId(documentPath) : DocumentStore::InvalidId;
+    if (documentId != DocumentStore::InvalidId) {
+        DocumentSnapshot snapshot = m_store->snapshot(documentId);
+        if (!snapshot.isNull()) {
+            return toLinkInfos(documentPath,
+                               LinkExtractor::extract(documentPath, snapshot.text()));
+        }
     }
     
-    QTextStream in(&file);
-    QString content = in.readAll();
-    file.close();
-    
-    // Regular expression to match markdown links [text](path)
-    QRegularExpression linkRegex(R"(\[([^\]]+)\]\(([^)]+)\))");
-    QRegularExpressionMatchIterator iter = linkRegex.globalMatch(content);
-    
-    int lineNum = 1;
-    int pos = 0;
-    
-    // Calculate line numbers as we go
-    QStringList lines = content.split('\n');
-    int currentLineStart = 0;
-    
-    while (iter.hasNext()) {
-        QRegularExpressionMatch match = iter.next();
-        QString linkText = match.captured(1);
-        QString linkPath = match.captured(2);
-        
-        // Find which line this match is on
-        int matchPos = match.capturedStart();
-        for (int i = 0; i < lines.size(); ++i) {
-            int lineEnd = currentLineStart + lines[i].length() + 1; // +1 for newline
-            if (matchPos >= currentLineStart && matchPos < lineEnd) {
-                lineNum = i + 1;
-                break;
-            }
-            currentLineStart = lineEnd;
-        }
-        
-        // Only consider internal links (not external URLs)
-        if (!linkPath.startsWith("http://") && !linkPath.startsWith("https://")) {
-            LinkInfo linkInfo;
-            linkInfo.sourcePath = documentPath;
-            linkInfo.targetPath = resolveRelativeLink(documentPath, linkPath);
-            linkInfo.linkText = linkText;
-            linkInfo.line = lineNum;
-            links.append(linkInfo);
-        }
+    auto cached = m_forwardLinks.constFind(documentPath);
+    if (cached != m_forwardLinks.constEnd()) {
+        return *cached;
     }
     
+    QFile file(documentPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QList<LinkInfo>();
+    }
+    QList<LinkInfo> links = toLinkInfos(
+        documentPath, LinkExtractor::extract(documentPath, QString::fromUtf8(file.readAll())));
+    m_forwardLinks.insert(documentPath, links);
     return links;
 }
 
-QList<DocumentLinker::LinkInfo> DocumentLinker::findBacklinks(const QString &documentPath) const
-{
-    QList<LinkInfo> backlinks;
-    
-    // In a full implementation, this would search all documents in the workspace
-    // For now, we'll return an empty list
-    // This would require maintaining an index of all documents and their links
-    
-    return backlinks;
-}
-
-DocumentLinker::DocumentHierarchy DocumentLinker::buildHierarchy(const QString &rootPath) const
+QList<DocumentLinker::LinkInfo> DocumentLinker::findBacklinks(const QString &documentPath)
 {
-    DocumentHierarchy root;
-    root.path = rootPath;
-    root.title = QFileInfo(rootPath).fileName();
-    root.lastModified = QFileInfo(rootPath).lastModified();
-    
-    QDir dir(rootPath);
-    QFileInfoList entries = dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot, QDir::Name);
-    
-    for (const QFileInfo &entry : entries) {
-        if (entry.isDir()) {
-            DocumentHierarchy child = buildHierarchy(entry.filePath());
-            root.children.append(child);
-        } else if (entry.suffix().toLower() == "md") {
-            DocumentHierarchy child;
-            child.path = entry.filePath();
-            child.title = entry.fileName();
-            child.lastModified = entry.lastModified();
-            // Don't add child.children since it's a file
-            root.children.append(child);
-        }
+    if (!m_linkGraph) {
+        emit linkGraphNeeded();
     }
-    
-    return root;
+    if (!m_linkGraph) {
+        return QList<LinkInfo>();
+    }
+    return toLinkInfos(m_linkGraph->backlinks(QDir::cleanPath(documentPath)));
 }
 
 QString DocumentLinker::resolveRelativeLink(const QString &sourcePath, const QString &link) const
 {
-    QFileInfo sourceInfo(sourcePath);
-    QDir sourceDir = sourceInfo.dir();
-    
-    // Handle absolute paths
-    if (link.startsWith('/')) {
-        // Absolute from root of file system or project
-        return link;
+    // Same resolution as the link panel, graph and checker: titles and
+    // fragments are dropped, external URLs resolve to nothing
+    QString target;
+    QString anchor;
+    if (!LinkExtractor::resolve(sourcePath, link, &target, &anchor)) {
+        return QString();
     }
-    
-    // Handle relative paths
-    return sourceDir.filePath(link);
+    return target;
 }
 
 bool DocumentLinker::createLink(const QString &sourcePath, const QString &targetPath)
@@ -131,8 +75,67 @@ bool DocumentLinker::createLink(const QString &sourcePath, const QString &target
     return true;
 }
 
+void DocumentLinker::setDocumentStore(DocumentStore *store)
+{
+    m_store = store;
+}
+
+void DocumentLinker::setLinkGraph(LinkGraph *graph)
+{
+    if (m_linkGraph) {
+        disconnect(m_linkGraph, nullptr, this, nullptr);
+    }
+    m_linkGraph = graph;
+    if (m_linkGraph) {
+        connect(m_linkGraph, &LinkGraph::linksChanged, this, [this](const QStringList &sources) {
+            for (const QString &source : sources) {
+                m_forwardLinks.remove(source);
+            }
+        });
+        connect(m_linkGraph, &LinkGraph::graphChanged, this, &DocumentLinker::backlinksChanged);
+    }
+}
+
+void DocumentLinker::setWorkspaceWatcher(WorkspaceWatcher *watcher)
+{
+    watcher->subscribe(QString(), this, [this](const QVector<WorkspaceEvent> &events) {
+        onWorkspaceEvents(events);
+    });
+}
+
+void DocumentLinker::onWorkspaceEvents(const QVector<WorkspaceEvent> &events)
+{
+    bool structureChanged = false;
+    for (const WorkspaceEvent &event : events) {
+        if (event.type == WorkspaceEvent::Rescan) {
+            m_forwardLinks.clear();
+            structureChanged = true;
+            continue;
+        }
+        
+        updateLinkCache(event.path);
+        if (!event.oldPath.isEmpty()) {
+            m_forwardLinks.remove(event.oldPath);
+        }
+        
+        bool markdown = event.path.endsWith(".md", Qt::CaseInsensitive);
+        if (event.type != WorkspaceEvent::Modified && (markdown || event.isDirectory)) {
+            structureChanged = true;
+        }
+    }
+    
+    if (structureChanged) {
+        emit hierarchyChanged();
+    }
+}
+
 void DocumentLinker::addToHistory(const QString &path)
 {
+    // Reopening the current page, e.g. after navigating back to it
+    if (m_navigationIndex > 0 && m_navigationStack[m_navigationIndex - 1] == path) {
+        return;
+    }
+    
     // Remove any forward history since we're adding a new path
     while (m_navigationStack.size() > m_navigationIndex) {
         m_navigationStack.pop();
@@ -174,8 +177,45 @@ bool DocumentLinker::canNavigateForward() const
     return m_navigationIndex < m_navigationStack.size(); // Can go forward if we're not at the last item
 }
 
+QString DocumentLinker::backPath() const
+{
+    return canNavigateBack() ? m_navigationStack[m_navigationIndex - 2] : QString();
+}
+
+QString DocumentLinker::forwardPath() const
+{
+    return canNavigateForward() ? m_navigationStack[m_navigationIndex] : QString();
+}
+
 void DocumentLinker::updateLinkCache(const QString &documentPath)
 {
-    // In a full implementation, this would update the cached links for a document
-    // and also update backlink references to this document
-}
\ No newline at end of file
+    m_forwardLinks.remove(documentPath);
+    
+    // Parsed right away instead of after the workspace index catches up;
+    // the graph skips files outside the workspace
+    if (m_linkGraph) {
+        m_linkGraph->updateDocument(documentPath);
+    }
+}
+
+QList<DocumentLinker::LinkInfo> DocumentLinker::toLinkInfos(
+    const QString &sourcePath, const QVector<LinkExtractor::Link> &links)
+{
+    QList<LinkInfo> infos;
+    infos.reserve(links.size());
+    for (const LinkExtractor::Link &link : links) {
+        infos.append({sourcePath, link.target, link.text, link.line, link.column, link.kind,
+                      link.anchor});
+    }
+    return infos;
+}
+
+QList<DocumentLinker::LinkInfo> DocumentLinker::toLinkInfos(const QVector<LinkGraph::Link> &links)
+{
+    QList<LinkInfo> infos;
+    infos.reserve(links.size());
+    for (const LinkGraph::Link &link : links) {
+        infos.append({link.source, link.target, link.text, link.line, link.column, link.kind});
+    }
+    return infos;
+}
@@ -7,6 +7,13 @@
 #include <QHash>
 #include <QList>
 #include <QDateTime>
+#include <QPointer>
+
+#include "DocumentStore.h"
+#include "LinkGraph.h"
+
+class WorkspaceWatcher;
+struct WorkspaceEvent;
 
 class DocumentLinker : public QObject
 {
@@ -20,41 +27,56 @@ public:
         QString targetPath;
         QString linkText;
         int line; // Line number in source file
+        int column = 0;
+        LinkExtractor::Kind kind = LinkExtractor::File;
+        QString anchor;
     };
     
-    struct DocumentHierarchy {
-        QString path;
-        QString title;
-        QList<DocumentHierarchy> children;
-        QDateTime lastModified;
-    };
-    
+    // Open documents are read from their current text, edits included
     QList<LinkInfo> findInternalLinks(const QString &documentPath) const;
-    QList<LinkInfo> findBacklinks(const QString &documentPath) const;
-    DocumentHierarchy buildHierarchy(const QString &rootPath) const;
+    // Asks for the link graph through linkGraphNeeded() on first use;
+    // empty until it is loaded, then backlinksChanged() is emitted
+    QList<LinkInfo> findBacklinks(const QString &documentPath);
     
     QString resolveRelativeLink(const QString &sourcePath, const QString &link) const;
     bool createLink(const QString &sourcePath, const QString &targetPath);
     
+    void setDocumentStore(DocumentStore *store);
+    // Backlinks come from the graph
+    void setLinkGraph(LinkGraph *graph);
+    
+    // Drop cached links of files changed on disk
+    void setWorkspaceWatcher(WorkspaceWatcher *watcher);
+    
     // Navigation history
     void addToHistory(const QString &path);
     QString navigateBack();
     QString navigateForward();
     bool canNavigateBack() const;
     bool canNavigateForward() const;
+    // The paths navigateBack() and navigateForward() would return, or empty
+    QString backPath() const;
+    QString forwardPath() const;
     
 signals:
     void linksFound(const QList<LinkInfo> &links);
     void hierarchyChanged();
     void navigationHistoryChanged();
+    void linkGraphNeeded();
+    void backlinksChanged();
     
 private:
     QStack<QString> m_navigationStack;
     int m_navigationIndex;
-    QHash<QString, QList<LinkInfo>> m_forwardLinks;
-    QHash<QString, QList<LinkInfo>> m_backLinks;
+    mutable QHash<QString, QList<LinkInfo>> m_forwardLinks;  // Files not open, by path
+    DocumentStore *m_store;
+    QPointer<LinkGraph> m_linkGraph;
     
     void updateLinkCache(const QString &documentPath);
+    void onWorkspaceEvents(const QVector<WorkspaceEvent> &events);
+    static QList<LinkInfo> toLinkInfos(const QString &sourcePath,
+                                       const QVector<LinkExtractor::Link> &links);
+    static QList<LinkInfo> toLinkInfos(const QVector<LinkGraph::Link> &links);
 };
 
 #endif // DOCUMENTLINKER_H
\ No newline at end of file
@@ -0,0 +1,201 @@
+// DocumentLinksModel.cpp
+#include "DocumentLinksModel.h"
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+
+DocumentLinksModel::DocumentLinksModel(DocumentStore *store, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_store(store)
+    , m_documentId(DocumentStore::InvalidId)
+    , m_revision(0)
+    , m_generation(0)
+{
+    // Re-extracted once typing pauses, not on every keystroke
+    m_extractTimer = new QTimer(this);
+    m_extractTimer->setSingleShot(true);
+    m_extractTimer->setInterval(150);
+    connect(m_extractTimer, &QTimer::timeout, this, &DocumentLinksModel::extract);
+
+    connect(m_store, &DocumentStore::documentEdited, this, [this](int documentId) {
+        if (documentId == m_documentId) {
+            m_extractTimer->start();
+        }
+    });
+    connect(m_store, &DocumentStore::documentRenamed, this, [this](int documentId) {
+        if (documentId == m_documentId) {
+            // Relative targets resolve against the new location
+            m_revision = 0;
+            extract();
+        }
+    });
+    connect(m_store, &DocumentStore::documentClosed, this, [this](int documentId) {
+        if (documentId == m_documentId) {
+            setDocumentId(DocumentStore::InvalidId);
+        }
+    });
+    // Released text is read back in the background
+    connect(m_store, &DocumentStore::residencyChanged, this,
+            [this](int documentId, DocumentStore::Residency residency) {
+        if (documentId == m_documentId && residency == DocumentStore::Resident) {
+            extract();
+        }
+    });
+}
+
+void DocumentLinksModel::setDocumentId(int documentId)
+{
+    if (m_documentId == documentId) {
+        return;
+    }
+    m_documentId = documentId;
+    m_revision = 0;
+    emit documentIdChanged();
+    extract();
+}
+
+int DocumentLinksModel::brokenCount() const
+{
+    return int(std::count_if(m_rows.cbegin(), m_rows.cend(),
+                             [](const Row &row) { return !row.exists; }));
+}
+
+QString DocumentLinksModel::targetPath(int row) const
+{
+    if (row < 0 || row >= m_rows.size()) {
+        return QString();
+    }
+    return m_rows.at(row).link.target;
+}
+
+int DocumentLinksModel::position(int row) const
+{
+    if (row < 0 || row >= m_rows.size()) {
+        return -1;
+    }
+    return int(m_rows.at(row).link.position);
+}
+
+QStringList DocumentLinksModel::targetsInRange(int from, int to) const
+{
+    // Rows are in text order
+    auto it = std::lower_bound(m_rows.cbegin(), m_rows.cend(), qsizetype(from),
+                               [](const Row &row, qsizetype position) {
+        return row.link.position + row.link.length <= position;
+    });
+
+    QStringList targets;
+    for (; it != m_rows.cend() && it->link.position < to; ++it) {
+        if (it->link.kind == LinkExtractor::File && it->exists
+            && !targets.contains(it->link.target)) {
+            targets.append(it->link.target);
+        }
+    }
+    return targets;
+}
+
+int DocumentLinksModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+QVariant DocumentLinksModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size()) {
+        return QVariant();
+    }
+
+    const Row &row = m_rows.at(index.row());
+    switch (role) {
+        case Qt::DisplayRole:
+        case TextRole:
+            return row.link.text;
+        case TargetPathRole:
+            return row.link.target;
+        case FileNameRole:
+            return QFileInfo(row.link.target).fileName();
+        case AnchorRole:
+            return row.link.anchor;
+        case KindRole:
+            return LinkExtractor::kindName(row.link.kind);
+        case LineRole:
+            return row.link.line;
+        case ColumnRole:
+            return row.link.column;
+        case PositionRole:
+            return int(row.link.position);
+        case LengthRole:
+            return int(row.link.length);
+        case ExistsRole:
+            return row.exists;
+        default:
+            return QVariant();
+    }
+}
+
+QHash<int, QByteArray> DocumentLinksModel::roleNames() const
+{
+    return {
+        {TargetPathRole, "targetPath"},
+        {FileNameRole, "fileName"},
+        {AnchorRole, "anchor"},
+        {TextRole, "linkText"},
+        {KindRole, "kind"},
+        {LineRole, "line"},
+        {ColumnRole, "column"},
+        {PositionRole, "position"},
+        {LengthRole, "length"},
+        {ExistsRole, "exists"}
+    };
+}
+
+void DocumentLinksModel::extract()
+{
+    m_extractTimer->stop();
+    ++m_generation;
+
+    if (!m_store->isOpen(m_documentId)) {
+        setRows({});
+        return;
+    }
+
+    DocumentSnapshot snapshot = m_store->snapshot(m_documentId);
+    if (snapshot.isNull()) {
+        // Released; extracted again once the text is back
+        if (m_revision == 0) {
+            setRows({});
+        }
+        return;
+    }
+    if (m_revision != 0 && snapshot.revision() == m_revision) {
+        return;
+    }
+
+    // The existence checks stat each target, so they run with the extraction
+    quint64 generation = m_generation;
+    QtConcurrent::run([snapshot]() {
+        QVector<Row> rows;
+        const QVector<LinkExtractor::Link> links =
+            LinkExtractor::extract(snapshot.path(), snapshot.text());
+        rows.reserve(links.size());
+        for (const LinkExtractor::Link &link : links) {
+            rows.append({link, link.kind == LinkExtractor::Anchor
+                                   || QFileInfo::exists(link.target)});
+        }
+        return rows;
+    }).then(this, [this, generation, snapshot](const QVector<Row> &rows) {
+        if (generation != m_generation) {
+            return;
+        }
+        m_revision = snapshot.revision();
+        setRows(rows);
+    });
+}
+
+void DocumentLinksModel::setRows(const QVector<Row> &rows)
+{
+    beginResetModel();
+    m_rows = rows;
+    endResetModel();
+    emit countChanged();
+}
@@ -0,0 +1,73 @@
+// DocumentLinksModel.h
+#ifndef DOCUMENTLINKSMODEL_H
+#define DOCUMENTLINKSMODEL_H
+
+#include <QAbstractListModel>
+#include <QTimer>
+#include <QVector>
+
+#include "DocumentStore.h"
+#include "LinkExtractor.h"
+
+// The links of one open document, for the link panel. They are extracted
+// from a snapshot of the document off the GUI thread, again shortly after
+// each pause in typing, so the panel follows unsaved edits.
+class DocumentLinksModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int documentId READ documentId WRITE setDocumentId NOTIFY documentIdChanged)
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+    Q_PROPERTY(int brokenCount READ brokenCount NOTIFY countChanged)
+
+public:
+    enum Roles {
+        TargetPathRole = Qt::UserRole + 1,
+        FileNameRole,
+        AnchorRole,
+        TextRole,
+        KindRole,       // "file", "anchor" or "image"
+        LineRole,
+        ColumnRole,
+        PositionRole,
+        LengthRole,
+        ExistsRole      // The target file exists; always true for anchors
+    };
+
+    explicit DocumentLinksModel(DocumentStore *store, QObject *parent = nullptr);
+
+    int documentId() const { return m_documentId; }
+    void setDocumentId(int documentId);
+
+    int brokenCount() const;
+
+    Q_INVOKABLE QString targetPath(int row) const;
+    Q_INVOKABLE int position(int row) const;
+    // Existing files linked from [from, to), in text order, each once
+    Q_INVOKABLE QStringList targetsInRange(int from, int to) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void documentIdChanged();
+    void countChanged();
+
+private:
+    struct Row {
+        LinkExtractor::Link link;
+        bool exists = true;
+    };
+
+    DocumentStore *m_store;
+    int m_documentId;
+    quint64 m_revision;           // The rows are from this revision
+    quint64 m_generation;
+    QVector<Row> m_rows;
+    QTimer *m_extractTimer;
+
+    void extract();
+    void setRows(const QVector<Row> &rows);
+};
+
+#endif // DOCUMENTLINKSMODEL_H
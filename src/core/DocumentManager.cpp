@@ -1,135 +1,279 @@
 // DocumentManager.cpp
 #include "DocumentManager.h"
 #include <QDir>
-#include <QStandardPaths>
 #include <QFileInfo>
 #include <QDebug>
 
-DocumentManager::DocumentManager(QObject *parent)
+DocumentManager::DocumentManager(DocumentStore *store, FileIoService *io,
+                                 WorkspaceWatcher *workspace, QObject *parent)
     : QObject(parent)
+    , m_store(store)
+    , m_io(io)
+    , m_hydrationPaused(false)
+    , m_currentDocument(DocumentStore::InvalidId)
     , m_autoSaveEnabled(true)
     , m_autoSaveInterval(3) // 3 seconds
 {
+    // Auto-save is armed by edits and fires once; an idle editor has no
+    // timer running at all
     m_autoSaveTimer = new QTimer(this);
+    m_autoSaveTimer->setSingleShot(true);
     m_autoSaveTimer->setInterval(m_autoSaveInterval * 1000);
     connect(m_autoSaveTimer, &QTimer::timeout, this, &DocumentManager::autoSave);
     
-    m_fileWatcher = new QFileSystemWatcher(this);
-    connect(m_fileWatcher, &QFileSystemWatcher::fileChanged, [this](const QString &path) {
-        // Handle external file changes
-        // For now, just emit a signal
+    m_changeMonitor = new FileChangeMonitor(m_store, m_io, workspace, this);
+    connect(m_changeMonitor, &FileChangeMonitor::documentReloaded, this, [this](int documentId) {
+        // The file on disk is the new recovery base
+        m_journal->begin(documentId);
+        emit documentReloaded(documentId);
+    });
+    connect(m_changeMonitor, &FileChangeMonitor::documentConflict, this,
+            [this](int documentId, const QString &path) {
         emit errorOccurred("File changed externally: " + path);
+        emit documentConflict(documentId);
+    });
+    connect(m_changeMonitor, &FileChangeMonitor::fileRemoved, this,
+            [this](int, const QString &path) {
+        emit errorOccurred("File removed externally: " + path);
+    });
+    
+    connect(m_store, &DocumentStore::documentEdited, this,
+            [this](int documentId, quint64 revision, qsizetype position,
+                   qsizetype removedLength, qsizetype insertedLength) {
+        emit documentEdited(documentId, revision, position, removedLength, insertedLength);
+        emit documentModified(documentId);
+        scheduleAutoSave();
+    });
+    connect(m_store, &DocumentStore::documentClosed, this, &DocumentManager::onStoreDocumentClosed);
+    
+    m_journal = new EditJournal(m_store, m_io, this);
+    
+    m_memoryBudget = new MemoryBudget(m_store, m_io, this);
+    connect(m_memoryBudget, &MemoryBudget::documentRehydrated, this,
+            &DocumentManager::onDocumentRehydrated);
+    connect(m_memoryBudget, &MemoryBudget::restoreFailed, this,
+            [this](int documentId, const QString &errorString) {
+        emit errorOccurred("Could not read document: " + errorString);
+        m_pendingWrites.remove(documentId);
+        // Not retried in the background; activating the tab tries again
+        if (m_placeholders.contains(documentId)) {
+            m_unreadable.insert(documentId);
+            m_hydrateTimer->start();
+        }
+    });
+    connect(m_store, &DocumentStore::residencyFailed, this,
+            [this](int, const QString &errorString) {
+        emit errorOccurred("Could not read document: " + errorString);
+    });
+    
+    m_session = new SessionStore(m_io, this);
+    
+    // Restored tabs are read one at a time with gaps in between, so the
+    // active tab and user input are never queued behind them
+    m_hydrateTimer = new QTimer(this);
+    m_hydrateTimer->setSingleShot(true);
+    m_hydrateTimer->setInterval(50);
+    connect(m_hydrateTimer, &QTimer::timeout, this, &DocumentManager::hydrateNext);
+    // Hydration paused at the budget resumes once memory is released
+    connect(m_store, &DocumentStore::residencyChanged, this,
+            [this](int, DocumentStore::Residency residency) {
+        if (residency != DocumentStore::Resident) {
+            resumeHydration();
+        }
+    });
+    connect(m_store, &DocumentStore::documentClosed, this, [this]() {
+        resumeHydration();
     });
     
     m_settings = new QSettings(this);
     
     // Load recent documents
     m_recentDocuments = m_settings->value("recentDocuments", QStringList()).toStringList();
-    
-    // Start auto-save timer if enabled
-    if (m_autoSaveEnabled) {
-        m_autoSaveTimer->start();
-    }
 }
 
 bool DocumentManager::openDocument(const QString &filePath)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        emit errorOccurred("Could not open file: " + file.errorString());
+    if (filePath.isEmpty()) {
+        emit errorOccurred("No file path specified for open");
         return false;
     }
-
-    QTextStream in(&file);
-    QString content = in.readAll();
-    file.close();
-
-    m_documents[filePath] = content;
-    m_modifiedStatus[filePath] = false;
-    m_currentDocument = filePath;
-    
-    // Update recent documents
-    updateRecentDocuments(filePath);
     
-    // Start watching this file for external changes
-    startWatchingFile(filePath);
+    auto opened = [this, filePath](const FileIoService::Result &result) {
+        if (!result.success) {
+            emit errorOccurred("Could not open file: " + result.errorString);
+            return;
+        }
+        
+        QString diskContent = result.content;
+        restoreFromBackup(filePath, diskContent)
+            .then(this, [this, filePath, diskContent, result](const EditJournal::Recovery &recovery) {
+                int id = m_store->open(filePath, diskContent, result.contentHash);
+                if (recovery.recovered) {
+                    // Edits from a session that ended before they were saved
+                    m_store->setContent(id, recovery.content);
+                }
+                m_journal->begin(id);
+                m_memoryBudget->activate(id);
+                m_session->documentOpened(filePath, result.contentHash);
+                m_session->setActive(filePath);
+                m_currentDocument = id;
+                
+                // Update recent documents
+                updateRecentDocuments(filePath);
+                
+                // Start watching this file for external changes
+                startWatchingFile(filePath);
+                m_changeMonitor->noteFileState(result);
+                
+                emit documentOpened(id, filePath, m_store->content(id));
+                if (recovery.recovered) {
+                    emit documentRecovered(id);
+                }
+                emit currentDocumentChanged();
+            });
+    };
     
-    emit documentOpened(filePath, content);
-    emit currentDocumentChanged();
+    // A link target read ahead while idle skips the disk
+    FileIoService::Result prefetched;
+    if (m_prefetcher && m_prefetcher->take(filePath, &prefetched)) {
+        opened(prefetched);
+    } else {
+        m_io->readFile(filePath).then(this, opened);
+    }
     
     return true;
 }
 
+void DocumentManager::setPrefetcher(Prefetcher *prefetcher)
+{
+    m_prefetcher = prefetcher;
+}
+
 bool DocumentManager::saveDocument(const QString &filePath)
 {
-    QString path = filePath.isEmpty() ? m_currentDocument : filePath;
-    
-    if (path.isEmpty()) {
-        emit errorOccurred("No file path specified for save");
-        return false;
+    if (filePath.isEmpty()) {
+        if (m_currentDocument == DocumentStore::InvalidId) {
+            emit errorOccurred("No file path specified for save");
+            return false;
+        }
+        return saveDocument(m_currentDocument);
     }
     
-    if (!m_documents.contains(path)) {
-        emit errorOccurred("Document not loaded: " + path);
+    int id = m_store->documentId(filePath);
+    if (id == DocumentStore::InvalidId) {
+        emit errorOccurred("Document not loaded: " + filePath);
         return false;
     }
-    
-    QFile file(path);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        emit errorOccurred("Could not save file: " + file.errorString());
+    return saveDocument(id);
+}
+
+bool DocumentManager::saveDocument(int documentId)
+{
+    if (!m_store->isOpen(documentId)) {
+        emit errorOccurred("Document not loaded: " + QString::number(documentId));
         return false;
     }
     
-    QTextStream out(&file);
-    out << m_documents[path];
-    file.close();
+    return writeDocument(documentId, false);
+}
+
+bool DocumentManager::writeDocument(int documentId, bool autoSaved)
+{
+    // Announced before the write is queued, so the change monitor knows the
+    // file's new content however long the write takes
+    DocumentSnapshot snapshot = m_store->snapshot(documentId);
+    if (snapshot.isNull()) {
+        // Released text is being read back; the write follows once it is in
+        if (m_store->residency(documentId) == DocumentStore::Resident) {
+            return false;
+        }
+        m_pendingWrites[documentId] = m_pendingWrites.value(documentId, true) && autoSaved;
+        return true;
+    }
+    quint64 contentHash = m_store->contentHash(documentId);
+    m_changeMonitor->expectWrite(snapshot.path(), contentHash);
+    m_latestWrites[documentId] = snapshot.revision();
+
+    m_io->writeFile(snapshot.path(), snapshot.text())
+        .then(this, [this, documentId, snapshot, contentHash, autoSaved](
+                        const FileIoService::Result &result) {
+            m_changeMonitor->writeFinished(snapshot.path(), contentHash);
+            onDocumentWritten(documentId, snapshot, result, autoSaved);
+        });
+    return true;
+}
+
+void DocumentManager::onDocumentWritten(int documentId, const DocumentSnapshot &snapshot,
+                                        const FileIoService::Result &result, bool autoSaved)
+{
+    // A newer write of the same document is queued behind this one; its
+    // result is the one that counts
+    auto latest = m_latestWrites.constFind(documentId);
+    if (latest != m_latestWrites.constEnd() && *latest > snapshot.revision()) {
+        return;
+    }
+    m_latestWrites.remove(documentId);
     
-    m_modifiedStatus[path] = false;
-    m_lastSaved[path] = QDateTime::currentDateTime();
+    if (!result.success) {
+        emit errorOccurred("Could not save file: " + result.errorString);
+        return;
+    }
     
-    // Create backup after successful save
-    createBackup(path);
+    // The document may have been closed, reused or renamed while the write
+    // was in flight. Later edits stay modified unless they came back to the
+    // text that was written.
+    if (m_store->path(documentId) != result.path) {
+        return;
+    }
+    m_changeMonitor->noteFileState(result);
+    m_session->setContentHash(result.path, result.contentHash);
+    m_store->markSaved(documentId, snapshot.revision(), result.contentHash,
+                       snapshot.length());
+    if (!m_store->isModified(documentId)) {
+        // The file is the new recovery base, earlier journal entries are moot
+        m_journal->begin(documentId);
+    }
+    m_store->setLastSaved(documentId, QDateTime::currentMSecsSinceEpoch());
     
-    emit documentSaved(path);
-    return true;
+    if (autoSaved) {
+        qDebug() << "Auto-saved:" << result.path << "in" << result.elapsedMs << "ms";
+    } else {
+        emit documentSaved(documentId);
+    }
 }
 
 bool DocumentManager::saveDocumentAs(const QString &filePath)
 {
-    if (m_currentDocument.isEmpty()) {
+    if (m_currentDocument == DocumentStore::InvalidId) {
         emit errorOccurred("No document currently open");
         return false;
     }
     
-    // Save content to new path
-    m_documents[filePath] = m_documents[m_currentDocument];
-    m_modifiedStatus[filePath] = false;
-    m_lastSaved[filePath] = QDateTime::currentDateTime();
-    
     // Move document from old path to new path
-    if (m_currentDocument != filePath) {
-        m_documents.remove(m_currentDocument);
-        m_modifiedStatus.remove(m_currentDocument);
-        m_lastSaved.remove(m_currentDocument);
-        stopWatchingFile(m_currentDocument);
+    QString oldPath = m_store->path(m_currentDocument);
+    if (oldPath != filePath) {
+        closeDocument(m_store->documentId(filePath));
+        m_store->rename(m_currentDocument, filePath);
+        stopWatchingFile(oldPath);
         
-        m_currentDocument = filePath;
+        m_session->documentClosed(oldPath);
+        m_session->documentOpened(filePath, m_store->savedHash(m_currentDocument));
+        m_session->setActive(filePath);
         
         // Start watching new file path
         startWatchingFile(filePath);
     }
     
-    return saveDocument(filePath);
+    return saveDocument(m_currentDocument);
 }
 
 bool DocumentManager::saveAllDocuments()
 {
     bool allSaved = true;
-    for (const QString &path : m_documents.keys()) {
-        if (m_modifiedStatus[path]) {
-            if (!saveDocument(path)) {
-                allSaved = false;
-            }
+    for (int id : m_store->modifiedIds()) {
+        m_store->refreshModified(id);
+        if (m_store->isModified(id) && !saveDocument(id)) {
+            allSaved = false;
         }
     }
     return allSaved;
@@ -137,38 +281,52 @@ bool DocumentManager::saveAllDocuments()
 
 void DocumentManager::closeDocument(const QString &filePath)
 {
-    QString path = filePath.isEmpty() ? m_currentDocument : filePath;
+    if (filePath.isEmpty()) {
+        closeDocument(m_currentDocument);
+    } else {
+        closeDocument(m_store->documentId(filePath));
+    }
+}
+
+void DocumentManager::closeDocument(int documentId)
+{
+    // Cleanup happens in onStoreDocumentClosed so documents closed through
+    // EditorManager are handled the same way
+    m_store->close(documentId);
+}
+
+void DocumentManager::onStoreDocumentClosed(int documentId, const QString &filePath)
+{
+    // Stop watching file
+    stopWatchingFile(filePath);
     
-    if (m_documents.contains(path)) {
-        // Stop watching file
-        stopWatchingFile(path);
-        
-        m_documents.remove(path);
-        m_modifiedStatus.remove(path);
-        m_lastSaved.remove(path);
-        
-        if (m_currentDocument == path) {
-            // Set current document to another open document, or empty if none
-            if (!m_documents.isEmpty()) {
-                m_currentDocument = m_documents.keys().first();
-            } else {
-                m_currentDocument = "";
-            }
-            emit currentDocumentChanged();
-        }
-        
-        emit documentClosed(path);
+    // Unsaved edits of a closed document are dropped on purpose
+    m_journal->discard(filePath);
+    m_session->documentClosed(filePath);
+    m_placeholders.remove(documentId);
+    m_unreadable.remove(documentId);
+    m_pendingWrites.remove(documentId);
+    m_latestWrites.remove(documentId);
+    
+    if (m_currentDocument == documentId) {
+        // Set current document to another open document, or none
+        QVector<int> openDocuments = m_store->ids();
+        m_currentDocument = openDocuments.isEmpty() ? DocumentStore::InvalidId
+                                                    : openDocuments.first();
+        emit currentDocumentChanged();
     }
+    
+    emit documentClosed(documentId);
 }
 
 void DocumentManager::newDocument()
 {
     QString untitledName = generateUntitledName();
-    m_documents[untitledName] = "";
-    m_modifiedStatus[untitledName] = true;
-    m_currentDocument = untitledName;
+    int id = m_store->open(untitledName, "");
+    m_store->setModified(id, true);
+    m_currentDocument = id;
     
-    emit documentOpened(untitledName, "");
+    emit documentOpened(id, untitledName, "");
     emit currentDocumentChanged();
 }
 
@@ -178,38 +336,226 @@ void DocumentManager::saveCurrent()
 }
 
 QString DocumentManager::currentDocument() const
+{
+    return m_store->path(m_currentDocument);
+}
+
+int DocumentManager::currentDocumentId() const
 {
     return m_currentDocument;
 }
 
+void DocumentManager::activateDocument(int documentId)
+{
+    if (!m_store->isOpen(documentId)) {
+        emit errorOccurred("Document not loaded: " + QString::number(documentId));
+        return;
+    }
+    
+    m_memoryBudget->activate(documentId);
+    m_session->setActive(m_store->path(documentId));
+    if (m_currentDocument != documentId) {
+        m_currentDocument = documentId;
+        emit currentDocumentChanged();
+    }
+}
+
 QStringList DocumentManager::recentDocuments() const
 {
     return m_recentDocuments;
 }
 
-bool DocumentManager::isDocumentModified(const QString &filePath) const
+int DocumentManager::documentId(const QString &filePath) const
+{
+    return m_store->documentId(filePath);
+}
+
+QString DocumentManager::documentPath(int documentId) const
 {
-    return m_modifiedStatus.value(filePath, false);
+    return m_store->path(documentId);
+}
+
+bool DocumentManager::isDocumentModified(int documentId) const
+{
+    return m_store->isModified(documentId);
 }
 
 QStringList DocumentManager::getOpenDocuments() const
 {
-    return m_documents.keys();
+    QStringList paths;
+    for (int id : m_store->ids()) {
+        paths.append(m_store->path(id));
+    }
+    return paths;
 }
 
-void DocumentManager::updateDocumentContent(const QString &filePath, const QString &content)
+QVector<int> DocumentManager::openDocumentIds() const
 {
-    if (m_documents[filePath] != content) {
-        m_documents[filePath] = content;
-        m_modifiedStatus[filePath] = true;
+    return m_store->ids();
+}
+
+void DocumentManager::updateDocumentContent(int documentId, const QString &content)
+{
+    // Whole-text updates are reduced to a single edit by the store.
+    // Editors should prefer applyEdit().
+    if (!m_store->setContent(documentId, content)) {
+        emit errorOccurred("Document not loaded: " + QString::number(documentId));
+    }
+}
+
+QString DocumentManager::getDocumentContent(int documentId) const
+{
+    return m_store->content(documentId);
+}
+
+bool DocumentManager::isDocumentLoaded(int documentId) const
+{
+    // Compressed text is expanded on the GUI thread when read
+    DocumentStore::Residency residency = m_store->residency(documentId);
+    return m_store->isOpen(documentId)
+           && (residency == DocumentStore::Resident || residency == DocumentStore::Compressed);
+}
+
+bool DocumentManager::applyEdit(int documentId, int position, int removedLength,
+                                const QString &insertedText)
+{
+    if (!m_store->isOpen(documentId)) {
+        emit errorOccurred("Document not loaded: " + QString::number(documentId));
+        return false;
+    }
+    
+    if (!m_store->applyEdit(documentId, position, removedLength, insertedText)) {
+        emit errorOccurred("Edit out of range for: " + m_store->path(documentId));
+        return false;
+    }
+    return true;
+}
+
+quint64 DocumentManager::documentRevision(int documentId) const
+{
+    return m_store->revision(documentId);
+}
+
+DocumentSnapshot DocumentManager::documentSnapshot(int documentId) const
+{
+    return m_store->snapshot(documentId);
+}
+
+qint64 DocumentManager::documentResidentBytes(int documentId) const
+{
+    return m_memoryBudget->residentBytes(documentId);
+}
+
+void DocumentManager::setViewState(int documentId, int cursorPosition, qreal scrollPosition)
+{
+    m_session->setViewState(m_store->path(documentId), cursorPosition, scrollPosition);
+}
+
+QVariantMap DocumentManager::viewState(int documentId) const
+{
+    SessionStore::Entry entry = m_session->entry(m_store->path(documentId));
+    QVariantMap state;
+    state["cursorPosition"] = entry.cursorPosition;
+    state["scrollPosition"] = entry.scrollPosition;
+    return state;
+}
+
+void DocumentManager::restoreSession()
+{
+    m_session->load().then(this, [this](const SessionStore::Session &session) {
+        for (const SessionStore::Entry &entry : session.entries) {
+            if (m_store->documentId(entry.path) != DocumentStore::InvalidId) {
+                continue;
+            }
+            
+            // Keeps the tab order of the previous run
+            m_session->documentOpened(entry.path, entry.contentHash);
+            m_session->setViewState(entry.path, entry.cursorPosition, entry.scrollPosition);
+            
+            if (entry.path == session.activePath) {
+                openDocument(entry.path);
+                continue;
+            }
+            
+            int id = m_store->openUnloaded(entry.path, entry.contentHash);
+            m_placeholders.insert(id);
+            startWatchingFile(entry.path);
+            emit documentPlaceholderOpened(id, entry.path);
+        }
         
-        emit documentModified(filePath);
+        if (!m_placeholders.isEmpty()) {
+            m_hydrateTimer->start();
+        }
+    });
+}
+
+void DocumentManager::hydrateNext()
+{
+    // Leave room for the tabs the user actually opens; resumeHydration()
+    // starts again when documents are released or closed
+    if (m_memoryBudget->residentBytes() > m_memoryBudget->budget() / 2) {
+        m_hydrationPaused = true;
+        return;
+    }
+    
+    for (int id : std::as_const(m_placeholders)) {
+        if (m_store->residency(id) == DocumentStore::Evicted && !m_unreadable.contains(id)) {
+            m_memoryBudget->prefetch(id);
+            return;
+        }
     }
 }
 
-QString DocumentManager::getDocumentContent(const QString &filePath) const
+void DocumentManager::resumeHydration()
 {
-    return m_documents.value(filePath, "");
+    if (m_hydrationPaused && !m_placeholders.isEmpty()) {
+        m_hydrationPaused = false;
+        m_hydrateTimer->start();
+    }
+}
+
+void DocumentManager::onDocumentRehydrated(int documentId, bool changedOnDisk)
+{
+    QString filePath = m_store->path(documentId);
+    
+    // The store took a file changed while released as the new saved state
+    if (changedOnDisk) {
+        m_session->setContentHash(filePath, m_store->savedHash(documentId));
+    }
+    if (m_pendingWrites.contains(documentId)) {
+        writeDocument(documentId, m_pendingWrites.take(documentId));
+    }
+    
+    if (m_placeholders.remove(documentId)) {
+        m_unreadable.remove(documentId);
+        // First read of a restored tab: replay edits the previous run did
+        // not get to save, as openDocument() does
+        restoreFromBackup(filePath, m_store->content(documentId))
+            .then(this, [this, documentId, filePath](const EditJournal::Recovery &recovery) {
+                if (m_store->path(documentId) != filePath) {
+                    return;
+                }
+                if (recovery.recovered) {
+                    m_store->setContent(documentId, recovery.content);
+                }
+                m_journal->begin(documentId);
+                emit documentLoaded(documentId);
+                if (recovery.recovered) {
+                    emit documentRecovered(documentId);
+                }
+            });
+        
+        if (!m_placeholders.isEmpty()) {
+            m_hydrateTimer->start();
+        }
+        return;
+    }
+    
+    if (changedOnDisk) {
+        m_journal->begin(documentId);
+        emit documentReloaded(documentId);
+    }
+    emit documentLoaded(documentId);
 }
 
 void DocumentManager::setAutoSaveEnabled(bool enabled)
@@ -217,7 +563,9 @@ void DocumentManager::setAutoSaveEnabled(bool enabled)
     if (m_autoSaveEnabled != enabled) {
         m_autoSaveEnabled = enabled;
         if (enabled) {
-            m_autoSaveTimer->start();
+            if (!m_store->modifiedIds().isEmpty()) {
+                scheduleAutoSave();
+            }
         } else {
             m_autoSaveTimer->stop();
         }
@@ -233,9 +581,16 @@ void DocumentManager::setAutoSaveInterval(int seconds)
 {
     if (m_autoSaveInterval != seconds && seconds > 0) {
         m_autoSaveInterval = seconds;
-        if (m_autoSaveEnabled) {
-            m_autoSaveTimer->setInterval(seconds * 1000);
-        }
+        m_autoSaveTimer->setInterval(seconds * 1000);
+    }
+}
+
+void DocumentManager::scheduleAutoSave()
+{
+    // Not restarted on every keystroke, so continuous typing is still saved
+    // once per interval
+    if (m_autoSaveEnabled && !m_autoSaveTimer->isActive()) {
+        m_autoSaveTimer->start();
     }
 }
 
@@ -243,25 +598,19 @@ void DocumentManager::autoSave()
 {
     if (!m_autoSaveEnabled) return;
     
-    for (const QString &path : m_documents.keys()) {
-        if (m_modifiedStatus[path]) {
-            // Save with auto-save flag to distinguish from user-initiated save
-            if (QFileInfo(path).isFile()) {  // Only save if it's an actual file (not untitled document)
-                QFile file(path);
-                if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-                    QTextStream out(&file);
-                    out << m_documents[path];
-                    file.close();
-                    
-                    m_modifiedStatus[path] = false;
-                    m_lastSaved[path] = QDateTime::currentDateTime();
-                    
-                    // Create backup after auto-save
-                    createBackup(path);
-                    
-                    qDebug() << "Auto-saved:" << path;
-                }
-            }
+    // Hand every dirty document to the write-behind queue in one pass. A
+    // write still queued for the same file is replaced, not duplicated.
+    for (int id : m_store->modifiedIds()) {
+        // Edits that were undone back to the saved text need no write
+        m_store->refreshModified(id);
+        if (!m_store->isModified(id)) {
+            continue;
+        }
+        
+        // Save with auto-save flag to distinguish from user-initiated save
+        QString path = m_store->path(id);
+        if (QFileInfo(path).isFile()) {  // Only save if it's an actual file (not untitled document)
+            writeDocument(id, true);
         }
     }
 }
@@ -285,24 +634,12 @@ void DocumentManager::updateRecentDocuments(const QString &filePath)
 
 void DocumentManager::startWatchingFile(const QString &filePath)
 {
-    // Stop watching if already watching
-    stopWatchingFile(filePath);
-    
-    // Add file to watcher
-    m_fileWatcher->addPath(filePath);
+    m_changeMonitor->watch(filePath);
 }
 
 void DocumentManager::stopWatchingFile(const QString &filePath)
 {
-    m_fileWatcher->removePath(filePath);
-}
-
-void DocumentManager::createBackup(const QString &filePath)
-{
-    if (!QFileInfo::exists(filePath)) return;
-    
-    QString backupPath = getBackupPath(filePath);
-    QFile(filePath).copy(backupPath);
+    m_changeMonitor->unwatch(filePath);
 }
 
 QString DocumentManager::generateUntitledName() const
@@ -312,7 +649,7 @@ QString DocumentManager::generateUntitledName() const
     do {
         name = "untitled_" + QString::number(counter) + ".md";
         counter++;
-    } while (m_documents.contains(name));
+    } while (m_store->documentId(name) != DocumentStore::InvalidId);
     
     return name;
 }
@@ -322,22 +659,10 @@ bool DocumentManager::isUntitledDocument(const QString &filePath) const
     return filePath.startsWith("untitled_");
 }
 
-QString DocumentManager::getBackupPath(const QString &filePath) const
-{
-    QFileInfo fileInfo(filePath);
-    QString backupDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/backups";
-    QDir().mkpath(backupDir);
-    
-    QString backupPath = backupDir + "/" + fileInfo.fileName() + ".backup";
-    return backupPath;
-}
-
-bool DocumentManager::restoreFromBackup(const QString &filePath)
+QFuture<EditJournal::Recovery> DocumentManager::restoreFromBackup(const QString &filePath,
+                                                                  const QString &diskContent)
 {
-    QString backupPath = getBackupPath(filePath);
-    if (QFile::exists(backupPath)) {
-        QFile::copy(backupPath, filePath);
-        return true;
-    }
-    return false;
+    // Replays the edit journal on a worker thread; the file itself is only
+    // rewritten by the next save
+    return m_journal->recover(filePath, diskContent);
 }
\ No newline at end of file
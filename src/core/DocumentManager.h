@@ -3,40 +3,88 @@
 #define DOCUMENTMANAGER_H
 
 #include <QObject>
+#include <QPointer>
 #include <QHash>
+#include <QSet>
 #include <QTimer>
-#include <QFileSystemWatcher>
+#include <QVariantMap>
 #include <QSettings>
 #include <QFile>
 #include <QTextStream>
 #include <QDateTime>
 #include <QDir>
 
+#include "DocumentStore.h"
+#include "FileIoService.h"
+#include "EditJournal.h"
+#include "FileChangeMonitor.h"
+#include "MemoryBudget.h"
+#include "Prefetcher.h"
+#include "SessionStore.h"
+
 class DocumentManager : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(QString currentDocument READ currentDocument NOTIFY currentDocumentChanged)
+    Q_PROPERTY(int currentDocumentId READ currentDocumentId NOTIFY currentDocumentChanged)
     Q_PROPERTY(QStringList recentDocuments READ recentDocuments NOTIFY recentDocumentsChanged)
 
 public:
-    explicit DocumentManager(QObject *parent = nullptr);
+    DocumentManager(DocumentStore *store, FileIoService *io, WorkspaceWatcher *workspace,
+                    QObject *parent = nullptr);
 
-    bool openDocument(const QString &filePath);
+    // File I/O runs on FileIoService. These return false only when the
+    // request is rejected up front; results arrive through signals.
+    Q_INVOKABLE bool openDocument(const QString &filePath);
     bool saveDocument(const QString &filePath = "");
-    bool saveDocumentAs(const QString &filePath);
+    bool saveDocument(int documentId);
+    Q_INVOKABLE bool saveDocumentAs(const QString &filePath);
     bool saveAllDocuments();
     void closeDocument(const QString &filePath);
-    void newDocument();
-    void saveCurrent();
+    void closeDocument(int documentId);
+    Q_INVOKABLE void newDocument();
+    Q_INVOKABLE void saveCurrent();
+    
+    // Opens take a prefetched read of the file when there is a fresh one
+    void setPrefetcher(Prefetcher *prefetcher);
+    
+    // Reopen the tabs of the previous run. Only the active one is read
+    // right away; the others start as placeholders and are loaded when
+    // activated or while the application is idle.
+    void restoreSession();
 
     QString currentDocument() const;
+    int currentDocumentId() const;
+    // Make a tab current, reading its text back if it was released
+    Q_INVOKABLE void activateDocument(int documentId);
     QStringList recentDocuments() const;
 
-    bool isDocumentModified(const QString &filePath) const;
+    // Documents are addressed by the integer ids handed out by DocumentStore
+    Q_INVOKABLE int documentId(const QString &filePath) const;
+    Q_INVOKABLE QString documentPath(int documentId) const;
+
+    bool isDocumentModified(int documentId) const;
     QStringList getOpenDocuments() const;
+    QVector<int> openDocumentIds() const;
+
+    Q_INVOKABLE void updateDocumentContent(int documentId, const QString &content);
+    Q_INVOKABLE QString getDocumentContent(int documentId) const;
+    // Whether the text can be read now; documentLoaded() follows otherwise
+    Q_INVOKABLE bool isDocumentLoaded(int documentId) const;
 
-    void updateDocumentContent(const QString &filePath, const QString &content);
-    QString getDocumentContent(const QString &filePath) const;
+    // Incremental editing: replace removedLength characters at position
+    Q_INVOKABLE bool applyEdit(int documentId, int position, int removedLength,
+                               const QString &insertedText);
+    quint64 documentRevision(int documentId) const;
+    DocumentSnapshot documentSnapshot(int documentId) const;
+    
+    // Memory held by a document's text in bytes, 0 while released
+    Q_INVOKABLE qint64 documentResidentBytes(int documentId) const;
+    MemoryBudget *memoryBudget() const { return m_memoryBudget; }
+    
+    // Cursor and scroll position, kept in the session
+    Q_INVOKABLE void setViewState(int documentId, int cursorPosition, qreal scrollPosition);
+    Q_INVOKABLE QVariantMap viewState(int documentId) const;
 
     // Auto-save functionality
     void setAutoSaveEnabled(bool enabled);
@@ -47,34 +95,58 @@ public slots:
     void autoSave();
 
 signals:
-    void documentOpened(const QString &filePath, const QString &content);
-    void documentSaved(const QString &filePath);
-    void documentClosed(const QString &filePath);
-    void documentModified(const QString &filePath);
+    void documentOpened(int documentId, const QString &filePath, const QString &content);
+    void documentPlaceholderOpened(int documentId, const QString &filePath);
+    // The text of a placeholder or released document was read back
+    void documentLoaded(int documentId);
+    void documentSaved(int documentId);
+    void documentClosed(int documentId);
+    void documentModified(int documentId);
+    void documentRecovered(int documentId);
+    void documentReloaded(int documentId);
+    void documentConflict(int documentId);
+    void documentEdited(int documentId, quint64 revision, int position,
+                        int removedLength, int insertedLength);
     void currentDocumentChanged();
     void recentDocumentsChanged();
     void errorOccurred(const QString &error);
 
 private:
-    QHash<QString, QString> m_documents;  // filePath -> content
-    QHash<QString, bool> m_modifiedStatus;  // filePath -> isModified
-    QHash<QString, QDateTime> m_lastSaved;  // filePath -> last save time
+    DocumentStore *m_store;  // Owns content, revision, modified and save state
+    FileIoService *m_io;
+    EditJournal *m_journal;
+    MemoryBudget *m_memoryBudget;
+    SessionStore *m_session;
+    QPointer<Prefetcher> m_prefetcher;
+    QSet<int> m_placeholders;   // Restored tabs not read from disk yet
+    QSet<int> m_unreadable;     // Placeholders whose read failed; left to the user
+    QHash<int, bool> m_pendingWrites;  // Saves waiting for released text; auto-saved
+    QHash<int, quint64> m_latestWrites;  // Revision of the last write queued per document
+    bool m_hydrationPaused;     // Stopped at the memory budget
+    QTimer *m_hydrateTimer;
     QStringList m_recentDocuments;
-    QString m_currentDocument;
+    int m_currentDocument;
     QTimer *m_autoSaveTimer;
-    QFileSystemWatcher *m_fileWatcher;
+    FileChangeMonitor *m_changeMonitor;
     QSettings *m_settings;
     bool m_autoSaveEnabled;
     int m_autoSaveInterval;  // in seconds
 
+    void onStoreDocumentClosed(int documentId, const QString &filePath);
+    bool writeDocument(int documentId, bool autoSaved);
+    void onDocumentWritten(int documentId, const DocumentSnapshot &snapshot,
+                           const FileIoService::Result &result, bool autoSaved);
+    void scheduleAutoSave();
+    void hydrateNext();
+    void resumeHydration();
+    void onDocumentRehydrated(int documentId, bool changedOnDisk);
     void updateRecentDocuments(const QString &filePath);
     void startWatchingFile(const QString &filePath);
     void stopWatchingFile(const QString &filePath);
-    void createBackup(const QString &filePath);
     QString generateUntitledName() const;
     bool isUntitledDocument(const QString &filePath) const;
-    QString getBackupPath(const QString &filePath) const;
-    bool restoreFromBackup(const QString &filePath);
+    QFuture<EditJournal::Recovery> restoreFromBackup(const QString &filePath,
+                                                     const QString &diskContent);
 };
 
 #endif // DOCUMENTMANAGER_H
\ No newline at end of file
@@ -0,0 +1,534 @@
+// DocumentStore.cpp
+#include "DocumentStore.h"
+#include "ContentHash.h"
+#include <QFile>
+#include <QDebug>
+
+DocumentStore::DocumentStore(QObject *parent)
+    : QObject(parent)
+{
+    // Same-length edits are compared by hash once typing pauses
+    m_hashCheckTimer = new QTimer(this);
+    m_hashCheckTimer->setSingleShot(true);
+    m_hashCheckTimer->setInterval(100);
+    connect(m_hashCheckTimer, &QTimer::timeout, this, &DocumentStore::checkPendingHashes);
+}
+
+int DocumentStore::documentId(const QString &path) const
+{
+    return m_ids.value(path, InvalidId);
+}
+
+QString DocumentStore::path(int id) const
+{
+    return isOpen(id) ? m_paths[id] : QString();
+}
+
+bool DocumentStore::isOpen(int id) const
+{
+    return id >= 0 && id < m_flags.size() && (m_flags[id] & Open);
+}
+
+QVector<int> DocumentStore::ids() const
+{
+    QVector<int> result;
+    for (int id = 0; id < m_flags.size(); ++id) {
+        if (m_flags[id] & Open) {
+            result.append(id);
+        }
+    }
+    return result;
+}
+
+QVector<int> DocumentStore::modifiedIds() const
+{
+    QVector<int> result;
+    for (int id = 0; id < m_flags.size(); ++id) {
+        if ((m_flags[id] & (Open | Modified)) == (Open | Modified)) {
+            result.append(id);
+        }
+    }
+    return result;
+}
+
+int DocumentStore::open(const QString &path, const QString &content)
+{
+    return open(path, content, ContentHash::of(content));
+}
+
+int DocumentStore::open(const QString &path, const QString &content, quint64 contentHash)
+{
+    int id = allocate(path);
+
+    m_texts[id] = PieceTable(content);
+    m_residency[id] = Resident;
+    m_savedHashes[id] = contentHash;
+    m_savedLengths[id] = content.length();
+    m_hashes[id] = contentHash;
+
+    emit documentOpened(id);
+    return id;
+}
+
+int DocumentStore::openUnloaded(const QString &path, quint64 contentHash)
+{
+    int id = allocate(path);
+
+    // Length is unknown until restore() reads the file
+    m_texts[id] = PieceTable();
+    m_residency[id] = Evicted;
+    m_lengths[id] = 0;
+    m_savedHashes[id] = contentHash;
+    m_savedLengths[id] = -1;
+    m_hashes[id] = contentHash;
+
+    emit documentOpened(id);
+    return id;
+}
+
+int DocumentStore::allocate(const QString &path)
+{
+    int id = documentId(path);
+    if (id == InvalidId) {
+        if (!m_freeIds.isEmpty()) {
+            id = m_freeIds.takeLast();
+        } else {
+            id = m_paths.size();
+            m_paths.resize(id + 1);
+            m_flags.resize(id + 1);
+            m_revisions.resize(id + 1);
+            m_lastSaved.resize(id + 1);
+            m_texts.resize(id + 1);
+            m_snapshots.resize(id + 1);
+            m_savedHashes.resize(id + 1);
+            m_savedLengths.resize(id + 1);
+            m_savedRevisions.resize(id + 1);
+            m_hashes.resize(id + 1);
+            m_hashRevisions.resize(id + 1);
+            m_residency.resize(id + 1);
+            m_compressed.resize(id + 1);
+            m_lengths.resize(id + 1);
+            m_spillFiles.resize(id + 1);
+        }
+        m_ids.insert(path, id);
+        m_paths[id] = path;
+        m_lastSaved[id] = 0;
+    }
+
+    m_flags[id] = Open;
+    m_revisions[id]++;
+    m_snapshots[id] = DocumentSnapshot();
+    m_compressed[id].clear();
+    if (!m_spillFiles[id].isEmpty()) {
+        QFile::remove(m_spillFiles[id]);
+        m_spillFiles[id].clear();
+    }
+    m_savedRevisions[id] = m_revisions[id];
+    m_hashRevisions[id] = m_revisions[id];
+    return id;
+}
+
+void DocumentStore::close(int id)
+{
+    if (!isOpen(id)) {
+        return;
+    }
+
+    QString path = m_paths[id];
+    m_ids.remove(path);
+    m_paths[id].clear();
+    m_flags[id] = 0;
+    m_texts[id] = PieceTable();
+    m_snapshots[id] = DocumentSnapshot();
+    m_compressed[id].clear();
+    if (!m_spillFiles[id].isEmpty()) {
+        QFile::remove(m_spillFiles[id]);
+        m_spillFiles[id].clear();
+    }
+    m_residency[id] = Resident;
+    m_pendingHashChecks.removeAll(id);
+    m_freeIds.append(id);
+
+    emit documentClosed(id, path);
+}
+
+bool DocumentStore::rename(int id, const QString &newPath)
+{
+    if (!isOpen(id) || m_ids.contains(newPath)) {
+        return false;
+    }
+
+    QString oldPath = m_paths[id];
+    m_ids.remove(oldPath);
+    m_ids.insert(newPath, id);
+    m_paths[id] = newPath;
+    m_snapshots[id] = DocumentSnapshot();
+
+    emit documentRenamed(id, oldPath, newPath);
+    return true;
+}
+
+bool DocumentStore::applyEdit(int id, qsizetype position, qsizetype removedLength,
+                              const QString &insertedText)
+{
+    if (!isOpen(id)) {
+        return false;
+    }
+
+    if (!ensureResident(id)) {
+        return false;
+    }
+    PieceTable &text = m_texts[id];
+    if (position < 0 || removedLength < 0 || position + removedLength > text.length()) {
+        return false;
+    }
+
+    if (removedLength == 0 && insertedText.isEmpty()) {
+        return true;
+    }
+
+    text.replace(position, removedLength, insertedText);
+    quint64 revision = ++m_revisions[id];
+
+    emit documentEdited(id, revision, position, removedLength, insertedText.length());
+
+    // A length change settles it; otherwise assume modified until the
+    // deferred hash comparison says otherwise
+    setModified(id, true);
+    if (text.length() == m_savedLengths[id] && !m_pendingHashChecks.contains(id)) {
+        m_pendingHashChecks.append(id);
+        m_hashCheckTimer->start();
+    }
+    return true;
+}
+
+bool DocumentStore::setContent(int id, const QString &content)
+{
+    if (!isOpen(id)) {
+        return false;
+    }
+
+    // Reduce a whole-text update to the range between the common prefix and
+    // suffix so listeners still receive a delta. Compared piece by piece, so
+    // the current text is never copied.
+    if (!ensureResident(id)) {
+        return false;
+    }
+    const PieceTable &current = m_texts[id];
+
+    qsizetype prefix = current.commonPrefixLength(content);
+    qsizetype suffix = current.commonSuffixLength(
+        content, qMin(current.length(), content.length()) - prefix);
+
+    qsizetype removedLength = current.length() - prefix - suffix;
+    qsizetype insertedLength = content.length() - prefix - suffix;
+    return applyEdit(id, prefix, removedLength, content.mid(prefix, insertedLength));
+}
+
+QString DocumentStore::content(int id) const
+{
+    if (!isOpen(id) || !ensureResident(id)) {
+        return QString();
+    }
+    return m_texts[id].text();
+}
+
+QString DocumentStore::textRange(int id, qsizetype position, qsizetype length) const
+{
+    if (!isOpen(id) || !ensureResident(id)) {
+        return QString();
+    }
+    return m_texts[id].mid(position, length);
+}
+
+DocumentSnapshot DocumentStore::snapshot(int id) const
+{
+    if (!isOpen(id) || !ensureResident(id)) {
+        return DocumentSnapshot();
+    }
+
+    DocumentSnapshot &cached = m_snapshots[id];
+    if (cached.isNull() || cached.revision() != m_revisions[id]) {
+        auto data = QSharedPointer<DocumentSnapshot::Data>::create();
+        data->documentId = id;
+        data->path = m_paths[id];
+        data->revision = m_revisions[id];
+
+        // Later edits go to a fresh add buffer, so the copy shares every
+        // buffer with the live table and only the piece list is duplicated
+        m_texts[id].freeze();
+        data->text = m_texts[id];
+
+        cached.d = data;
+    }
+    return cached;
+}
+
+quint64 DocumentStore::revision(int id) const
+{
+    return isOpen(id) ? m_revisions[id] : 0;
+}
+
+qsizetype DocumentStore::length(int id) const
+{
+    if (!isOpen(id)) {
+        return 0;
+    }
+    return m_residency[id] == Resident ? m_texts[id].length() : m_lengths[id];
+}
+
+bool DocumentStore::isModified(int id) const
+{
+    return isOpen(id) && hasFlag(id, Modified);
+}
+
+void DocumentStore::setModified(int id, bool modified)
+{
+    if (isOpen(id) && hasFlag(id, Modified) != modified) {
+        setFlag(id, Modified, modified);
+        emit modifiedChanged(id, modified);
+    }
+}
+
+void DocumentStore::refreshModified(int id)
+{
+    if (!isOpen(id)) {
+        return;
+    }
+
+    m_pendingHashChecks.removeAll(id);
+
+    bool modified;
+    if (m_revisions[id] == m_savedRevisions[id]) {
+        modified = false;
+    } else if (length(id) != m_savedLengths[id]) {
+        modified = true;
+    } else {
+        modified = contentHash(id) != m_savedHashes[id];
+    }
+    setModified(id, modified);
+}
+
+quint64 DocumentStore::contentHash(int id) const
+{
+    if (!isOpen(id)) {
+        return 0;
+    }
+
+    // Left at the last known hash if the text can't be brought back
+    if (m_hashRevisions[id] != m_revisions[id] && ensureResident(id)) {
+        m_hashes[id] = ContentHash::of(m_texts[id].text());
+        m_hashRevisions[id] = m_revisions[id];
+    }
+    return m_hashes[id];
+}
+
+quint64 DocumentStore::savedHash(int id) const
+{
+    return isOpen(id) ? m_savedHashes[id] : 0;
+}
+
+void DocumentStore::markSaved(int id, quint64 revision, quint64 contentHash, qsizetype length)
+{
+    if (!isOpen(id)) {
+        return;
+    }
+
+    m_savedHashes[id] = contentHash;
+    m_savedLengths[id] = length;
+    m_savedRevisions[id] = revision;
+    if (m_revisions[id] == revision) {
+        m_hashes[id] = contentHash;
+        m_hashRevisions[id] = revision;
+    }
+    refreshModified(id);
+}
+
+qint64 DocumentStore::lastSaved(int id) const
+{
+    return isOpen(id) ? m_lastSaved[id] : 0;
+}
+
+void DocumentStore::setLastSaved(int id, qint64 msecsSinceEpoch)
+{
+    if (isOpen(id)) {
+        m_lastSaved[id] = msecsSinceEpoch;
+    }
+}
+
+DocumentStore::Residency DocumentStore::residency(int id) const
+{
+    return isOpen(id) ? Residency(m_residency[id]) : Resident;
+}
+
+qsizetype DocumentStore::residentBytes(int id) const
+{
+    if (!isOpen(id)) {
+        return 0;
+    }
+
+    switch (m_residency[id]) {
+        case Resident:
+            return m_texts[id].memoryUsage();
+        case Compressed:
+            return m_compressed[id].size();
+        default:
+            return 0;
+    }
+}
+
+bool DocumentStore::evict(int id)
+{
+    if (!isOpen(id) || m_residency[id] != Resident || hasFlag(id, Modified)) {
+        return false;
+    }
+
+    m_lengths[id] = m_texts[id].length();
+    m_texts[id] = PieceTable();
+    m_snapshots[id] = DocumentSnapshot();
+    setResidency(id, Evicted);
+    return true;
+}
+
+bool DocumentStore::compress(int id)
+{
+    if (!isOpen(id) || m_residency[id] != Resident) {
+        return false;
+    }
+
+    m_lengths[id] = m_texts[id].length();
+    m_compressed[id] = qCompress(m_texts[id].text().toUtf8());
+    m_texts[id] = PieceTable();
+    m_snapshots[id] = DocumentSnapshot();
+    setResidency(id, Compressed);
+    return true;
+}
+
+QByteArray DocumentStore::compressedData(int id) const
+{
+    return isOpen(id) && m_residency[id] == Compressed ? m_compressed[id] : QByteArray();
+}
+
+bool DocumentStore::markSpilled(int id, const QString &fileName)
+{
+    if (!isOpen(id) || m_residency[id] != Compressed) {
+        return false;
+    }
+
+    m_compressed[id].clear();
+    m_spillFiles[id] = fileName;
+    setResidency(id, Spilled);
+    return true;
+}
+
+bool DocumentStore::restore(int id, const QString &content, quint64 contentHash)
+{
+    if (!isOpen(id) || m_residency[id] != Evicted) {
+        return false;
+    }
+
+    m_texts[id] = PieceTable(content);
+
+    // Documents restored from a session don't know their length yet
+    bool changed = contentHash != m_savedHashes[id]
+                   || (m_savedLengths[id] >= 0 && content.length() != m_savedLengths[id]);
+    if (changed) {
+        // Changed on disk while evicted. There is no old text to diff
+        // against, so this counts as a reload at a new revision.
+        quint64 revision = ++m_revisions[id];
+        m_savedHashes[id] = contentHash;
+        m_savedRevisions[id] = revision;
+        m_hashes[id] = contentHash;
+        m_hashRevisions[id] = revision;
+    }
+    m_savedLengths[id] = content.length();
+    setResidency(id, Resident);
+    return changed;
+}
+
+bool DocumentStore::ensureResident(int id) const
+{
+    switch (m_residency[id]) {
+        case Resident:
+            return true;
+        case Evicted:
+        case Spilled:
+            // Read in the background and installed through restore() or
+            // unspill(), which also notice a file changed in the meantime
+            emit const_cast<DocumentStore *>(this)->restoreRequested(id);
+            return false;
+        case Compressed:
+            break;
+    }
+
+    // qUncompress() returns nothing for damaged data. The document then stays
+    // released; installing empty text would let the next save overwrite the
+    // file with it.
+    QString text = QString::fromUtf8(qUncompress(m_compressed[id]));
+    if (text.isEmpty() && m_lengths[id] > 0) {
+        QString error = QStringLiteral("compressed text is damaged");
+        qWarning() << "Could not restore document" << m_paths[id] << ":" << error;
+        emit const_cast<DocumentStore *>(this)->residencyFailed(id, error);
+        return false;
+    }
+
+    m_compressed[id].clear();
+    m_texts[id] = PieceTable(text);
+    const_cast<DocumentStore *>(this)->setResidency(id, Resident);
+    return true;
+}
+
+bool DocumentStore::unspill(int id, const QByteArray &data)
+{
+    if (!isOpen(id) || m_residency[id] != Spilled) {
+        return false;
+    }
+
+    QString text = QString::fromUtf8(qUncompress(data));
+    if (text.isEmpty() && m_lengths[id] > 0) {
+        return false;
+    }
+
+    m_texts[id] = PieceTable(text);
+    setResidency(id, Resident);
+    return true;
+}
+
+QString DocumentStore::spillFile(int id) const
+{
+    return isOpen(id) ? m_spillFiles[id] : QString();
+}
+
+void DocumentStore::setResidency(int id, Residency residency)
+{
+    if (residency != Spilled && !m_spillFiles[id].isEmpty()) {
+        QFile::remove(m_spillFiles[id]);
+        m_spillFiles[id].clear();
+    }
+    if (m_residency[id] != residency) {
+        m_residency[id] = residency;
+        emit residencyChanged(id, residency);
+    }
+}
+
+bool DocumentStore::hasFlag(int id, Flag flag) const
+{
+    return m_flags[id] & flag;
+}
+
+void DocumentStore::setFlag(int id, Flag flag, bool on)
+{
+    if (on) {
+        m_flags[id] |= flag;
+    } else {
+        m_flags[id] &= ~flag;
+    }
+}
+
+void DocumentStore::checkPendingHashes()
+{
+    const QVector<int> pending = m_pendingHashChecks;
+    for (int id : pending) {
+        refreshModified(id);
+    }
+}
@@ -0,0 +1,180 @@
+// DocumentStore.h
+#ifndef DOCUMENTSTORE_H
+#define DOCUMENTSTORE_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QSharedPointer>
+#include <QString>
+#include <QTimer>
+
+#include "PieceTable.h"
+
+// Immutable, versioned view of a document's text. Copies are cheap and the
+// text can be read from any thread (renderer, exporter, link indexer).
+// A snapshot shares the piece buffers of the document instead of copying
+// them; text() assembles the text from the pieces on each call.
+class DocumentSnapshot
+{
+public:
+    DocumentSnapshot() = default;
+
+    bool isNull() const { return d.isNull(); }
+    int documentId() const { return d ? d->documentId : -1; }
+    QString path() const { return d ? d->path : QString(); }
+    quint64 revision() const { return d ? d->revision : 0; }
+    qsizetype length() const { return d ? d->text.length() : 0; }
+    QString text() const { return d ? d->text.text() : QString(); }
+
+private:
+    friend class DocumentStore;
+
+    struct Data {
+        int documentId;
+        QString path;
+        quint64 revision;
+        PieceTable text;  // Frozen copy; only text() is used on it
+    };
+    QSharedPointer<const Data> d;
+};
+
+// Single owner of the text of every open document. DocumentManager and
+// EditorManager are views on it, so each document is held exactly once.
+//
+// Paths are interned once into small integer ids. Per-document state is kept
+// in parallel arrays indexed by id, so sweeps such as save-all and autosave
+// walk contiguous memory instead of hashing paths. Ids of closed documents
+// are reused.
+//
+// "Modified" means the text differs from what was last loaded from or
+// written to disk. Edits that change the length are decided immediately;
+// same-length edits are confirmed by comparing content hashes shortly after,
+// so typing and undoing back to the saved text clears the flag again.
+//
+// Text of inactive documents can be released to stay within a memory budget
+// (see MemoryBudget). A clean document drops its text and is read back from
+// its file, a modified one is kept compressed or spilled to a temporary file.
+// Compressed text is brought back by any accessor. Text that lives in a file
+// is never read on the caller's thread: the accessor returns nothing and
+// restoreRequested() asks for the file to be read in the background, after
+// which restore() or unspill() install it.
+class DocumentStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int InvalidId = -1;
+
+    enum Residency : quint8 {
+        Resident,
+        Evicted,     // Clean, text is the file on disk
+        Compressed,  // qCompress'd UTF-8 in memory
+        Spilled      // Compressed data in a temporary file
+    };
+    Q_ENUM(Residency)
+
+    explicit DocumentStore(QObject *parent = nullptr);
+
+    int documentId(const QString &path) const;
+    QString path(int id) const;
+    bool isOpen(int id) const;
+    QVector<int> ids() const;
+    QVector<int> modifiedIds() const;
+    int capacity() const { return m_paths.size(); }
+
+    int open(const QString &path, const QString &content);
+    int open(const QString &path, const QString &content, quint64 contentHash);
+    // Placeholder whose text stays on disk until it is first needed
+    int openUnloaded(const QString &path, quint64 contentHash);
+    void close(int id);
+    bool rename(int id, const QString &newPath);
+
+    bool applyEdit(int id, qsizetype position, qsizetype removedLength,
+                   const QString &insertedText);
+    bool setContent(int id, const QString &content);
+
+    QString content(int id) const;
+    QString textRange(int id, qsizetype position, qsizetype length) const;
+    DocumentSnapshot snapshot(int id) const;
+    quint64 revision(int id) const;
+    qsizetype length(int id) const;
+
+    bool isModified(int id) const;
+    void setModified(int id, bool modified);
+    void refreshModified(int id);
+
+    quint64 contentHash(int id) const;  // Cached per revision
+    quint64 savedHash(int id) const;
+    void markSaved(int id, quint64 revision, quint64 contentHash, qsizetype length);
+
+    qint64 lastSaved(int id) const;  // msecs since epoch, 0 if never saved
+    void setLastSaved(int id, qint64 msecsSinceEpoch);
+
+    Residency residency(int id) const;
+    bool isResident(int id) const { return residency(id) == Resident; }
+    qsizetype residentBytes(int id) const;
+
+    bool evict(int id);  // Clean documents only
+    bool compress(int id);
+    QByteArray compressedData(int id) const;
+    bool markSpilled(int id, const QString &fileName);  // After compressedData() was written
+    QString spillFile(int id) const;
+    // Spill file content read back in the background
+    bool unspill(int id, const QByteArray &data);
+    // Text of an evicted document read back from disk. Returns true if the
+    // file no longer matches the saved hash; the content is then taken as
+    // the new saved state at a new revision.
+    bool restore(int id, const QString &content, quint64 contentHash);
+
+signals:
+    void documentOpened(int id);
+    void documentClosed(int id, const QString &path);
+    void documentRenamed(int id, const QString &oldPath, const QString &newPath);
+    void documentEdited(int id, quint64 revision, qsizetype position,
+                        qsizetype removedLength, qsizetype insertedLength);
+    void modifiedChanged(int id, bool modified);
+    void residencyChanged(int id, DocumentStore::Residency residency);
+    // An accessor needed the text of an evicted or spilled document
+    void restoreRequested(int id);
+    void residencyFailed(int id, const QString &errorString);
+
+private:
+    enum Flag : quint8 {
+        Open = 0x1,
+        Modified = 0x2
+    };
+
+    QHash<QString, int> m_ids;  // Interned paths of open documents
+    QVector<int> m_freeIds;
+
+    // Per-document state, indexed by id
+    QVector<QString> m_paths;
+    QVector<quint8> m_flags;
+    QVector<quint64> m_revisions;
+    QVector<qint64> m_lastSaved;
+    mutable QVector<PieceTable> m_texts;
+    mutable QVector<DocumentSnapshot> m_snapshots;  // Valid while revision matches
+    QVector<quint64> m_savedHashes;
+    mutable QVector<qsizetype> m_savedLengths;  // -1 until a session placeholder is read
+    QVector<quint64> m_savedRevisions;
+    mutable QVector<quint64> m_hashes;
+    mutable QVector<quint64> m_hashRevisions;  // Revision m_hashes was computed for
+
+    mutable QVector<quint8> m_residency;
+    mutable QVector<QByteArray> m_compressed;
+    QVector<qsizetype> m_lengths;   // Length while not resident
+    mutable QVector<QString> m_spillFiles;
+
+    QTimer *m_hashCheckTimer;
+    QVector<int> m_pendingHashChecks;
+
+    bool hasFlag(int id, Flag flag) const;
+    void setFlag(int id, Flag flag, bool on);
+    int allocate(const QString &path);
+    void checkPendingHashes();
+    bool ensureResident(int id) const;
+    void setResidency(int id, Residency residency);
+};
+
+#endif // DOCUMENTSTORE_H
@@ -0,0 +1,252 @@
+// EditJournal.cpp
+#include "EditJournal.h"
+#include "ContentHash.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace {
+constexpr quint32 kJournalMagic = 0x4d44564a;   // "MDVJ"
+constexpr quint16 kFormatVersion = 2;
+constexpr auto kStreamVersion = QDataStream::Qt_6_0;
+
+// What the records of a journal apply to
+constexpr quint8 kBaseDisk = 0;      // The document file as last saved
+constexpr quint8 kBaseSnapshot = 1;  // The compressed snapshot after the header
+
+constexpr quint8 kEditRecord = 1;
+
+constexpr int kFlushDelayMs = 1000;
+constexpr qint64 kMinCompactionBytes = 256 * 1024;
+}
+
+EditJournal::EditJournal(DocumentStore *store, FileIoService *io, QObject *parent)
+    : QObject(parent)
+    , m_store(store)
+    , m_io(io)
+{
+    QDir().mkpath(journalDirectory());
+
+    // Records are buffered and appended in one write shortly after typing
+    // stops, so there are no wakeups while idle
+    m_flushTimer = new QTimer(this);
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(kFlushDelayMs);
+    connect(m_flushTimer, &QTimer::timeout, this, &EditJournal::flush);
+
+    connect(m_store, &DocumentStore::documentEdited, this, &EditJournal::onDocumentEdited);
+    connect(m_store, &DocumentStore::documentClosed, this, [this](int documentId) {
+        m_journals.remove(documentId);
+    });
+    connect(m_store, &DocumentStore::documentRenamed, this,
+            [this](int documentId, const QString &oldPath) {
+        // The journal is keyed on the old path; the next save starts a new one
+        m_journals.remove(documentId);
+        discard(oldPath);
+    });
+}
+
+void EditJournal::begin(int documentId)
+{
+    QString path = m_store->path(documentId);
+    if (path.isEmpty()) {
+        return;
+    }
+
+    Journal &journal = m_journals[documentId];
+    journal.pending.clear();
+
+    if (m_store->isModified(documentId)) {
+        compact(documentId);
+        return;
+    }
+
+    // Clean, so the saved hash is the hash of the text
+    QByteArray header = journalHeader(path, kBaseDisk, m_store->revision(documentId),
+                                      m_store->length(documentId),
+                                      m_store->savedHash(documentId));
+    m_io->writeData(journalPath(path), header);
+    journal.bytesOnDisk = header.size();
+}
+
+void EditJournal::discard(const QString &path)
+{
+    m_io->removeFile(journalPath(path));
+}
+
+QFuture<EditJournal::Recovery> EditJournal::recover(const QString &path,
+                                                    const QString &diskContent) const
+{
+    return QtConcurrent::run(&EditJournal::replay, path, diskContent);
+}
+
+void EditJournal::flush()
+{
+    for (auto it = m_journals.begin(); it != m_journals.end(); ++it) {
+        int documentId = it.key();
+        Journal &journal = it.value();
+        if (journal.pending.isEmpty()) {
+            continue;
+        }
+
+        // Once the journal outgrows the document, one compressed snapshot
+        // is cheaper to replay than the edits
+        qint64 limit = qMax<qint64>(kMinCompactionBytes,
+                                    m_store->length(documentId) * qint64(sizeof(QChar)));
+        if (journal.bytesOnDisk + journal.pending.size() > limit) {
+            compact(documentId);
+            continue;
+        }
+
+        m_io->appendData(journalPath(m_store->path(documentId)), journal.pending);
+        journal.bytesOnDisk += journal.pending.size();
+        journal.pending.clear();
+    }
+}
+
+void EditJournal::onDocumentEdited(int documentId, quint64 revision, qsizetype position,
+                                   qsizetype removedLength, qsizetype insertedLength)
+{
+    auto it = m_journals.find(documentId);
+    if (it == m_journals.end()) {
+        return;
+    }
+
+    // The store has already applied the edit, so the inserted text is the
+    // range that now starts at position
+    QString insertedText = m_store->textRange(documentId, position, insertedLength);
+
+    QDataStream out(&it->pending, QIODevice::WriteOnly | QIODevice::Append);
+    out.setVersion(kStreamVersion);
+    out << kEditRecord << quint64(revision) << qint64(position) << qint64(removedLength)
+        << insertedText;
+
+    if (!m_flushTimer->isActive()) {
+        m_flushTimer->start();
+    }
+}
+
+void EditJournal::compact(int documentId)
+{
+    DocumentSnapshot snapshot = m_store->snapshot(documentId);
+    if (snapshot.isNull()) {
+        return;  // Keeps the journal that still has the edits
+    }
+    QString path = snapshot.path();
+    QString text = snapshot.text();
+
+    // Header and snapshot replace the journal in one atomic write, so a
+    // crash leaves either the old journal or the new one
+    QByteArray data = journalHeader(path, kBaseSnapshot, snapshot.revision(), text.length(),
+                                    ContentHash::of(text));
+    QDataStream out(&data, QIODevice::WriteOnly | QIODevice::Append);
+    out.setVersion(kStreamVersion);
+    out << qCompress(text.toUtf8());
+    m_io->writeData(journalPath(path), data);
+
+    Journal &journal = m_journals[documentId];
+    journal.pending.clear();
+    journal.bytesOnDisk = data.size();
+}
+
+QByteArray EditJournal::journalHeader(const QString &path, quint8 base, quint64 revision,
+                                      qint64 baseLength, quint64 baseHash) const
+{
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+    out.setVersion(kStreamVersion);
+    out << kJournalMagic << kFormatVersion << path << base << revision << baseLength
+        << baseHash;
+    return header;
+}
+
+QString EditJournal::journalDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/journals";
+}
+
+QString EditJournal::journalPath(const QString &path)
+{
+    QByteArray key = QCryptographicHash::hash(QFileInfo(path).absoluteFilePath().toUtf8(),
+                                              QCryptographicHash::Sha1).toHex();
+    return journalDirectory() + "/" + QString::fromLatin1(key) + ".journal";
+}
+
+EditJournal::Recovery EditJournal::replay(const QString &path, const QString &diskContent)
+{
+    Recovery recovery;
+
+    QFile journalFile(journalPath(path));
+    if (!journalFile.open(QIODevice::ReadOnly)) {
+        return recovery;
+    }
+
+    QDataStream in(&journalFile);
+    in.setVersion(kStreamVersion);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    QString journaledPath;
+    quint8 base = 0;
+    quint64 baseRevision = 0;
+    qint64 baseLength = 0;
+    quint64 baseHash = 0;
+    in >> magic >> version >> journaledPath >> base >> baseRevision >> baseLength >> baseHash;
+    if (in.status() != QDataStream::Ok || magic != kJournalMagic
+        || version != kFormatVersion || journaledPath != path) {
+        return recovery;
+    }
+
+    PieceTable text;
+    quint64 revision = baseRevision;
+    if (base == kBaseSnapshot) {
+        QByteArray compressed;
+        in >> compressed;
+        QString snapshot = QString::fromUtf8(qUncompress(compressed));
+        if (in.status() != QDataStream::Ok || snapshot.length() != baseLength
+            || ContentHash::of(snapshot) != baseHash) {
+            return recovery;
+        }
+        text = PieceTable(snapshot);
+    } else {
+        // Edits against a file that has since changed on disk can't be
+        // replayed, even if it kept its length
+        if (base != kBaseDisk || diskContent.length() != baseLength
+            || ContentHash::of(diskContent) != baseHash) {
+            return recovery;
+        }
+        text = PieceTable(diskContent);
+    }
+
+    // Records are contiguous revisions; stop at the first gap or torn record
+    while (!in.atEnd()) {
+        quint8 kind = 0;
+        quint64 recordRevision = 0;
+        qint64 position = 0;
+        qint64 removedLength = 0;
+        QString insertedText;
+        in >> kind >> recordRevision >> position >> removedLength >> insertedText;
+        if (in.status() != QDataStream::Ok || kind != kEditRecord) {
+            break;
+        }
+
+        if (recordRevision <= revision) {
+            continue;
+        }
+        if (recordRevision != revision + 1 || position < 0 || removedLength < 0
+            || position + removedLength > text.length()) {
+            break;
+        }
+
+        text.replace(position, removedLength, insertedText);
+        revision = recordRevision;
+    }
+
+    recovery.content = text.text();
+    recovery.recovered = recovery.content != diskContent;
+    return recovery;
+}
@@ -0,0 +1,69 @@
+// EditJournal.h
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QObject>
+#include <QFuture>
+#include <QHash>
+#include <QTimer>
+
+#include "DocumentStore.h"
+#include "FileIoService.h"
+
+// Crash-recovery journal for open documents. Every edit is appended to a
+// per-document journal file, so backup I/O is proportional to what was typed
+// rather than to the size of the file. Once a journal grows past the size of
+// its document it is compacted: the journal is rewritten in one write with a
+// compressed snapshot of the text as its base.
+//
+// A journal based on the file on disk records the content hash of that file
+// and is only replayed onto the same text.
+//
+// Files live in AppDataLocation/journals and are named after a hash of the
+// absolute document path, so documents with the same file name don't collide.
+class EditJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Recovery {
+        bool recovered = false;
+        QString content;
+    };
+
+    EditJournal(DocumentStore *store, FileIoService *io, QObject *parent = nullptr);
+
+    // Start a fresh journal for a document. A clean document uses the file
+    // on disk as its base, a modified one is snapshotted first.
+    void begin(int documentId);
+    void discard(const QString &path);
+
+    // Replay the journal left behind for path on top of the file content
+    // read from disk. Runs on a worker thread.
+    QFuture<Recovery> recover(const QString &path, const QString &diskContent) const;
+
+    void flush();
+
+private:
+    struct Journal {
+        QByteArray pending;       // Records not yet appended to disk
+        qint64 bytesOnDisk = 0;
+    };
+
+    DocumentStore *m_store;
+    FileIoService *m_io;
+    QHash<int, Journal> m_journals;  // Journaled documents by id
+    QTimer *m_flushTimer;
+
+    void onDocumentEdited(int documentId, quint64 revision, qsizetype position,
+                          qsizetype removedLength, qsizetype insertedLength);
+    void compact(int documentId);
+    QByteArray journalHeader(const QString &path, quint8 base, quint64 revision,
+                             qint64 baseLength, quint64 baseHash) const;
+
+    static QString journalDirectory();
+    static QString journalPath(const QString &path);
+    static Recovery replay(const QString &path, const QString &diskContent);
+};
+
+#endif // EDITJOURNAL_H
@@ -3,32 +3,37 @@
 #include <QTextCursor>
 #include <QTextBlock>
 
-EditorManager::EditorManager(QObject *parent)
+EditorManager::EditorManager(DocumentStore *store, QObject *parent)
     : QObject(parent)
+    , m_store(store)
 {
+    connect(m_store, &DocumentStore::documentClosed, this, [this](int documentId) {
+        if (documentId < m_editorModes.size()) {
+            m_editorModes[documentId] = EditorMode::VIEW_ONLY;
+        }
+        
+        emit documentClosed(documentId);
+    });
 }
 
-void EditorManager::setEditMode(const QString &filePath)
+void EditorManager::setEditMode(int documentId)
 {
-    m_editorModes[filePath] = EditorMode::EDIT_ONLY;
-    emit modeChanged(filePath, EditorMode::EDIT_ONLY);
+    setMode(documentId, EditorMode::EDIT_ONLY);
 }
 
-void EditorManager::setViewMode(const QString &filePath)
+void EditorManager::setViewMode(int documentId)
 {
-    m_editorModes[filePath] = EditorMode::VIEW_ONLY;
-    emit modeChanged(filePath, EditorMode::VIEW_ONLY);
+    setMode(documentId, EditorMode::VIEW_ONLY);
 }
 
-void EditorManager::setSplitMode(const QString &filePath)
+void EditorManager::setSplitMode(int documentId)
 {
-    m_editorModes[filePath] = EditorMode::SPLIT_VIEW;
-    emit modeChanged(filePath, EditorMode::SPLIT_VIEW);
+    setMode(documentId, EditorMode::SPLIT_VIEW);
 }
 
-void EditorManager::toggleMode(const QString &filePath)
+void EditorManager::toggleMode(int documentId)
 {
-    EditorMode current = m_editorModes.value(filePath, EditorMode::VIEW_ONLY);
+    EditorMode current = currentMode(documentId);
     EditorMode newMode;
     
     switch (current) {
@@ -43,25 +48,24 @@ void EditorManager::toggleMode(const QString &filePath)
             break;
     }
     
-    m_editorModes[filePath] = newMode;
-    emit modeChanged(filePath, newMode);
+    setMode(documentId, newMode);
 }
 
-EditorMode EditorManager::currentMode(const QString &filePath) const
+EditorMode EditorManager::currentMode(int documentId) const
 {
-    return m_editorModes.value(filePath, EditorMode::VIEW_ONLY);
+    return m_editorModes.value(documentId, EditorMode::VIEW_ONLY);
 }
 
-QString EditorManager::currentContent(const QString &filePath) const
+QString EditorManager::currentContent(int documentId) const
 {
-    return m_editorContents.value(filePath);
+    return m_store->content(documentId);
 }
 
-void EditorManager::setFormatting(const QString &filePath, ElementType type)
+void EditorManager::setFormatting(int documentId, ElementType type)
 {
     // In a real implementation, this would interact with the QTextDocument
     // to apply formatting to the selected text
-    QString content = m_editorContents[filePath];
+    QString content = m_store->content(documentId);
     
     switch (type) {
         case ElementType::BOLD:
@@ -102,52 +106,49 @@ void EditorManager::setFormatting(const QString &filePath, ElementType type)
             break;
     }
     
-    setDocumentContent(filePath, content);
+    setDocumentContent(documentId, content);
 }
 
-void EditorManager::insertElement(const QString &filePath, ElementType element)
+void EditorManager::insertElement(int documentId, ElementType element)
 {
-    setFormatting(filePath, element);
+    setFormatting(documentId, element);
 }
 
-void EditorManager::setDocumentContent(const QString &filePath, const QString &content)
+void EditorManager::setDocumentContent(int documentId, const QString &content)
 {
-    if (m_editorContents[filePath] != content) {
-        m_editorContents[filePath] = content;
-        updateModifiedStatus(filePath);
-        emit contentChanged(filePath, content);
+    quint64 revision = m_store->revision(documentId);
+    m_store->setContent(documentId, content);
+    if (m_store->revision(documentId) != revision) {
+        emit contentChanged(documentId, content);
     }
 }
 
-bool EditorManager::isDocumentModified(const QString &filePath) const
+bool EditorManager::isDocumentModified(int documentId) const
 {
-    return m_modifiedStatus.value(filePath, false);
+    return m_store->isModified(documentId);
 }
 
-QStringList EditorManager::openDocuments() const
+QVector<int> EditorManager::openDocuments() const
 {
-    return m_editorContents.keys();
+    return m_store->ids();
 }
 
-void EditorManager::closeDocument(const QString &filePath)
+void EditorManager::closeDocument(int documentId)
 {
-    m_editorModes.remove(filePath);
-    m_editorContents.remove(filePath);
-    m_modifiedStatus.remove(filePath);
-    
-    if (m_documents.contains(filePath)) {
-        delete m_documents[filePath];
-        m_documents.remove(filePath);
-    }
-    
-    emit documentClosed(filePath);
+    // View state is dropped when the store reports the close
+    m_store->close(documentId);
 }
 
-void EditorManager::updateModifiedStatus(const QString &filePath)
+void EditorManager::setMode(int documentId, EditorMode mode)
 {
-    // In a real implementation, we would compare the current content with the saved version
-    bool isModified = true; // Simplified logic
-    if (m_modifiedStatus[filePath] != isModified) {
-        m_modifiedStatus[filePath] = isModified;
+    if (!m_store->isOpen(documentId)) {
+        return;
     }
-}
\ No newline at end of file
+    
+    if (documentId >= m_editorModes.size()) {
+        m_editorModes.resize(m_store->capacity(), EditorMode::VIEW_ONLY);
+    }
+    
+    m_editorModes[documentId] = mode;
+    emit modeChanged(documentId, mode);
+}
@@ -6,6 +6,8 @@
 #include <QHash>
 #include <QTextDocument>
 
+#include "DocumentStore.h"
+
 enum class EditorMode {
     VIEW_ONLY,
     EDIT_ONLY,
@@ -32,37 +34,37 @@ class EditorManager : public QObject
     Q_OBJECT
     
 public:
-    explicit EditorManager(QObject *parent = nullptr);
+    explicit EditorManager(DocumentStore *store, QObject *parent = nullptr);
     
-    void setEditMode(const QString &filePath);
-    void setViewMode(const QString &filePath);
-    void setSplitMode(const QString &filePath);
-    void toggleMode(const QString &filePath);
+    void setEditMode(int documentId);
+    void setViewMode(int documentId);
+    void setSplitMode(int documentId);
+    void toggleMode(int documentId);
     
-    EditorMode currentMode(const QString &filePath) const;
-    QString currentContent(const QString &filePath) const;
+    EditorMode currentMode(int documentId) const;
+    QString currentContent(int documentId) const;
     
-    void setFormatting(const QString &filePath, ElementType type);
-    void insertElement(const QString &filePath, ElementType element);
+    void setFormatting(int documentId, ElementType type);
+    void insertElement(int documentId, ElementType element);
     
-    bool isDocumentModified(const QString &filePath) const;
-    void setDocumentContent(const QString &filePath, const QString &content);
+    bool isDocumentModified(int documentId) const;
+    void setDocumentContent(int documentId, const QString &content);
     
-    QStringList openDocuments() const;
-    void closeDocument(const QString &filePath);
+    QVector<int> openDocuments() const;
+    void closeDocument(int documentId);
     
 signals:
-    void modeChanged(const QString &filePath, EditorMode mode);
-    void contentChanged(const QString &filePath, const QString &content);
-    void documentClosed(const QString &filePath);
+    void modeChanged(int documentId, EditorMode mode);
+    void contentChanged(int documentId, const QString &content);
+    void documentClosed(int documentId);
     
 private:
-    QHash<QString, EditorMode> m_editorModes;
-    QHash<QString, QString> m_editorContents;
-    QHash<QString, bool> m_modifiedStatus;
-    QHash<QString, QTextDocument*> m_documents;
+    DocumentStore *m_store;  // Owns content and modified state
+    
+    // View state, indexed by document id
+    QVector<EditorMode> m_editorModes;
     
-    void updateModifiedStatus(const QString &filePath);
+    void setMode(int documentId, EditorMode mode);
 };
 
 #endif // EDITORMANAGER_H
\ No newline at end of file
@@ -0,0 +1,117 @@
+// ExplorerBenchmark.cpp
+#include "ExplorerBenchmark.h"
+#include "FileExplorerModel.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QVector>
+#include <QDebug>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+constexpr int kRowsPerFrame = 40;
+constexpr int kLoadTimeoutMs = 120000;
+
+const char *const kSuffixes[] = {"md", "markdown", "txt", "png", "json", "cpp", "h", "pdf"};
+
+bool createTree(const QString &root, int entryCount)
+{
+    QDir dir(root);
+    for (int i = 0; i < entryCount; ++i) {
+        // Every 50th entry is a directory, the rest files of mixed types
+        QString name = QString("entry-%1").arg(i, 6, 10, QChar('0'));
+        if (i % 50 == 0) {
+            if (!dir.mkdir(name)) {
+                return false;
+            }
+            continue;
+        }
+        QFile file(dir.filePath(name + '.' + kSuffixes[i % std::size(kSuffixes)]));
+        if (!file.open(QIODevice::WriteOnly)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double percentile(QVector<qint64> values, double p)
+{
+    if (values.isEmpty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values.at(qMin<qsizetype>(values.size() - 1, qsizetype(p * values.size()))) / 1000.0;
+}
+}
+
+namespace ExplorerBenchmark {
+
+int runScroll(int entryCount)
+{
+    if (entryCount <= 0) {
+        qWarning() << "The entry count must be positive";
+        return 1;
+    }
+
+    QTemporaryDir tree;
+    if (!tree.isValid() || !createTree(tree.path(), entryCount)) {
+        qWarning() << "Could not create the synthetic tree";
+        return 1;
+    }
+
+    FileExplorerModel model;
+    QModelIndex root = model.setRootPath(tree.path());
+
+    // Listing happens on QFileSystemModel's gatherer thread; wait until all
+    // rows have arrived
+    QElapsedTimer loadTimer;
+    loadTimer.start();
+    while (model.rowCount(root) < entryCount && loadTimer.elapsed() < kLoadTimeoutMs) {
+        if (model.canFetchMore(root)) {
+            model.fetchMore(root);
+        }
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+    }
+    int rows = model.rowCount(root);
+    if (rows < entryCount) {
+        qWarning() << "Only" << rows << "of" << entryCount << "entries were listed";
+        return 1;
+    }
+    qInfo().noquote() << QString("Listed %1 entries in %2 ms").arg(rows).arg(loadTimer.elapsed());
+
+    // One frame draws one screen of rows
+    QVector<qint64> frames;
+    frames.reserve(rows / kRowsPerFrame + 1);
+    QElapsedTimer frameTimer;
+    for (int first = 0; first < rows; first += kRowsPerFrame) {
+        frameTimer.start();
+        int last = qMin(rows, first + kRowsPerFrame);
+        for (int row = first; row < last; ++row) {
+            QModelIndex index = model.index(row, 0, root);
+            model.data(index, Qt::DisplayRole);
+            model.data(index, Qt::DecorationRole);
+            model.data(index, QFileSystemModel::FilePathRole);
+        }
+        frames.append(frameTimer.nsecsElapsed() / 1000);
+    }
+
+    // Compare the same-sized slices at the start, middle and end
+    qsizetype slice = qMax<qsizetype>(1, frames.size() / 10);
+    auto report = [&](const char *label, qsizetype from) {
+        QVector<qint64> part = frames.mid(from, slice);
+        qInfo().noquote() << QString("  %1: median %2 ms, p99 %3 ms per frame")
+                                 .arg(label, -6)
+                                 .arg(percentile(part, 0.5), 0, 'f', 3)
+                                 .arg(percentile(part, 0.99), 0, 'f', 3);
+    };
+    qInfo().noquote() << QString("Scrolled %1 frames of %2 rows").arg(frames.size()).arg(kRowsPerFrame);
+    report("start", 0);
+    report("middle", (frames.size() - slice) / 2);
+    report("end", frames.size() - slice);
+    return 0;
+}
+
+}
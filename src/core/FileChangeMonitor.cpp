@@ -0,0 +1,185 @@
+// FileChangeMonitor.cpp
+#include "FileChangeMonitor.h"
+#include <QFileInfo>
+
+FileChangeMonitor::FileChangeMonitor(DocumentStore *store, FileIoService *io,
+                                     WorkspaceWatcher *workspace, QObject *parent)
+    : QObject(parent)
+    , m_store(store)
+    , m_io(io)
+    , m_workspace(workspace)
+    , m_suppressedEvents(0)
+{
+    m_workspace->subscribe(QString(), this, [this](const QVector<WorkspaceEvent> &events) {
+        onWorkspaceEvents(events);
+    });
+
+    // A save usually produces several events (truncate, write, close, rename)
+    m_debounceTimer = new QTimer(this);
+    m_debounceTimer->setSingleShot(true);
+    m_debounceTimer->setInterval(200);
+    connect(m_debounceTimer, &QTimer::timeout, this, &FileChangeMonitor::checkPending);
+}
+
+void FileChangeMonitor::watch(const QString &path)
+{
+    if (m_states.contains(path)) {
+        return;
+    }
+
+    QFileInfo info(path);
+    FileState &state = m_states[path];
+    state.size = info.size();
+    state.lastModified = info.lastModified();
+    int id = m_store->documentId(path);
+    state.contentHash = id != DocumentStore::InvalidId ? m_store->savedHash(id) : 0;
+
+    m_workspace->watchFile(path);
+}
+
+void FileChangeMonitor::unwatch(const QString &path)
+{
+    if (!m_states.remove(path)) {
+        return;
+    }
+
+    m_pending.remove(path);
+    m_expectedWrites.remove(path);
+    m_workspace->unwatchFile(path);
+}
+
+void FileChangeMonitor::noteFileState(const FileIoService::Result &result)
+{
+    auto it = m_states.find(result.path);
+    if (it == m_states.end() || !result.success) {
+        return;
+    }
+
+    it->size = result.size;
+    it->lastModified = result.lastModified;
+    it->contentHash = result.contentHash;
+}
+
+void FileChangeMonitor::expectWrite(const QString &path, quint64 contentHash)
+{
+    m_expectedWrites[path].append(contentHash);
+}
+
+void FileChangeMonitor::writeFinished(const QString &path, quint64 contentHash)
+{
+    auto it = m_expectedWrites.find(path);
+    if (it == m_expectedWrites.end()) {
+        return;
+    }
+    it->removeOne(contentHash);
+    if (it->isEmpty()) {
+        m_expectedWrites.erase(it);
+    }
+}
+
+void FileChangeMonitor::setDebounceInterval(int msecs)
+{
+    m_debounceTimer->setInterval(msecs);
+}
+
+void FileChangeMonitor::onWorkspaceEvents(const QVector<WorkspaceEvent> &events)
+{
+    // Events arrive with absolute paths; documents may be opened by a
+    // relative one, so compare on the absolute form
+    QHash<QString, QString> watched;
+    for (auto it = m_states.cbegin(); it != m_states.cend(); ++it) {
+        watched.insert(QFileInfo(it.key()).absoluteFilePath(), it.key());
+    }
+
+    for (const WorkspaceEvent &event : events) {
+        if (event.type == WorkspaceEvent::Rescan) {
+            for (auto it = m_states.cbegin(); it != m_states.cend(); ++it) {
+                m_pending.insert(it.key());
+            }
+            continue;
+        }
+        if (watched.contains(event.path)) {
+            m_pending.insert(watched.value(event.path));
+        }
+        if (!event.oldPath.isEmpty() && watched.contains(event.oldPath)) {
+            m_pending.insert(watched.value(event.oldPath));
+        }
+    }
+
+    if (!m_pending.isEmpty()) {
+        m_debounceTimer->start();
+    }
+}
+
+void FileChangeMonitor::checkPending()
+{
+    const QSet<QString> pending = m_pending;
+    m_pending.clear();
+
+    for (const QString &path : pending) {
+        auto it = m_states.find(path);
+        if (it == m_states.end()) {
+            continue;
+        }
+
+        int id = m_store->documentId(path);
+        QFileInfo info(path);
+        if (!info.exists()) {
+            if (id != DocumentStore::InvalidId) {
+                emit fileRemoved(id, path);
+            }
+            continue;
+        }
+
+        // Same size and mtime as our last read or write: our own save or a
+        // touch, no need to read the file. With a write still in flight the
+        // recorded state is stale, so the content decides.
+        if (!m_expectedWrites.contains(path)
+            && info.size() == it->size && info.lastModified() == it->lastModified) {
+            m_suppressedEvents++;
+            continue;
+        }
+
+        reload(path);
+    }
+}
+
+void FileChangeMonitor::reload(const QString &path)
+{
+    m_io->readFile(path).then(this, [this, path](const FileIoService::Result &result) {
+        auto it = m_states.find(path);
+        int id = m_store->documentId(path);
+        if (it == m_states.end() || id == DocumentStore::InvalidId || !result.success) {
+            return;
+        }
+
+        it->size = result.size;
+        it->lastModified = result.lastModified;
+
+        // Rewritten with the same bytes, e.g. by a formatter or a git
+        // checkout, or our own write that has not reported back yet
+        if (result.contentHash == it->contentHash
+            || m_expectedWrites.value(path).contains(result.contentHash)) {
+            it->contentHash = result.contentHash;
+            m_suppressedEvents++;
+            return;
+        }
+        it->contentHash = result.contentHash;
+
+        if (m_store->isModified(id)) {
+            emit documentConflict(id, path);
+            return;
+        }
+
+        // An evicted document is read from disk when it is activated again
+        if (m_store->residency(id) == DocumentStore::Evicted) {
+            return;
+        }
+
+        // setContent() reduces the new text to a single edit, so editors and
+        // the journal see a delta instead of a full replacement
+        m_store->setContent(id, result.content);
+        m_store->markSaved(id, m_store->revision(id), result.contentHash, result.content.length());
+        emit documentReloaded(id);
+    });
+}
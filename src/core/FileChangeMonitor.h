@@ -0,0 +1,77 @@
+// FileChangeMonitor.h
+#ifndef FILECHANGEMONITOR_H
+#define FILECHANGEMONITOR_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+
+#include "DocumentStore.h"
+#include "FileIoService.h"
+#include "WorkspaceWatcher.h"
+
+// Watches the files of open documents and reloads them when they change on
+// disk. Notifications caused by our own saves are recognized by the content
+// hash announced when the write was queued, and by the size and mtime
+// recorded once it finished. Bursts of events for one file are coalesced
+// into a single check.
+//
+// Events come from the shared WorkspaceWatcher, which watches the parent
+// directory, so saves that rename a temporary file over the original are
+// seen like any other change.
+class FileChangeMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    FileChangeMonitor(DocumentStore *store, FileIoService *io, WorkspaceWatcher *workspace,
+                      QObject *parent = nullptr);
+
+    void watch(const QString &path);
+    void unwatch(const QString &path);
+
+    // Record what a read or write left on disk so the resulting
+    // notifications are not mistaken for external changes
+    void noteFileState(const FileIoService::Result &result);
+
+    // A write of text with this hash is queued for path. Until
+    // writeFinished() the file is read on every event and a match is taken
+    // as our own write, however late the write completes.
+    void expectWrite(const QString &path, quint64 contentHash);
+    void writeFinished(const QString &path, quint64 contentHash);
+
+    void setDebounceInterval(int msecs);
+    int suppressedEvents() const { return m_suppressedEvents; }
+
+signals:
+    // The document was clean and now holds the new file content. The store
+    // has already emitted the difference as a regular edit.
+    void documentReloaded(int documentId);
+    // The file changed while the document has unsaved edits
+    void documentConflict(int documentId, const QString &path);
+    void fileRemoved(int documentId, const QString &path);
+
+private:
+    struct FileState {
+        qint64 size = -1;
+        QDateTime lastModified;
+        quint64 contentHash = 0;
+    };
+
+    DocumentStore *m_store;
+    FileIoService *m_io;
+    WorkspaceWatcher *m_workspace;
+    QTimer *m_debounceTimer;
+    QHash<QString, FileState> m_states;     // Watched files by path
+    QSet<QString> m_pending;                // Files with events since the last check
+    QHash<QString, QList<quint64>> m_expectedWrites;  // Hashes of writes in flight
+    int m_suppressedEvents;
+
+    void onWorkspaceEvents(const QVector<WorkspaceEvent> &events);
+    void checkPending();
+    void reload(const QString &path);
+};
+
+#endif // FILECHANGEMONITOR_H
@@ -1,14 +1,21 @@
 #include "FileExplorerModel.h"
+#include "WorkspaceWatcher.h"
 #include <QMimeType>
 #include <QFile>
 #include <QTextStream>
 #include <QtWidgets/QMessageBox>
 #include <QDir>
 #include <QIcon>
+#include <QDirIterator>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
 
 FileExplorerModel::FileExplorerModel(QObject *parent)
     : QFileSystemModel(parent)
     , m_markdownOnly(false)
+    , m_pendingOperations(0)
+    , m_watcher(nullptr)
 {
     setIconProvider(&m_iconProvider);
 }
@@ -26,13 +33,20 @@ Qt::ItemFlags FileExplorerModel::flags(const QModelIndex &index) const
 QVariant FileExplorerModel::data(const QModelIndex &index, int role) const
 {
     if (role == Qt::DecorationRole && index.column() == 0) {
-        QFileInfo info = fileInfo(index);
-        return iconForFile(info);
+        return cachedIcon(index);
     }
     
     return QFileSystemModel::data(index, role);
 }
 
+void FileExplorerModel::fetchMore(const QModelIndex &parent)
+{
+    QFileSystemModel::fetchMore(parent);
+    if (parent.isValid() && isDir(parent)) {
+        watchDirectory(filePath(parent));
+    }
+}
+
 QIcon FileExplorerModel::iconForFile(const QFileInfo &info) const
 {
     if (info.isDir()) {
@@ -48,82 +62,153 @@ QIcon FileExplorerModel::iconForFile(const QFileInfo &info) const
     return m_iconProvider.icon(QFileInfo());
 }
 
-bool FileExplorerModel::createFile(const QString &path, const QString &fileName)
+void FileExplorerModel::createFile(const QString &path, const QString &fileName)
 {
     QString fullPath = path + "/" + fileName;
-    if (QFile::exists(fullPath)) {
-        emit fileOperationError("File already exists: " + fullPath);
-        return false;
-    }
-    
-    QFile file(fullPath);
-    if (file.open(QIODevice::WriteOnly)) {
-        file.close();
-        // Reset the model to refresh data
-        beginResetModel();
-        endResetModel();
-        return true;
-    }
-    
-    emit fileOperationError("Could not create file: " + fullPath);
-    return false;
+    track(QtConcurrent::run([fullPath]() {
+        OperationResult result;
+        result.operation = FileOperation::CreateFile;
+        result.path = fullPath;
+        
+        QFile file(fullPath);
+        if (file.exists()) {
+            result.errorString = "File already exists: " + fullPath;
+        } else if (!file.open(QIODevice::WriteOnly | QIODevice::NewOnly)) {
+            result.errorString = "Could not create file: " + fullPath;
+        } else {
+            result.success = true;
+        }
+        return result;
+    }));
 }
 
-bool FileExplorerModel::createDirectory(const QString &path, const QString &dirName)
+void FileExplorerModel::createDirectory(const QString &path, const QString &dirName)
 {
     QString fullPath = path + "/" + dirName;
-    QDir dir(path);
+    track(QtConcurrent::run([path, dirName, fullPath]() {
+        OperationResult result;
+        result.operation = FileOperation::CreateDirectory;
+        result.path = fullPath;
+        
+        result.success = QDir(path).mkdir(dirName);
+        if (!result.success) {
+            result.errorString = "Could not create directory: " + fullPath;
+        }
+        return result;
+    }));
+}
+
+void FileExplorerModel::renameFile(const QString &oldPath, const QString &newPath)
+{
+    track(QtConcurrent::run([oldPath, newPath]() {
+        OperationResult result;
+        result.operation = FileOperation::Rename;
+        result.path = oldPath;
+        result.newPath = newPath;
+        
+        if (QFileInfo::exists(newPath)) {
+            result.errorString = "File already exists: " + newPath;
+        } else if (!QFile::rename(oldPath, newPath)) {
+            result.errorString = "Could not rename file: " + oldPath;
+        } else {
+            result.success = true;
+        }
+        return result;
+    }));
+}
+
+void FileExplorerModel::deleteFile(const QString &path)
+{
+    QFuture<OperationResult> future = QtConcurrent::run(&FileExplorerModel::removeRecursively, path);
     
-    if (dir.mkdir(dirName)) {
-        // Reset the model to refresh data
-        beginResetModel();
-        endResetModel();
-        return true;
-    }
+    auto *watcher = new QFutureWatcher<OperationResult>(this);
+    connect(watcher, &QFutureWatcherBase::progressValueChanged, this,
+            [this, watcher, path](int value) {
+        emit operationProgress(path, value, watcher->progressMaximum());
+    });
+    connect(watcher, &QFutureWatcherBase::finished, watcher, &QObject::deleteLater);
+    watcher->setFuture(future);
     
-    emit fileOperationError("Could not create directory: " + fullPath);
-    return false;
+    track(future);
 }
 
-bool FileExplorerModel::renameFile(const QString &oldPath, const QString &newPath)
+void FileExplorerModel::track(const QFuture<OperationResult> &future)
 {
-    if (QFile::exists(newPath)) {
-        emit fileOperationError("File already exists: " + newPath);
-        return false;
-    }
-    
-    if (QFile::rename(oldPath, newPath)) {
-        // Reset the model to refresh data
-        beginResetModel();
-        endResetModel();
-        return true;
+    ++m_pendingOperations;
+    future.then(this, [this](const OperationResult &result) {
+        --m_pendingOperations;
+        finishOperation(result);
+    });
+}
+
+void FileExplorerModel::finishOperation(const OperationResult &result)
+{
+    if (!result.success) {
+        emit fileOperationError(result.errorString);
     }
-    
-    emit fileOperationError("Could not rename file: " + oldPath);
-    return false;
+    emit fileOperationFinished(result.operation, result.path, result.success);
 }
 
-bool FileExplorerModel::deleteFile(const QString &path)
+void FileExplorerModel::removeRecursively(QPromise<OperationResult> &promise, const QString &path)
 {
-    QFileInfo fileInfo(path);
-    bool success = false;
+    OperationResult result;
+    result.operation = FileOperation::Delete;
+    result.path = path;
     
-    if (fileInfo.isDir()) {
-        QDir dir(path);
-        success = dir.removeRecursively();
-    } else {
-        success = QFile::remove(path);
+    QFileInfo info(path);
+    if (!info.isDir() || info.isSymLink()) {
+        result.success = QFile::remove(path);
+        if (!result.success) {
+            result.errorString = "Could not delete: " + path;
+        }
+        promise.addResult(result);
+        return;
     }
     
-    if (success) {
-        // Reset the model to refresh data
-        beginResetModel();
-        endResetModel();
-        return true;
+    // List everything first so progress has a known range. Symlinked
+    // directories are removed as links, not followed.
+    QStringList files;
+    QStringList directories;
+    QDirIterator it(path, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        QFileInfo entry = it.fileInfo();
+        if (entry.isDir() && !entry.isSymLink()) {
+            directories.append(entry.filePath());
+        } else {
+            files.append(entry.filePath());
+        }
     }
     
-    emit fileOperationError("Could not delete: " + path);
-    return false;
+    promise.setProgressRange(0, files.size() + directories.size() + 1);
+    int done = 0;
+    QString failed;
+    
+    for (const QString &file : std::as_const(files)) {
+        if (!QFile::remove(file) && failed.isEmpty()) {
+            failed = file;
+        }
+        promise.setProgressValue(++done);
+    }
+    
+    // Deepest first, so each directory is empty when it is removed
+    std::sort(directories.begin(), directories.end(), [](const QString &a, const QString &b) {
+        return a.size() > b.size();
+    });
+    directories.append(path);
+    for (const QString &directory : std::as_const(directories)) {
+        if (!QDir().rmdir(directory) && failed.isEmpty()) {
+            failed = directory;
+        }
+        promise.setProgressValue(++done);
+    }
+    
+    result.success = failed.isEmpty();
+    if (!result.success) {
+        result.errorString = "Could not delete: " + failed;
+    }
+    promise.addResult(result);
 }
 
 void FileExplorerModel::setMarkdownOnly(bool markdownOnly)
@@ -137,10 +222,126 @@ void FileExplorerModel::setMarkdownOnly(bool markdownOnly)
     }
 }
 
+void FileExplorerModel::setWorkspaceWatcher(WorkspaceWatcher *watcher)
+{
+    // QFileSystemModel keeps watching the directories it has listed for
+    // entries being added or removed; it doesn't notice files changing in
+    // place, which is what the workspace events are used for
+    m_watcher = watcher;
+    watcher->subscribe(QString(), this, [this](const QVector<WorkspaceEvent> &events) {
+        onWorkspaceEvents(events);
+    });
+
+    connect(this, &QFileSystemModel::rootPathChanged, this, [this](const QString &path) {
+        unwatchDirectories(QString());
+        watchDirectory(path);
+    });
+    if (!rootPath().isEmpty()) {
+        watchDirectory(rootPath());
+    }
+}
+
+void FileExplorerModel::watchDirectory(const QString &path)
+{
+    if (m_watcher && !path.isEmpty() && !m_watchedDirectories.contains(path)) {
+        m_watchedDirectories.insert(path);
+        m_watcher->watchDirectory(path);
+    }
+}
+
+// path and everything under it; all directories for an empty path
+void FileExplorerModel::unwatchDirectories(const QString &path)
+{
+    for (auto it = m_watchedDirectories.begin(); it != m_watchedDirectories.end();) {
+        if (path.isEmpty() || *it == path || it->startsWith(path + '/')) {
+            m_watcher->unwatchDirectory(*it);
+            it = m_watchedDirectories.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void FileExplorerModel::onWorkspaceEvents(const QVector<WorkspaceEvent> &events)
+{
+    for (const WorkspaceEvent &event : events) {
+        if (event.isDirectory && (event.type == WorkspaceEvent::Removed
+                                  || event.type == WorkspaceEvent::Moved)) {
+            unwatchDirectories(event.type == WorkspaceEvent::Moved ? event.oldPath : event.path);
+            continue;
+        }
+        if (event.type != WorkspaceEvent::Modified || event.isDirectory) {
+            continue;
+        }
+        
+        if (!event.path.startsWith(rootPath())) {
+            continue;
+        }
+        
+        QModelIndex first = index(event.path, 0);
+        if (first.isValid()) {
+            emit dataChanged(first, first.siblingAtColumn(columnCount(first.parent()) - 1));
+        }
+    }
+}
+
+FileExplorerModel::FileKind FileExplorerModel::classify(const QString &fileName, bool isDirectory)
+{
+    if (isDirectory) {
+        return FileKind::Directory;
+    }
+    if (fileName.endsWith(".md", Qt::CaseInsensitive)
+        || fileName.endsWith(".markdown", Qt::CaseInsensitive)) {
+        return FileKind::Markdown;
+    }
+    return FileKind::Other;
+}
+
+QIcon FileExplorerModel::cachedIcon(const QModelIndex &index) const
+{
+    // The node already holds the name and type gathered when the directory
+    // was listed, so no QFileInfo is built per request
+    bool directory = isDir(index);
+    QString name = fileName(index);
+    QString key = typeKey(name, directory);
+    
+    auto it = m_iconCache.constFind(key);
+    if (it != m_iconCache.constEnd()) {
+        return *it;
+    }
+    
+    QIcon icon = iconForFile(fileInfo(index));
+    m_iconCache.insert(key, icon);
+    return icon;
+}
+
+QString FileExplorerModel::typeKey(const QString &fileName, bool isDirectory)
+{
+    if (isDirectory) {
+        return QStringLiteral("/");
+    }
+    qsizetype dot = fileName.lastIndexOf('.');
+    return dot > 0 ? fileName.mid(dot + 1).toLower() : QString();
+}
+
 bool FileExplorerModel::isMarkdownFile(const QFileInfo &info) const
 {
     if (!info.isFile()) return false;
     
-    QString suffix = info.suffix().toLower();
-    return (suffix == "md" || suffix == "markdown");
+    return classify(info.fileName(), false) == FileKind::Markdown;
+}
+
+bool FileExplorerModel::isMarkdownFile(const QString &path) const
+{
+    return isMarkdownFile(QFileInfo(path));
+}
+
+void FileExplorerModel::refresh()
+{
+    QString root = rootPath();
+    if (root.isEmpty()) {
+        return;
+    }
+    setRootPath(QString());
+    setRootPath(root);
 }
\ No newline at end of file
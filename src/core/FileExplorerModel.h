@@ -2,11 +2,18 @@
 #define FILEEXPLORERMODEL_H
 
 #include <QFileSystemModel>
+#include <QHash>
+#include <QSet>
+#include <QFuture>
+#include <QPromise>
 #include <QIcon>
 #include <QDir>
 #include <QMimeDatabase>
 #include <QtWidgets/QFileIconProvider>
 
+class WorkspaceWatcher;
+struct WorkspaceEvent;
+
 class FileExplorerModel : public QFileSystemModel
 {
     Q_OBJECT
@@ -14,6 +21,22 @@ class FileExplorerModel : public QFileSystemModel
 public:
     explicit FileExplorerModel(QObject *parent = nullptr);
     
+    enum class FileOperation {
+        CreateFile,
+        CreateDirectory,
+        Rename,
+        Delete
+    };
+    Q_ENUM(FileOperation)
+    
+    struct OperationResult {
+        FileOperation operation = FileOperation::CreateFile;
+        QString path;
+        QString newPath;     // Target of a rename
+        bool success = false;
+        QString errorString;
+    };
+    
     // Override flags to support drag and drop
     Qt::ItemFlags flags(const QModelIndex &index) const override;
     
@@ -23,26 +46,70 @@ public:
     // Get file icon based on file type
     QIcon iconForFile(const QFileInfo &info) const;
     
-    // Methods for file operations
-    bool createFile(const QString &path, const QString &fileName);
-    bool createDirectory(const QString &path, const QString &dirName);
-    bool renameFile(const QString &oldPath, const QString &newPath);
-    bool deleteFile(const QString &path);
+    // Listing a directory (expanding its node) also registers it with the
+    // workspace watcher
+    void fetchMore(const QModelIndex &parent) override;
+    
+    enum class FileKind {
+        Directory,
+        Markdown,
+        Other
+    };
+    // By name only; never touches the disk
+    static FileKind classify(const QString &fileName, bool isDirectory);
+    
+    // File operations run on a worker thread and report through
+    // fileOperationFinished(). The rows change as QFileSystemModel sees the
+    // result on disk, one inserted or removed row at a time, so expanded
+    // nodes and the scroll position survive.
+    Q_INVOKABLE void createFile(const QString &path, const QString &fileName);
+    Q_INVOKABLE void createDirectory(const QString &path, const QString &dirName);
+    Q_INVOKABLE void renameFile(const QString &oldPath, const QString &newPath);
+    // Directories are removed recursively with operationProgress() updates
+    Q_INVOKABLE void deleteFile(const QString &path);
+    int pendingOperations() const { return m_pendingOperations; }
     
     // Filter for markdown files
     void setMarkdownOnly(bool markdownOnly);
     bool isMarkdownOnly() const { return m_markdownOnly; }
+    Q_INVOKABLE bool isMarkdownFile(const QString &path) const;
+    
+    // Re-lists the root, for changes the watcher missed
+    Q_INVOKABLE void refresh();
+    
+    // Refresh size and date of files changed on disk. The root and every
+    // listed directory are watched until the root changes.
+    void setWorkspaceWatcher(WorkspaceWatcher *watcher);
     
 signals:
     void fileOpened(const QString &filePath);
     void fileOperationError(const QString &error);
+    void fileOperationFinished(FileExplorerModel::FileOperation operation, const QString &path,
+                               bool success);
+    void operationProgress(const QString &path, int done, int total);
 
 private:
     bool m_markdownOnly;
     QMimeDatabase m_mimeDatabase;
     QFileIconProvider m_iconProvider;
+    int m_pendingOperations;
+    WorkspaceWatcher *m_watcher;
+    QSet<QString> m_watchedDirectories;
+    
+    // Icons by type: "/" for directories, otherwise the lowercase suffix.
+    // The platform icon theme is asked once per type, not once per row.
+    mutable QHash<QString, QIcon> m_iconCache;
+    
+    QIcon cachedIcon(const QModelIndex &index) const;
+    static QString typeKey(const QString &fileName, bool isDirectory);
     
+    void track(const QFuture<OperationResult> &future);
+    void finishOperation(const OperationResult &result);
+    static void removeRecursively(QPromise<OperationResult> &promise, const QString &path);
     bool isMarkdownFile(const QFileInfo &info) const;
+    void onWorkspaceEvents(const QVector<WorkspaceEvent> &events);
+    void watchDirectory(const QString &path);
+    void unwatchDirectories(const QString &path);
 };
 
 #endif // FILEEXPLORERMODEL_H
\ No newline at end of file
@@ -0,0 +1,259 @@
+// FileIoService.cpp
+#include "FileIoService.h"
+#include "ContentHash.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QDebug>
+
+FileIoService::FileIoService(QObject *parent)
+    : QObject(parent)
+    , m_nextSerial(0)
+    , m_slowThresholdMs(500)
+    , m_coalescedWrites(0)
+{
+    m_pool = new QThreadPool(this);
+    m_pool->setMaxThreadCount(4);
+    m_pool->setObjectName("FileIoService");
+}
+
+FileIoService::~FileIoService()
+{
+    waitForDone();
+}
+
+QFuture<FileIoService::Result> FileIoService::readFile(const QString &path)
+{
+    return enqueue(Operation::Read, path, QString());
+}
+
+QFuture<FileIoService::Result> FileIoService::readData(const QString &path)
+{
+    return enqueue(Operation::ReadData, path, QString());
+}
+
+QFuture<FileIoService::Result> FileIoService::writeFile(const QString &path, const QString &content)
+{
+    return enqueue(Operation::Write, path, content);
+}
+
+QFuture<FileIoService::Result> FileIoService::writeData(const QString &path, const QByteArray &data)
+{
+    return enqueue(Operation::WriteData, path, QString(), data);
+}
+
+QFuture<FileIoService::Result> FileIoService::appendData(const QString &path, const QByteArray &data)
+{
+    return enqueue(Operation::Append, path, QString(), data);
+}
+
+QFuture<FileIoService::Result> FileIoService::removeFile(const QString &path)
+{
+    return enqueue(Operation::Remove, path, QString());
+}
+
+void FileIoService::setSlowOperationThreshold(int msecs)
+{
+    m_slowThresholdMs = msecs;
+}
+
+void FileIoService::waitForDone()
+{
+    m_pool->waitForDone();
+
+    // Every queue head has run by now. The rest of each queue is normally
+    // started from onTaskFinished() on the event loop, which may not run
+    // again at shutdown, so it runs here in order.
+    for (auto it = m_queues.begin(); it != m_queues.end(); ++it) {
+        QQueue<Task> &queue = *it;
+        queue.dequeue();
+        while (!queue.isEmpty()) {
+            Task task = queue.dequeue();
+            Result result = runTask(task);
+            finishTask(task, result);
+            emit operationFinished(result.path, task.operation, result.success,
+                                   result.elapsedMs);
+        }
+    }
+    m_queues.clear();
+}
+
+QFuture<FileIoService::Result> FileIoService::enqueue(Operation operation, const QString &path,
+                                                      const QString &content, const QByteArray &data)
+{
+    // Serialize on the absolute path so "a.md" and "./a.md" share a queue
+    QString key = QFileInfo(path).absoluteFilePath();
+    QQueue<Task> &queue = m_queues[key];
+
+    auto promise = std::make_shared<QPromise<Result>>();
+    promise->start();
+    QFuture<Result> future = promise->future();
+
+    // A write that has not started yet is superseded by the newer content.
+    // A QFuture holds a single continuation, so each caller gets its own
+    // promise. The head of the queue is already running.
+    bool replaceable = operation == Operation::Write || operation == Operation::WriteData;
+    if (replaceable && queue.size() > 1 && queue.last().operation == operation) {
+        queue.last().content = content;
+        queue.last().data = data;
+        queue.last().promises.append(promise);
+        m_coalescedWrites++;
+        return future;
+    }
+
+    Task task;
+    task.operation = operation;
+    task.path = path;
+    task.content = content;
+    task.data = data;
+    task.serial = ++m_nextSerial;
+    task.promises.append(promise);
+
+    queue.enqueue(task);
+    if (queue.size() == 1) {
+        startNext(key);
+    }
+
+    return future;
+}
+
+void FileIoService::startNext(const QString &key)
+{
+    Task task = m_queues.value(key).head();
+
+    m_pool->start([this, key, task]() {
+        Result result = runTask(task);
+        finishTask(task, result);
+
+        quint64 serial = task.serial;
+        QMetaObject::invokeMethod(this, [this, key, serial, result]() {
+            onTaskFinished(key, serial, result);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void FileIoService::onTaskFinished(const QString &key, quint64 serial, const Result &result)
+{
+    // waitForDone() may have drained the queue in the meantime
+    auto it = m_queues.find(key);
+    if (it == m_queues.end() || it->head().serial != serial) {
+        return;
+    }
+
+    Operation operation = it->dequeue().operation;
+    if (it->isEmpty()) {
+        m_queues.erase(it);
+    } else {
+        startNext(key);
+    }
+
+    if (result.elapsedMs >= m_slowThresholdMs) {
+        qWarning() << "Slow file operation" << operation << result.path
+                   << result.elapsedMs << "ms";
+        emit slowOperation(result.path, operation, result.elapsedMs);
+    }
+
+    emit operationFinished(result.path, operation, result.success, result.elapsedMs);
+}
+
+void FileIoService::finishTask(const Task &task, const Result &result)
+{
+    for (const std::shared_ptr<QPromise<Result>> &promise : task.promises) {
+        promise->addResult(result);
+        promise->finish();
+    }
+}
+
+FileIoService::Result FileIoService::runTask(const Task &task)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    Result result;
+    result.path = task.path;
+
+    switch (task.operation) {
+        case Operation::Read: {
+            QFile file(task.path);
+            if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                QTextStream in(&file);
+                result.content = in.readAll();
+                result.contentHash = ContentHash::of(result.content);
+                result.success = true;
+            } else {
+                result.errorString = file.errorString();
+            }
+            break;
+        }
+        case Operation::ReadData: {
+            QFile file(task.path);
+            if (file.open(QIODevice::ReadOnly)) {
+                result.data = file.readAll();
+                result.success = file.error() == QFileDevice::NoError;
+                if (!result.success) {
+                    result.errorString = file.errorString();
+                }
+            } else {
+                result.errorString = file.errorString();
+            }
+            break;
+        }
+        case Operation::Write:
+        case Operation::WriteData: {
+            // Write to a temporary file and rename over the target on commit
+            // so a crash never leaves a truncated file behind
+            bool text = task.operation == Operation::Write;
+            QSaveFile file(task.path);
+            if (file.open(text ? QIODevice::WriteOnly | QIODevice::Text : QIODevice::WriteOnly)) {
+                if (text) {
+                    QTextStream out(&file);
+                    out << task.content;
+                    out.flush();
+                    result.contentHash = ContentHash::of(task.content);
+                    result.success = out.status() == QTextStream::Ok;
+                } else {
+                    result.success = file.write(task.data) == task.data.size();
+                }
+                result.success = result.success && file.commit();
+                if (!result.success) {
+                    result.errorString = file.errorString();
+                }
+            } else {
+                result.errorString = file.errorString();
+            }
+            break;
+        }
+        case Operation::Append: {
+            QFile file(task.path);
+            if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+                result.success = file.write(task.data) == task.data.size();
+                if (!result.success) {
+                    result.errorString = file.errorString();
+                }
+            } else {
+                result.errorString = file.errorString();
+            }
+            break;
+        }
+        case Operation::Remove: {
+            QFile file(task.path);
+            result.success = !file.exists() || file.remove();
+            if (!result.success) {
+                result.errorString = file.errorString();
+            }
+            break;
+        }
+    }
+
+    // Lets the change monitor recognize the file it just saw being written
+    if (result.success && (task.operation == Operation::Read || task.operation == Operation::Write)) {
+        QFileInfo info(task.path);
+        result.size = info.size();
+        result.lastModified = info.lastModified();
+    }
+
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
@@ -0,0 +1,105 @@
+// FileIoService.h
+#ifndef FILEIOSERVICE_H
+#define FILEIOSERVICE_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QFuture>
+#include <QPromise>
+#include <QHash>
+#include <QQueue>
+#include <QThreadPool>
+#include <QVector>
+#include <memory>
+
+// Runs file reads and writes on a dedicated thread pool so slow disks and
+// network mounts never block the GUI thread. Operations on the same file run
+// in submission order; operations on different files run concurrently.
+//
+// Writes are write-behind: a write that is still queued behind another
+// operation on the same file is replaced by a newer write instead of adding
+// a second one, and files are replaced atomically through QSaveFile. Each
+// caller of a coalesced write still gets a future of its own, finished with
+// the result of the one write.
+//
+// waitForDone(), also run on destruction, finishes every queued operation,
+// including those that would otherwise wait for the event loop to start.
+class FileIoService : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Operation {
+        Read,
+        ReadData,
+        Write,
+        WriteData,
+        Append,
+        Remove
+    };
+    Q_ENUM(Operation)
+
+    struct Result {
+        QString path;
+        bool success = false;
+        QString content;      // File content for reads
+        QByteArray data;      // File content for binary reads
+        quint64 contentHash = 0;  // ContentHash of the text read or written
+        qint64 size = -1;         // File size and mtime after a read or write
+        QDateTime lastModified;
+        QString errorString;
+        qint64 elapsedMs = 0;
+    };
+
+    explicit FileIoService(QObject *parent = nullptr);
+    ~FileIoService() override;
+
+    QFuture<Result> readFile(const QString &path);
+    QFuture<Result> writeFile(const QString &path, const QString &content);
+
+    // Binary variants used for journals, caches and spill files
+    QFuture<Result> readData(const QString &path);
+    QFuture<Result> writeData(const QString &path, const QByteArray &data);
+    QFuture<Result> appendData(const QString &path, const QByteArray &data);
+    QFuture<Result> removeFile(const QString &path);
+
+    int coalescedWrites() const { return m_coalescedWrites; }
+
+    // Operations slower than this are reported through slowOperation()
+    void setSlowOperationThreshold(int msecs);
+    int slowOperationThreshold() const { return m_slowThresholdMs; }
+
+    void waitForDone();
+
+signals:
+    void operationFinished(const QString &path, FileIoService::Operation operation,
+                           bool success, qint64 elapsedMs);
+    void slowOperation(const QString &path, FileIoService::Operation operation, qint64 elapsedMs);
+
+private:
+    struct Task {
+        Operation operation;
+        QString path;
+        QString content;
+        QByteArray data;
+        quint64 serial = 0;
+        // One per caller; coalesced writes add theirs to the queued task
+        QVector<std::shared_ptr<QPromise<Result>>> promises;
+    };
+
+    QThreadPool *m_pool;
+    QHash<QString, QQueue<Task>> m_queues;  // Per-file queues, head is running
+    quint64 m_nextSerial;
+    int m_slowThresholdMs;
+    int m_coalescedWrites;
+
+    QFuture<Result> enqueue(Operation operation, const QString &path, const QString &content,
+                            const QByteArray &data = QByteArray());
+    void startNext(const QString &key);
+    void onTaskFinished(const QString &key, quint64 serial, const Result &result);
+
+    static Result runTask(const Task &task);
+    static void finishTask(const Task &task, const Result &result);
+};
+
+#endif // FILEIOSERVICE_H
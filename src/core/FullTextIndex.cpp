@@ -0,0 +1,763 @@
+// FullTextIndex.cpp
+#include "FullTextIndex.h"
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr quint32 kManifestMagic = 0x4d44464d;  // "MDFM"
+constexpr quint16 kFormatVersion = 1;
+constexpr auto kStreamVersion = QDataStream::Qt_6_0;
+
+constexpr int kMaxConcurrentReads = 4;
+constexpr int kFlushDocuments = 512;      // Documents per new segment at most
+constexpr int kFlushDelayMs = 1000;
+constexpr int kManifestDelayMs = 2000;
+constexpr int kMaxSegments = 8;
+constexpr int kMergeFactor = 4;
+constexpr int kMaxTokenLength = 64;
+constexpr int kMaxPrefixTerms = 256;
+constexpr qint64 kMaxFileSize = 8 * 1024 * 1024;
+
+// BM25 parameters
+constexpr double kK1 = 1.2;
+constexpr double kB = 0.75;
+
+constexpr int kSnippetBefore = 60;
+constexpr int kSnippetLength = 200;
+}
+
+struct FullTextIndex::MergeResult {
+    std::shared_ptr<IndexSegment> segment;
+    QVector<QPair<QString, quint32>> origins;  // Source segment and id per document
+    QString error;
+};
+
+FullTextIndex::FullTextIndex(FileIoService *io, WorkspaceIndexer *indexer, QObject *parent)
+    : QObject(parent)
+    , m_io(io)
+    , m_indexer(indexer)
+    , m_nextVersion(0)
+    , m_nextSegmentId(0)
+    , m_reading(0)
+    , m_flushing(false)
+    , m_merging(false)
+    , m_wasIndexing(false)
+{
+    QDir().mkpath(directory());
+
+    // Files read close together go into one segment
+    m_flushTimer = new QTimer(this);
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(kFlushDelayMs);
+    connect(m_flushTimer, &QTimer::timeout, this, &FullTextIndex::flush);
+
+    // Deletions are recorded in the manifest in batches
+    m_manifestTimer = new QTimer(this);
+    m_manifestTimer->setSingleShot(true);
+    m_manifestTimer->setInterval(kManifestDelayMs);
+    connect(m_manifestTimer, &QTimer::timeout, this, &FullTextIndex::saveManifest);
+
+    // FileIoService finishes queued writes before it is destroyed
+    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, [this]() {
+        if (m_manifestTimer->isActive()) {
+            saveManifest();
+        }
+    });
+
+    connect(m_indexer, &WorkspaceIndexer::filesAdded, this, &FullTextIndex::enqueue);
+    connect(m_indexer, &WorkspaceIndexer::filesChanged, this, &FullTextIndex::enqueue);
+    connect(m_indexer, &WorkspaceIndexer::filesRemoved, this, [this](const QStringList &paths) {
+        for (const QString &path : paths) {
+            removeDocument(path);
+        }
+        updateIndexing();
+    });
+    connect(m_indexer, &WorkspaceIndexer::scanFinished, this, [this]() {
+        reconcile(true);
+    });
+}
+
+void FullTextIndex::start()
+{
+    load();
+    // The workspace index may still be loading; files it reports later
+    // arrive through filesAdded()
+    reconcile(false);
+}
+
+bool FullTextIndex::isIndexing() const
+{
+    return !m_queue.isEmpty() || m_reading > 0 || !m_pending.isEmpty() || m_flushing || m_merging;
+}
+
+void FullTextIndex::tokenize(QStringView text,
+                             const std::function<void(QStringView, qsizetype)> &callback)
+{
+    qsizetype start = -1;
+    for (qsizetype i = 0; i <= text.size(); ++i) {
+        bool word = i < text.size() && (text[i].isLetterOrNumber() || text[i] == '_');
+        if (word && start < 0) {
+            start = i;
+        } else if (!word && start >= 0) {
+            // Base64 blobs and the like are not worth indexing
+            if (i - start <= kMaxTokenLength) {
+                callback(text.mid(start, i - start), start);
+            }
+            start = -1;
+        }
+    }
+}
+
+QFuture<FullTextIndex::Hit> FullTextIndex::search(const QString &query, int limit) const
+{
+    // The search works on a snapshot; segments stay mapped while it runs
+    return QtConcurrent::run(&FullTextIndex::runSearch, m_segments, query, limit);
+}
+
+void FullTextIndex::load()
+{
+    QFile file(directory() + "/manifest");
+    QVector<Segment> segments;
+    if (file.open(QIODevice::ReadOnly)) {
+        QDataStream in(&file);
+        in.setVersion(kStreamVersion);
+
+        quint32 magic = 0;
+        quint16 version = 0;
+        qint32 nextSegmentId = 0;
+        quint32 count = 0;
+        in >> magic >> version >> nextSegmentId >> count;
+        if (in.status() == QDataStream::Ok && magic == kManifestMagic
+            && version == kFormatVersion) {
+            m_nextSegmentId = nextSegmentId;
+            for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+                Segment segment;
+                QVector<quint32> deleted;
+                in >> segment.name >> deleted;
+                segment.deleted = QSet<quint32>(deleted.cbegin(), deleted.cend());
+                segments.append(segment);
+            }
+        }
+    }
+
+    QSet<QString> referenced;
+    for (Segment &segment : segments) {
+        QString error;
+        segment.segment = IndexSegment::open(directory() + '/' + segment.name, &error);
+        if (!segment.segment) {
+            // Its documents are missing from m_documents and get re-indexed
+            qWarning() << "Dropping full-text segment:" << error;
+            continue;
+        }
+        referenced.insert(segment.name);
+
+        for (quint32 id = 0; id < segment.segment->documentCount(); ++id) {
+            if (segment.deleted.contains(id)) {
+                continue;
+            }
+            IndexSegment::Document document = segment.segment->document(id);
+            if (m_documents.contains(document.path)) {
+                segment.deleted.insert(id);
+                continue;
+            }
+            m_documents.insert(document.path, {segment.name, id, document.size,
+                                               document.lastModified, ++m_nextVersion});
+        }
+        m_segments.append(segment);
+    }
+
+    // Segments written or merged but never recorded, e.g. after a crash
+    const QStringList files = QDir(directory()).entryList({"seg-*.idx"}, QDir::Files);
+    for (const QString &name : files) {
+        if (!referenced.contains(name)) {
+            QFile::remove(directory() + '/' + name);
+        }
+    }
+
+    emit indexChanged();
+}
+
+void FullTextIndex::reconcile(bool removeMissing)
+{
+    enqueue(m_indexer->paths());
+
+    if (removeMissing) {
+        const QStringList paths = m_documents.keys();
+        for (const QString &path : paths) {
+            if (!m_indexer->contains(path)) {
+                removeDocument(path);
+            }
+        }
+        updateIndexing();
+    }
+}
+
+void FullTextIndex::enqueue(const QStringList &paths)
+{
+    for (const QString &path : paths) {
+        WorkspaceIndexer::FileEntry entry = m_indexer->entry(path);
+        auto it = m_documents.constFind(path);
+        if (it != m_documents.constEnd() && it->size == entry.size
+            && it->lastModified == entry.lastModified) {
+            continue;
+        }
+        m_queue.append(path);
+    }
+    pump();
+    updateIndexing();
+}
+
+void FullTextIndex::pump()
+{
+    while (m_reading < kMaxConcurrentReads && !m_queue.isEmpty()) {
+        QString path = m_queue.takeFirst();
+        ++m_reading;
+        QtConcurrent::run(&FullTextIndex::readDocument, path)
+            .then(this, [this](const IndexedDocument &document) {
+                --m_reading;
+                if (document.size < 0) {
+                    removeDocument(document.path);
+                } else {
+                    addDocument(document);
+                }
+                pump();
+                updateIndexing();
+            });
+    }
+}
+
+IndexedDocument FullTextIndex::readDocument(const QString &path)
+{
+    IndexedDocument document;
+    document.path = path;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return document;
+    }
+    QFileInfo info(file);
+    document.size = info.size();
+    document.lastModified = info.lastModified().toMSecsSinceEpoch();
+
+    QString text = readText(&file, kMaxFileSize);
+    quint32 position = 0;
+    tokenize(text, [&](QStringView token, qsizetype) {
+        document.positions[token.toString().toLower()].append(position++);
+    });
+    document.tokenCount = position;
+    return document;
+}
+
+void FullTextIndex::addDocument(const IndexedDocument &document)
+{
+    removeDocument(document.path);
+
+    DocumentState state;
+    state.size = document.size;
+    state.lastModified = document.lastModified;
+    state.version = ++m_nextVersion;
+    m_documents.insert(document.path, state);
+
+    m_pending.append(document);
+    m_pendingVersions.append(state.version);
+    if (m_pending.size() >= kFlushDocuments) {
+        flush();
+    } else {
+        m_flushTimer->start();
+    }
+}
+
+void FullTextIndex::removeDocument(const QString &path)
+{
+    auto it = m_documents.find(path);
+    if (it == m_documents.end()) {
+        return;
+    }
+
+    if (!it->segment.isEmpty()) {
+        markDeleted(it->segment, it->document);
+    } else {
+        // Not written yet; a copy already being written is dropped when the
+        // write finishes, because its version no longer matches
+        for (qsizetype i = 0; i < m_pending.size(); ++i) {
+            if (m_pending.at(i).path == path) {
+                m_pending.removeAt(i);
+                m_pendingVersions.removeAt(i);
+                break;
+            }
+        }
+    }
+    m_documents.erase(it);
+    emit indexChanged();
+}
+
+void FullTextIndex::markDeleted(const QString &segmentName, quint32 document)
+{
+    for (Segment &segment : m_segments) {
+        if (segment.name == segmentName) {
+            segment.deleted.insert(document);
+            m_manifestTimer->start();
+            return;
+        }
+    }
+}
+
+void FullTextIndex::flush()
+{
+    if (m_flushing || m_pending.isEmpty()) {
+        return;
+    }
+    m_flushing = true;
+    m_flushTimer->stop();
+
+    QVector<IndexedDocument> documents = std::move(m_pending);
+    QVector<quint64> versions = std::move(m_pendingVersions);
+    m_pending.clear();
+    m_pendingVersions.clear();
+
+    QString name = nextSegmentName();
+    QString fileName = directory() + '/' + name;
+    QtConcurrent::run([fileName, documents]() -> std::shared_ptr<IndexSegment> {
+        QString error;
+        if (!IndexSegment::write(fileName, documents, &error)) {
+            qWarning() << "Could not write full-text segment:" << error;
+            return nullptr;
+        }
+        return IndexSegment::open(fileName);
+    }).then(this, [this, name, documents, versions](const std::shared_ptr<IndexSegment> &written) {
+        m_flushing = false;
+        if (!written) {
+            // Read again on the next change or scan. Documents read again
+            // while this was being written are still pending.
+            for (quint32 id = 0; id < quint32(documents.size()); ++id) {
+                auto it = m_documents.find(documents.at(id).path);
+                if (it != m_documents.end() && it->segment.isEmpty()
+                    && it->version == versions.at(id)) {
+                    m_documents.erase(it);
+                }
+            }
+            updateIndexing();
+            return;
+        }
+
+        Segment segment{name, written, {}};
+        for (quint32 id = 0; id < quint32(documents.size()); ++id) {
+            auto it = m_documents.find(documents.at(id).path);
+            if (it == m_documents.end() || !it->segment.isEmpty()
+                || it->version != versions.at(id)) {
+                // Removed or read again while this was being written
+                segment.deleted.insert(id);
+                continue;
+            }
+            it->segment = name;
+            it->document = id;
+        }
+        m_segments.append(segment);
+        saveManifest();
+        emit indexChanged();
+
+        if (!m_pending.isEmpty()) {
+            m_flushTimer->start();
+        }
+        maybeMerge();
+        updateIndexing();
+    });
+    updateIndexing();
+}
+
+void FullTextIndex::maybeMerge()
+{
+    if (m_merging || m_segments.size() <= kMaxSegments) {
+        return;
+    }
+    m_merging = true;
+
+    // Smallest first, so each document is rewritten only a few times
+    QVector<Segment> inputs = m_segments;
+    std::sort(inputs.begin(), inputs.end(), [](const Segment &a, const Segment &b) {
+        return a.segment->documentCount() - a.deleted.size()
+               < b.segment->documentCount() - b.deleted.size();
+    });
+    inputs.resize(kMergeFactor);
+
+    QString name = nextSegmentName();
+    QString fileName = directory() + '/' + name;
+    QtConcurrent::run([fileName, inputs]() {
+        MergeResult result;
+        QVector<IndexedDocument> documents;
+        for (const Segment &input : inputs) {
+            QVector<quint32> ids;
+            documents += input.segment->documents(input.deleted, &ids);
+            for (quint32 id : std::as_const(ids)) {
+                result.origins.append({input.name, id});
+            }
+        }
+        if (IndexSegment::write(fileName, documents, &result.error)) {
+            result.segment = IndexSegment::open(fileName, &result.error);
+        }
+        return result;
+    }).then(this, [this, name, inputs](const MergeResult &result) {
+        m_merging = false;
+        if (!result.segment) {
+            qWarning() << "Could not merge full-text segments:" << result.error;
+            updateIndexing();
+            return;
+        }
+
+        Segment merged{name, result.segment, {}};
+        for (quint32 id = 0; id < quint32(result.origins.size()); ++id) {
+            const auto &origin = result.origins.at(id);
+            auto it = m_documents.find(result.segment->document(id).path);
+            // Deleted or re-indexed while the merge ran
+            if (it == m_documents.end() || it->segment != origin.first
+                || it->document != origin.second) {
+                merged.deleted.insert(id);
+                continue;
+            }
+            it->segment = name;
+            it->document = id;
+        }
+
+        QStringList obsolete;
+        for (const Segment &input : inputs) {
+            obsolete.append(directory() + '/' + input.name);
+            m_segments.erase(std::remove_if(m_segments.begin(), m_segments.end(),
+                                            [&input](const Segment &segment) {
+                                                return segment.name == input.name;
+                                            }),
+                             m_segments.end());
+        }
+        m_segments.append(merged);
+
+        // Searches still running keep the old files mapped
+        saveManifest().then(this, [obsolete](const FileIoService::Result &saved) {
+            if (!saved.success) {
+                return;
+            }
+            for (const QString &fileName : obsolete) {
+                QFile::remove(fileName);
+            }
+        });
+
+        emit segmentsMerged(inputs.size());
+        maybeMerge();
+        updateIndexing();
+    });
+    updateIndexing();
+}
+
+QFuture<FileIoService::Result> FullTextIndex::saveManifest()
+{
+    m_manifestTimer->stop();
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(kStreamVersion);
+    out << kManifestMagic << kFormatVersion << qint32(m_nextSegmentId)
+        << quint32(m_segments.size());
+    for (const Segment &segment : std::as_const(m_segments)) {
+        QVector<quint32> deleted(segment.deleted.cbegin(), segment.deleted.cend());
+        std::sort(deleted.begin(), deleted.end());
+        out << segment.name << deleted;
+    }
+
+    return m_io->writeData(directory() + "/manifest", data);
+}
+
+void FullTextIndex::updateIndexing()
+{
+    bool indexing = isIndexing();
+    if (indexing != m_wasIndexing) {
+        m_wasIndexing = indexing;
+        emit indexingChanged();
+    }
+}
+
+QString FullTextIndex::nextSegmentName()
+{
+    return QString("seg-%1.idx").arg(m_nextSegmentId++, 6, 10, QChar('0'));
+}
+
+QString FullTextIndex::directory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/fulltext";
+}
+
+QString FullTextIndex::readText(QIODevice *device, qint64 maxBytes)
+{
+    QByteArray data = device->read(maxBytes);
+    if (data.isEmpty() || data.size() < maxBytes || device->atEnd()) {
+        return QString::fromUtf8(data);
+    }
+
+    // Back up to the lead byte of the last sequence and drop the sequence
+    // if its continuation bytes were not read
+    qsizetype lead = data.size() - 1;
+    while (lead > 0 && data.size() - lead < 4 && (uchar(data.at(lead)) & 0xc0) == 0x80) {
+        --lead;
+    }
+    uchar byte = uchar(data.at(lead));
+    qsizetype length = byte < 0x80 ? 1
+                       : (byte & 0xe0) == 0xc0 ? 2
+                       : (byte & 0xf0) == 0xe0 ? 3
+                       : (byte & 0xf8) == 0xf0 ? 4
+                                               : 1;
+    if (lead + length > data.size()) {
+        data.truncate(lead);
+    }
+    return QString::fromUtf8(data);
+}
+
+QVector<FullTextIndex::Clause> FullTextIndex::parseQuery(const QString &query)
+{
+    auto words = [](QStringView text) {
+        QStringList terms;
+        tokenize(text, [&](QStringView token, qsizetype) {
+            terms.append(token.toString().toLower());
+        });
+        return terms;
+    };
+
+    QVector<Clause> clauses;
+    qsizetype i = 0;
+    while (i < query.size()) {
+        if (query.at(i).isSpace()) {
+            ++i;
+            continue;
+        }
+
+        if (query.at(i) == '"') {
+            qsizetype end = query.indexOf('"', i + 1);
+            if (end < 0) {
+                end = query.size();
+            }
+            Clause clause;
+            clause.kind = Clause::Phrase;
+            clause.terms = words(QStringView(query).mid(i + 1, end - i - 1));
+            if (clause.terms.size() == 1) {
+                clause.kind = Clause::Term;
+            }
+            if (!clause.terms.isEmpty()) {
+                clauses.append(clause);
+            }
+            i = end + 1;
+            continue;
+        }
+
+        qsizetype end = i;
+        while (end < query.size() && !query.at(end).isSpace() && query.at(end) != '"') {
+            ++end;
+        }
+        QStringView word = QStringView(query).mid(i, end - i);
+        bool prefix = word.endsWith('*');
+
+        Clause clause;
+        clause.terms = words(word);
+        if (clause.terms.size() > 1) {
+            // e.g. "foo-bar" is indexed as two adjacent tokens
+            clause.kind = Clause::Phrase;
+        } else if (prefix) {
+            clause.kind = Clause::Prefix;
+        }
+        if (!clause.terms.isEmpty()) {
+            clauses.append(clause);
+        }
+        i = end;
+    }
+    return clauses;
+}
+
+void FullTextIndex::runSearch(QPromise<Hit> &promise, const QVector<Segment> &segments,
+                              const QString &query, int limit)
+{
+    QVector<Clause> clauses = parseQuery(query);
+    if (clauses.isEmpty()) {
+        return;
+    }
+
+    QVector<Hit> hits;
+    for (const Segment &segment : segments) {
+        if (promise.isCanceled()) {
+            return;
+        }
+        const IndexSegment &index = *segment.segment;
+        double documentCount = index.documentCount();
+        double averageLength = qMax(1.0, index.averageTokenCount());
+
+        // Every clause must match; scores add up
+        QHash<quint32, double> scores;
+        bool first = true;
+        for (const Clause &clause : std::as_const(clauses)) {
+            QHash<quint32, quint32> frequencies;
+
+            if (clause.kind == Clause::Term || clause.kind == Clause::Prefix) {
+                QStringList terms = clause.kind == Clause::Term
+                                        ? clause.terms
+                                        : index.termsWithPrefix(clause.terms.first(),
+                                                                kMaxPrefixTerms);
+                for (const QString &term : std::as_const(terms)) {
+                    for (const IndexSegment::Posting &posting : index.postings(term)) {
+                        frequencies[posting.document] += posting.positions.size();
+                    }
+                }
+            } else {
+                QVector<QVector<IndexSegment::Posting>> lists;
+                for (const QString &term : clause.terms) {
+                    lists.append(index.postings(term));
+                }
+                QVector<QHash<quint32, const QVector<quint32> *>> byDocument(lists.size());
+                for (qsizetype k = 1; k < lists.size(); ++k) {
+                    for (const IndexSegment::Posting &posting : std::as_const(lists[k])) {
+                        byDocument[k].insert(posting.document, &posting.positions);
+                    }
+                }
+                // Count the starts of the first term followed by the rest
+                for (const IndexSegment::Posting &posting : std::as_const(lists[0])) {
+                    quint32 occurrences = 0;
+                    for (quint32 start : posting.positions) {
+                        bool matched = true;
+                        for (qsizetype k = 1; k < lists.size() && matched; ++k) {
+                            const QVector<quint32> *positions = byDocument[k].value(posting.document);
+                            matched = positions
+                                      && std::binary_search(positions->cbegin(), positions->cend(),
+                                                            start + quint32(k));
+                        }
+                        if (matched) {
+                            ++occurrences;
+                        }
+                    }
+                    if (occurrences > 0) {
+                        frequencies.insert(posting.document, occurrences);
+                    }
+                }
+            }
+
+            double documentFrequency = frequencies.size();
+            double idf = std::log(1 + (documentCount - documentFrequency + 0.5)
+                                          / (documentFrequency + 0.5));
+            QHash<quint32, double> next;
+            for (auto it = frequencies.cbegin(); it != frequencies.cend(); ++it) {
+                if (segment.deleted.contains(it.key()) || (!first && !scores.contains(it.key()))) {
+                    continue;
+                }
+                double tf = it.value();
+                double length = index.tokenCount(it.key());
+                double score = idf * tf * (kK1 + 1)
+                               / (tf + kK1 * (1 - kB + kB * length / averageLength));
+                next.insert(it.key(), scores.value(it.key()) + score);
+            }
+            scores = next;
+            first = false;
+            if (scores.isEmpty()) {
+                break;
+            }
+        }
+
+        for (auto it = scores.cbegin(); it != scores.cend(); ++it) {
+            Hit hit;
+            hit.path = index.document(it.key()).path;
+            hit.score = it.value();
+            hits.append(hit);
+        }
+    }
+
+    auto better = [](const Hit &a, const Hit &b) {
+        return a.score != b.score ? a.score > b.score : a.path < b.path;
+    };
+    if (hits.size() > limit) {
+        std::partial_sort(hits.begin(), hits.begin() + limit, hits.end(), better);
+        hits.resize(limit);
+    } else {
+        std::sort(hits.begin(), hits.end(), better);
+    }
+
+    // Ranking is cheap; snippets need the files, so they are streamed
+    for (Hit &hit : hits) {
+        if (promise.isCanceled()) {
+            return;
+        }
+        makeSnippet(hit, clauses);
+        promise.addResult(hit);
+    }
+}
+
+void FullTextIndex::makeSnippet(Hit &hit, const QVector<Clause> &clauses)
+{
+    QFile file(hit.path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QString text = readText(&file, kMaxFileSize);
+
+    QSet<QString> terms;
+    QStringList prefixes;
+    for (const Clause &clause : clauses) {
+        if (clause.kind == Clause::Prefix) {
+            prefixes.append(clause.terms.first());
+        } else {
+            for (const QString &term : clause.terms) {
+                terms.insert(term);
+            }
+        }
+    }
+
+    QVector<QPair<qsizetype, qsizetype>> matches;
+    tokenize(text, [&](QStringView token, qsizetype offset) {
+        QString lowered = token.toString().toLower();
+        bool matched = terms.contains(lowered);
+        for (qsizetype i = 0; i < prefixes.size() && !matched; ++i) {
+            matched = lowered.startsWith(prefixes.at(i));
+        }
+        if (matched) {
+            matches.append({offset, token.size()});
+        }
+    });
+    hit.matchCount = matches.size();
+
+    // A window around the first match, cut at word boundaries
+    qsizetype anchor = matches.isEmpty() ? 0 : matches.first().first;
+    qsizetype from = qMax<qsizetype>(0, anchor - kSnippetBefore);
+    if (from > 0) {
+        qsizetype space = text.indexOf(' ', from);
+        if (space >= 0 && space < anchor) {
+            from = space + 1;
+        }
+    }
+    qsizetype to = qMin(text.size(), from + kSnippetLength);
+    if (to < text.size()) {
+        qsizetype space = text.lastIndexOf(' ', to);
+        if (space > anchor) {
+            to = space;
+        }
+    }
+
+    QString snippet = text.mid(from, to - from);
+    for (QChar &c : snippet) {
+        if (c == '\n' || c == '\r' || c == '\t') {
+            c = ' ';
+        }
+    }
+    int lead = 0;
+    if (from > 0) {
+        snippet.prepend(QChar(0x2026));
+        lead = 1;
+    }
+    if (to < text.size()) {
+        snippet.append(QChar(0x2026));
+    }
+
+    hit.snippet = snippet;
+    for (const auto &match : std::as_const(matches)) {
+        if (match.first >= from && match.first + match.second <= to) {
+            hit.ranges.append({int(match.first - from) + lead, int(match.second)});
+        }
+    }
+}
@@ -0,0 +1,140 @@
+// FullTextIndex.h
+#ifndef FULLTEXTINDEX_H
+#define FULLTEXTINDEX_H
+
+#include <QObject>
+#include <QFuture>
+#include <QHash>
+#include <QPair>
+#include <QPromise>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+#include <memory>
+
+#include "FileIoService.h"
+#include "IndexSegment.h"
+#include "WorkspaceIndexer.h"
+
+class QIODevice;
+
+// Inverted index over the contents of the markdown files found by the
+// WorkspaceIndexer. Files are read and tokenized on worker threads and
+// collected into immutable, memory-mapped segments. A changed file is
+// re-indexed into a new segment and its old entry marked deleted; once
+// there are too many segments, the smallest are merged in the background.
+//
+// Queries are made of terms (all must occur), "quoted phrases" and
+// prefixes ending in *. Results are ranked and then streamed with a
+// snippet of the text around the first match.
+class FullTextIndex : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int documentCount READ documentCount NOTIFY indexChanged)
+    Q_PROPERTY(bool indexing READ isIndexing NOTIFY indexingChanged)
+
+public:
+    // One part of a query: a word, a prefix or a phrase of adjacent words
+    struct Clause {
+        enum Kind {
+            Term,
+            Prefix,
+            Phrase
+        };
+
+        Kind kind = Term;
+        QStringList terms;  // Lowercased tokens
+    };
+
+    struct Hit {
+        QString path;
+        double score = 0;
+        QString snippet;
+        QVector<QPair<int, int>> ranges;  // Start and length of matches in snippet
+        int matchCount = 0;               // Matching tokens in the file
+    };
+
+    FullTextIndex(FileIoService *io, WorkspaceIndexer *indexer, QObject *parent = nullptr);
+
+    // Opens the saved segments and indexes what changed since
+    void start();
+
+    // Hits arrive in rank order; cancel the future to stop early
+    QFuture<Hit> search(const QString &query, int limit = 100) const;
+
+    int documentCount() const { return m_documents.size(); }
+    int segmentCount() const { return m_segments.size(); }
+    bool isIndexing() const;
+
+    // Splits text into words; offsets are in UTF-16 code units
+    static void tokenize(QStringView text,
+                         const std::function<void(QStringView token, qsizetype offset)> &callback);
+    static QVector<Clause> parseQuery(const QString &query);
+    // Decodes at most maxBytes of UTF-8, cut before a character that does
+    // not fit instead of through it
+    static QString readText(QIODevice *device, qint64 maxBytes);
+
+signals:
+    void indexChanged();
+    void indexingChanged();
+    void segmentsMerged(int mergedCount);
+
+private:
+    struct Segment {
+        QString name;
+        std::shared_ptr<IndexSegment> segment;
+        QSet<quint32> deleted;
+    };
+
+    // Where the live copy of a document is; an empty segment name means it
+    // is waiting to be written
+    struct DocumentState {
+        QString segment;
+        quint32 document = 0;
+        qint64 size = -1;
+        qint64 lastModified = 0;
+        quint64 version = 0;
+    };
+
+    struct MergeResult;
+
+    FileIoService *m_io;
+    WorkspaceIndexer *m_indexer;
+    QVector<Segment> m_segments;
+    QHash<QString, DocumentState> m_documents;
+    quint64 m_nextVersion;
+    int m_nextSegmentId;
+
+    QStringList m_queue;                // Files to read
+    int m_reading;
+    QVector<IndexedDocument> m_pending;  // Read, not yet in a segment
+    QVector<quint64> m_pendingVersions;
+    bool m_flushing;
+    bool m_merging;
+    bool m_wasIndexing;
+    QTimer *m_flushTimer;
+    QTimer *m_manifestTimer;
+
+    void load();
+    void reconcile(bool removeMissing);
+    void enqueue(const QStringList &paths);
+    void pump();
+    void addDocument(const IndexedDocument &document);
+    void removeDocument(const QString &path);
+    void markDeleted(const QString &segmentName, quint32 document);
+    void flush();
+    void maybeMerge();
+    QFuture<FileIoService::Result> saveManifest();
+    void updateIndexing();
+    QString nextSegmentName();
+
+    static QString directory();
+    static IndexedDocument readDocument(const QString &path);
+    static void runSearch(QPromise<Hit> &promise, const QVector<Segment> &segments,
+                          const QString &query, int limit);
+    static void makeSnippet(Hit &hit, const QVector<Clause> &clauses);
+};
+
+#endif // FULLTEXTINDEX_H
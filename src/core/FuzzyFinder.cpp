@@ -0,0 +1,231 @@
+// FuzzyFinder.cpp
+#include "FuzzyFinder.h"
+#include <algorithm>
+
+namespace {
+constexpr int kMatchScore = 16;
+constexpr int kBoundaryBonus = 10;
+constexpr int kCamelCaseBonus = 8;
+constexpr int kConsecutiveBonus = 6;
+constexpr int kFileNameBonus = 8;
+constexpr int kGapStartPenalty = 3;
+constexpr int kGapPenalty = 1;
+
+bool isSeparator(QChar c)
+{
+    return c == '/' || c == '-' || c == '_' || c == '.' || c == ' ';
+}
+}
+
+quint64 FuzzyFinder::maskOf(QStringView text)
+{
+    // a-z, 0-9 and a few separators get a bit each; everything else shares one
+    quint64 mask = kAliveBit;
+    for (QChar c : text) {
+        char16_t u = c.unicode();
+        int bit;
+        if (u >= 'a' && u <= 'z') {
+            bit = u - 'a';
+        } else if (u >= '0' && u <= '9') {
+            bit = 26 + (u - '0');
+        } else if (u == '.') {
+            bit = 36;
+        } else if (u == '-') {
+            bit = 37;
+        } else if (u == '_') {
+            bit = 38;
+        } else if (u == '/') {
+            bit = 39;
+        } else {
+            bit = 40;
+        }
+        mask |= quint64(1) << bit;
+    }
+    return mask;
+}
+
+void FuzzyFinder::add(const QString &path, qsizetype matchStart)
+{
+    if (m_entries.contains(path)) {
+        return;
+    }
+
+    QString lowered = path.mid(matchStart).toLower();
+    int entry = m_paths.size();
+    m_entries.insert(path, entry);
+    m_paths.append(path);
+    m_offsets.append(m_text.size());
+    m_lengths.append(lowered.size());
+    m_textStart.append(int(matchStart));
+    m_nameStart.append(int(lowered.lastIndexOf('/') + 1));
+    m_masks.append(maskOf(lowered));
+    m_text += lowered;
+
+    // The new path may match the last query without having been a candidate
+    m_lastQuery.clear();
+}
+
+void FuzzyFinder::remove(const QString &path)
+{
+    auto it = m_entries.find(path);
+    if (it == m_entries.end()) {
+        return;
+    }
+    m_masks[*it] &= ~kAliveBit;
+    m_entries.erase(it);
+    m_lastQuery.clear();
+
+    if (++m_removed > 1024 && m_removed > m_paths.size() / 2) {
+        compact();
+    }
+}
+
+void FuzzyFinder::clear()
+{
+    *this = FuzzyFinder();
+}
+
+qsizetype FuzzyFinder::nameStart(int entry) const
+{
+    return m_textStart.at(entry) + m_nameStart.at(entry);
+}
+
+void FuzzyFinder::compact()
+{
+    FuzzyFinder compacted;
+    for (int entry = 0; entry < m_paths.size(); ++entry) {
+        if (m_masks.at(entry) & kAliveBit) {
+            compacted.add(m_paths.at(entry), m_textStart.at(entry));
+        }
+    }
+    *this = std::move(compacted);
+}
+
+QVector<FuzzyFinder::Match> FuzzyFinder::search(const QString &query, int limit)
+{
+    QString needle;
+    for (QChar c : query) {
+        if (!c.isSpace()) {
+            needle += c.toLower();
+        }
+    }
+    if (needle.isEmpty()) {
+        m_lastQuery.clear();
+        m_lastMatches.clear();
+        return {};
+    }
+
+    // Whatever matches the longer query also matched the shorter one
+    bool narrowing = !m_lastQuery.isEmpty() && needle.startsWith(m_lastQuery);
+    quint64 queryMask = maskOf(needle);
+
+    QVector<Match> matches;
+    auto consider = [&](int entry) {
+        if ((m_masks.at(entry) & queryMask) != queryMask) {
+            return;
+        }
+        int value = score(entry, needle);
+        if (value != kNoMatch) {
+            matches.append({entry, value});
+        }
+    };
+
+    if (narrowing) {
+        for (int entry : std::as_const(m_lastMatches)) {
+            consider(entry);
+        }
+    } else {
+        for (int entry = 0; entry < m_masks.size(); ++entry) {
+            consider(entry);
+        }
+    }
+
+    m_lastQuery = needle;
+    m_lastMatches.resize(matches.size());
+    for (qsizetype i = 0; i < matches.size(); ++i) {
+        m_lastMatches[i] = matches.at(i).entry;
+    }
+
+    // Higher score first, then shorter paths
+    auto better = [this](const Match &a, const Match &b) {
+        if (a.score != b.score) {
+            return a.score > b.score;
+        }
+        return m_lengths.at(a.entry) < m_lengths.at(b.entry);
+    };
+    if (matches.size() > limit) {
+        std::partial_sort(matches.begin(), matches.begin() + limit, matches.end(), better);
+        matches.resize(limit);
+    } else {
+        std::sort(matches.begin(), matches.end(), better);
+    }
+    return matches;
+}
+
+int FuzzyFinder::score(int entry, QStringView query) const
+{
+    QStringView text = QStringView(m_text).mid(m_offsets.at(entry), m_lengths.at(entry));
+    QStringView original = QStringView(m_paths.at(entry)).mid(m_textStart.at(entry));
+
+    // Forward to the earliest position where the whole query has matched
+    qsizetype q = 0;
+    qsizetype end = -1;
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        if (text[i] == query[q] && ++q == query.size()) {
+            end = i;
+            break;
+        }
+    }
+    if (end < 0) {
+        return kNoMatch;
+    }
+
+    // Then back to the latest start, giving the tightest window
+    qsizetype start = end;
+    q = query.size() - 1;
+    for (qsizetype i = end; i >= 0; --i) {
+        if (text[i] == query[q]) {
+            if (q == 0) {
+                start = i;
+                break;
+            }
+            --q;
+        }
+    }
+
+    int total = 0;
+    int run = 0;
+    qsizetype previous = -1;
+    q = 0;
+    for (qsizetype i = start; i <= end && q < query.size(); ++i) {
+        if (text[i] != query[q]) {
+            continue;
+        }
+
+        int bonus = kMatchScore;
+        if (i == 0 || isSeparator(text[i - 1])) {
+            bonus += kBoundaryBonus;
+        } else if (original.size() == text.size() && original[i].isUpper()
+                   && original[i - 1].isLower()) {
+            bonus += kCamelCaseBonus;
+        }
+        if (i >= m_nameStart.at(entry)) {
+            bonus += kFileNameBonus;
+        }
+
+        if (previous >= 0 && i == previous + 1) {
+            ++run;
+            bonus += kConsecutiveBonus * run;
+        } else {
+            run = 0;
+            if (previous >= 0) {
+                total -= kGapStartPenalty + kGapPenalty * int(i - previous - 1);
+            }
+        }
+
+        total += bonus;
+        previous = i;
+        ++q;
+    }
+    return total;
+}
@@ -0,0 +1,67 @@
+// FuzzyFinder.h
+#ifndef FUZZYFINDER_H
+#define FUZZYFINDER_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Fuzzy matching of a query against many file paths: the query characters
+// must appear in order, and matches at word boundaries, in the file name
+// and in runs score higher.
+//
+// Paths are kept lowercased in one contiguous buffer, each with a bitmask
+// of the characters it contains. A path is only scanned if its mask covers
+// the query's, which rejects most paths with one AND over a flat array.
+// When the query grows by appending characters, only the previous matches
+// are scanned again.
+class FuzzyFinder
+{
+public:
+    struct Match {
+        int entry;
+        int score;
+    };
+
+    // matchStart is where matching begins in path, e.g. after the
+    // workspace root
+    void add(const QString &path, qsizetype matchStart = 0);
+    void remove(const QString &path);
+    void clear();
+
+    int size() const { return m_paths.size() - m_removed; }
+    QString path(int entry) const { return m_paths.at(entry); }
+    // Offset of the file name within path
+    qsizetype nameStart(int entry) const;
+
+    // Best matches first, at most limit of them. Whitespace in the query is
+    // ignored.
+    QVector<Match> search(const QString &query, int limit);
+    // Matches of the last search, before limiting
+    int lastMatchCount() const { return m_lastMatches.size(); }
+
+private:
+    static constexpr quint64 kAliveBit = quint64(1) << 63;
+    static constexpr int kNoMatch = -1000000;
+
+    QStringList m_paths;
+    QString m_text;                // Lowercased paths from matchStart, back to back
+    QVector<qsizetype> m_offsets;  // Into m_text
+    QVector<int> m_lengths;
+    QVector<int> m_textStart;      // matchStart within the original path
+    QVector<int> m_nameStart;      // File name within the matched text
+    QVector<quint64> m_masks;
+    QHash<QString, int> m_entries;
+    int m_removed = 0;
+
+    // Narrowing state
+    QString m_lastQuery;
+    QVector<int> m_lastMatches;
+
+    void compact();
+    int score(int entry, QStringView query) const;
+    static quint64 maskOf(QStringView text);
+};
+
+#endif // FUZZYFINDER_H
@@ -0,0 +1,134 @@
+// FuzzyFinderModel.cpp
+#include "FuzzyFinderModel.h"
+#include <QElapsedTimer>
+
+FuzzyFinderModel::FuzzyFinderModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_limit(200)
+    , m_matchCount(0)
+    , m_lastSearchMs(0)
+{
+}
+
+void FuzzyFinderModel::setIndexer(WorkspaceIndexer *indexer)
+{
+    if (m_indexer) {
+        disconnect(m_indexer, nullptr, this, nullptr);
+    }
+    m_indexer = indexer;
+    m_finder.clear();
+    if (!m_indexer) {
+        search();
+        return;
+    }
+
+    connect(m_indexer, &WorkspaceIndexer::filesAdded, this, [this](const QStringList &paths) {
+        addPaths(paths);
+        search();
+    });
+    connect(m_indexer, &WorkspaceIndexer::filesRemoved, this, [this](const QStringList &paths) {
+        removePaths(paths);
+        search();
+    });
+
+    addPaths(m_indexer->paths());
+    search();
+}
+
+void FuzzyFinderModel::setQuery(const QString &query)
+{
+    if (m_query == query) {
+        return;
+    }
+    m_query = query;
+    emit queryChanged();
+    if (!m_indexer && !m_query.isEmpty()) {
+        emit indexerNeeded();
+    }
+    search();
+}
+
+void FuzzyFinderModel::setLimit(int limit)
+{
+    m_limit = limit;
+    search();
+}
+
+QString FuzzyFinderModel::filePath(int row) const
+{
+    if (row < 0 || row >= m_results.size()) {
+        return QString();
+    }
+    return m_finder.path(m_results.at(row).entry);
+}
+
+int FuzzyFinderModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_results.size();
+}
+
+QVariant FuzzyFinderModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_results.size()) {
+        return QVariant();
+    }
+
+    const FuzzyFinder::Match &match = m_results.at(index.row());
+    QString path = m_finder.path(match.entry);
+    qsizetype nameStart = m_finder.nameStart(match.entry);
+
+    switch (role) {
+        case Qt::DisplayRole:
+        case FileNameRole:
+            return path.mid(nameStart);
+        case FilePathRole:
+            return path;
+        case DirectoryRole:
+            return path.left(qMax<qsizetype>(0, nameStart - 1));
+        case ScoreRole:
+            return match.score;
+        default:
+            return QVariant();
+    }
+}
+
+QHash<int, QByteArray> FuzzyFinderModel::roleNames() const
+{
+    return {
+        {FilePathRole, "filePath"},
+        {FileNameRole, "fileName"},
+        {DirectoryRole, "directory"},
+        {ScoreRole, "score"}
+    };
+}
+
+void FuzzyFinderModel::addPaths(const QStringList &paths)
+{
+    for (const QString &path : paths) {
+        // Match the path below its root; the root is the same for every file
+        QString root = m_indexer->rootOf(path);
+        m_finder.add(path, root.isEmpty() ? 0 : root.size() + 1);
+    }
+}
+
+void FuzzyFinderModel::removePaths(const QStringList &paths)
+{
+    for (const QString &path : paths) {
+        m_finder.remove(path);
+    }
+}
+
+void FuzzyFinderModel::search()
+{
+    QElapsedTimer timer;
+    timer.start();
+    QVector<FuzzyFinder::Match> results = m_finder.search(m_query, m_limit);
+    m_lastSearchMs = timer.nsecsElapsed() / 1e6;
+
+    // A new ranking has little in common with the old one
+    beginResetModel();
+    m_results = results;
+    m_matchCount = m_finder.lastMatchCount();
+    endResetModel();
+    emit resultsChanged();
+}
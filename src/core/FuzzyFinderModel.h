@@ -0,0 +1,67 @@
+// FuzzyFinderModel.h
+#ifndef FUZZYFINDERMODEL_H
+#define FUZZYFINDERMODEL_H
+
+#include <QAbstractListModel>
+#include <QPointer>
+
+#include "FuzzyFinder.h"
+#include "WorkspaceIndexer.h"
+
+// Ranked fuzzy search over the files of the workspace index, for the
+// explorer's search field. Each change of the query runs a search
+// synchronously; typing ahead narrows the previous matches.
+class FuzzyFinderModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QString query READ query WRITE setQuery NOTIFY queryChanged)
+    Q_PROPERTY(int count READ rowCount NOTIFY resultsChanged)
+    Q_PROPERTY(int matchCount READ matchCount NOTIFY resultsChanged)
+    Q_PROPERTY(double lastSearchMs READ lastSearchMs NOTIFY resultsChanged)
+
+public:
+    enum Roles {
+        FilePathRole = Qt::UserRole + 1,
+        FileNameRole,
+        DirectoryRole,
+        ScoreRole
+    };
+
+    explicit FuzzyFinderModel(QObject *parent = nullptr);
+
+    void setIndexer(WorkspaceIndexer *indexer);
+
+    QString query() const { return m_query; }
+    void setQuery(const QString &query);
+
+    void setLimit(int limit);
+    int matchCount() const { return m_matchCount; }
+    double lastSearchMs() const { return m_lastSearchMs; }
+
+    Q_INVOKABLE QString filePath(int row) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void queryChanged();
+    void resultsChanged();
+    // First query without an indexer; the index is built on first use
+    void indexerNeeded();
+
+private:
+    QPointer<WorkspaceIndexer> m_indexer;
+    FuzzyFinder m_finder;
+    QVector<FuzzyFinder::Match> m_results;
+    QString m_query;
+    int m_limit;
+    int m_matchCount;
+    double m_lastSearchMs;
+
+    void addPaths(const QStringList &paths);
+    void removePaths(const QStringList &paths);
+    void search();
+};
+
+#endif // FUZZYFINDERMODEL_H
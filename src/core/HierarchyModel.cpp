@@ -0,0 +1,531 @@
+// HierarchyModel.cpp
+#include "HierarchyModel.h"
+#include "WorkspaceIndexer.h"
+#include "WorkspaceWatcher.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+
+namespace {
+constexpr quint32 kCacheMagic = 0x4d444843;  // "MDHC"
+constexpr quint16 kFormatVersion = 1;
+constexpr auto kStreamVersion = QDataStream::Qt_6_0;
+constexpr int kSaveDelayMs = 2000;
+// Listings of directories no longer in the tree are dropped past this
+constexpr int kMaxCachedDirectories = 4096;
+
+QString parentPath(const QString &path)
+{
+    return path.left(path.lastIndexOf('/'));
+}
+}
+
+HierarchyModel::HierarchyModel(FileIoService *io, QObject *parent)
+    : QAbstractItemModel(parent)
+    , m_io(io)
+    , m_cacheLoaded(false)
+    , m_watcher(nullptr)
+    , m_generation(0)
+    , m_listing(0)
+{
+    QDir().mkpath(QFileInfo(cachePath()).absolutePath());
+
+    // Listing competes with the GUI for the disk, not for the CPU
+    m_pool.setThreadPriority(QThread::LowPriority);
+
+    m_saveTimer = new QTimer(this);
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(kSaveDelayMs);
+    connect(m_saveTimer, &QTimer::timeout, this, &HierarchyModel::save);
+}
+
+HierarchyModel::~HierarchyModel()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+
+    if (m_saveTimer->isActive()) {
+        save();
+    }
+}
+
+void HierarchyModel::start()
+{
+    QtConcurrent::run(&HierarchyModel::read, cachePath())
+        .then(this, [this](const QHash<QString, Listing> &saved) {
+            // Listings made since are newer
+            for (auto it = saved.cbegin(); it != saved.cend(); ++it) {
+                if (!m_cache.contains(it.key())) {
+                    m_cache.insert(it.key(), it.value());
+                }
+            }
+            m_cacheLoaded = true;
+            trimCache();
+            if (m_root) {
+                list(m_root.get());
+            }
+        });
+}
+
+void HierarchyModel::setWorkspaceWatcher(WorkspaceWatcher *watcher)
+{
+    m_watcher = watcher;
+    watcher->subscribe(QString(), this, [this](const QVector<WorkspaceEvent> &events) {
+        onWorkspaceEvents(events);
+    });
+    for (Node *node : std::as_const(m_directories)) {
+        if (node->state == State::Listed) {
+            watchDirectory(node->path);
+        }
+    }
+}
+
+void HierarchyModel::setRootPath(const QString &path)
+{
+    QString cleaned = QDir::cleanPath(QFileInfo(path).absoluteFilePath());
+    if (cleaned == m_rootPath) {
+        return;
+    }
+
+    for (const QString &directory : std::as_const(m_watchedDirectories)) {
+        m_watcher->unwatchDirectory(directory);
+    }
+    m_watchedDirectories.clear();
+
+    beginResetModel();
+    m_rootPath = cleaned;
+    ++m_generation;
+    m_prefetching.clear();
+    m_directories.clear();
+    m_root = std::make_unique<Node>();
+    m_root->path = cleaned;
+    m_root->name = QFileInfo(cleaned).fileName();
+    m_root->isDir = true;
+    m_directories.insert(cleaned, m_root.get());
+    endResetModel();
+    emit rootPathChanged();
+
+    // From the cache this fills the first level before returning; before the
+    // cache is loaded, start() lists it
+    list(m_root.get());
+}
+
+void HierarchyModel::refresh()
+{
+    for (Node *node : std::as_const(m_directories)) {
+        if (node->state == State::Listed) {
+            startListing(node->path, m_cache.value(node->path));
+        }
+    }
+}
+
+QString HierarchyModel::filePath(const QModelIndex &index) const
+{
+    Node *node = nodeFor(index);
+    return node ? node->path : QString();
+}
+
+QModelIndex HierarchyModel::index(int row, int column, const QModelIndex &parent) const
+{
+    Node *node = nodeFor(parent);
+    if (!node || column != 0 || row < 0 || row >= int(node->children.size())) {
+        return QModelIndex();
+    }
+    return createIndex(row, 0, node->children[row].get());
+}
+
+QModelIndex HierarchyModel::parent(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return QModelIndex();
+    }
+    return indexFor(static_cast<Node *>(index.internalPointer())->parent);
+}
+
+int HierarchyModel::rowCount(const QModelIndex &parent) const
+{
+    Node *node = nodeFor(parent);
+    return node ? int(node->children.size()) : 0;
+}
+
+int HierarchyModel::columnCount(const QModelIndex &) const
+{
+    return 1;
+}
+
+bool HierarchyModel::hasChildren(const QModelIndex &parent) const
+{
+    Node *node = nodeFor(parent);
+    if (!node || !node->isDir) {
+        return false;
+    }
+    if (node->state == State::Listed) {
+        return !node->children.empty();
+    }
+    // Known from a listing made ahead, otherwise assumed until listed
+    auto cached = m_cache.constFind(node->path);
+    return cached == m_cache.constEnd() || !cached->entries.isEmpty();
+}
+
+bool HierarchyModel::canFetchMore(const QModelIndex &parent) const
+{
+    Node *node = nodeFor(parent);
+    return node && node->isDir && node->state == State::Unlisted;
+}
+
+void HierarchyModel::fetchMore(const QModelIndex &parent)
+{
+    if (Node *node = nodeFor(parent)) {
+        list(node);
+    }
+}
+
+QVariant HierarchyModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    const Node *node = static_cast<Node *>(index.internalPointer());
+    switch (role) {
+        case Qt::DisplayRole:
+            return node->name;
+        case FilePathRole:
+            return node->path;
+        case IsFolderRole:
+            return node->isDir;
+        case LastModifiedRole:
+            return QDateTime::fromMSecsSinceEpoch(node->lastModified);
+        default:
+            return QVariant();
+    }
+}
+
+QHash<int, QByteArray> HierarchyModel::roleNames() const
+{
+    QHash<int, QByteArray> roles = QAbstractItemModel::roleNames();
+    roles.insert(FilePathRole, "filePath");
+    roles.insert(IsFolderRole, "isFolder");
+    roles.insert(LastModifiedRole, "lastModified");
+    return roles;
+}
+
+HierarchyModel::Node *HierarchyModel::nodeFor(const QModelIndex &index) const
+{
+    return index.isValid() ? static_cast<Node *>(index.internalPointer()) : m_root.get();
+}
+
+QModelIndex HierarchyModel::indexFor(Node *node) const
+{
+    if (!node || node == m_root.get()) {
+        return QModelIndex();
+    }
+    return createIndex(node->row, 0, node);
+}
+
+void HierarchyModel::list(Node *node)
+{
+    if (node->state != State::Unlisted || !m_cacheLoaded) {
+        return;
+    }
+
+    auto cached = m_cache.constFind(node->path);
+    if (cached != m_cache.constEnd()) {
+        // Shown right away, then checked against the directory
+        Listing listing = *cached;
+        populate(node, listing);
+        startListing(node->path, listing);
+        return;
+    }
+
+    node->state = State::Listing;
+    // A listing made ahead may already be on its way
+    if (!m_prefetching.contains(node->path)) {
+        startListing(node->path, Listing());
+    }
+}
+
+void HierarchyModel::prefetch(const Node *node)
+{
+    for (const auto &child : node->children) {
+        if (child->isDir && !m_cache.contains(child->path)
+            && !m_prefetching.contains(child->path)) {
+            m_prefetching.insert(child->path);
+            startListing(child->path, Listing());
+        }
+    }
+}
+
+void HierarchyModel::startListing(const QString &path, const Listing &cached)
+{
+    if (m_listing++ == 0) {
+        emit loadingChanged();
+    }
+
+    quint64 generation = m_generation;
+    QtConcurrent::run(&m_pool, &HierarchyModel::listDirectory, path, cached)
+        .then(this, [this, generation, path](const Listing &listing) {
+            if (--m_listing == 0) {
+                emit loadingChanged();
+            }
+            if (generation != m_generation) {
+                return;
+            }
+            m_prefetching.remove(path);
+            applyListing(path, listing);
+        });
+}
+
+void HierarchyModel::applyListing(const QString &path, const Listing &listing)
+{
+    auto cached = m_cache.find(path);
+    bool unchanged = cached != m_cache.end() && cached->mtime == listing.mtime;
+    if (!unchanged) {
+        m_cache.insert(path, listing);
+        m_saveTimer->start();
+    }
+
+    Node *node = m_directories.value(path);
+    if (!node) {
+        return;
+    }
+
+    switch (node->state) {
+        case State::Unlisted:
+            // Listed ahead; only whether it has children may have changed
+            if (listing.entries.isEmpty() && node != m_root.get()) {
+                QModelIndex index = indexFor(node);
+                emit dataChanged(index, index);
+            }
+            return;
+        case State::Listing:
+            populate(node, listing);
+            return;
+        case State::Listed:
+            break;
+    }
+
+    if (unchanged) {
+        return;
+    }
+
+    // The directory changed since it was cached; a changed directory is
+    // shown again as a whole
+    if (!node->children.empty()) {
+        beginRemoveRows(indexFor(node), 0, int(node->children.size()) - 1);
+        for (const auto &child : node->children) {
+            forget(child.get());
+        }
+        node->children.clear();
+        endRemoveRows();
+    }
+    populate(node, listing);
+}
+
+void HierarchyModel::populate(Node *node, const Listing &listing)
+{
+    node->state = State::Listed;
+    watchDirectory(node->path);
+    if (listing.entries.isEmpty()) {
+        if (node != m_root.get()) {
+            QModelIndex index = indexFor(node);
+            emit dataChanged(index, index);
+        }
+        return;
+    }
+
+    beginInsertRows(indexFor(node), 0, listing.entries.size() - 1);
+    node->children.reserve(listing.entries.size());
+    for (const Entry &entry : listing.entries) {
+        auto child = std::make_unique<Node>();
+        child->path = node->path + '/' + entry.name;
+        child->name = entry.name;
+        child->isDir = entry.isDir;
+        child->lastModified = entry.lastModified;
+        child->parent = node;
+        child->row = int(node->children.size());
+        if (child->isDir) {
+            m_directories.insert(child->path, child.get());
+        }
+        node->children.push_back(std::move(child));
+    }
+    endInsertRows();
+
+    prefetch(node);
+}
+
+void HierarchyModel::forget(Node *node)
+{
+    if (!node->isDir) {
+        return;
+    }
+    m_directories.remove(node->path);
+    unwatchDirectory(node->path);
+    for (const auto &child : node->children) {
+        forget(child.get());
+    }
+}
+
+void HierarchyModel::watchDirectory(const QString &path)
+{
+    if (m_watcher && !m_watchedDirectories.contains(path)) {
+        m_watchedDirectories.insert(path);
+        m_watcher->watchDirectory(path);
+    }
+}
+
+void HierarchyModel::unwatchDirectory(const QString &path)
+{
+    if (m_watchedDirectories.remove(path)) {
+        m_watcher->unwatchDirectory(path);
+    }
+}
+
+void HierarchyModel::onWorkspaceEvents(const QVector<WorkspaceEvent> &events)
+{
+    // Entries only come and go with creates, removes and renames, and only
+    // their parent directory changes
+    QSet<QString> parents;
+    for (const WorkspaceEvent &event : events) {
+        if (event.type == WorkspaceEvent::Rescan) {
+            refresh();
+            return;
+        }
+        if (event.type == WorkspaceEvent::Modified) {
+            continue;
+        }
+        bool shown = event.isDirectory || WorkspaceIndexer::isMarkdownFile(event.path)
+                     || WorkspaceIndexer::isMarkdownFile(event.oldPath);
+        if (!shown) {
+            continue;
+        }
+        parents.insert(parentPath(event.path));
+        if (!event.oldPath.isEmpty()) {
+            parents.insert(parentPath(event.oldPath));
+        }
+    }
+
+    for (const QString &path : std::as_const(parents)) {
+        relist(path);
+    }
+}
+
+void HierarchyModel::relist(const QString &path)
+{
+    Node *node = m_directories.value(path);
+    if (node && node->state == State::Listed) {
+        startListing(path, m_cache.value(path));
+    }
+}
+
+void HierarchyModel::trimCache()
+{
+    if (m_cache.size() <= kMaxCachedDirectories) {
+        return;
+    }
+    // Down to three quarters, so this runs once per many new listings
+    for (auto it = m_cache.begin();
+         it != m_cache.end() && m_cache.size() > kMaxCachedDirectories * 3 / 4;) {
+        if (m_directories.contains(it.key())) {
+            ++it;
+        } else {
+            it = m_cache.erase(it);
+        }
+    }
+}
+
+void HierarchyModel::save()
+{
+    trimCache();
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(kStreamVersion);
+    out << kCacheMagic << kFormatVersion << quint32(m_cache.size());
+    for (auto it = m_cache.cbegin(); it != m_cache.cend(); ++it) {
+        out << it.key() << it->mtime << quint32(it->entries.size());
+        for (const Entry &entry : it->entries) {
+            out << entry.name << entry.isDir << entry.lastModified;
+        }
+    }
+
+    m_io->writeData(cachePath(), data);
+}
+
+HierarchyModel::Listing HierarchyModel::listDirectory(const QString &path, const Listing &cached)
+{
+    Listing listing;
+    listing.mtime = QFileInfo(path).lastModified().toMSecsSinceEpoch();
+    // Entries are only added, removed or renamed when the mtime moves
+    if (cached.mtime == listing.mtime) {
+        return cached;
+    }
+
+    QDirIterator it(path, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+    while (it.hasNext()) {
+        it.next();
+        QFileInfo info = it.fileInfo();
+        // Symlinked directories could lead back up the tree
+        if ((info.isDir() && !info.isSymLink())
+            || (!info.isDir() && WorkspaceIndexer::isMarkdownFile(info.fileName()))) {
+            listing.entries.append({info.fileName(), info.isDir(),
+                                    info.lastModified().toMSecsSinceEpoch()});
+        }
+    }
+
+    std::sort(listing.entries.begin(), listing.entries.end(), [](const Entry &a, const Entry &b) {
+        if (a.isDir != b.isDir) {
+            return a.isDir;
+        }
+        return a.name.compare(b.name, Qt::CaseInsensitive) < 0;
+    });
+    return listing;
+}
+
+QString HierarchyModel::cachePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/hierarchy-cache.bin";
+}
+
+QHash<QString, HierarchyModel::Listing> HierarchyModel::read(const QString &fileName)
+{
+    QHash<QString, Listing> cache;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return cache;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(kStreamVersion);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+    in >> magic >> version >> count;
+    if (in.status() != QDataStream::Ok || magic != kCacheMagic || version != kFormatVersion) {
+        return cache;
+    }
+
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString path;
+        Listing listing;
+        quint32 entryCount = 0;
+        in >> path >> listing.mtime >> entryCount;
+        for (quint32 j = 0; j < entryCount && in.status() == QDataStream::Ok; ++j) {
+            Entry entry;
+            in >> entry.name >> entry.isDir >> entry.lastModified;
+            listing.entries.append(entry);
+        }
+        if (in.status() == QDataStream::Ok) {
+            cache.insert(path, listing);
+        }
+    }
+    return cache;
+}
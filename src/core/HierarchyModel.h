@@ -0,0 +1,136 @@
+// HierarchyModel.h
+#ifndef HIERARCHYMODEL_H
+#define HIERARCHYMODEL_H
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+#include <memory>
+#include <vector>
+
+#include "FileIoService.h"
+
+class WorkspaceWatcher;
+struct WorkspaceEvent;
+
+// Tree of the directories and markdown documents below a root, for the
+// document hierarchy view. Directories are listed only when a view asks
+// for their children (fetchMore), on a thread pool; the subdirectories of
+// a listed directory are listed ahead in the background so expanding them
+// is immediate.
+//
+// Listings are cached per directory with the directory's mtime and saved
+// between runs. A cached listing is shown at once and then checked
+// against the directory's current mtime in the background. Listed
+// directories are watched, and only the parent of a created, removed or
+// renamed entry is listed again.
+class HierarchyModel : public QAbstractItemModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QString rootPath READ rootPath WRITE setRootPath NOTIFY rootPathChanged)
+    Q_PROPERTY(bool loading READ isLoading NOTIFY loadingChanged)
+
+public:
+    enum Roles {
+        FilePathRole = Qt::UserRole + 1,
+        IsFolderRole,
+        LastModifiedRole
+    };
+
+    explicit HierarchyModel(FileIoService *io, QObject *parent = nullptr);
+    ~HierarchyModel() override;
+
+    // Loads the saved listings. Nothing is listed before they are in, so a
+    // root set earlier starts from the cache too.
+    void start();
+    void setWorkspaceWatcher(WorkspaceWatcher *watcher);
+
+    QString rootPath() const { return m_rootPath; }
+    void setRootPath(const QString &path);
+    bool isLoading() const { return m_listing > 0; }
+
+    // Checks every listed directory against its mtime again
+    Q_INVOKABLE void refresh();
+    Q_INVOKABLE QString filePath(const QModelIndex &index) const;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &index) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void rootPathChanged();
+    void loadingChanged();
+
+private:
+    struct Entry {
+        QString name;
+        bool isDir = false;
+        qint64 lastModified = 0;  // Milliseconds since the epoch
+    };
+
+    struct Listing {
+        qint64 mtime = -1;        // Of the directory when it was listed
+        QVector<Entry> entries;   // Directories first, then by name
+    };
+
+    enum class State {
+        Unlisted,
+        Listing,
+        Listed
+    };
+
+    struct Node {
+        QString path;
+        QString name;
+        bool isDir = false;
+        qint64 lastModified = 0;
+        Node *parent = nullptr;
+        int row = 0;
+        State state = State::Unlisted;
+        std::vector<std::unique_ptr<Node>> children;
+    };
+
+    FileIoService *m_io;
+    QThreadPool m_pool;
+    QString m_rootPath;
+    std::unique_ptr<Node> m_root;
+    QHash<QString, Node *> m_directories;  // Directory nodes by path
+    QHash<QString, Listing> m_cache;
+    bool m_cacheLoaded;
+    QSet<QString> m_prefetching;
+    WorkspaceWatcher *m_watcher;
+    QSet<QString> m_watchedDirectories;
+    quint64 m_generation;                  // Bumped when the root changes
+    int m_listing;
+    QTimer *m_saveTimer;
+
+    Node *nodeFor(const QModelIndex &index) const;
+    QModelIndex indexFor(Node *node) const;
+    void list(Node *node);
+    void prefetch(const Node *node);
+    void startListing(const QString &path, const Listing &cached);
+    void applyListing(const QString &path, const Listing &listing);
+    void populate(Node *node, const Listing &listing);
+    void forget(Node *node);
+    void watchDirectory(const QString &path);
+    void unwatchDirectory(const QString &path);
+    void onWorkspaceEvents(const QVector<WorkspaceEvent> &events);
+    void relist(const QString &path);
+    void trimCache();
+    void save();
+
+    static Listing listDirectory(const QString &path, const Listing &cached);
+    static QString cachePath();
+    static QHash<QString, Listing> read(const QString &fileName);
+};
+
+#endif // HIERARCHYMODEL_H
@@ -0,0 +1,117 @@
+// IgnoreRules.cpp
+#include "IgnoreRules.h"
+#include <QFile>
+
+void IgnoreRules::addPatterns(const QString &baseDir, const QStringList &patterns)
+{
+    QString base = baseDir.endsWith('/') ? baseDir : baseDir + '/';
+
+    for (QString pattern : patterns) {
+        if (pattern.endsWith('\r')) {
+            pattern.chop(1);
+        }
+        // Trailing spaces are ignored unless escaped
+        while (pattern.endsWith(' ') && !pattern.endsWith("\\ ")) {
+            pattern.chop(1);
+        }
+        if (pattern.isEmpty() || pattern.startsWith('#')) {
+            continue;
+        }
+
+        Rule rule;
+        rule.baseDir = base;
+        if (pattern.startsWith('!')) {
+            rule.negated = true;
+            pattern.remove(0, 1);
+        } else if (pattern.startsWith("\\!") || pattern.startsWith("\\#")) {
+            pattern.remove(0, 1);
+        }
+        if (pattern.endsWith('/')) {
+            rule.directoryOnly = true;
+            pattern.chop(1);
+        }
+        rule.matchPath = pattern.contains('/');
+        if (pattern.startsWith('/')) {
+            pattern.remove(0, 1);
+        }
+        if (pattern.isEmpty()) {
+            continue;
+        }
+
+        rule.regex = QRegularExpression(globToRegex(pattern));
+        if (rule.regex.isValid()) {
+            m_rules.append(rule);
+        }
+    }
+}
+
+bool IgnoreRules::addGitIgnore(const QString &directory)
+{
+    QFile file(directory + "/.gitignore");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    addPatterns(directory, QString::fromUtf8(file.readAll()).split('\n'));
+    return true;
+}
+
+bool IgnoreRules::isIgnored(const QString &absolutePath, bool isDirectory) const
+{
+    for (qsizetype i = m_rules.size() - 1; i >= 0; --i) {
+        const Rule &rule = m_rules.at(i);
+        if (rule.directoryOnly && !isDirectory) {
+            continue;
+        }
+        if (!absolutePath.startsWith(rule.baseDir)) {
+            continue;
+        }
+
+        QStringView relative = QStringView(absolutePath).mid(rule.baseDir.size());
+        QStringView subject = relative;
+        if (!rule.matchPath) {
+            subject = relative.mid(relative.lastIndexOf('/') + 1);
+        }
+        if (rule.regex.matchView(subject).hasMatch()) {
+            return !rule.negated;
+        }
+    }
+    return false;
+}
+
+QString IgnoreRules::globToRegex(QStringView glob)
+{
+    QString regex = "\\A";
+    for (qsizetype i = 0; i < glob.size(); ++i) {
+        QChar c = glob.at(i);
+        if (c == '*') {
+            if (glob.mid(i, 3) == QLatin1String("**/")) {
+                regex += "(?:.*/)?";
+                i += 2;
+            } else if (glob.mid(i, 2) == QLatin1String("**")) {
+                regex += ".*";
+                i += 1;
+            } else {
+                regex += "[^/]*";
+            }
+        } else if (c == '?') {
+            regex += "[^/]";
+        } else if (c == '[') {
+            qsizetype end = glob.indexOf(']', i + 1);
+            if (end < 0) {
+                regex += "\\[";
+                continue;
+            }
+            QString set = glob.mid(i + 1, end - i - 1).toString();
+            if (set.startsWith('!')) {
+                set[0] = '^';
+            }
+            regex += '[' + set.replace("\\", "\\\\") + ']';
+            i = end;
+        } else if (c == '\\' && i + 1 < glob.size()) {
+            regex += QRegularExpression::escape(glob.mid(++i, 1).toString());
+        } else {
+            regex += QRegularExpression::escape(QString(c));
+        }
+    }
+    return regex + "\\z";
+}
@@ -0,0 +1,40 @@
+// IgnoreRules.h
+#ifndef IGNORERULES_H
+#define IGNORERULES_H
+
+#include <QRegularExpression>
+#include <QStringList>
+#include <QVector>
+
+// Patterns in .gitignore syntax: globs with *, ?, ** and [...], negation
+// with a leading !, directory-only patterns with a trailing /, and patterns
+// containing a / anchored to the directory that declared them. The last
+// matching pattern decides.
+//
+// Rules are cheap to copy; a directory walk copies its parent's rules only
+// when the directory has a .gitignore of its own.
+class IgnoreRules
+{
+public:
+    void addPatterns(const QString &baseDir, const QStringList &patterns);
+    // Adds the .gitignore in directory, if there is one
+    bool addGitIgnore(const QString &directory);
+
+    bool isIgnored(const QString &absolutePath, bool isDirectory) const;
+    bool isEmpty() const { return m_rules.isEmpty(); }
+
+private:
+    struct Rule {
+        QString baseDir;  // With a trailing /
+        QRegularExpression regex;
+        bool negated = false;
+        bool directoryOnly = false;
+        bool matchPath = false;  // Match the path relative to baseDir, not the name
+    };
+
+    QVector<Rule> m_rules;
+
+    static QString globToRegex(QStringView glob);
+};
+
+#endif // IGNORERULES_H
@@ -0,0 +1,396 @@
+// IndexSegment.cpp
+#include "IndexSegment.h"
+#include <QMap>
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr quint32 kSegmentMagic = 0x4d444653;  // "MDFS"
+constexpr quint16 kFormatVersion = 1;
+
+// magic u32, version u16, reserved u16, documents u32, terms u32,
+// documentsOffset u64, termsOffset u64, totalTokens u64
+constexpr qint64 kHeaderSize = 40;
+// pathOffset u64, pathBytes u32, tokenCount u32, size i64, lastModified i64
+constexpr qint64 kDocumentEntrySize = 32;
+// termOffset u64, termBytes u32, documentFrequency u32, postingsOffset u64,
+// postingsBytes u64
+constexpr qint64 kTermEntrySize = 32;
+
+template<typename T>
+void put(QByteArray &out, T value)
+{
+    char buffer[sizeof(T)];
+    qToLittleEndian(value, buffer);
+    out.append(buffer, sizeof(T));
+}
+
+template<typename T>
+void putAt(QByteArray &out, qint64 offset, T value)
+{
+    qToLittleEndian(value, out.data() + offset);
+}
+
+template<typename T>
+T get(const uchar *data, qint64 offset)
+{
+    return qFromLittleEndian<T>(data + offset);
+}
+
+void putVarint(QByteArray &out, quint32 value)
+{
+    while (value >= 0x80) {
+        out.append(char(value | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+bool getVarint(const uchar *&p, const uchar *end, quint32 &value)
+{
+    value = 0;
+    for (int shift = 0; p < end && shift <= 28; shift += 7) {
+        uchar byte = *p++;
+        value |= quint32(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int compareBytes(const char *a, qsizetype aSize, const char *b, qsizetype bSize)
+{
+    int result = std::memcmp(a, b, size_t(qMin(aSize, bSize)));
+    if (result != 0) {
+        return result;
+    }
+    return aSize < bSize ? -1 : (aSize > bSize ? 1 : 0);
+}
+}
+
+IndexSegment::~IndexSegment()
+{
+    if (m_data) {
+        m_file.unmap(const_cast<uchar *>(m_data));
+    }
+}
+
+std::shared_ptr<IndexSegment> IndexSegment::open(const QString &fileName, QString *error)
+{
+    std::shared_ptr<IndexSegment> segment(new IndexSegment);
+    segment->m_file.setFileName(fileName);
+    if (!segment->m_file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = segment->m_file.errorString();
+        }
+        return nullptr;
+    }
+
+    segment->m_size = segment->m_file.size();
+    if (segment->m_size < kHeaderSize) {
+        if (error) {
+            *error = "Truncated segment: " + fileName;
+        }
+        return nullptr;
+    }
+    segment->m_data = segment->m_file.map(0, segment->m_size);
+    if (!segment->m_data) {
+        if (error) {
+            *error = segment->m_file.errorString();
+        }
+        return nullptr;
+    }
+
+    const uchar *data = segment->m_data;
+    if (get<quint32>(data, 0) != kSegmentMagic || get<quint16>(data, 4) != kFormatVersion) {
+        if (error) {
+            *error = "Not a segment of this version: " + fileName;
+        }
+        return nullptr;
+    }
+    segment->m_documentCount = get<quint32>(data, 8);
+    segment->m_termCount = get<quint32>(data, 12);
+    segment->m_documentsOffset = get<quint64>(data, 16);
+    segment->m_termsOffset = get<quint64>(data, 24);
+    segment->m_totalTokens = get<quint64>(data, 32);
+
+    // Tables must lie inside the file; entries are checked when read
+    quint64 documentsEnd = segment->m_documentsOffset
+                           + quint64(segment->m_documentCount) * kDocumentEntrySize;
+    quint64 termsEnd = segment->m_termsOffset + quint64(segment->m_termCount) * kTermEntrySize;
+    if (documentsEnd > quint64(segment->m_size) || termsEnd > quint64(segment->m_size)) {
+        if (error) {
+            *error = "Corrupt segment: " + fileName;
+        }
+        return nullptr;
+    }
+    return segment;
+}
+
+bool IndexSegment::write(const QString &fileName, const QVector<IndexedDocument> &documents,
+                         QString *error)
+{
+    // Terms in UTF-8 byte order, which is the order lookups compare in
+    QMap<QByteArray, QVector<QPair<quint32, const QVector<quint32> *>>> terms;
+    quint64 totalTokens = 0;
+    for (quint32 id = 0; id < quint32(documents.size()); ++id) {
+        const IndexedDocument &document = documents.at(id);
+        totalTokens += document.tokenCount;
+        for (auto it = document.positions.cbegin(); it != document.positions.cend(); ++it) {
+            terms[it.key().toUtf8()].append({id, &it.value()});
+        }
+    }
+
+    QByteArray data(kHeaderSize, '\0');
+
+    struct TermEntry {
+        quint64 postingsOffset;
+        quint64 postingsBytes;
+        quint32 documentFrequency;
+        quint64 termOffset = 0;
+    };
+    QVector<TermEntry> termEntries;
+    termEntries.reserve(terms.size());
+    for (auto it = terms.cbegin(); it != terms.cend(); ++it) {
+        TermEntry entry;
+        entry.postingsOffset = data.size();
+        entry.documentFrequency = it.value().size();
+
+        quint32 previousDocument = 0;
+        for (const auto &posting : it.value()) {
+            putVarint(data, posting.first - previousDocument);
+            previousDocument = posting.first;
+            putVarint(data, posting.second->size());
+            quint32 previousPosition = 0;
+            for (quint32 position : *posting.second) {
+                putVarint(data, position - previousPosition);
+                previousPosition = position;
+            }
+        }
+        entry.postingsBytes = data.size() - entry.postingsOffset;
+        termEntries.append(entry);
+    }
+
+    QVector<quint64> pathOffsets;
+    QVector<QByteArray> paths;
+    for (const IndexedDocument &document : documents) {
+        paths.append(document.path.toUtf8());
+        pathOffsets.append(data.size());
+        data.append(paths.last());
+    }
+    qsizetype termIndex = 0;
+    for (auto it = terms.cbegin(); it != terms.cend(); ++it) {
+        termEntries[termIndex++].termOffset = data.size();
+        data.append(it.key());
+    }
+
+    while (data.size() % 8 != 0) {
+        data.append('\0');
+    }
+    quint64 documentsOffset = data.size();
+    for (qsizetype i = 0; i < documents.size(); ++i) {
+        put<quint64>(data, pathOffsets.at(i));
+        put<quint32>(data, paths.at(i).size());
+        put<quint32>(data, documents.at(i).tokenCount);
+        put<qint64>(data, documents.at(i).size);
+        put<qint64>(data, documents.at(i).lastModified);
+    }
+
+    quint64 termsOffset = data.size();
+    termIndex = 0;
+    for (auto it = terms.cbegin(); it != terms.cend(); ++it) {
+        const TermEntry &entry = termEntries.at(termIndex++);
+        put<quint64>(data, entry.termOffset);
+        put<quint32>(data, it.key().size());
+        put<quint32>(data, entry.documentFrequency);
+        put<quint64>(data, entry.postingsOffset);
+        put<quint64>(data, entry.postingsBytes);
+    }
+
+    putAt<quint32>(data, 0, kSegmentMagic);
+    putAt<quint16>(data, 4, kFormatVersion);
+    putAt<quint32>(data, 8, documents.size());
+    putAt<quint32>(data, 12, terms.size());
+    putAt<quint64>(data, 16, documentsOffset);
+    putAt<quint64>(data, 24, termsOffset);
+    putAt<quint64>(data, 32, totalTokens);
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
+
+double IndexSegment::averageTokenCount() const
+{
+    return m_documentCount > 0 ? double(m_totalTokens) / m_documentCount : 0;
+}
+
+IndexSegment::Document IndexSegment::document(quint32 id) const
+{
+    Document document;
+    if (id >= m_documentCount) {
+        return document;
+    }
+    qint64 entry = m_documentsOffset + qint64(id) * kDocumentEntrySize;
+    quint64 pathOffset = get<quint64>(m_data, entry);
+    quint32 pathBytes = get<quint32>(m_data, entry + 8);
+    if (pathOffset + pathBytes <= quint64(m_size)) {
+        document.path = QString::fromUtf8(reinterpret_cast<const char *>(m_data + pathOffset),
+                                          pathBytes);
+    }
+    document.tokenCount = get<quint32>(m_data, entry + 12);
+    document.size = get<qint64>(m_data, entry + 16);
+    document.lastModified = get<qint64>(m_data, entry + 24);
+    return document;
+}
+
+quint32 IndexSegment::tokenCount(quint32 id) const
+{
+    if (id >= m_documentCount) {
+        return 0;
+    }
+    return get<quint32>(m_data, m_documentsOffset + qint64(id) * kDocumentEntrySize + 12);
+}
+
+QByteArray IndexSegment::termAt(quint32 index) const
+{
+    qint64 entry = m_termsOffset + qint64(index) * kTermEntrySize;
+    quint64 offset = get<quint64>(m_data, entry);
+    quint32 bytes = get<quint32>(m_data, entry + 8);
+    if (offset + bytes > quint64(m_size)) {
+        return QByteArray();
+    }
+    // Points into the mapping; valid as long as the segment
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(m_data + offset), bytes);
+}
+
+qint64 IndexSegment::lowerBound(const QByteArray &term) const
+{
+    qint64 low = 0;
+    qint64 high = m_termCount;
+    while (low < high) {
+        qint64 middle = (low + high) / 2;
+        QByteArray candidate = termAt(quint32(middle));
+        if (compareBytes(candidate.constData(), candidate.size(), term.constData(), term.size()) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+QVector<IndexSegment::Posting> IndexSegment::postings(const QString &term) const
+{
+    QByteArray utf8 = term.toUtf8();
+    qint64 index = lowerBound(utf8);
+    if (index >= m_termCount || termAt(quint32(index)) != utf8) {
+        return {};
+    }
+    return decodePostings(quint32(index));
+}
+
+QStringList IndexSegment::termsWithPrefix(const QString &prefix, int limit) const
+{
+    QByteArray utf8 = prefix.toUtf8();
+    QStringList terms;
+    for (qint64 index = lowerBound(utf8); index < m_termCount && terms.size() < limit; ++index) {
+        QByteArray term = termAt(quint32(index));
+        if (!term.startsWith(utf8)) {
+            break;
+        }
+        terms.append(QString::fromUtf8(term));
+    }
+    return terms;
+}
+
+QVector<IndexSegment::Posting> IndexSegment::decodePostings(quint32 index) const
+{
+    qint64 entry = m_termsOffset + qint64(index) * kTermEntrySize;
+    quint32 documentFrequency = get<quint32>(m_data, entry + 12);
+    quint64 offset = get<quint64>(m_data, entry + 16);
+    quint64 bytes = get<quint64>(m_data, entry + 24);
+    if (offset > quint64(m_size) || bytes > quint64(m_size) - offset) {
+        return {};
+    }
+
+    // The counts come from the file; a posting takes at least two bytes and
+    // a position one, so a damaged count can't size the vectors
+    QVector<Posting> postings;
+    postings.reserve(std::min<quint64>({documentFrequency, m_documentCount, bytes / 2}));
+    const uchar *p = m_data + offset;
+    const uchar *end = p + bytes;
+    quint32 document = 0;
+    for (quint32 i = 0; i < documentFrequency; ++i) {
+        quint32 delta;
+        quint32 frequency;
+        if (!getVarint(p, end, delta) || !getVarint(p, end, frequency)) {
+            break;
+        }
+        document += delta;
+
+        Posting posting;
+        posting.document = document;
+        posting.positions.reserve(qMin<quint64>(frequency, quint64(end - p)));
+        quint32 position = 0;
+        for (quint32 j = 0; j < frequency; ++j) {
+            quint32 positionDelta;
+            if (!getVarint(p, end, positionDelta)) {
+                break;
+            }
+            position += positionDelta;
+            posting.positions.append(position);
+        }
+        postings.append(posting);
+    }
+    return postings;
+}
+
+QVector<IndexedDocument> IndexSegment::documents(const QSet<quint32> &deleted,
+                                                 QVector<quint32> *ids) const
+{
+    QVector<IndexedDocument> documents(m_documentCount);
+    for (quint32 id = 0; id < m_documentCount; ++id) {
+        if (deleted.contains(id)) {
+            continue;
+        }
+        Document stored = document(id);
+        documents[id].path = stored.path;
+        documents[id].size = stored.size;
+        documents[id].lastModified = stored.lastModified;
+        documents[id].tokenCount = stored.tokenCount;
+    }
+
+    // Invert the term table back into per-document positions
+    for (quint32 index = 0; index < m_termCount; ++index) {
+        QString term;
+        for (const Posting &posting : decodePostings(index)) {
+            if (posting.document >= m_documentCount || deleted.contains(posting.document)) {
+                continue;
+            }
+            if (term.isNull()) {
+                term = QString::fromUtf8(termAt(index));
+            }
+            documents[posting.document].positions.insert(term, posting.positions);
+        }
+    }
+
+    QVector<IndexedDocument> live;
+    for (quint32 id = 0; id < m_documentCount; ++id) {
+        if (!deleted.contains(id)) {
+            live.append(std::move(documents[id]));
+            if (ids) {
+                ids->append(id);
+            }
+        }
+    }
+    return live;
+}
@@ -0,0 +1,88 @@
+// IndexSegment.h
+#ifndef INDEXSEGMENT_H
+#define INDEXSEGMENT_H
+
+#include <QFile>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <memory>
+
+// A document as it goes into a segment: its terms and their token positions
+struct IndexedDocument {
+    QString path;
+    qint64 size = -1;          // -1 if the file could not be read
+    qint64 lastModified = 0;   // Milliseconds since the epoch
+    quint32 tokenCount = 0;
+    QHash<QString, QVector<quint32>> positions;  // Term -> ascending positions
+};
+
+// Immutable part of the full-text index, stored in one file and read
+// through a memory mapping. The file holds a document table, a sorted term
+// table and the posting lists, which are varint-encoded deltas of document
+// ids and token positions:
+//
+//   header | postings | UTF-8 strings | document table | term table
+//
+// Segments are written once and never changed; deleting a document is
+// recorded outside the segment, and merging writes a new one.
+class IndexSegment
+{
+public:
+    struct Document {
+        QString path;
+        quint32 tokenCount = 0;
+        qint64 size = -1;
+        qint64 lastModified = 0;
+    };
+
+    struct Posting {
+        quint32 document;
+        QVector<quint32> positions;
+    };
+
+    static std::shared_ptr<IndexSegment> open(const QString &fileName, QString *error = nullptr);
+    static bool write(const QString &fileName, const QVector<IndexedDocument> &documents,
+                      QString *error = nullptr);
+
+    ~IndexSegment();
+    IndexSegment(const IndexSegment &) = delete;
+    IndexSegment &operator=(const IndexSegment &) = delete;
+
+    QString fileName() const { return m_file.fileName(); }
+    quint32 documentCount() const { return m_documentCount; }
+    quint32 termCount() const { return m_termCount; }
+    double averageTokenCount() const;
+
+    Document document(quint32 id) const;
+    quint32 tokenCount(quint32 id) const;
+
+    // Posting list of an exact term, empty if it does not occur
+    QVector<Posting> postings(const QString &term) const;
+    // Terms starting with prefix, in order, at most limit of them
+    QStringList termsWithPrefix(const QString &prefix, int limit) const;
+
+    // Reconstructs the documents that are not deleted, for merging. ids
+    // receives their ids in this segment.
+    QVector<IndexedDocument> documents(const QSet<quint32> &deleted, QVector<quint32> *ids) const;
+
+private:
+    QFile m_file;
+    const uchar *m_data = nullptr;
+    qint64 m_size = 0;
+    quint32 m_documentCount = 0;
+    quint32 m_termCount = 0;
+    quint64 m_documentsOffset = 0;
+    quint64 m_termsOffset = 0;
+    quint64 m_totalTokens = 0;
+
+    IndexSegment() = default;
+
+    QByteArray termAt(quint32 index) const;
+    qint64 lowerBound(const QByteArray &term) const;
+    QVector<Posting> decodePostings(quint32 index) const;
+};
+
+#endif // INDEXSEGMENT_H
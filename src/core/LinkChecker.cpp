@@ -0,0 +1,521 @@
+// LinkChecker.cpp
+#include "LinkChecker.h"
+#include "ContentHash.h"
+#include "IgnoreRules.h"
+#include <QDataStream>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+
+namespace {
+constexpr quint32 kCacheMagic = 0x4d444c43;  // "MDLC"
+constexpr quint16 kFormatVersion = 1;
+constexpr auto kStreamVersion = QDataStream::Qt_6_0;
+
+QString readText(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    return QString::fromUtf8(file.readAll());
+}
+}
+
+LinkChecker::LinkChecker(FileIoService *io, WorkspaceIndexer *indexer, QObject *parent)
+    : QObject(parent)
+    , m_io(io)
+    , m_indexer(indexer)
+    , m_cacheFile(cachePath(QStringList()))
+    , m_running(false)
+{
+    QDir().mkpath(QFileInfo(m_cacheFile).absolutePath());
+}
+
+void LinkChecker::setCacheRoots(const QStringList &roots)
+{
+    QString fileName = cachePath(roots);
+    if (fileName != m_cacheFile) {
+        m_cacheFile = fileName;
+        m_cache = Cache();
+    }
+}
+
+void LinkChecker::checkWorkspace()
+{
+    if (m_running || !m_indexer) {
+        return;
+    }
+    m_running = true;
+    emit runningChanged();
+
+    // A new indexer is still loading and walking; its empty list would
+    // report nothing and empty the cache
+    if (!m_indexer->hasScanned()) {
+        connect(m_indexer, &WorkspaceIndexer::scanFinished, this,
+                &LinkChecker::startWorkspaceCheck, Qt::SingleShotConnection);
+        return;
+    }
+    startWorkspaceCheck();
+}
+
+void LinkChecker::startWorkspaceCheck()
+{
+    // The cache moves to the worker and comes back with the result
+    setCacheRoots(m_indexer->roots());
+    QtConcurrent::run(&LinkChecker::run, std::move(m_cache), m_cacheFile, m_indexer->paths())
+        .then(this, [this](Outcome outcome) {
+            finish(outcome);
+            m_io->writeData(reportPath(), outcome.json);
+            m_running = false;
+            emit runningChanged();
+            emit finished(reportPath(), brokenCount());
+        });
+}
+
+LinkChecker::Report LinkChecker::check(const QStringList &documents)
+{
+    Outcome outcome = run(std::move(m_cache), m_cacheFile, documents);
+    finish(outcome);
+    return m_report;
+}
+
+void LinkChecker::finish(Outcome &outcome)
+{
+    m_cache = std::move(outcome.cache);
+    m_report = outcome.report;
+    if (!outcome.cacheData.isEmpty()) {
+        m_io->writeData(m_cacheFile, outcome.cacheData);
+    }
+    emit reportChanged();
+}
+
+QVariantList LinkChecker::issues() const
+{
+    QVariantList list;
+    list.reserve(m_report.issues.size());
+    for (const Issue &issue : m_report.issues) {
+        list.append(QVariantMap{
+            {"source", issue.source},
+            {"line", issue.line},
+            {"column", issue.column + 1},
+            {"target", issue.target},
+            {"anchor", issue.anchor},
+            {"kind", LinkExtractor::kindName(issue.kind)},
+            {"problem", issue.problem == MissingFile ? "missing-file" : "missing-anchor"}
+        });
+    }
+    return list;
+}
+
+QByteArray LinkChecker::toJson(const Report &report)
+{
+    QJsonArray broken;
+    for (const Issue &issue : report.issues) {
+        broken.append(QJsonObject{
+            {"source", issue.source},
+            {"line", issue.line},
+            {"column", issue.column + 1},
+            {"kind", LinkExtractor::kindName(issue.kind)},
+            {"target", issue.target},
+            {"anchor", issue.anchor},
+            {"problem", issue.problem == MissingFile ? "missing-file" : "missing-anchor"}
+        });
+    }
+
+    QJsonObject root{
+        {"documents", report.documentCount},
+        {"links", report.linkCount},
+        {"targets", report.targetCount},
+        {"parsed", report.parsedCount},
+        {"elapsedMs", report.elapsedMs},
+        {"broken", broken}
+    };
+    return QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
+
+QStringList LinkChecker::findDocuments(const QString &root)
+{
+    IgnoreRules rootRules;
+    rootRules.addPatterns(root, WorkspaceIndexer::defaultExcludePatterns());
+
+    QStringList documents;
+    QVector<QPair<QString, IgnoreRules>> directories{{root, rootRules}};
+    while (!directories.isEmpty()) {
+        auto [directory, rules] = directories.takeLast();
+        rules.addGitIgnore(directory);
+
+        const QFileInfoList entries = QDir(directory).entryInfoList(
+            QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot | QDir::Hidden | QDir::NoSymLinks);
+        for (const QFileInfo &entry : entries) {
+            QString path = entry.absoluteFilePath();
+            if (rules.isIgnored(path, entry.isDir())) {
+                continue;
+            }
+            if (entry.isDir()) {
+                directories.append({path, rules});
+            } else if (WorkspaceIndexer::isMarkdownFile(path)) {
+                documents.append(path);
+            }
+        }
+    }
+    documents.sort();
+    return documents;
+}
+
+int LinkChecker::runCli(const QString &root, const QString &outputPath)
+{
+    QFileInfo rootInfo(root);
+    if (!rootInfo.isDir()) {
+        qWarning() << "Not a directory:" << root;
+        return 2;
+    }
+
+    FileIoService io;
+    LinkChecker checker(&io, nullptr);
+    QString cleanRoot = QDir::cleanPath(rootInfo.absoluteFilePath());
+    checker.setCacheRoots({cleanRoot});
+    Report report = checker.check(findDocuments(cleanRoot));
+    QByteArray json = toJson(report);
+
+    if (outputPath.isEmpty()) {
+        QFile out;
+        out.open(stdout, QIODevice::WriteOnly);
+        out.write(json);
+    } else {
+        QSaveFile file(outputPath);
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()
+            || !file.commit()) {
+            qWarning() << "Could not write" << outputPath << file.errorString();
+            return 2;
+        }
+    }
+
+    // The cache write is still queued
+    io.waitForDone();
+    return report.issues.isEmpty() ? 0 : 1;
+}
+
+LinkChecker::Outcome LinkChecker::run(Cache cache, const QString &cacheFile,
+                                      const QStringList &documents)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    Outcome outcome;
+    Report &report = outcome.report;
+
+    // Nothing to check says nothing about the cached documents, so it is
+    // kept as it is
+    if (documents.isEmpty()) {
+        report.elapsedMs = timer.elapsed();
+        outcome.json = toJson(report);
+        outcome.cache = std::move(cache);
+        return outcome;
+    }
+
+    if (!cache.loaded) {
+        cache = read(cacheFile);
+        cache.loaded = true;
+    }
+    checkDocuments(cache, documents, report);
+
+    // Distinct targets, and whether any link needs their headings
+    QHash<QString, bool> targets;
+    for (const Document &document : std::as_const(cache.documents)) {
+        for (const CachedLink &link : document.links) {
+            bool &needsAnchors = targets[link.target];
+            needsAnchors = needsAnchors || !link.anchor.isEmpty();
+        }
+    }
+    checkTargets(cache, targets);
+
+    QStringList sources = cache.documents.keys();
+    sources.sort();
+    for (const QString &source : std::as_const(sources)) {
+        for (const CachedLink &link : cache.documents.value(source).links) {
+            ++report.linkCount;
+            const Target target = cache.targets.value(link.target);
+
+            Issue issue{source, link.target, link.anchor, LinkExtractor::Kind(link.kind),
+                        MissingFile, int(link.line), int(link.column)};
+            if (target.mtime < 0) {
+                report.issues.append(issue);
+            } else if (!link.anchor.isEmpty() && target.anchorsLoaded
+                       && !target.anchors.contains(link.anchor)
+                       && !target.anchors.contains(slugify(link.anchor))) {
+                issue.problem = MissingAnchor;
+                report.issues.append(issue);
+            }
+        }
+    }
+
+    report.documentCount = cache.documents.size();
+    report.targetCount = cache.targets.size();
+    report.elapsedMs = timer.elapsed();
+
+    outcome.json = toJson(report);
+    outcome.cacheData = serialize(cache);
+    outcome.cache = std::move(cache);
+    return outcome;
+}
+
+void LinkChecker::checkDocuments(Cache &cache, const QStringList &documents, Report &report)
+{
+    struct Scanned {
+        QString path;
+        Document document;
+        bool parsed = false;
+        QSet<QString> anchors;  // Collected while the text is at hand
+    };
+
+    const Cache &previous = cache;
+    QVector<Scanned> scanned = QtConcurrent::blockingMapped<QVector<Scanned>>(
+        documents, [&previous](const QString &path) {
+            Scanned result;
+            result.path = path;
+
+            QFileInfo info(path);
+            if (!info.isFile()) {
+                return result;
+            }
+            qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+            auto cached = previous.documents.constFind(path);
+            if (cached != previous.documents.constEnd() && cached->size == info.size()
+                && cached->mtime == mtime) {
+                result.document = *cached;
+                return result;
+            }
+
+            QString text = readText(path);
+            result.parsed = true;
+            result.document.size = info.size();
+            result.document.mtime = mtime;
+            const QVector<LinkExtractor::Link> links = LinkExtractor::extract(path, text);
+            result.document.links.reserve(links.size());
+            for (const LinkExtractor::Link &link : links) {
+                result.document.links.append({link.target, link.anchor, quint32(link.line),
+                                              quint32(link.column), quint8(link.kind)});
+            }
+            result.anchors = headingAnchors(text);
+            return result;
+        });
+
+    // Documents no longer checked leave the cache
+    QHash<QString, Document> current;
+    current.reserve(scanned.size());
+    for (Scanned &result : scanned) {
+        if (result.document.size < 0) {
+            continue;
+        }
+        if (result.parsed) {
+            ++report.parsedCount;
+            Target &target = cache.targets[result.path];
+            target.mtime = result.document.mtime;
+            target.anchorsLoaded = true;
+            target.anchors = std::move(result.anchors);
+        }
+        current.insert(result.path, std::move(result.document));
+    }
+    cache.documents = std::move(current);
+}
+
+void LinkChecker::checkTargets(Cache &cache, const QHash<QString, bool> &targets)
+{
+    const QStringList paths = targets.keys();
+    const Cache &previous = cache;
+    QVector<QPair<QString, Target>> checked =
+        QtConcurrent::blockingMapped<QVector<QPair<QString, Target>>>(
+            paths, [&previous, &targets](const QString &path) {
+                Target cached = previous.targets.value(path);
+                QFileInfo info(path);
+                Target target;
+                target.mtime = info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+
+                // Headings are read again only if the target changed
+                bool needsAnchors = targets.value(path) && info.isFile()
+                                    && WorkspaceIndexer::isMarkdownFile(path);
+                if (target.mtime == cached.mtime && (cached.anchorsLoaded || !needsAnchors)) {
+                    return qMakePair(path, cached);
+                }
+                if (needsAnchors) {
+                    target.anchors = headingAnchors(readText(path));
+                    target.anchorsLoaded = true;
+                }
+                return qMakePair(path, target);
+            });
+
+    QHash<QString, Target> current;
+    current.reserve(checked.size());
+    for (auto &entry : checked) {
+        current.insert(entry.first, std::move(entry.second));
+    }
+    cache.targets = std::move(current);
+}
+
+QSet<QString> LinkChecker::headingAnchors(QStringView text)
+{
+    static const QRegularExpression atxRegex(R"(^ {0,3}#{1,6}(?:[ \t]+(.*?))?(?:[ \t]+#+)?[ \t]*$)");
+    static const QRegularExpression setextRegex(R"(^ {0,3}(?:=+|-+)[ \t]*$)");
+    static const QRegularExpression customIdRegex(R"(\{#([^}\s]+)\}\s*$)");
+    static const QRegularExpression htmlIdRegex(R"(<[^>]+\b(?:id|name)\s*=\s*["']([^"']+)["'])");
+
+    QSet<QString> anchors;
+    QHash<QString, int> seen;  // Repeated headings get -1, -2, ... like on GitHub
+    auto addHeading = [&](const QString &heading) {
+        QRegularExpressionMatch customId = customIdRegex.match(heading);
+        if (customId.hasMatch()) {
+            anchors.insert(customId.captured(1));
+            return;
+        }
+        QString slug = slugify(heading);
+        int &count = seen[slug];
+        anchors.insert(count == 0 ? slug : slug + '-' + QString::number(count));
+        ++count;
+    };
+
+    bool fenced = false;
+    QStringView previous;
+    for (QStringView line : text.tokenize(u'\n')) {
+        QStringView trimmed = line.trimmed();
+        if (trimmed.startsWith(u"```") || trimmed.startsWith(u"~~~")) {
+            fenced = !fenced;
+            previous = QStringView();
+            continue;
+        }
+        if (fenced) {
+            continue;
+        }
+
+        QRegularExpressionMatch atx = atxRegex.matchView(line);
+        if (atx.hasMatch()) {
+            addHeading(atx.captured(1));
+            previous = QStringView();
+        } else if (!previous.isEmpty() && setextRegex.matchView(line).hasMatch()) {
+            addHeading(previous.toString());
+            previous = QStringView();
+        } else {
+            previous = trimmed;
+        }
+    }
+
+    QRegularExpressionMatchIterator it = htmlIdRegex.globalMatchView(text);
+    while (it.hasNext()) {
+        anchors.insert(it.next().captured(1));
+    }
+    return anchors;
+}
+
+QString LinkChecker::slugify(QString heading)
+{
+    // Links in a heading contribute their text only
+    static const QRegularExpression linkRegex(R"(!?\[([^\]]*)\]\([^)]*\))");
+    heading.replace(linkRegex, "\\1");
+
+    QString slug;
+    slug.reserve(heading.size());
+    for (QChar c : heading.trimmed().toLower()) {
+        if (c.isLetterOrNumber() || c == '-' || c == '_') {
+            slug += c;
+        } else if (c == ' ') {
+            slug += '-';
+        }
+    }
+    return slug;
+}
+
+QString LinkChecker::cachePath(const QStringList &roots)
+{
+    // One file per set of roots
+    quint64 key = ContentHash::of(roots.join('\n'));
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+           + QString("/link-check/%1.bin").arg(key, 16, 16, QChar('0'));
+}
+
+QString LinkChecker::reportPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/link-check.json";
+}
+
+QByteArray LinkChecker::serialize(const Cache &cache)
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(kStreamVersion);
+    out << kCacheMagic << kFormatVersion;
+
+    out << quint32(cache.documents.size());
+    for (auto it = cache.documents.cbegin(); it != cache.documents.cend(); ++it) {
+        out << it.key() << it->size << it->mtime << quint32(it->links.size());
+        for (const CachedLink &link : it->links) {
+            out << link.target << link.anchor << link.line << link.column << link.kind;
+        }
+    }
+
+    out << quint32(cache.targets.size());
+    for (auto it = cache.targets.cbegin(); it != cache.targets.cend(); ++it) {
+        out << it.key() << it->mtime << it->anchorsLoaded << it->anchors;
+    }
+    return data;
+}
+
+LinkChecker::Cache LinkChecker::read(const QString &fileName)
+{
+    Cache cache;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return cache;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(kStreamVersion);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != kCacheMagic || version != kFormatVersion) {
+        return cache;
+    }
+
+    quint32 documentCount = 0;
+    in >> documentCount;
+    for (quint32 i = 0; i < documentCount && in.status() == QDataStream::Ok; ++i) {
+        QString path;
+        Document document;
+        quint32 linkCount = 0;
+        in >> path >> document.size >> document.mtime >> linkCount;
+        for (quint32 j = 0; j < linkCount && in.status() == QDataStream::Ok; ++j) {
+            CachedLink link;
+            in >> link.target >> link.anchor >> link.line >> link.column >> link.kind;
+            document.links.append(link);
+        }
+        cache.documents.insert(path, document);
+    }
+
+    quint32 targetCount = 0;
+    in >> targetCount;
+    for (quint32 i = 0; i < targetCount && in.status() == QDataStream::Ok; ++i) {
+        QString path;
+        Target target;
+        in >> path >> target.mtime >> target.anchorsLoaded >> target.anchors;
+        cache.targets.insert(path, target);
+    }
+
+    // A torn cache only costs a full check
+    if (in.status() != QDataStream::Ok) {
+        return Cache();
+    }
+    return cache;
+}
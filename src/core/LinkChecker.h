@@ -0,0 +1,147 @@
+// LinkChecker.h
+#ifndef LINKCHECKER_H
+#define LINKCHECKER_H
+
+#include <QObject>
+#include <QHash>
+#include <QPointer>
+#include <QSet>
+#include <QStringList>
+#include <QVariantList>
+#include <QVector>
+
+#include "FileIoService.h"
+#include "LinkExtractor.h"
+#include "WorkspaceIndexer.h"
+
+// Finds internal links and images that point to a missing file, and
+// links whose #fragment names no heading of the target document.
+//
+// Documents are parsed on the global thread pool and their links kept in
+// a cache saved between runs (link-check.bin). A run parses again only
+// the documents whose size or mtime changed, stats every distinct target
+// once, and reads the headings of a target only when it changed since they
+// were collected; everything else is answered from the cache.
+//
+// The result is written as JSON: to link-check.json for the workspace
+// check, or to stdout or a file with --check-links <directory>. The last
+// workspace result is also available as issues() for the window.
+class LinkChecker : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool running READ isRunning NOTIFY runningChanged)
+    Q_PROPERTY(int brokenCount READ brokenCount NOTIFY reportChanged)
+    Q_PROPERTY(int documentCount READ documentCount NOTIFY reportChanged)
+    Q_PROPERTY(QVariantList issues READ issues NOTIFY reportChanged)
+
+public:
+    enum Problem {
+        MissingFile,
+        MissingAnchor
+    };
+
+    struct Issue {
+        QString source;
+        QString target;
+        QString anchor;
+        LinkExtractor::Kind kind = LinkExtractor::File;
+        Problem problem = MissingFile;
+        int line = 0;
+        int column = 0;  // 0-based
+    };
+
+    struct Report {
+        QVector<Issue> issues;     // By source, then position
+        int documentCount = 0;
+        int linkCount = 0;
+        int parsedCount = 0;       // Documents not answered from the cache
+        int targetCount = 0;
+        qint64 elapsedMs = 0;
+    };
+
+    LinkChecker(FileIoService *io, WorkspaceIndexer *indexer, QObject *parent = nullptr);
+
+    // Checks the documents of the workspace index in the background, once
+    // the index has finished its first walk
+    Q_INVOKABLE void checkWorkspace();
+    // Checks the given documents and waits for the result
+    Report check(const QStringList &documents);
+    // Parsed links are cached per set of roots, so checks of different
+    // directories keep their own cache. checkWorkspace() uses the index roots.
+    void setCacheRoots(const QStringList &roots);
+
+    bool isRunning() const { return m_running; }
+    Report report() const { return m_report; }
+    int brokenCount() const { return m_report.issues.size(); }
+    int documentCount() const { return m_report.documentCount; }
+    // One map per issue: source, line, column, target, anchor, kind, problem
+    QVariantList issues() const;
+
+    static QByteArray toJson(const Report &report);
+    static QStringList findDocuments(const QString &root);
+
+    // --check-links <root>; the exit code is 1 if a link is broken
+    static int runCli(const QString &root, const QString &outputPath);
+
+signals:
+    void runningChanged();
+    void reportChanged();
+    void finished(const QString &reportPath, int brokenCount);
+
+private:
+    struct CachedLink {
+        QString target;
+        QString anchor;
+        quint32 line = 0;
+        quint32 column = 0;
+        quint8 kind = LinkExtractor::File;
+    };
+
+    struct Document {
+        qint64 size = -1;
+        qint64 mtime = 0;
+        QVector<CachedLink> links;
+    };
+
+    struct Target {
+        qint64 mtime = -1;             // -1 if missing
+        bool anchorsLoaded = false;
+        QSet<QString> anchors;
+    };
+
+    struct Cache {
+        QHash<QString, Document> documents;
+        QHash<QString, Target> targets;
+        bool loaded = false;
+    };
+
+    struct Outcome {
+        Report report;
+        Cache cache;
+        QByteArray cacheData;
+        QByteArray json;
+    };
+
+    FileIoService *m_io;
+    QPointer<WorkspaceIndexer> m_indexer;
+    Cache m_cache;
+    QString m_cacheFile;
+    Report m_report;
+    bool m_running;
+
+    void startWorkspaceCheck();
+    void finish(Outcome &outcome);
+
+    static Outcome run(Cache cache, const QString &cacheFile, const QStringList &documents);
+    static void checkDocuments(Cache &cache, const QStringList &documents, Report &report);
+    static void checkTargets(Cache &cache, const QHash<QString, bool> &targets);
+    static QSet<QString> headingAnchors(QStringView text);
+    static QString slugify(QString heading);
+
+    static QString cachePath(const QStringList &roots);
+    static QString reportPath();
+    static QByteArray serialize(const Cache &cache);
+    static Cache read(const QString &fileName);
+};
+
+#endif // LINKCHECKER_H
@@ -0,0 +1,123 @@
+// LinkExtractor.cpp
+#include "LinkExtractor.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QUrl>
+#include <algorithm>
+
+LinkExtractor::LineIndex::LineIndex(QStringView text)
+{
+    m_starts.append(0);
+    qsizetype newline = text.indexOf('\n');
+    while (newline >= 0) {
+        m_starts.append(newline + 1);
+        newline = text.indexOf('\n', newline + 1);
+    }
+}
+
+int LinkExtractor::LineIndex::lineAt(qsizetype position) const
+{
+    // The last line starting at or before the position
+    auto it = std::upper_bound(m_starts.cbegin(), m_starts.cend(), position);
+    return int(it - m_starts.cbegin());
+}
+
+int LinkExtractor::LineIndex::columnAt(qsizetype position) const
+{
+    return int(position - m_starts.at(lineAt(position) - 1));
+}
+
+QVector<LinkExtractor::Link> LinkExtractor::extract(const QString &sourcePath, QStringView text)
+{
+    // [text](target) and ![alt](target)
+    static const QRegularExpression linkRegex(R"((!?)\[([^\]]*)\]\(([^)]+)\))");
+
+    QVector<Link> links;
+    QRegularExpressionMatchIterator it = linkRegex.globalMatchView(text);
+    if (!it.hasNext()) {
+        return links;
+    }
+
+    LineIndex lines(text);
+    while (it.hasNext()) {
+        QRegularExpressionMatch match = it.next();
+        QString destination = match.captured(3);
+        Link link;
+        if (!resolve(sourcePath, destination, &link.target, &link.anchor)) {
+            continue;
+        }
+
+        if (match.capturedLength(1) > 0) {
+            link.kind = Image;
+        } else if (destination.trimmed().startsWith('#')) {
+            link.kind = Anchor;
+        }
+        link.text = match.captured(2);
+        link.position = match.capturedStart();
+        link.length = match.capturedLength();
+        link.line = lines.lineAt(link.position);
+        link.column = lines.columnAt(link.position);
+        links.append(link);
+    }
+    return links;
+}
+
+bool LinkExtractor::resolve(const QString &sourcePath, QString destination, QString *target,
+                            QString *anchor)
+{
+    static const QRegularExpression schemeRegex("^[A-Za-z][A-Za-z0-9+.-]+:");
+
+    // <target with spaces>, or a target followed by a "title"
+    destination = destination.trimmed();
+    if (destination.startsWith('<')) {
+        qsizetype end = destination.indexOf('>');
+        destination = destination.mid(1, end < 0 ? -1 : end - 1);
+    } else {
+        qsizetype space = destination.indexOf(' ');
+        if (space >= 0) {
+            destination.truncate(space);
+        }
+    }
+    if (destination.isEmpty() || schemeRegex.match(destination).hasMatch()) {
+        return false;
+    }
+
+    qsizetype hash = destination.indexOf('#');
+    *anchor = hash >= 0 ? QUrl::fromPercentEncoding(destination.mid(hash + 1).toUtf8())
+                        : QString();
+    qsizetype end = destination.indexOf('?');
+    if (hash >= 0 && (end < 0 || hash < end)) {
+        end = hash;
+    }
+    if (end >= 0) {
+        destination.truncate(end);
+    }
+
+    // An in-page anchor points at the source itself
+    if (destination.isEmpty()) {
+        if (anchor->isEmpty()) {
+            return false;
+        }
+        *target = QDir::cleanPath(sourcePath);
+        return true;
+    }
+
+    destination = QUrl::fromPercentEncoding(destination.toUtf8());
+    *target = QDir::isAbsolutePath(destination)
+                  ? QDir::cleanPath(destination)
+                  : QDir::cleanPath(QFileInfo(sourcePath).absolutePath() + '/' + destination);
+    return true;
+}
+
+QString LinkExtractor::kindName(Kind kind)
+{
+    switch (kind) {
+        case Anchor:
+            return "anchor";
+        case Image:
+            return "image";
+        default:
+            return "file";
+    }
+}
@@ -0,0 +1,59 @@
+// LinkExtractor.h
+#ifndef LINKEXTRACTOR_H
+#define LINKEXTRACTOR_H
+
+#include <QString>
+#include <QVector>
+
+// Finds the markdown links of a text in one pass. Line and column come
+// from a table of line start offsets built once per text and searched
+// with a binary search, so each link costs O(log lines) instead of a
+// scan from the start of the text.
+//
+// Works on any text, so the links of an open document are taken from its
+// snapshot rather than from the file, which may be out of date.
+class LinkExtractor
+{
+public:
+    enum Kind : quint8 {
+        File,    // [text](other.md), possibly with a #fragment
+        Anchor,  // [text](#heading) within the same document
+        Image    // ![alt](picture.png)
+    };
+
+    struct Link {
+        QString target;        // Absolute, cleaned; the source itself for anchors
+        QString anchor;        // Fragment without '#', if any
+        QString text;
+        Kind kind = File;
+        int line = 0;          // 1-based
+        int column = 0;        // 0-based, in UTF-16 code units
+        qsizetype position = 0;
+        qsizetype length = 0;  // Of the whole [text](target)
+    };
+
+    // Line start offsets and the lookups on them
+    class LineIndex
+    {
+    public:
+        explicit LineIndex(QStringView text);
+        int lineAt(qsizetype position) const;    // 1-based
+        int columnAt(qsizetype position) const;
+        int lineCount() const { return int(m_starts.size()); }
+
+    private:
+        QVector<qsizetype> m_starts;
+    };
+
+    // External URLs are left out
+    static QVector<Link> extract(const QString &sourcePath, QStringView text);
+
+    // Split a link destination into an absolute target and a fragment.
+    // Returns false for external URLs and empty destinations.
+    static bool resolve(const QString &sourcePath, QString destination, QString *target,
+                        QString *anchor);
+
+    static QString kindName(Kind kind);
+};
+
+#endif // LINKEXTRACTOR_H
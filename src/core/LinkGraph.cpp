@@ -0,0 +1,490 @@
+// LinkGraph.cpp
+#include "LinkGraph.h"
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+
+namespace {
+constexpr quint32 kGraphMagic = 0x4d444c47;  // "MDLG"
+constexpr quint16 kFormatVersion = 2;
+constexpr auto kStreamVersion = QDataStream::Qt_6_0;
+constexpr int kSaveDelayMs = 2000;
+constexpr int kMaxOverlay = 512;  // Changed documents before the arrays are rebuilt
+constexpr quint32 kNoId = ~quint32(0);
+}
+
+LinkGraph::LinkGraph(FileIoService *io, WorkspaceIndexer *indexer, QObject *parent)
+    : QObject(parent)
+    , m_io(io)
+    , m_indexer(indexer)
+    , m_ready(false)
+    , m_documentCount(0)
+    , m_parser(nullptr)
+{
+    QDir().mkpath(QFileInfo(graphPath()).absolutePath());
+
+    m_saveTimer = new QTimer(this);
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(kSaveDelayMs);
+    connect(m_saveTimer, &QTimer::timeout, this, &LinkGraph::save);
+
+    connect(m_indexer, &WorkspaceIndexer::filesAdded, this, &LinkGraph::enqueue);
+    connect(m_indexer, &WorkspaceIndexer::filesChanged, this, &LinkGraph::enqueue);
+    connect(m_indexer, &WorkspaceIndexer::filesRemoved, this, [this](const QStringList &paths) {
+        for (const QString &path : paths) {
+            removeDocument(path);
+        }
+    });
+    connect(m_indexer, &WorkspaceIndexer::scanFinished, this, [this]() {
+        if (!m_ready) {
+            return;
+        }
+        for (quint32 id = 0; id < quint32(m_data.paths.size()); ++id) {
+            if (m_data.sizes.at(id) >= 0 && !m_indexer->contains(m_data.paths.at(id))) {
+                removeDocument(m_data.paths.at(id));
+            }
+        }
+        enqueue(m_indexer->paths());
+    });
+}
+
+void LinkGraph::start()
+{
+    QtConcurrent::run(&LinkGraph::read, graphPath()).then(this, [this](Data data) {
+        m_ids = std::move(data.ids);
+        data.ids.clear();
+        m_data = std::move(data);
+        m_documentCount = std::count_if(m_data.sizes.cbegin(), m_data.sizes.cend(),
+                                        [](qint64 size) { return size >= 0; });
+        m_ready = true;
+        emit readyChanged();
+        emit graphChanged();
+
+        // Only what changed since the graph was saved is parsed
+        enqueue(m_indexer->paths());
+    });
+}
+
+int LinkGraph::linkCount() const
+{
+    qsizetype count = m_data.targets.size();
+    for (auto it = m_overlay.cbegin(); it != m_overlay.cend(); ++it) {
+        if (it.key() + 1 < quint32(m_data.forwardOffsets.size())) {
+            count -= m_data.forwardOffsets.at(it.key() + 1) - m_data.forwardOffsets.at(it.key());
+        }
+        count += it->size();
+    }
+    return int(count);
+}
+
+bool LinkGraph::containsDocument(const QString &path) const
+{
+    quint32 id = m_ids.value(path, kNoId);
+    return id != kNoId && m_data.sizes.at(id) >= 0;
+}
+
+QVector<LinkGraph::Link> LinkGraph::links(const QString &source) const
+{
+    QVector<Link> result;
+    quint32 id = m_ids.value(source, kNoId);
+    if (id == kNoId) {
+        return result;
+    }
+    const QVector<Edge> edges = edgesOf(id);
+    result.reserve(edges.size());
+    for (const Edge &edge : edges) {
+        result.append(toLink(id, edge));
+    }
+    return result;
+}
+
+QVector<LinkGraph::Link> LinkGraph::backlinks(const QString &target) const
+{
+    QVector<Link> result;
+    quint32 id = m_ids.value(target, kNoId);
+    if (id == kNoId) {
+        return result;
+    }
+
+    // Links from the arrays, unless their source has been parsed again since
+    if (id + 1 < quint32(m_data.reverseOffsets.size())) {
+        for (quint32 r = m_data.reverseOffsets.at(id); r < m_data.reverseOffsets.at(id + 1); ++r) {
+            quint32 edge = m_data.reverseEdges.at(r);
+            quint32 source = m_data.sources.at(edge);
+            if (!m_overlay.contains(source)) {
+                result.append(toLink(source, {id, m_data.lines.at(edge), m_data.columns.at(edge),
+                                              m_data.kinds.at(edge), m_data.texts.at(edge)}));
+            }
+        }
+    }
+    for (const auto &entry : m_overlayReverse.value(id)) {
+        result.append(toLink(entry.first, m_overlay.value(entry.first).at(entry.second)));
+    }
+    return result;
+}
+
+QStringList LinkGraph::sources() const
+{
+    QStringList result;
+    for (quint32 id = 0; id < quint32(m_data.paths.size()); ++id) {
+        if (m_data.sizes.at(id) >= 0 && !edgesOf(id).isEmpty()) {
+            result.append(m_data.paths.at(id));
+        }
+    }
+    result.sort();
+    return result;
+}
+
+void LinkGraph::updateDocument(const QString &path)
+{
+    // Files outside the workspace are not part of the graph
+    if (!WorkspaceIndexer::isMarkdownFile(path) || m_indexer->isExcluded(path, false)) {
+        return;
+    }
+    if (!m_queue.contains(path)) {
+        m_queue.append(path);
+    }
+    parseQueued();
+}
+
+quint32 LinkGraph::intern(const QString &path)
+{
+    auto it = m_ids.constFind(path);
+    if (it != m_ids.constEnd()) {
+        return it.value();
+    }
+
+    // New ids have no links in the arrays until the next rebuild
+    quint32 id = quint32(m_data.paths.size());
+    m_data.paths.append(path);
+    m_data.sizes.append(-1);
+    m_data.mtimes.append(0);
+    m_ids.insert(path, id);
+    return id;
+}
+
+void LinkGraph::enqueue(const QStringList &paths)
+{
+    // Saved documents are compared once the graph is loaded
+    if (!m_ready) {
+        return;
+    }
+
+    for (const QString &path : paths) {
+        quint32 id = m_ids.value(path, kNoId);
+        WorkspaceIndexer::FileEntry entry = m_indexer->entry(path);
+        if (id != kNoId && m_data.sizes.at(id) == entry.size
+            && m_data.mtimes.at(id) == entry.lastModified) {
+            continue;
+        }
+        m_queue.append(path);
+    }
+    parseQueued();
+}
+
+void LinkGraph::parseQueued()
+{
+    // Documents queued before the graph is loaded wait for it
+    if (!m_ready || m_parser || m_queue.isEmpty()) {
+        return;
+    }
+
+    QStringList paths = std::move(m_queue);
+    m_queue.clear();
+
+    m_parser = new QFutureWatcher<Parsed>(this);
+    connect(m_parser, &QFutureWatcher<Parsed>::resultsReadyAt, this, [this](int begin, int end) {
+        QStringList changed;
+        for (int i = begin; i < end; ++i) {
+            Parsed parsed = m_parser->resultAt(i);
+            changed.append(parsed.path);
+            apply(parsed);
+        }
+        emit linksChanged(changed);
+    });
+    connect(m_parser, &QFutureWatcher<Parsed>::finished, this, [this]() {
+        m_parser->deleteLater();
+        m_parser = nullptr;
+        m_saveTimer->start();
+        emit graphChanged();
+        parseQueued();
+    });
+    m_parser->setFuture(QtConcurrent::mapped(paths, &LinkGraph::parse));
+}
+
+void LinkGraph::apply(const Parsed &parsed)
+{
+    if (parsed.size < 0) {
+        removeDocument(parsed.path);
+        return;
+    }
+
+    quint32 source = intern(parsed.path);
+    QVector<Edge> edges;
+    edges.reserve(parsed.links.size());
+    for (const LinkExtractor::Link &link : parsed.links) {
+        // Links within the document are not part of the graph
+        if (link.kind == LinkExtractor::Anchor) {
+            continue;
+        }
+        edges.append({intern(link.target), quint32(link.line), quint32(link.column),
+                      quint8(link.kind), link.text});
+    }
+
+    if (m_data.sizes.at(source) < 0) {
+        ++m_documentCount;
+    }
+    m_data.sizes[source] = parsed.size;
+    m_data.mtimes[source] = parsed.mtime;
+    setEdges(source, edges);
+}
+
+void LinkGraph::setEdges(quint32 source, const QVector<Edge> &edges)
+{
+    auto old = m_overlay.constFind(source);
+    if (old != m_overlay.constEnd()) {
+        for (const Edge &edge : *old) {
+            m_overlayReverse[edge.target].removeIf([source](const QPair<quint32, int> &entry) {
+                return entry.first == source;
+            });
+        }
+    }
+
+    m_overlay.insert(source, edges);
+    for (int i = 0; i < edges.size(); ++i) {
+        m_overlayReverse[edges.at(i).target].append({source, i});
+    }
+
+    if (m_overlay.size() > kMaxOverlay) {
+        compact();
+    }
+}
+
+QVector<LinkGraph::Edge> LinkGraph::edgesOf(quint32 source) const
+{
+    auto overlay = m_overlay.constFind(source);
+    if (overlay != m_overlay.constEnd()) {
+        return *overlay;
+    }
+
+    QVector<Edge> edges;
+    if (source + 1 < quint32(m_data.forwardOffsets.size())) {
+        for (quint32 e = m_data.forwardOffsets.at(source); e < m_data.forwardOffsets.at(source + 1);
+             ++e) {
+            edges.append({m_data.targets.at(e), m_data.lines.at(e), m_data.columns.at(e),
+                          m_data.kinds.at(e), m_data.texts.at(e)});
+        }
+    }
+    return edges;
+}
+
+void LinkGraph::removeDocument(const QString &path)
+{
+    quint32 id = m_ids.value(path, kNoId);
+    if (id == kNoId || m_data.sizes.at(id) < 0) {
+        return;
+    }
+    m_data.sizes[id] = -1;
+    --m_documentCount;
+    setEdges(id, {});
+    m_saveTimer->start();
+    emit linksChanged({path});
+    emit graphChanged();
+}
+
+void LinkGraph::compact()
+{
+    if (m_overlay.isEmpty() && m_data.forwardOffsets.size() == m_data.paths.size() + 1) {
+        return;
+    }
+
+    // Paths that are neither a document nor linked to any more give up
+    // their ids, and the rest are numbered again in order
+    quint32 pathCount = quint32(m_data.paths.size());
+    QVector<quint32> newIds(pathCount, kNoId);
+    for (quint32 id = 0; id < pathCount; ++id) {
+        if (m_data.sizes.at(id) >= 0) {
+            newIds[id] = 0;
+            for (const Edge &edge : edgesOf(id)) {
+                newIds[edge.target] = 0;
+            }
+        }
+    }
+    QStringList paths;
+    QVector<qint64> sizes;
+    QVector<qint64> mtimes;
+    for (quint32 id = 0; id < pathCount; ++id) {
+        if (newIds.at(id) != kNoId) {
+            newIds[id] = quint32(paths.size());
+            paths.append(m_data.paths.at(id));
+            sizes.append(m_data.sizes.at(id));
+            mtimes.append(m_data.mtimes.at(id));
+        }
+    }
+
+    QVector<quint32> offsets;
+    QVector<quint32> targets;
+    QVector<quint32> lines;
+    QVector<quint32> columns;
+    QVector<quint8> kinds;
+    QStringList texts;
+    int count = linkCount();
+    offsets.reserve(paths.size() + 1);
+    targets.reserve(count);
+    lines.reserve(count);
+    columns.reserve(count);
+    kinds.reserve(count);
+    texts.reserve(count);
+
+    for (quint32 id = 0; id < pathCount; ++id) {
+        if (newIds.at(id) == kNoId) {
+            continue;
+        }
+        offsets.append(quint32(targets.size()));
+        const QVector<Edge> edges = edgesOf(id);
+        for (const Edge &edge : edges) {
+            targets.append(newIds.at(edge.target));
+            lines.append(edge.line);
+            columns.append(edge.column);
+            kinds.append(edge.kind);
+            texts.append(edge.text);
+        }
+    }
+    offsets.append(quint32(targets.size()));
+
+    if (paths.size() != m_data.paths.size()) {
+        m_ids.clear();
+        m_ids.reserve(paths.size());
+        for (quint32 id = 0; id < quint32(paths.size()); ++id) {
+            m_ids.insert(paths.at(id), id);
+        }
+    }
+    m_data.paths = std::move(paths);
+    m_data.sizes = std::move(sizes);
+    m_data.mtimes = std::move(mtimes);
+    m_data.forwardOffsets = std::move(offsets);
+    m_data.targets = std::move(targets);
+    m_data.lines = std::move(lines);
+    m_data.columns = std::move(columns);
+    m_data.kinds = std::move(kinds);
+    m_data.texts = std::move(texts);
+    m_overlay.clear();
+    m_overlayReverse.clear();
+    buildReverse(m_data);
+}
+
+void LinkGraph::save()
+{
+    compact();
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(kStreamVersion);
+    out << kGraphMagic << kFormatVersion << m_data.paths << m_data.sizes << m_data.mtimes
+        << m_data.forwardOffsets << m_data.targets << m_data.lines << m_data.columns
+        << m_data.kinds << m_data.texts;
+
+    m_io->writeData(graphPath(), data);
+}
+
+LinkGraph::Link LinkGraph::toLink(quint32 source, const Edge &edge) const
+{
+    return {m_data.paths.at(source), m_data.paths.at(edge.target), edge.text,
+            LinkExtractor::Kind(edge.kind), int(edge.line), int(edge.column)};
+}
+
+QString LinkGraph::graphPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/link-graph.bin";
+}
+
+LinkGraph::Parsed LinkGraph::parse(const QString &path)
+{
+    Parsed parsed;
+    parsed.path = path;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return parsed;
+    }
+    QFileInfo info(file);
+    parsed.size = info.size();
+    parsed.mtime = info.lastModified().toMSecsSinceEpoch();
+    parsed.links = LinkExtractor::extract(path, QString::fromUtf8(file.readAll()));
+    return parsed;
+}
+
+LinkGraph::Data LinkGraph::read(const QString &fileName)
+{
+    Data data;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return data;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(kStreamVersion);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != kGraphMagic || version != kFormatVersion) {
+        return data;
+    }
+    in >> data.paths >> data.sizes >> data.mtimes >> data.forwardOffsets >> data.targets
+       >> data.lines >> data.columns >> data.kinds >> data.texts;
+
+    // A torn or inconsistent file is rebuilt from scratch
+    qsizetype count = data.paths.size();
+    qsizetype edges = data.targets.size();
+    bool valid = in.status() == QDataStream::Ok && data.sizes.size() == count
+                 && data.mtimes.size() == count && data.forwardOffsets.size() == count + 1
+                 && data.lines.size() == edges && data.columns.size() == edges
+                 && data.kinds.size() == edges && data.texts.size() == edges
+                 && data.forwardOffsets.last() == quint32(edges)
+                 && std::is_sorted(data.forwardOffsets.cbegin(), data.forwardOffsets.cend())
+                 && std::all_of(data.targets.cbegin(), data.targets.cend(),
+                                [count](quint32 target) { return target < quint32(count); });
+    if (!valid) {
+        return Data();
+    }
+
+    data.ids.reserve(count);
+    for (quint32 id = 0; id < quint32(count); ++id) {
+        data.ids.insert(data.paths.at(id), id);
+    }
+    buildReverse(data);
+    return data;
+}
+
+void LinkGraph::buildReverse(Data &data)
+{
+    qsizetype count = data.paths.size();
+    qsizetype edges = data.targets.size();
+
+    data.sources.resize(edges);
+    for (quint32 id = 0; id + 1 < quint32(data.forwardOffsets.size()); ++id) {
+        std::fill(data.sources.begin() + data.forwardOffsets.at(id),
+                  data.sources.begin() + data.forwardOffsets.at(id + 1), id);
+    }
+
+    // Counting sort of the edges by target
+    data.reverseOffsets.fill(0, count + 1);
+    for (quint32 target : std::as_const(data.targets)) {
+        ++data.reverseOffsets[target + 1];
+    }
+    for (qsizetype i = 0; i < count; ++i) {
+        data.reverseOffsets[i + 1] += data.reverseOffsets[i];
+    }
+    data.reverseEdges.resize(edges);
+    QVector<quint32> next(data.reverseOffsets.cbegin(), data.reverseOffsets.cend() - 1);
+    for (quint32 e = 0; e < quint32(edges); ++e) {
+        data.reverseEdges[next[data.targets.at(e)]++] = e;
+    }
+}
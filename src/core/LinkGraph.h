@@ -0,0 +1,133 @@
+// LinkGraph.h
+#ifndef LINKGRAPH_H
+#define LINKGRAPH_H
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+#include "FileIoService.h"
+#include "LinkExtractor.h"
+#include "WorkspaceIndexer.h"
+
+// Links between the markdown documents of the workspace. Paths are
+// interned into integer ids and the links are kept as two CSR arrays, one
+// by source and one by target, so both the links of a document and the
+// backlinks to it are read in time proportional to their number.
+//
+// Every document is parsed once, on the global thread pool, and the graph
+// is saved compactly (paths once, links as id arrays) so backlinks are
+// available as soon as it is loaded at the next start. Afterwards a
+// changed document is re-parsed alone; its new links go to a small
+// overlay that is folded into the arrays when it grows or before saving.
+class LinkGraph : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int documentCount READ documentCount NOTIFY graphChanged)
+    Q_PROPERTY(int linkCount READ linkCount NOTIFY graphChanged)
+    Q_PROPERTY(bool ready READ isReady NOTIFY readyChanged)
+
+public:
+    struct Link {
+        QString source;
+        QString target;  // Absolute, cleaned; may not exist
+        QString text;
+        LinkExtractor::Kind kind = LinkExtractor::File;
+        int line = 0;    // 1-based line in the source
+        int column = 0;
+    };
+
+    LinkGraph(FileIoService *io, WorkspaceIndexer *indexer, QObject *parent = nullptr);
+
+    // Loads the saved graph, then parses what changed since
+    void start();
+    bool isReady() const { return m_ready; }
+
+    int documentCount() const { return m_documentCount; }
+    int linkCount() const;
+
+    bool containsDocument(const QString &path) const;
+    QVector<Link> links(const QString &source) const;
+    QVector<Link> backlinks(const QString &target) const;
+    // Every document with at least one link, sorted
+    QStringList sources() const;
+
+    // Parse one document again now, e.g. after it was saved. Paths the
+    // workspace index excludes are ignored.
+    void updateDocument(const QString &path);
+
+signals:
+    void graphChanged();
+    void readyChanged();
+    // The links of these documents changed
+    void linksChanged(const QStringList &sources);
+
+private:
+    struct Edge {
+        quint32 target;
+        quint32 line;
+        quint32 column;
+        quint8 kind;
+        QString text;
+    };
+
+    // Everything that is saved, plus the reverse arrays built on load
+    struct Data {
+        QStringList paths;                // Interned, by id
+        QVector<qint64> sizes;            // -1 if the path is not a parsed document
+        QVector<qint64> mtimes;
+        QVector<quint32> forwardOffsets;  // Edges of id i are [offsets[i], offsets[i + 1])
+        QVector<quint32> targets;
+        QVector<quint32> lines;
+        QVector<quint32> columns;
+        QVector<quint8> kinds;
+        QStringList texts;
+        QVector<quint32> sources;         // Source id of each edge
+        QVector<quint32> reverseOffsets;
+        QVector<quint32> reverseEdges;    // Edge indices grouped by target
+        QHash<QString, quint32> ids;      // Built on load, then moved out
+    };
+
+    struct Parsed {
+        QString path;
+        qint64 size = -1;                 // -1 if the file could not be read
+        qint64 mtime = 0;
+        QVector<LinkExtractor::Link> links;
+    };
+
+    FileIoService *m_io;
+    WorkspaceIndexer *m_indexer;
+    Data m_data;
+    QHash<QString, quint32> m_ids;
+    bool m_ready;
+    int m_documentCount;
+
+    // Links of documents changed since the arrays were built
+    QHash<quint32, QVector<Edge>> m_overlay;
+    QHash<quint32, QVector<QPair<quint32, int>>> m_overlayReverse;  // Target -> (source, index)
+
+    QStringList m_queue;
+    QFutureWatcher<Parsed> *m_parser;
+    QTimer *m_saveTimer;
+
+    quint32 intern(const QString &path);
+    void enqueue(const QStringList &paths);
+    void parseQueued();
+    void apply(const Parsed &parsed);
+    void setEdges(quint32 source, const QVector<Edge> &edges);
+    QVector<Edge> edgesOf(quint32 source) const;
+    void removeDocument(const QString &path);
+    void compact();
+    void save();
+    Link toLink(quint32 source, const Edge &edge) const;
+
+    static QString graphPath();
+    static Parsed parse(const QString &path);
+    static Data read(const QString &fileName);
+    static void buildReverse(Data &data);
+};
+
+#endif // LINKGRAPH_H
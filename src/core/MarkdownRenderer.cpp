@@ -1,5 +1,8 @@
 // MarkdownRenderer.cpp
 #include "MarkdownRenderer.h"
+#include "ContentHash.h"
+#include "DocumentStore.h"
+#include "Prefetcher.h"
 #include <QRegularExpression>
 #include <QDir>
 #include <QFile>
@@ -15,6 +18,7 @@ MarkdownRenderer::MarkdownRenderer(QObject *parent)
     , m_mathEnabled(true)
     , m_gfmEnabled(true)
     , m_codeBlockTheme("default")
+    , m_store(nullptr)
 {
 }
 
@@ -103,9 +107,36 @@ QString MarkdownRenderer::renderMarkdown(const QString &markdown) const
 }
 
 void MarkdownRenderer::processMarkdown(const QString &markdown)
+{
+    // Hashing the text only pays off when HTML rendered ahead is waiting
+    render(markdown, hasRenderedAhead() ? ContentHash::of(markdown) : 0);
+}
+
+void MarkdownRenderer::processDocument(int documentId)
+{
+    if (!m_store || !m_store->isOpen(documentId)) {
+        return;
+    }
+    // The store hashes each revision once
+    render(m_store->content(documentId),
+           hasRenderedAhead() ? m_store->contentHash(documentId) : 0);
+}
+
+bool MarkdownRenderer::hasRenderedAhead() const
+{
+    return m_prefetcher && m_prefetcher->hasRendered();
+}
+
+void MarkdownRenderer::render(const QString &markdown, quint64 contentHash)
 {
     m_markdownContent = markdown;
-    QString html = renderMarkdown(markdown);
+    QString html;
+    if (contentHash != 0) {
+        html = m_prefetcher->takeRendered(renderKey(contentHash));
+    }
+    if (html.isEmpty()) {
+        html = renderMarkdown(markdown);
+    }
     
     if (m_htmlContent != html) {
         m_htmlContent = html;
@@ -144,6 +175,26 @@ void MarkdownRenderer::setBaseUrl(const QUrl &baseUrl)
     m_baseUrl = baseUrl;
 }
 
+quint64 MarkdownRenderer::renderKey(quint64 contentHash) const
+{
+    QString settings = QString("%1|%2|%3|%4")
+                           .arg(m_mathEnabled)
+                           .arg(m_gfmEnabled)
+                           .arg(m_codeBlockTheme, m_baseUrl.toString());
+    return ContentHash::of(settings.utf16(), settings.size() * qsizetype(sizeof(char16_t)),
+                           contentHash);
+}
+
+void MarkdownRenderer::setPrefetcher(Prefetcher *prefetcher)
+{
+    m_prefetcher = prefetcher;
+}
+
+void MarkdownRenderer::setDocumentStore(DocumentStore *store)
+{
+    m_store = store;
+}
+
 void MarkdownRenderer::setCodeBlockTheme(const QString &theme)
 {
     if (m_codeBlockTheme != theme) {
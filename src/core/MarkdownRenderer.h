@@ -3,10 +3,14 @@
 #define MARKDOWNRENDERER_H
 
 #include <QObject>
+#include <QPointer>
 #include <QString>
 #include <QUrl>
 #include <QTimer>
 
+class DocumentStore;
+class Prefetcher;
+
 class MarkdownRenderer : public QObject
 {
     Q_OBJECT
@@ -29,8 +33,20 @@ public:
     void setBaseUrl(const QUrl &baseUrl);
     QUrl baseUrl() const { return m_baseUrl; }
     
+    QString codeBlockTheme() const { return m_codeBlockTheme; }
+    
+    // Identifies the HTML of a text with this content hash under the
+    // current settings
+    quint64 renderKey(quint64 contentHash) const;
+    
+    // Documents rendered ahead are shown without rendering them again
+    void setPrefetcher(Prefetcher *prefetcher);
+    // Open documents are rendered with the content hash the store keeps
+    void setDocumentStore(DocumentStore *store);
+    
 public slots:
     void processMarkdown(const QString &markdown);
+    void processDocument(int documentId);
     void setCodeBlockTheme(const QString &theme);
 
 signals:
@@ -46,6 +62,12 @@ private:
     bool m_gfmEnabled;
     QUrl m_baseUrl;
     QString m_codeBlockTheme;
+    QPointer<Prefetcher> m_prefetcher;
+    DocumentStore *m_store;
+    
+    // contentHash is 0 when not known
+    void render(const QString &markdown, quint64 contentHash);
+    bool hasRenderedAhead() const;
     
     QString generateHtmlTemplate(const QString &bodyContent) const;
     QString applyCustomStyling(const QString &html) const;
@@ -0,0 +1,285 @@
+// MemoryBudget.cpp
+#include "MemoryBudget.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QtConcurrent>
+#include <QDebug>
+#include <algorithm>
+
+MemoryBudget::MemoryBudget(DocumentStore *store, FileIoService *io, QObject *parent)
+    : QObject(parent)
+    , m_store(store)
+    , m_io(io)
+    , m_tick(0)
+    , m_activeDocument(DocumentStore::InvalidId)
+    , m_budget(64 * 1024 * 1024)
+    , m_activationTargetMs(50)
+{
+    // Spilled text is unsaved work, so it goes to a directory only this user
+    // can read. Each instance has its own, locked while it runs, so leftovers
+    // of a crashed run can be told apart from another instance's files.
+    QString root = spillRoot();
+    if (QDir().mkpath(root)) {
+        QFile::setPermissions(root, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner);
+        m_spillDirectory = std::make_unique<QTemporaryDir>(root + "/XXXXXX");
+    }
+    if (m_spillDirectory && m_spillDirectory->isValid()) {
+        m_spillLock = std::make_unique<QLockFile>(m_spillDirectory->filePath("lock"));
+        m_spillLock->tryLock(0);
+        QtConcurrent::run(&MemoryBudget::removeStaleSpillDirectories, root,
+                          m_spillDirectory->path());
+    } else {
+        qWarning() << "Could not create spill directory in" << root;
+        m_spillDirectory.reset();
+    }
+
+    // Released in one pass once tab switching and loading settle down
+    m_enforceTimer = new QTimer(this);
+    m_enforceTimer->setSingleShot(true);
+    m_enforceTimer->setInterval(500);
+    connect(m_enforceTimer, &QTimer::timeout, this, &MemoryBudget::enforce);
+
+    connect(m_store, &DocumentStore::documentOpened, this, [this](int documentId) {
+        touch(documentId);
+        m_enforceTimer->start();
+    });
+    connect(m_store, &DocumentStore::restoreRequested, this, [this](int documentId) {
+        if (!m_unreadable.contains(documentId)) {
+            prefetch(documentId);
+        }
+    });
+    connect(m_store, &DocumentStore::documentClosed, this, [this](int documentId) {
+        m_loading.remove(documentId);
+        m_unreadable.remove(documentId);
+        if (m_activeDocument == documentId) {
+            m_activeDocument = DocumentStore::InvalidId;
+        }
+    });
+}
+
+MemoryBudget::~MemoryBudget() = default;
+
+void MemoryBudget::setBudget(qint64 bytes)
+{
+    m_budget = bytes;
+    m_enforceTimer->start();
+}
+
+void MemoryBudget::setActivationTarget(int msecs)
+{
+    m_activationTargetMs = msecs;
+}
+
+qint64 MemoryBudget::residentBytes() const
+{
+    qint64 total = 0;
+    for (int id : m_store->ids()) {
+        total += m_store->residentBytes(id);
+    }
+    return total;
+}
+
+qint64 MemoryBudget::residentBytes(int documentId) const
+{
+    return m_store->residentBytes(documentId);
+}
+
+void MemoryBudget::activate(int documentId)
+{
+    if (!m_store->isOpen(documentId)) {
+        return;
+    }
+
+    touch(documentId);
+    m_activeDocument = documentId;
+    m_unreadable.remove(documentId);
+    m_enforceTimer->start();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (m_store->residency(documentId) == DocumentStore::Resident
+        || m_store->residency(documentId) == DocumentStore::Compressed) {
+        // Decompressing from memory is quick enough for the GUI thread
+        if (!m_store->snapshot(documentId).isNull()) {
+            finishActivation(documentId, timer.elapsed());
+        }
+        return;
+    }
+
+    rehydrate(documentId, true, timer);
+}
+
+void MemoryBudget::prefetch(int documentId)
+{
+    if (m_store->residency(documentId) != DocumentStore::Evicted
+        && m_store->residency(documentId) != DocumentStore::Spilled) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    rehydrate(documentId, false, timer);
+}
+
+void MemoryBudget::rehydrate(int documentId, bool activation, const QElapsedTimer &timer)
+{
+    if (m_loading.contains(documentId)) {
+        return;
+    }
+    m_loading.insert(documentId);
+
+    // Evicted documents come back from their file, spilled ones from the
+    // spill file; both are read on the I/O pool
+    QString path = m_store->path(documentId);
+    bool spilled = m_store->residency(documentId) == DocumentStore::Spilled;
+    QFuture<FileIoService::Result> read = spilled ? m_io->readData(m_store->spillFile(documentId))
+                                                  : m_io->readFile(path);
+    read.then(this, [this, documentId, path, spilled, activation, timer](
+                        const FileIoService::Result &result) {
+        if (!m_loading.remove(documentId) || m_store->path(documentId) != path) {
+            return;
+        }
+
+        bool changed = false;
+        if (m_store->isResident(documentId)) {
+            // Brought back by an accessor while the read was in flight
+        } else if (!result.success) {
+            m_unreadable.insert(documentId);
+            emit restoreFailed(documentId, result.errorString);
+            return;
+        } else if (spilled) {
+            if (!m_store->unspill(documentId, result.data)) {
+                m_unreadable.insert(documentId);
+                emit restoreFailed(documentId, QStringLiteral("spilled text is damaged"));
+                return;
+            }
+        } else {
+            changed = m_store->restore(documentId, result.content, result.contentHash);
+        }
+        emit documentRehydrated(documentId, changed);
+        if (activation) {
+            finishActivation(documentId, timer.elapsed());
+        }
+    });
+}
+
+void MemoryBudget::touch(int documentId)
+{
+    if (documentId >= m_lastActivated.size()) {
+        m_lastActivated.resize(m_store->capacity());
+    }
+    m_lastActivated[documentId] = ++m_tick;
+}
+
+void MemoryBudget::finishActivation(int documentId, qint64 elapsedMs)
+{
+    if (elapsedMs > m_activationTargetMs) {
+        qWarning() << "Slow document activation" << m_store->path(documentId)
+                   << elapsedMs << "ms";
+        emit slowActivation(documentId, elapsedMs);
+    }
+    emit documentActivated(documentId, elapsedMs);
+}
+
+void MemoryBudget::enforce()
+{
+    qint64 total = residentBytes();
+    if (total <= m_budget) {
+        return;
+    }
+
+    // Least recently activated first
+    QVector<int> candidates;
+    for (int id : m_store->ids()) {
+        if (id != m_activeDocument && !m_loading.contains(id)) {
+            candidates.append(id);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [this](int a, int b) {
+        return m_lastActivated.value(a) < m_lastActivated.value(b);
+    });
+
+    // First pass releases what is cheap to get back; the second spills
+    // documents that were already compressed
+    for (int pass = 0; pass < 2 && total > m_budget; ++pass) {
+        for (int id : std::as_const(candidates)) {
+            if (total <= m_budget) {
+                break;
+            }
+
+            qint64 before = m_store->residentBytes(id);
+            switch (m_store->residency(id)) {
+                case DocumentStore::Resident:
+                    if (!m_store->isModified(id) && QFileInfo(m_store->path(id)).isFile()) {
+                        m_store->evict(id);
+                    } else {
+                        m_store->compress(id);
+                    }
+                    total -= before - m_store->residentBytes(id);
+                    break;
+                case DocumentStore::Compressed:
+                    if (pass > 0) {
+                        spill(id);
+                        total -= before;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+void MemoryBudget::spill(int documentId)
+{
+    if (!m_spillDirectory) {
+        return;  // Stays compressed in memory
+    }
+
+    QByteArray data = m_store->compressedData(documentId);
+    quint64 revision = m_store->revision(documentId);
+    QString fileName = m_spillDirectory->filePath(
+        QString("%1-%2.spill").arg(documentId).arg(revision));
+
+    m_io->writeData(fileName, data).then(this, [this, documentId, revision, fileName](
+                                                   const FileIoService::Result &result) {
+        if (!result.success) {
+            return;
+        }
+        // Edited or closed while the write was in flight
+        if (m_store->revision(documentId) != revision
+            || !m_store->markSpilled(documentId, fileName)) {
+            m_io->removeFile(fileName);
+        }
+    });
+}
+
+QString MemoryBudget::spillRoot()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/spill";
+}
+
+void MemoryBudget::removeStaleSpillDirectories(const QString &root, const QString &own)
+{
+    // A directory whose lock can be taken belongs to a run that has ended.
+    // Without a stale time only the owner's exit frees the lock, not its age.
+    const QStringList entries = QDir(root).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &entry : entries) {
+        QString path = root + "/" + entry;
+        if (path == own) {
+            continue;
+        }
+        QLockFile lock(path + "/lock");
+        lock.setStaleLockTime(0);
+        if (lock.tryLock(0)) {
+            lock.unlock();
+            QDir(path).removeRecursively();
+        }
+    }
+}
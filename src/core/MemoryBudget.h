@@ -0,0 +1,82 @@
+// MemoryBudget.h
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+#include <memory>
+
+#include "DocumentStore.h"
+#include "FileIoService.h"
+
+class QLockFile;
+class QTemporaryDir;
+
+// Keeps the text of open documents within a memory budget. When the budget
+// is exceeded, the least recently activated documents are released first:
+// clean ones are evicted and read back from their file, modified ones are
+// compressed and, if that is not enough, spilled to a file in a private
+// per-user directory.
+//
+// The active document is never released. Activating a released document
+// brings it back and reports how long that took; so does any store accessor
+// that needs its text. Files are read on the I/O pool, and a document that
+// can't be read stays released until it is activated again.
+class MemoryBudget : public QObject
+{
+    Q_OBJECT
+
+public:
+    MemoryBudget(DocumentStore *store, FileIoService *io, QObject *parent = nullptr);
+    ~MemoryBudget() override;
+
+    void setBudget(qint64 bytes);
+    qint64 budget() const { return m_budget; }
+
+    // Activations slower than this are reported through slowActivation()
+    void setActivationTarget(int msecs);
+    int activationTarget() const { return m_activationTargetMs; }
+
+    qint64 residentBytes() const;
+    qint64 residentBytes(int documentId) const;
+
+    void activate(int documentId);
+    // Read a released document back without making it the active one
+    void prefetch(int documentId);
+
+signals:
+    void documentActivated(int documentId, qint64 elapsedMs);
+    void slowActivation(int documentId, qint64 elapsedMs);
+    // A released document was read back; changedOnDisk if the file no longer
+    // matched what was saved
+    void documentRehydrated(int documentId, bool changedOnDisk);
+    void restoreFailed(int documentId, const QString &errorString);
+
+private:
+    DocumentStore *m_store;
+    FileIoService *m_io;
+    QVector<quint64> m_lastActivated;  // Activation tick, indexed by id
+    quint64 m_tick;
+    int m_activeDocument;
+    QSet<int> m_loading;               // Released documents being read back
+    QSet<int> m_unreadable;            // Read back failed; only activation retries
+    qint64 m_budget;
+    int m_activationTargetMs;
+    QTimer *m_enforceTimer;
+    std::unique_ptr<QTemporaryDir> m_spillDirectory;  // Null if it could not be created
+    std::unique_ptr<QLockFile> m_spillLock;            // Released before the directory goes
+
+    void touch(int documentId);
+    void rehydrate(int documentId, bool activation, const QElapsedTimer &timer);
+    void finishActivation(int documentId, qint64 elapsedMs);
+    void enforce();
+    void spill(int documentId);
+
+    static QString spillRoot();
+    static void removeStaleSpillDirectories(const QString &root, const QString &own);
+};
+
+#endif // MEMORYBUDGET_H
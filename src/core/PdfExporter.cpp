@@ -12,8 +12,19 @@
 
 PdfExporter::PdfExporter(QObject *parent)
     : QObject(parent)
+    , m_profile(nullptr)
+    , m_page(nullptr)
 {
-    // Create a dedicated profile for PDF export to avoid interfering with web views
+}
+
+QWebEnginePage *PdfExporter::page()
+{
+    if (m_page) {
+        return m_page;
+    }
+    
+    // Starting the web engine is expensive, so this waits for the first
+    // export. A dedicated profile avoids interfering with web views.
     m_profile = new QWebEngineProfile(this);
     m_page = new QWebEnginePage(m_profile, this);
     
@@ -25,6 +36,7 @@ PdfExporter::PdfExporter(QObject *parent)
             emit exportError("PDF export failed for: " + filePath);
         }
     });
+    return m_page;
 }
 
 bool PdfExporter::exportToPdf(const QString &htmlContent, const QString &outputPath,
@@ -44,7 +56,7 @@ bool PdfExporter::exportToPdf(const QString &htmlContent, const QString &outputP
     timeout.setInterval(10000); // 10 second timeout
 
     // Connect to the finished signal
-    connect(m_page, &QWebEnginePage::pdfPrintingFinished,
+    connect(page(), &QWebEnginePage::pdfPrintingFinished,
             [&](const QString &filePath, bool result) {
         success = result;
         loop.quit();
@@ -68,6 +68,7 @@ private:
     QWebEngineProfile *m_profile;
     QWebEnginePage *m_page;
     
+    QWebEnginePage *page();
     void setupPrinter(QPrinter *printer, const ExportOptions &options);
     QString generatePrintCss(const ExportOptions &options) const;
     QString injectPrintStyles(const QString &html, const ExportOptions &options) const;
@@ -0,0 +1,283 @@
+// PieceTable.cpp
+#include "PieceTable.h"
+#include <QtGlobal>
+
+namespace {
+// Scattered edits fragment the table; past this many pieces it is cheaper to
+// rebuild the original buffer once than to keep walking the list
+constexpr int kCompactThreshold = 8192;
+// Each freeze() leaves a sealed add buffer behind
+constexpr int kMaxBuffers = 1024;
+}
+
+PieceTable::PieceTable()
+    : m_buffers(2)
+    , m_length(0)
+    , m_cachedPiece(0)
+    , m_cachedPieceStart(0)
+{
+}
+
+PieceTable::PieceTable(const QString &original)
+    : m_buffers({original, QString()})
+    , m_length(original.length())
+    , m_cachedPiece(0)
+    , m_cachedPieceStart(0)
+{
+    if (!original.isEmpty()) {
+        m_pieces.append({0, 0, original.length()});
+    }
+}
+
+void PieceTable::replace(qsizetype position, qsizetype removedLength, QStringView insertedText)
+{
+    position = qBound<qsizetype>(0, position, m_length);
+    removedLength = qBound<qsizetype>(0, removedLength, m_length - position);
+
+    if (removedLength == 0 && insertedText.isEmpty()) {
+        return;
+    }
+
+    // Fast path for typing: extend the piece that ends at the cursor if it
+    // is also the tail of the add buffer
+    if (removedLength == 0 && position > 0) {
+        qsizetype pieceStart = 0;
+        int index = findPiece(position - 1, &pieceStart);
+        Piece &piece = m_pieces[index];
+        QString &added = m_buffers.last();
+        if (piece.buffer == addBuffer()
+            && pieceStart + piece.length == position
+            && piece.start + piece.length == added.length()) {
+            added.append(insertedText);
+            piece.length += insertedText.length();
+            m_length += insertedText.length();
+            return;
+        }
+    }
+
+    // Fast path for backspace/delete inside a single piece
+    if (insertedText.isEmpty()) {
+        qsizetype pieceStart = 0;
+        int index = findPiece(position, &pieceStart);
+        Piece &piece = m_pieces[index];
+        qsizetype offset = position - pieceStart;
+        if (offset + removedLength <= piece.length) {
+            if (offset + removedLength == piece.length) {
+                piece.length -= removedLength;
+            } else if (offset == 0) {
+                piece.start += removedLength;
+                piece.length -= removedLength;
+            } else {
+                Piece tail = {piece.buffer, piece.start + offset + removedLength,
+                              piece.length - offset - removedLength};
+                piece.length = offset;
+                m_pieces.insert(index + 1, tail);
+            }
+            m_length -= removedLength;
+            if (m_pieces[index].length == 0) {
+                m_pieces.remove(index);
+                invalidateCache();
+            }
+            return;
+        }
+    }
+
+    int first = splitAt(position);
+    int last = splitAt(position + removedLength);
+    if (last > first) {
+        m_pieces.remove(first, last - first);
+    }
+
+    if (!insertedText.isEmpty()) {
+        QString &added = m_buffers.last();
+        Piece piece = {addBuffer(), added.length(), insertedText.length()};
+        added.append(insertedText);
+        m_pieces.insert(first, piece);
+    }
+
+    m_length += insertedText.length() - removedLength;
+
+    if (first < m_pieces.size()) {
+        m_cachedPiece = first;
+        m_cachedPieceStart = position;
+    } else {
+        invalidateCache();
+    }
+
+    if (m_pieces.size() > kCompactThreshold) {
+        compact();
+    }
+}
+
+void PieceTable::insert(qsizetype position, QStringView text)
+{
+    replace(position, 0, text);
+}
+
+void PieceTable::remove(qsizetype position, qsizetype length)
+{
+    replace(position, length, QStringView());
+}
+
+QString PieceTable::text() const
+{
+    QString result;
+    result.reserve(m_length);
+    for (const Piece &piece : m_pieces) {
+        result.append(pieceText(piece));
+    }
+    return result;
+}
+
+QString PieceTable::mid(qsizetype position, qsizetype length) const
+{
+    QString result;
+    if (position < 0 || position >= m_length || length <= 0) {
+        return result;
+    }
+
+    length = qMin(length, m_length - position);
+    result.reserve(length);
+
+    qsizetype pieceStart = 0;
+    int index = findPiece(position, &pieceStart);
+    qsizetype offset = position - pieceStart;
+    while (length > 0 && index < m_pieces.size()) {
+        QStringView chunk = pieceText(m_pieces[index]).mid(offset);
+        chunk = chunk.left(length);
+        result.append(chunk);
+        length -= chunk.length();
+        offset = 0;
+        ++index;
+    }
+    return result;
+}
+
+qsizetype PieceTable::commonPrefixLength(QStringView other) const
+{
+    qsizetype matched = 0;
+    for (const Piece &piece : m_pieces) {
+        QStringView chunk = pieceText(piece);
+        qsizetype count = qMin(chunk.length(), other.length() - matched);
+        for (qsizetype i = 0; i < count; ++i) {
+            if (chunk[i] != other[matched + i]) {
+                return matched + i;
+            }
+        }
+        matched += count;
+        if (count < chunk.length()) {
+            break;
+        }
+    }
+    return matched;
+}
+
+qsizetype PieceTable::commonSuffixLength(QStringView other, qsizetype limit) const
+{
+    limit = qMin(limit, qMin(m_length, other.length()));
+    qsizetype matched = 0;
+    for (int index = m_pieces.size() - 1; index >= 0 && matched < limit; --index) {
+        QStringView chunk = pieceText(m_pieces[index]);
+        for (qsizetype i = chunk.length() - 1; i >= 0 && matched < limit; --i) {
+            if (chunk[i] != other[other.length() - 1 - matched]) {
+                return matched;
+            }
+            ++matched;
+        }
+    }
+    return matched;
+}
+
+void PieceTable::freeze()
+{
+    if (m_buffers.last().isEmpty()) {
+        return;
+    }
+    if (m_buffers.size() >= kMaxBuffers) {
+        compact();
+        return;
+    }
+    m_buffers.append(QString());
+}
+
+void PieceTable::compact()
+{
+    QString original = text();
+    m_buffers = {original, QString()};
+    m_pieces.clear();
+    if (!original.isEmpty()) {
+        m_pieces.append({0, 0, original.length()});
+    }
+    invalidateCache();
+}
+
+qsizetype PieceTable::memoryUsage() const
+{
+    qsizetype characters = 0;
+    for (const QString &buffer : m_buffers) {
+        characters += buffer.capacity();
+    }
+    return characters * qsizetype(sizeof(QChar))
+         + m_pieces.capacity() * qsizetype(sizeof(Piece));
+}
+
+int PieceTable::findPiece(qsizetype position, qsizetype *pieceStart) const
+{
+    if (position >= m_length) {
+        *pieceStart = m_length;
+        return m_pieces.size();
+    }
+
+    if (m_cachedPiece >= m_pieces.size()) {
+        m_cachedPiece = 0;
+        m_cachedPieceStart = 0;
+    }
+
+    int index = m_cachedPiece;
+    qsizetype start = m_cachedPieceStart;
+
+    // Walk from the cached piece towards the requested position
+    while (position < start) {
+        --index;
+        start -= m_pieces[index].length;
+    }
+    while (position >= start + m_pieces[index].length) {
+        start += m_pieces[index].length;
+        ++index;
+    }
+
+    m_cachedPiece = index;
+    m_cachedPieceStart = start;
+    *pieceStart = start;
+    return index;
+}
+
+int PieceTable::splitAt(qsizetype position)
+{
+    qsizetype pieceStart = 0;
+    int index = findPiece(position, &pieceStart);
+    if (index >= m_pieces.size() || pieceStart == position) {
+        return index;
+    }
+
+    Piece &piece = m_pieces[index];
+    qsizetype leftLength = position - pieceStart;
+    Piece right = {piece.buffer, piece.start + leftLength, piece.length - leftLength};
+    piece.length = leftLength;
+    m_pieces.insert(index + 1, right);
+
+    m_cachedPiece = index + 1;
+    m_cachedPieceStart = position;
+    return index + 1;
+}
+
+QStringView PieceTable::pieceText(const Piece &piece) const
+{
+    return QStringView(m_buffers[piece.buffer]).mid(piece.start, piece.length);
+}
+
+void PieceTable::invalidateCache()
+{
+    m_cachedPiece = 0;
+    m_cachedPieceStart = 0;
+}
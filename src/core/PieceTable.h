@@ -0,0 +1,74 @@
+// PieceTable.h
+#ifndef PIECETABLE_H
+#define PIECETABLE_H
+
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+// Text buffer for open documents. The loaded text is kept untouched in an
+// original buffer, typed text is appended to an add buffer, and the document
+// is described by a list of pieces pointing into either of them. An edit only
+// splits or trims pieces, so its cost depends on the number of pieces near the
+// edit, not on the size of the document.
+//
+// Buffers are never changed once written, only appended to. freeze() starts a
+// new add buffer, after which a copy of the table shares every buffer with the
+// original and can be read from another thread while editing goes on.
+class PieceTable
+{
+public:
+    PieceTable();
+    explicit PieceTable(const QString &original);
+
+    void replace(qsizetype position, qsizetype removedLength, QStringView insertedText);
+    void insert(qsizetype position, QStringView text);
+    void remove(qsizetype position, qsizetype length);
+
+    qsizetype length() const { return m_length; }
+    bool isEmpty() const { return m_length == 0; }
+    int pieceCount() const { return m_pieces.size(); }
+
+    // Safe to call on a frozen copy from any thread
+    QString text() const;
+    QString mid(qsizetype position, qsizetype length) const;
+
+    // Characters this text has in common with other at the start, and at the
+    // end up to limit, without building the text
+    qsizetype commonPrefixLength(QStringView other) const;
+    qsizetype commonSuffixLength(QStringView other, qsizetype limit) const;
+
+    // Stop appending to the current add buffer so copies taken from now on
+    // share all buffers with this table
+    void freeze();
+
+    // Collapse all pieces into a fresh original buffer
+    void compact();
+
+    // Bytes held by the buffers and the piece list
+    qsizetype memoryUsage() const;
+
+private:
+    struct Piece {
+        int buffer;
+        qsizetype start;
+        qsizetype length;
+    };
+
+    // The first buffer is the original text, the last one takes typed text
+    QVector<QString> m_buffers;
+    QVector<Piece> m_pieces;
+    qsizetype m_length;
+
+    // Typing is local, so piece lookups start from the last piece touched
+    mutable int m_cachedPiece;
+    mutable qsizetype m_cachedPieceStart;
+
+    int findPiece(qsizetype position, qsizetype *pieceStart) const;
+    int splitAt(qsizetype position);
+    QStringView pieceText(const Piece &piece) const;
+    int addBuffer() const { return m_buffers.size() - 1; }
+    void invalidateCache();
+};
+
+#endif // PIECETABLE_H
@@ -0,0 +1,266 @@
+// Prefetcher.cpp
+#include "Prefetcher.h"
+#include "WorkspaceIndexer.h"
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace {
+constexpr int kIdleDelayMs = 300;         // Quiet time before each prefetch
+constexpr int kMaxViewportTargets = 8;
+constexpr int kMaxHandedOver = 4;
+}
+
+Prefetcher::Prefetcher(DocumentStore *store, FileIoService *io, MarkdownRenderer *renderer,
+                       QObject *parent)
+    : QObject(parent)
+    , m_store(store)
+    , m_io(io)
+    , m_renderer(renderer)
+    , m_budget(16 * 1024 * 1024)
+    , m_residentBytes(0)
+    , m_tick(0)
+    , m_hits(0)
+    , m_misses(0)
+    , m_renderHits(0)
+    , m_wasted(0)
+{
+    // Rendering ahead must never compete with what the user is doing
+    m_pool.setMaxThreadCount(1);
+    m_pool.setThreadPriority(QThread::LowPriority);
+
+    m_idleTimer = new QTimer(this);
+    m_idleTimer->setSingleShot(true);
+    m_idleTimer->setInterval(kIdleDelayMs);
+    connect(m_idleTimer, &QTimer::timeout, this, &Prefetcher::prefetchNext);
+
+    // Typing postpones the next prefetch
+    connect(m_store, &DocumentStore::documentEdited, this, [this]() {
+        if (m_idleTimer->isActive()) {
+            m_idleTimer->start();
+        }
+    });
+    connect(m_store, &DocumentStore::documentOpened, this, [this](int documentId) {
+        remove(m_store->path(documentId));
+    });
+}
+
+void Prefetcher::setBudget(qint64 bytes)
+{
+    m_budget = bytes;
+    enforceBudget();
+}
+
+void Prefetcher::setHistoryTargets(const QStringList &paths)
+{
+    if (paths == m_historyTargets) {
+        return;
+    }
+    m_historyTargets = paths;
+    forgetFailures();
+    schedule();
+}
+
+void Prefetcher::setViewportTargets(const QStringList &paths)
+{
+    QStringList targets = paths.mid(0, kMaxViewportTargets);
+    if (targets == m_viewportTargets) {
+        return;
+    }
+    m_viewportTargets = targets;
+    forgetFailures();
+    schedule();
+}
+
+void Prefetcher::forgetFailures()
+{
+    // A failure stands while its path remains a candidate; one that leaves
+    // and comes back later is tried again
+    for (auto it = m_failed.begin(); it != m_failed.end();) {
+        if (m_historyTargets.contains(*it) || m_viewportTargets.contains(*it)) {
+            ++it;
+        } else {
+            it = m_failed.erase(it);
+        }
+    }
+}
+
+bool Prefetcher::take(const QString &path, FileIoService::Result *result)
+{
+    auto it = m_entries.constFind(path);
+    if (it == m_entries.constEnd()) {
+        if (m_historyTargets.contains(path) || m_viewportTargets.contains(path)) {
+            ++m_misses;
+            emit statsChanged();
+        }
+        return false;
+    }
+
+    Entry entry = *it;
+    remove(path);
+    if (!isFresh(path, entry.result)) {
+        ++m_wasted;
+        ++m_misses;
+        emit statsChanged();
+        return false;
+    }
+
+    ++m_hits;
+    *result = entry.result;
+    if (!entry.html.isEmpty()) {
+        if (m_handedOver.size() >= kMaxHandedOver) {
+            m_handedOver.clear();
+        }
+        m_handedOver.insert(entry.renderKey, entry.html);
+    }
+    emit statsChanged();
+    return true;
+}
+
+QString Prefetcher::takeRendered(quint64 renderKey)
+{
+    QString html = m_handedOver.take(renderKey);
+    if (!html.isEmpty()) {
+        ++m_renderHits;
+        emit statsChanged();
+    }
+    return html;
+}
+
+double Prefetcher::hitRate() const
+{
+    int opens = m_hits + m_misses;
+    return opens > 0 ? double(m_hits) / opens : 0.0;
+}
+
+QString Prefetcher::summary() const
+{
+    return QString("%1 of %2 navigations prefetched (%3%), %4 pre-rendered, %5 MB held")
+        .arg(m_hits)
+        .arg(m_hits + m_misses)
+        .arg(qRound(hitRate() * 100))
+        .arg(m_renderHits)
+        .arg(m_residentBytes / (1024.0 * 1024.0), 0, 'f', 1);
+}
+
+void Prefetcher::schedule()
+{
+    if (m_loading.isEmpty()) {
+        m_idleTimer->start();
+    }
+}
+
+void Prefetcher::prefetchNext()
+{
+    QString path = nextCandidate();
+    if (!m_loading.isEmpty() || path.isEmpty()) {
+        return;
+    }
+    m_loading = path;
+
+    m_io->readFile(path).then(this, [this, path](const FileIoService::Result &result) {
+        if (!result.success) {
+            m_failed.insert(path);
+            m_loading.clear();
+            schedule();
+            return;
+        }
+
+        // Rendered with the settings the preview has now, on a renderer of
+        // its own so the worker shares no state with the GUI thread
+        bool mathEnabled = m_renderer->mathEnabled();
+        bool gfmEnabled = m_renderer->gfmEnabled();
+        QString codeBlockTheme = m_renderer->codeBlockTheme();
+        QUrl baseUrl = m_renderer->baseUrl();
+        quint64 renderKey = m_renderer->renderKey(result.contentHash);
+        QtConcurrent::run(&m_pool, [content = result.content, mathEnabled, gfmEnabled,
+                                    codeBlockTheme, baseUrl]() {
+            MarkdownRenderer renderer;
+            renderer.setMathEnabled(mathEnabled);
+            renderer.setGfmEnabled(gfmEnabled);
+            renderer.setCodeBlockTheme(codeBlockTheme);
+            renderer.setBaseUrl(baseUrl);
+            return renderer.renderMarkdown(content);
+        }).then(this, [this, path, result, renderKey](const QString &html) {
+            m_loading.clear();
+            store(path, result, renderKey, html);
+            schedule();
+        });
+    });
+}
+
+QString Prefetcher::nextCandidate() const
+{
+    // Back and forward are the likeliest next documents
+    for (const QStringList *paths : {&m_historyTargets, &m_viewportTargets}) {
+        for (const QString &path : *paths) {
+            if (path.isEmpty() || m_entries.contains(path) || m_failed.contains(path)
+                || !WorkspaceIndexer::isMarkdownFile(path)
+                || m_store->documentId(path) != DocumentStore::InvalidId) {
+                continue;
+            }
+            return path;
+        }
+    }
+    return QString();
+}
+
+bool Prefetcher::isFresh(const QString &path, const FileIoService::Result &result) const
+{
+    QFileInfo info(path);
+    return info.size() == result.size && info.lastModified() == result.lastModified;
+}
+
+void Prefetcher::store(const QString &path, const FileIoService::Result &result,
+                       quint64 renderKey, const QString &html)
+{
+    // Opened while it was being prefetched
+    if (m_store->documentId(path) != DocumentStore::InvalidId) {
+        return;
+    }
+
+    remove(path);
+    Entry entry{result, html, renderKey, 0, ++m_tick};
+    entry.bytes = sizeOf(entry);
+    if (entry.bytes > m_budget) {
+        m_failed.insert(path);
+        return;
+    }
+    m_entries.insert(path, entry);
+    m_residentBytes += entry.bytes;
+    enforceBudget();
+
+    emit prefetched(path);
+    emit statsChanged();
+}
+
+void Prefetcher::remove(const QString &path)
+{
+    auto it = m_entries.find(path);
+    if (it == m_entries.end()) {
+        return;
+    }
+    m_residentBytes -= it->bytes;
+    m_entries.erase(it);
+}
+
+void Prefetcher::enforceBudget()
+{
+    // Oldest prefetch first; it is the least likely to still be wanted
+    while (m_residentBytes > m_budget && !m_entries.isEmpty()) {
+        auto oldest = m_entries.cbegin();
+        for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+            if (it->tick < oldest->tick) {
+                oldest = it;
+            }
+        }
+        QString path = oldest.key();
+        remove(path);
+        m_failed.insert(path);
+        ++m_wasted;
+    }
+}
+
+qint64 Prefetcher::sizeOf(const Entry &entry)
+{
+    return (entry.result.content.size() + entry.html.size()) * qint64(sizeof(QChar));
+}
@@ -0,0 +1,108 @@
+// Prefetcher.h
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+
+#include "DocumentStore.h"
+#include "FileIoService.h"
+#include "MarkdownRenderer.h"
+
+// Reads and renders the documents the user is likely to open next, so
+// following a link or going back or forward does not wait for the disk or
+// the renderer. Candidates are the immediate back and forward history
+// entries and the targets of the links on screen.
+//
+// Work only starts once the user has paused (no edits, no scrolling) and
+// goes one document at a time; rendering runs on a low-priority pool.
+// Prefetched documents are kept within a memory budget, least recently
+// prefetched first out, and dropped on use or when the file changed.
+class Prefetcher : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int hits READ hits NOTIFY statsChanged)
+    Q_PROPERTY(int misses READ misses NOTIFY statsChanged)
+    Q_PROPERTY(double hitRate READ hitRate NOTIFY statsChanged)
+    Q_PROPERTY(qint64 residentBytes READ residentBytes NOTIFY statsChanged)
+
+public:
+    Prefetcher(DocumentStore *store, FileIoService *io, MarkdownRenderer *renderer,
+               QObject *parent = nullptr);
+
+    void setBudget(qint64 bytes);
+    qint64 budget() const { return m_budget; }
+
+    // Each call replaces the previous candidates of its kind
+    void setHistoryTargets(const QStringList &paths);
+    Q_INVOKABLE void setViewportTargets(const QStringList &paths);
+
+    // Hand over a prefetched read of path if it still matches the file.
+    // Only opens of a history or link target count as a hit or a miss;
+    // other opens were never candidates.
+    bool take(const QString &path, FileIoService::Result *result);
+    // HTML rendered ahead for a document just taken, or empty. The key is
+    // MarkdownRenderer::renderKey() of its text.
+    QString takeRendered(quint64 renderKey);
+    bool hasRendered() const { return !m_handedOver.isEmpty(); }
+
+    int hits() const { return m_hits; }
+    int misses() const { return m_misses; }
+    double hitRate() const;
+    int wasted() const { return m_wasted; }  // Evicted or stale before use
+    qint64 residentBytes() const { return m_residentBytes; }
+    // e.g. "12 of 15 navigations prefetched (80%), 11 pre-rendered, 1.2 MB held"
+    Q_INVOKABLE QString summary() const;
+
+signals:
+    void statsChanged();
+    void prefetched(const QString &path);
+
+private:
+    struct Entry {
+        FileIoService::Result result;
+        QString html;
+        quint64 renderKey = 0;
+        qint64 bytes = 0;
+        quint64 tick = 0;
+    };
+
+    DocumentStore *m_store;
+    FileIoService *m_io;
+    MarkdownRenderer *m_renderer;
+    QThreadPool m_pool;
+
+    QStringList m_historyTargets;
+    QStringList m_viewportTargets;
+    QHash<QString, Entry> m_entries;
+    QHash<quint64, QString> m_handedOver;   // HTML of taken documents, by render key
+    QSet<QString> m_failed;                 // Failed or evicted; skipped while still a candidate
+    QString m_loading;                      // Path being read or rendered
+    QTimer *m_idleTimer;
+    qint64 m_budget;
+    qint64 m_residentBytes;
+    quint64 m_tick;
+
+    int m_hits;
+    int m_misses;
+    int m_renderHits;
+    int m_wasted;
+
+    void schedule();
+    void prefetchNext();
+    QString nextCandidate() const;
+    void forgetFailures();
+    bool isFresh(const QString &path, const FileIoService::Result &result) const;
+    void store(const QString &path, const FileIoService::Result &result, quint64 renderKey,
+               const QString &html);
+    void remove(const QString &path);
+    void enforceBudget();
+
+    static qint64 sizeOf(const Entry &entry);
+};
+
+#endif // PREFETCHER_H
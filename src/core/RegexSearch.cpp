@@ -0,0 +1,403 @@
+// RegexSearch.cpp
+#include "RegexSearch.h"
+#include <QByteArrayMatcher>
+#include <QElapsedTimer>
+#include <QFile>
+#include <algorithm>
+#include <atomic>
+
+namespace {
+constexpr int kShardSize = 16;         // Files a worker takes at a time
+constexpr int kBatchSize = 256;        // Matches per delivery at most
+constexpr int kBatchIntervalMs = 50;
+constexpr int kMaxLineLength = 500;
+constexpr int kContextBefore = 100;    // Kept before the first match of a long line
+
+char asciiLower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? char(c + ('a' - 'A')) : c;
+}
+}
+
+// State of one search, shared by its workers
+struct RegexSearch::Search {
+    RegexSearch *owner = nullptr;
+    QRegularExpression regex;
+    QStringList files;
+    int maxMatches = 0;
+
+    QByteArray literal;          // Lowercased when the search ignores case
+    QByteArrayMatcher matcher;
+    bool caseSensitive = false;
+
+    std::atomic<int> next{0};    // First file of the next shard
+    std::atomic<int> running{0};
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> truncated{false};
+    std::atomic<int> filesSearched{0};
+    std::atomic<int> filesSkipped{0};
+    std::atomic<qint64> bytesSearched{0};
+    std::atomic<int> matchCount{0};
+    QElapsedTimer timer;
+
+    qsizetype find(QByteArrayView data, qsizetype from) const
+    {
+        if (caseSensitive) {
+            return matcher.indexIn(data, from);
+        }
+        auto it = std::search(data.begin() + from, data.end(), literal.cbegin(), literal.cend(),
+                              [](char a, char b) { return asciiLower(a) == b; });
+        return it == data.end() ? -1 : it - data.begin();
+    }
+};
+
+double RegexSearch::Stats::filesPerSecond() const
+{
+    return elapsedMs > 0 ? filesSearched * 1000.0 / elapsedMs : 0;
+}
+
+double RegexSearch::Stats::megabytesPerSecond() const
+{
+    return elapsedMs > 0 ? bytesSearched / (1024.0 * 1024.0) * 1000.0 / elapsedMs : 0;
+}
+
+RegexSearch::RegexSearch(QObject *parent)
+    : QObject(parent)
+{
+}
+
+RegexSearch::~RegexSearch()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+bool RegexSearch::start(const QString &pattern, const QStringList &files, bool caseSensitive,
+                        int maxMatches)
+{
+    cancel();
+
+    QRegularExpression regex(pattern, caseSensitive ? QRegularExpression::NoPatternOption
+                                                    : QRegularExpression::CaseInsensitiveOption);
+    if (!regex.isValid()) {
+        emit errorOccurred("Invalid regular expression: " + regex.errorString());
+        return false;
+    }
+    regex.optimize();
+
+    auto search = std::make_shared<Search>();
+    search->owner = this;
+    search->regex = regex;
+    search->files = files;
+    search->maxMatches = maxMatches;
+    search->caseSensitive = caseSensitive;
+    search->literal = requiredLiteral(pattern);
+
+    // The prefilter folds ASCII only; PCRE also folds the Kelvin sign to k
+    // and the long s to s, so literals with those are not used either
+    bool ascii = std::all_of(search->literal.cbegin(), search->literal.cend(), [](char c) {
+        return uchar(c) < 0x80 && c != 'k' && c != 'K' && c != 's' && c != 'S';
+    });
+    if (!caseSensitive && !ascii) {
+        search->literal.clear();
+    } else if (!caseSensitive) {
+        std::transform(search->literal.begin(), search->literal.end(), search->literal.begin(),
+                       asciiLower);
+    } else {
+        search->matcher.setPattern(search->literal);
+    }
+
+    m_current = search;
+    search->timer.start();
+
+    int workers = qMax(1, qMin(m_pool.maxThreadCount(),
+                               int(files.size() + kShardSize - 1) / kShardSize));
+    search->running = workers;
+    for (int i = 0; i < workers; ++i) {
+        m_pool.start([search]() { runShards(search); });
+    }
+    return true;
+}
+
+void RegexSearch::cancel()
+{
+    if (m_current) {
+        m_current->cancelled = true;
+        m_current.reset();
+    }
+}
+
+QByteArray RegexSearch::requiredLiteral(const QString &pattern)
+{
+    // Inline options and lookarounds change what the text around means
+    if (pattern.contains(QLatin1String("(?"))) {
+        return QByteArray();
+    }
+
+    QString best;
+    QString run;
+    auto endRun = [&]() {
+        if (run.size() > best.size()) {
+            best = run;
+        }
+        run.clear();
+    };
+
+    int depth = 0;
+    for (qsizetype i = 0; i < pattern.size(); ++i) {
+        QChar c = pattern.at(i);
+        switch (c.unicode()) {
+            case '\\': {
+                QChar escaped = i + 1 < pattern.size() ? pattern.at(i + 1) : QChar();
+                ++i;
+                // \w, \d, \b, back references and the like are not literals
+                if (escaped.isNull() || escaped.isLetterOrNumber()) {
+                    endRun();
+                } else if (depth == 0) {
+                    run += escaped;
+                }
+                break;
+            }
+            case '[': {
+                // Skip the class; a ] right after [ or [^ is part of it
+                qsizetype j = i + 1;
+                if (j < pattern.size() && pattern.at(j) == '^') {
+                    ++j;
+                }
+                if (j < pattern.size() && pattern.at(j) == ']') {
+                    ++j;
+                }
+                while (j < pattern.size() && pattern.at(j) != ']') {
+                    j += pattern.at(j) == '\\' ? 2 : 1;
+                }
+                i = j;
+                endRun();
+                break;
+            }
+            case '|':
+                // An alternative at the top level may match without it
+                if (depth == 0) {
+                    return QByteArray();
+                }
+                endRun();
+                break;
+            case '(':
+                ++depth;
+                endRun();
+                break;
+            case ')':
+                --depth;
+                endRun();
+                break;
+            case '{': {
+                // {n}, {n,} or {n,m}; anything else is a literal brace
+                qsizetype close = pattern.indexOf('}', i + 1);
+                static const QRegularExpression quantifier("^\\d+(,\\d*)?$");
+                QString bounds = close < 0 ? QString() : pattern.mid(i + 1, close - i - 1);
+                if (!quantifier.match(bounds).hasMatch()) {
+                    if (depth == 0) {
+                        run += c;
+                    }
+                    break;
+                }
+                // The preceding character occurs at least once unless the
+                // minimum is 0, and the run ends with its repetitions
+                if (bounds.section(',', 0, 0).toInt() == 0 && !run.isEmpty()) {
+                    run.chop(1);
+                }
+                endRun();
+                i = close;
+                break;
+            }
+            case '*':
+            case '?':
+                // The preceding character may be absent
+                if (!run.isEmpty()) {
+                    run.chop(1);
+                }
+                endRun();
+                break;
+            case '+':
+            case '.':
+            case '^':
+            case '$':
+                endRun();
+                break;
+            default:
+                if (depth == 0) {
+                    run += c;
+                }
+                break;
+        }
+    }
+    endRun();
+    return best.toUtf8();
+}
+
+void RegexSearch::runShards(const std::shared_ptr<Search> &search)
+{
+    QVector<Match> batch;
+    QElapsedTimer sinceDelivery;
+    sinceDelivery.start();
+
+    int count = search->files.size();
+    while (!search->cancelled) {
+        int begin = search->next.fetch_add(kShardSize);
+        if (begin >= count) {
+            break;
+        }
+        for (int i = begin; i < qMin(count, begin + kShardSize) && !search->cancelled; ++i) {
+            searchFile(*search, search->files.at(i), batch);
+
+            if (!batch.isEmpty()
+                && (batch.size() >= kBatchSize || sinceDelivery.elapsed() >= kBatchIntervalMs)) {
+                QMetaObject::invokeMethod(search->owner, [search, batch]() {
+                    search->owner->deliver(search, batch);
+                }, Qt::QueuedConnection);
+                batch.clear();
+                sinceDelivery.restart();
+            }
+        }
+    }
+
+    if (!batch.isEmpty()) {
+        QMetaObject::invokeMethod(search->owner, [search, batch]() {
+            search->owner->deliver(search, batch);
+        }, Qt::QueuedConnection);
+    }
+
+    // The last worker finishes the search
+    if (search->running.fetch_sub(1) == 1) {
+        QMetaObject::invokeMethod(search->owner, [search]() {
+            search->owner->finish(search);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void RegexSearch::searchFile(Search &search, const QString &path, QVector<Match> &batch)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    // Mapping avoids copying the file; empty files cannot be mapped
+    QByteArray buffer;
+    QByteArrayView data;
+    qint64 size = file.size();
+    if (uchar *mapped = size > 0 ? file.map(0, size) : nullptr) {
+        data = QByteArrayView(reinterpret_cast<const char *>(mapped), size);
+    } else {
+        buffer = file.readAll();
+        data = buffer;
+    }
+    search.filesSearched.fetch_add(1);
+    search.bytesSearched.fetch_add(data.size());
+
+    if (search.literal.isEmpty()) {
+        QString text = QString::fromUtf8(data);
+        qsizetype start = 0;
+        for (int line = 1; start <= text.size() && !search.cancelled; ++line) {
+            qsizetype end = text.indexOf('\n', start);
+            if (end < 0) {
+                end = text.size();
+            }
+            matchLine(search, path, line, QStringView(text).mid(start, end - start), batch);
+            start = end + 1;
+        }
+        return;
+    }
+
+    qsizetype at = search.find(data, 0);
+    if (at < 0) {
+        search.filesSkipped.fetch_add(1);
+        return;
+    }
+
+    // Only the lines holding the literal are decoded and matched
+    int line = 1;
+    qsizetype counted = 0;
+    while (at >= 0 && !search.cancelled) {
+        qsizetype lineStart = at > 0 ? data.lastIndexOf('\n', at - 1) + 1 : 0;
+        line += std::count(data.begin() + counted, data.begin() + lineStart, '\n');
+        counted = lineStart;
+
+        qsizetype lineEnd = data.indexOf('\n', at);
+        if (lineEnd < 0) {
+            lineEnd = data.size();
+        }
+        QString text = QString::fromUtf8(data.sliced(lineStart, lineEnd - lineStart));
+        matchLine(search, path, line, text, batch);
+
+        at = lineEnd < data.size() ? search.find(data, lineEnd + 1) : -1;
+    }
+}
+
+void RegexSearch::matchLine(Search &search, const QString &path, int line, QStringView text,
+                            QVector<Match> &batch)
+{
+    if (text.endsWith('\r')) {
+        text.chop(1);
+    }
+
+    QVector<QPair<int, int>> ranges;
+    QRegularExpressionMatchIterator it = search.regex.globalMatchView(text);
+    while (it.hasNext()) {
+        QRegularExpressionMatch match = it.next();
+        if (match.capturedLength() > 0) {
+            ranges.append({int(match.capturedStart()), int(match.capturedLength())});
+        }
+    }
+    if (ranges.isEmpty()) {
+        return;
+    }
+
+    if (search.matchCount.fetch_add(1) >= search.maxMatches) {
+        search.truncated = true;
+        search.cancelled = true;
+        return;
+    }
+
+    Match match;
+    match.path = path;
+    match.line = line;
+    if (text.size() <= kMaxLineLength) {
+        match.text = text.toString();
+        match.ranges = ranges;
+    } else {
+        // Minified or generated lines are cut down around the first match
+        int from = qMax(0, ranges.first().first - kContextBefore);
+        match.text = text.mid(from, kMaxLineLength).toString();
+        for (const auto &range : std::as_const(ranges)) {
+            if (range.first + range.second <= from + kMaxLineLength) {
+                match.ranges.append({range.first - from, range.second});
+            }
+        }
+    }
+    batch.append(match);
+}
+
+void RegexSearch::deliver(const std::shared_ptr<Search> &search, const QVector<Match> &matches)
+{
+    if (search == m_current) {
+        emit matchesFound(matches);
+    }
+}
+
+void RegexSearch::finish(const std::shared_ptr<Search> &search)
+{
+    if (search != m_current) {
+        return;
+    }
+    m_current.reset();
+
+    Stats stats;
+    stats.filesSearched = search->filesSearched;
+    stats.filesSkipped = search->filesSkipped;
+    stats.bytesSearched = search->bytesSearched;
+    stats.matchCount = qMin(search->matchCount.load(), search->maxMatches);
+    stats.elapsedMs = search->timer.elapsed();
+    stats.truncated = search->truncated;
+
+    emit finished(stats);
+}
@@ -0,0 +1,78 @@
+// RegexSearch.h
+#ifndef REGEXSEARCH_H
+#define REGEXSEARCH_H
+
+#include <QObject>
+#include <QPair>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+#include <memory>
+
+// Ad-hoc regular expression search over a list of files, in the manner of
+// ripgrep. Workers on a private thread pool take files in small shards,
+// map each one and only run the expression on the lines around a literal
+// the pattern requires, when it has one. Matches are reported in batches
+// while the search runs; it stops early once enough lines have matched.
+//
+// Patterns are matched line by line, so they cannot span lines.
+class RegexSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Match {
+        QString path;
+        int line = 0;                     // 1-based
+        QString text;                     // The line, shortened if very long
+        QVector<QPair<int, int>> ranges;  // Start and length of matches in text
+    };
+
+    struct Stats {
+        int filesSearched = 0;
+        int filesSkipped = 0;  // Rejected by the literal prefilter
+        qint64 bytesSearched = 0;
+        int matchCount = 0;
+        qint64 elapsedMs = 0;
+        bool truncated = false;  // Stopped at the result limit
+
+        double filesPerSecond() const;
+        double megabytesPerSecond() const;
+    };
+
+    explicit RegexSearch(QObject *parent = nullptr);
+    ~RegexSearch() override;
+
+    // Cancels the running search, if any. Returns false if the pattern
+    // does not compile; the error is reported through errorOccurred().
+    bool start(const QString &pattern, const QStringList &files, bool caseSensitive = false,
+               int maxMatches = 10000);
+    void cancel();
+    bool isRunning() const { return m_current != nullptr; }
+
+    // The literal every match must contain, in UTF-8, or empty if there
+    // is none that can be found cheaply. Exposed for diagnostics.
+    static QByteArray requiredLiteral(const QString &pattern);
+
+signals:
+    void matchesFound(const QVector<RegexSearch::Match> &matches);
+    void finished(const RegexSearch::Stats &stats);
+    void errorOccurred(const QString &error);
+
+private:
+    struct Search;
+
+    QThreadPool m_pool;
+    std::shared_ptr<Search> m_current;
+
+    void deliver(const std::shared_ptr<Search> &search, const QVector<Match> &matches);
+    void finish(const std::shared_ptr<Search> &search);
+
+    static void runShards(const std::shared_ptr<Search> &search);
+    static void searchFile(Search &search, const QString &path, QVector<Match> &batch);
+    static void matchLine(Search &search, const QString &path, int line, QStringView text,
+                          QVector<Match> &batch);
+};
+
+#endif // REGEXSEARCH_H
@@ -0,0 +1,175 @@
+// RegexSearchModel.cpp
+#include "RegexSearchModel.h"
+#include <QFileInfo>
+
+RegexSearchModel::RegexSearchModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_caseSensitive(false)
+    , m_maxMatches(10000)
+{
+    // Half-typed patterns are often slow or invalid; wait for a pause
+    m_searchTimer = new QTimer(this);
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(250);
+    connect(m_searchTimer, &QTimer::timeout, this, &RegexSearchModel::search);
+
+    connect(&m_search, &RegexSearch::matchesFound, this, &RegexSearchModel::appendMatches);
+    connect(&m_search, &RegexSearch::finished, this, [this](const RegexSearch::Stats &stats) {
+        m_stats = stats;
+        emit statsChanged();
+        emit searchingChanged();
+    });
+    connect(&m_search, &RegexSearch::errorOccurred, this, [this](const QString &error) {
+        m_errorString = error;
+        emit statsChanged();
+    });
+}
+
+void RegexSearchModel::setIndexer(WorkspaceIndexer *indexer)
+{
+    m_indexer = indexer;
+}
+
+void RegexSearchModel::setPattern(const QString &pattern)
+{
+    if (m_pattern == pattern) {
+        return;
+    }
+    m_pattern = pattern;
+    emit patternChanged();
+    if (!m_indexer && !m_pattern.isEmpty()) {
+        emit indexerNeeded();
+    }
+    m_searchTimer->start();
+}
+
+void RegexSearchModel::setCaseSensitive(bool caseSensitive)
+{
+    if (m_caseSensitive == caseSensitive) {
+        return;
+    }
+    m_caseSensitive = caseSensitive;
+    emit caseSensitiveChanged();
+    m_searchTimer->start();
+}
+
+void RegexSearchModel::setMaxMatches(int maxMatches)
+{
+    m_maxMatches = maxMatches;
+}
+
+QString RegexSearchModel::summary() const
+{
+    if (!m_errorString.isEmpty() || m_stats.filesSearched == 0) {
+        return m_errorString;
+    }
+    return QString("%1%2 matches in %3 files, %4 files/s, %5 MB/s")
+        .arg(m_stats.truncated ? "First " : "")
+        .arg(m_stats.matchCount)
+        .arg(m_stats.filesSearched)
+        .arg(qRound(m_stats.filesPerSecond()))
+        .arg(m_stats.megabytesPerSecond(), 0, 'f', 1);
+}
+
+QString RegexSearchModel::filePath(int row) const
+{
+    if (row < 0 || row >= m_results.size()) {
+        return QString();
+    }
+    return m_results.at(row).path;
+}
+
+int RegexSearchModel::line(int row) const
+{
+    if (row < 0 || row >= m_results.size()) {
+        return 0;
+    }
+    return m_results.at(row).line;
+}
+
+void RegexSearchModel::cancel()
+{
+    m_searchTimer->stop();
+    if (m_search.isRunning()) {
+        m_search.cancel();
+        emit searchingChanged();
+    }
+}
+
+int RegexSearchModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_results.size();
+}
+
+QVariant RegexSearchModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_results.size()) {
+        return QVariant();
+    }
+
+    const RegexSearch::Match &match = m_results.at(index.row());
+    switch (role) {
+        case Qt::DisplayRole:
+        case TextRole:
+            return match.text;
+        case FilePathRole:
+            return match.path;
+        case FileNameRole:
+            return QFileInfo(match.path).fileName();
+        case LineRole:
+            return match.line;
+        case TextHtmlRole: {
+            QString html;
+            int position = 0;
+            for (const auto &range : match.ranges) {
+                html += match.text.mid(position, range.first - position).toHtmlEscaped();
+                html += "<b>" + match.text.mid(range.first, range.second).toHtmlEscaped() + "</b>";
+                position = range.first + range.second;
+            }
+            return html + match.text.mid(position).toHtmlEscaped();
+        }
+        default:
+            return QVariant();
+    }
+}
+
+QHash<int, QByteArray> RegexSearchModel::roleNames() const
+{
+    return {
+        {FilePathRole, "filePath"},
+        {FileNameRole, "fileName"},
+        {LineRole, "line"},
+        {TextRole, "text"},
+        {TextHtmlRole, "textHtml"}
+    };
+}
+
+void RegexSearchModel::search()
+{
+    bool wasSearching = m_search.isRunning();
+    m_search.cancel();
+
+    beginResetModel();
+    m_results.clear();
+    endResetModel();
+    emit countChanged();
+
+    m_stats = RegexSearch::Stats();
+    m_errorString.clear();
+    emit statsChanged();
+
+    bool started = m_indexer && !m_pattern.isEmpty()
+                   && m_search.start(m_pattern, m_indexer->paths(), m_caseSensitive,
+                                     m_maxMatches);
+    if (started != wasSearching) {
+        emit searchingChanged();
+    }
+}
+
+void RegexSearchModel::appendMatches(const QVector<RegexSearch::Match> &matches)
+{
+    beginInsertRows(QModelIndex(), m_results.size(), m_results.size() + matches.size() - 1);
+    m_results += matches;
+    endInsertRows();
+    emit countChanged();
+}
@@ -0,0 +1,145 @@
+// SearchResultsModel.cpp
+#include "SearchResultsModel.h"
+#include <QFileInfo>
+
+SearchResultsModel::SearchResultsModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_watcher(nullptr)
+{
+    // Each keystroke would otherwise start and cancel a search
+    m_searchTimer = new QTimer(this);
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(150);
+    connect(m_searchTimer, &QTimer::timeout, this, &SearchResultsModel::search);
+}
+
+void SearchResultsModel::setIndex(FullTextIndex *index)
+{
+    m_index = index;
+    emit availableChanged();
+    search();
+}
+
+void SearchResultsModel::setQuery(const QString &query)
+{
+    if (m_query == query) {
+        return;
+    }
+    m_query = query;
+    emit queryChanged();
+    if (!m_index && !m_query.trimmed().isEmpty()) {
+        emit indexNeeded();
+    }
+    m_searchTimer->start();
+}
+
+QString SearchResultsModel::filePath(int row) const
+{
+    if (row < 0 || row >= m_results.size()) {
+        return QString();
+    }
+    return m_results.at(row).path;
+}
+
+int SearchResultsModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_results.size();
+}
+
+QVariant SearchResultsModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_results.size()) {
+        return QVariant();
+    }
+
+    const FullTextIndex::Hit &hit = m_results.at(index.row());
+    switch (role) {
+        case Qt::DisplayRole:
+        case FileNameRole:
+            return QFileInfo(hit.path).fileName();
+        case FilePathRole:
+            return hit.path;
+        case SnippetRole:
+            return hit.snippet;
+        case SnippetHtmlRole:
+            return highlight(hit);
+        case MatchCountRole:
+            return hit.matchCount;
+        case ScoreRole:
+            return hit.score;
+        default:
+            return QVariant();
+    }
+}
+
+QHash<int, QByteArray> SearchResultsModel::roleNames() const
+{
+    return {
+        {FilePathRole, "filePath"},
+        {FileNameRole, "fileName"},
+        {SnippetRole, "snippet"},
+        {SnippetHtmlRole, "snippetHtml"},
+        {MatchCountRole, "matchCount"},
+        {ScoreRole, "score"}
+    };
+}
+
+void SearchResultsModel::search()
+{
+    m_searchTimer->stop();
+
+    // A watcher per search, so results still queued from a cancelled one
+    // are never mixed into the new rows
+    bool wasSearching = isSearching();
+    if (m_watcher) {
+        m_watcher->disconnect(this);
+        m_watcher->cancel();
+        m_watcher->deleteLater();
+        m_watcher = nullptr;
+    }
+
+    if (!m_results.isEmpty()) {
+        beginResetModel();
+        m_results.clear();
+        endResetModel();
+        emit countChanged();
+    }
+
+    if (!m_index || m_query.trimmed().isEmpty()) {
+        if (wasSearching) {
+            emit searchingChanged();
+        }
+        return;
+    }
+
+    auto *watcher = new QFutureWatcher<FullTextIndex::Hit>(this);
+    connect(watcher, &QFutureWatcher<FullTextIndex::Hit>::resultsReadyAt, this,
+            [this, watcher](int begin, int end) {
+        beginInsertRows(QModelIndex(), m_results.size(), m_results.size() + end - begin - 1);
+        for (int i = begin; i < end; ++i) {
+            m_results.append(watcher->resultAt(i));
+        }
+        endInsertRows();
+        emit countChanged();
+    });
+    connect(watcher, &QFutureWatcher<FullTextIndex::Hit>::finished, this,
+            &SearchResultsModel::searchingChanged);
+    m_watcher = watcher;
+    m_watcher->setFuture(m_index->search(m_query));
+    if (!wasSearching) {
+        emit searchingChanged();
+    }
+}
+
+QString SearchResultsModel::highlight(const FullTextIndex::Hit &hit)
+{
+    QString html;
+    int position = 0;
+    for (const auto &range : hit.ranges) {
+        html += hit.snippet.mid(position, range.first - position).toHtmlEscaped();
+        html += "<b>" + hit.snippet.mid(range.first, range.second).toHtmlEscaped() + "</b>";
+        position = range.first + range.second;
+    }
+    html += hit.snippet.mid(position).toHtmlEscaped();
+    return html;
+}
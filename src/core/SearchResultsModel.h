@@ -0,0 +1,69 @@
+// SearchResultsModel.h
+#ifndef SEARCHRESULTSMODEL_H
+#define SEARCHRESULTSMODEL_H
+
+#include <QAbstractListModel>
+#include <QFutureWatcher>
+#include <QPointer>
+#include <QTimer>
+
+#include "FullTextIndex.h"
+
+// Results of a full-text search for the explorer's search field. Rows are
+// appended as the index streams them in; changing the query cancels the
+// search still running.
+class SearchResultsModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QString query READ query WRITE setQuery NOTIFY queryChanged)
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+    Q_PROPERTY(bool searching READ isSearching NOTIFY searchingChanged)
+    Q_PROPERTY(bool available READ isAvailable NOTIFY availableChanged)
+
+public:
+    enum Roles {
+        FilePathRole = Qt::UserRole + 1,
+        FileNameRole,
+        SnippetRole,
+        SnippetHtmlRole,  // Escaped, with the matches in <b>
+        MatchCountRole,
+        ScoreRole
+    };
+
+    explicit SearchResultsModel(QObject *parent = nullptr);
+
+    void setIndex(FullTextIndex *index);
+    bool isAvailable() const { return !m_index.isNull(); }
+
+    QString query() const { return m_query; }
+    void setQuery(const QString &query);
+
+    bool isSearching() const { return m_watcher && m_watcher->isRunning(); }
+
+    Q_INVOKABLE QString filePath(int row) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void queryChanged();
+    void countChanged();
+    void searchingChanged();
+    void availableChanged();
+    // First query without an index; the index is built on first use
+    void indexNeeded();
+
+private:
+    QPointer<FullTextIndex> m_index;
+    QString m_query;
+    QVector<FullTextIndex::Hit> m_results;
+    QFutureWatcher<FullTextIndex::Hit> *m_watcher;  // Of the current search
+    QTimer *m_searchTimer;
+
+    void search();
+
+    static QString highlight(const FullTextIndex::Hit &hit);
+};
+
+#endif // SEARCHRESULTSMODEL_H
@@ -0,0 +1,77 @@
+// ServiceRegistry.cpp
+#include "ServiceRegistry.h"
+#include "StartupTrace.h"
+#include <QTimer>
+#include <QDebug>
+
+ServiceRegistry::ServiceRegistry(QObject *parent)
+    : QObject(parent)
+    , m_firstFrameShown(false)
+    , m_startupFinished(false)
+{
+}
+
+void ServiceRegistry::registerService(const QString &name, const Factory &factory)
+{
+    m_factories.insert(name, factory);
+}
+
+QObject *ServiceRegistry::service(const QString &name)
+{
+    if (QObject *existing = m_services.value(name)) {
+        return existing;
+    }
+
+    Factory factory = m_factories.value(name);
+    if (!factory) {
+        qWarning() << "Unknown service" << name;
+        return nullptr;
+    }
+
+    QObject *created = nullptr;
+    {
+        StartupTrace::Scope scope("create " + name);
+        created = factory(this);
+    }
+    m_services.insert(name, created);
+    emit serviceCreated(name, created);
+    return created;
+}
+
+void ServiceRegistry::deferUntilFirstFrame(const QString &phase, const std::function<void()> &task)
+{
+    m_deferred.append({phase, task});
+    if (m_firstFrameShown && m_deferred.size() == 1) {
+        QTimer::singleShot(0, this, &ServiceRegistry::runNextDeferred);
+    }
+}
+
+void ServiceRegistry::firstFrameShown()
+{
+    if (m_firstFrameShown) {
+        return;
+    }
+    m_firstFrameShown = true;
+    StartupTrace::mark("first frame");
+
+    QTimer::singleShot(0, this, &ServiceRegistry::runNextDeferred);
+}
+
+void ServiceRegistry::runNextDeferred()
+{
+    if (m_deferred.isEmpty()) {
+        if (!m_startupFinished) {
+            m_startupFinished = true;
+            emit startupFinished();
+        }
+        return;
+    }
+
+    // One task per turn so input arriving meanwhile is not held up
+    DeferredTask next = m_deferred.takeFirst();
+    {
+        StartupTrace::Scope scope(next.phase);
+        next.task();
+    }
+    QTimer::singleShot(0, this, &ServiceRegistry::runNextDeferred);
+}
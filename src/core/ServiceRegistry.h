@@ -0,0 +1,58 @@
+// ServiceRegistry.h
+#ifndef SERVICEREGISTRY_H
+#define SERVICEREGISTRY_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <functional>
+
+// Owns services that are expensive to create and not needed by every
+// session, such as the PDF exporter and its web engine profile. A service
+// is registered with a factory and constructed on first use.
+//
+// Work that must happen at startup but need not delay the first frame is
+// queued with deferUntilFirstFrame() and run one task per event loop turn
+// once the window has been shown.
+class ServiceRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Factory = std::function<QObject *(QObject *parent)>;
+
+    explicit ServiceRegistry(QObject *parent = nullptr);
+
+    void registerService(const QString &name, const Factory &factory);
+
+    // Constructs the service if needed. Returns nullptr for unknown names.
+    Q_INVOKABLE QObject *service(const QString &name);
+    Q_INVOKABLE bool isCreated(const QString &name) const { return m_services.contains(name); }
+
+    template<typename T>
+    T *get(const QString &name) { return qobject_cast<T *>(service(name)); }
+
+    void deferUntilFirstFrame(const QString &phase, const std::function<void()> &task);
+    void firstFrameShown();
+
+signals:
+    void serviceCreated(const QString &name, QObject *service);
+    // The first frame was shown and all deferred work has run
+    void startupFinished();
+
+private:
+    struct DeferredTask {
+        QString phase;
+        std::function<void()> task;
+    };
+
+    QHash<QString, Factory> m_factories;
+    QHash<QString, QObject *> m_services;
+    QVector<DeferredTask> m_deferred;
+    bool m_firstFrameShown;
+    bool m_startupFinished;
+
+    void runNextDeferred();
+};
+
+#endif // SERVICEREGISTRY_H
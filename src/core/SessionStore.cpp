@@ -0,0 +1,268 @@
+// SessionStore.cpp
+#include "SessionStore.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace {
+constexpr quint32 kSessionMagic = 0x4d445354;  // "MDST"
+constexpr quint16 kFormatVersion = 1;
+constexpr auto kStreamVersion = QDataStream::Qt_6_0;
+
+constexpr quint8 kOpenRecord = 1;         // path, contentHash
+constexpr quint8 kCloseRecord = 2;        // path
+constexpr quint8 kActiveRecord = 3;       // path
+constexpr quint8 kViewRecord = 4;         // path, cursor, scroll
+constexpr quint8 kHashRecord = 5;         // path, contentHash
+constexpr quint8 kRenderKeyRecord = 6;    // path, renderKey; no longer written
+
+constexpr int kFlushDelayMs = 1000;
+constexpr qint64 kMinRewriteBytes = 64 * 1024;
+}
+
+SessionStore::SessionStore(FileIoService *io, QObject *parent)
+    : QObject(parent)
+    , m_io(io)
+    , m_bytesOnDisk(0)
+    , m_rewritePending(true)
+{
+    QDir().mkpath(QFileInfo(sessionPath()).absolutePath());
+
+    // Cursor moves and scrolling are frequent; records go out in one append
+    // shortly after they stop
+    m_flushTimer = new QTimer(this);
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(kFlushDelayMs);
+    connect(m_flushTimer, &QTimer::timeout, this, &SessionStore::flush);
+    
+    // The last append only gets queued here; the event loop stops right
+    // after, and FileIoService runs what is still queued when it is destroyed
+    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this,
+            &SessionStore::flush);
+}
+
+QFuture<SessionStore::Session> SessionStore::load() const
+{
+    return QtConcurrent::run(&SessionStore::read, sessionPath());
+}
+
+void SessionStore::documentOpened(const QString &path, quint64 contentHash)
+{
+    if (!m_entries.contains(path)) {
+        m_order.append(path);
+    }
+    Entry &entry = m_entries[path];
+    entry.path = path;
+    entry.contentHash = contentHash;
+
+    append([&](QDataStream &out) { out << kOpenRecord << path << contentHash; });
+}
+
+void SessionStore::documentClosed(const QString &path)
+{
+    if (!m_entries.remove(path)) {
+        return;
+    }
+    m_order.removeAll(path);
+    if (m_activePath == path) {
+        m_activePath.clear();
+    }
+
+    append([&](QDataStream &out) { out << kCloseRecord << path; });
+}
+
+void SessionStore::setActive(const QString &path)
+{
+    if (m_activePath == path || !m_entries.contains(path)) {
+        return;
+    }
+    m_activePath = path;
+
+    append([&](QDataStream &out) { out << kActiveRecord << path; });
+}
+
+void SessionStore::setViewState(const QString &path, int cursorPosition, double scrollPosition)
+{
+    auto it = m_entries.find(path);
+    if (it == m_entries.end()
+        || (it->cursorPosition == cursorPosition && it->scrollPosition == scrollPosition)) {
+        return;
+    }
+    it->cursorPosition = cursorPosition;
+    it->scrollPosition = scrollPosition;
+
+    append([&](QDataStream &out) {
+        out << kViewRecord << path << qint32(cursorPosition) << scrollPosition;
+    });
+}
+
+void SessionStore::setContentHash(const QString &path, quint64 contentHash)
+{
+    auto it = m_entries.find(path);
+    if (it == m_entries.end() || it->contentHash == contentHash) {
+        return;
+    }
+    it->contentHash = contentHash;
+
+    append([&](QDataStream &out) { out << kHashRecord << path << contentHash; });
+}
+
+void SessionStore::flush()
+{
+    m_flushTimer->stop();
+    if (m_pending.isEmpty()) {
+        return;
+    }
+
+    // Once the log holds much more than the current state, replaying it
+    // costs more than rewriting it
+    qint64 limit = qMax<qint64>(kMinRewriteBytes, qint64(m_entries.size()) * 1024);
+    if (m_rewritePending || m_bytesOnDisk + m_pending.size() > limit) {
+        rewrite();
+        return;
+    }
+
+    m_io->appendData(sessionPath(), m_pending);
+    m_bytesOnDisk += m_pending.size();
+    m_pending.clear();
+}
+
+void SessionStore::append(const std::function<void(QDataStream &)> &write)
+{
+    QDataStream out(&m_pending, QIODevice::WriteOnly | QIODevice::Append);
+    out.setVersion(kStreamVersion);
+    write(out);
+
+    if (!m_flushTimer->isActive()) {
+        m_flushTimer->start();
+    }
+}
+
+void SessionStore::rewrite()
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(kStreamVersion);
+    out << kSessionMagic << kFormatVersion;
+
+    for (const QString &path : std::as_const(m_order)) {
+        const Entry &entry = m_entries[path];
+        out << kOpenRecord << path << entry.contentHash;
+        out << kViewRecord << path << entry.cursorPosition << entry.scrollPosition;
+    }
+    if (!m_activePath.isEmpty()) {
+        out << kActiveRecord << m_activePath;
+    }
+
+    m_io->writeData(sessionPath(), data);
+    m_bytesOnDisk = data.size();
+    m_pending.clear();
+    m_rewritePending = false;
+}
+
+QString SessionStore::sessionPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/session.bin";
+}
+
+SessionStore::Session SessionStore::read(const QString &fileName)
+{
+    Session session;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return session;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(kStreamVersion);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != kSessionMagic || version != kFormatVersion) {
+        return session;
+    }
+
+    QHash<QString, Entry> entries;
+    QStringList order;
+
+    // Stop at the first torn record; everything before it is still valid
+    while (!in.atEnd()) {
+        quint8 kind = 0;
+        QString path;
+        in >> kind >> path;
+        if (in.status() != QDataStream::Ok) {
+            break;
+        }
+
+        Entry *entry = entries.contains(path) ? &entries[path] : nullptr;
+        switch (kind) {
+            case kOpenRecord: {
+                quint64 contentHash = 0;
+                in >> contentHash;
+                if (in.status() != QDataStream::Ok) {
+                    break;
+                }
+                if (!entry) {
+                    order.append(path);
+                    entry = &entries[path];
+                    entry->path = path;
+                }
+                entry->contentHash = contentHash;
+                break;
+            }
+            case kCloseRecord:
+                entries.remove(path);
+                order.removeAll(path);
+                if (session.activePath == path) {
+                    session.activePath.clear();
+                }
+                break;
+            case kActiveRecord:
+                session.activePath = path;
+                break;
+            case kViewRecord: {
+                qint32 cursorPosition = 0;
+                double scrollPosition = 0;
+                in >> cursorPosition >> scrollPosition;
+                if (entry) {
+                    entry->cursorPosition = cursorPosition;
+                    entry->scrollPosition = scrollPosition;
+                }
+                break;
+            }
+            case kHashRecord:
+            case kRenderKeyRecord: {
+                quint64 value = 0;
+                in >> value;
+                if (entry && kind == kHashRecord) {
+                    entry->contentHash = value;
+                }
+                break;
+            }
+            default:
+                in.setStatus(QDataStream::ReadCorruptData);
+                break;
+        }
+        if (in.status() != QDataStream::Ok) {
+            break;
+        }
+    }
+
+    // Files deleted since the last run are dropped here, off the GUI thread
+    for (const QString &path : std::as_const(order)) {
+        if (QFileInfo(path).isFile()) {
+            session.entries.append(entries.value(path));
+        } else {
+            entries.remove(path);
+        }
+    }
+    if (!entries.contains(session.activePath)) {
+        session.activePath.clear();
+    }
+    return session;
+}
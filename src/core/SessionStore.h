@@ -0,0 +1,71 @@
+// SessionStore.h
+#ifndef SESSIONSTORE_H
+#define SESSIONSTORE_H
+
+#include <QObject>
+#include <QDataStream>
+#include <QFuture>
+#include <QHash>
+#include <QStringList>
+#include <QTimer>
+#include <functional>
+
+#include "FileIoService.h"
+
+// Remembers the open tabs between runs. The session file is an append-only
+// log of small binary records (tab opened, closed, activated, view state),
+// so keeping it current costs a few bytes per change instead of rewriting
+// every tab. It is rewritten in full once at the start of a run and
+// whenever the log outgrows the state it describes.
+class SessionStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Entry {
+        QString path;
+        qint32 cursorPosition = 0;
+        double scrollPosition = 0;  // Fraction of the scrollable height
+        quint64 contentHash = 0;    // Of the file when last opened or saved
+    };
+
+    struct Session {
+        QVector<Entry> entries;     // In tab order
+        QString activePath;
+    };
+
+    explicit SessionStore(FileIoService *io, QObject *parent = nullptr);
+
+    // Reads the session left by the previous run on a worker thread.
+    // Entries whose file no longer exists are left out.
+    QFuture<Session> load() const;
+
+    void documentOpened(const QString &path, quint64 contentHash);
+    void documentClosed(const QString &path);
+    void setActive(const QString &path);
+    void setViewState(const QString &path, int cursorPosition, double scrollPosition);
+    void setContentHash(const QString &path, quint64 contentHash);
+
+    Entry entry(const QString &path) const { return m_entries.value(path); }
+
+    void flush();
+
+private:
+    FileIoService *m_io;
+    QHash<QString, Entry> m_entries;
+    QStringList m_order;
+    QString m_activePath;
+
+    QByteArray m_pending;  // Records not yet appended to disk
+    qint64 m_bytesOnDisk;
+    bool m_rewritePending; // The file still holds the previous run's session
+    QTimer *m_flushTimer;
+
+    void append(const std::function<void(QDataStream &)> &write);
+    void rewrite();
+
+    static QString sessionPath();
+    static Session read(const QString &fileName);
+};
+
+#endif // SESSIONSTORE_H
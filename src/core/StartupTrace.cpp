@@ -0,0 +1,88 @@
+// StartupTrace.cpp
+#include "StartupTrace.h"
+#include <QElapsedTimer>
+#include <QVector>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+struct Phase {
+    QString name;
+    qint64 startNs;
+    qint64 durationNs;   // -1 for marks
+};
+
+QElapsedTimer s_clock;
+QVector<Phase> s_phases;
+bool s_enabled = false;
+
+qint64 now()
+{
+    if (!s_clock.isValid()) {
+        s_clock.start();
+    }
+    return s_clock.nsecsElapsed();
+}
+}
+
+namespace StartupTrace {
+
+void start()
+{
+    s_clock.start();
+    s_phases.clear();
+}
+
+void setEnabled(bool enabled)
+{
+    s_enabled = enabled;
+}
+
+bool isEnabled()
+{
+    return s_enabled;
+}
+
+void mark(const QString &phase)
+{
+    s_phases.append({phase, now(), -1});
+}
+
+Scope::Scope(const QString &phase)
+    : m_phase(phase)
+    , m_startNs(now())
+{
+}
+
+Scope::~Scope()
+{
+    s_phases.append({m_phase, m_startNs, now() - m_startNs});
+}
+
+void print()
+{
+    if (!s_enabled) {
+        return;
+    }
+
+    // Nested scopes finish before the scope around them
+    QVector<Phase> phases = s_phases;
+    std::stable_sort(phases.begin(), phases.end(), [](const Phase &a, const Phase &b) {
+        return a.startNs < b.startNs;
+    });
+
+    qInfo().noquote() << "Startup trace:";
+    for (const Phase &phase : std::as_const(phases)) {
+        QString at = QString::number(phase.startNs / 1e6, 'f', 1);
+        if (phase.durationNs < 0) {
+            qInfo().noquote() << QString("  %1 ms  %2").arg(at, 8).arg(phase.name);
+        } else {
+            qInfo().noquote() << QString("  %1 ms  %2 (%3 ms)")
+                                     .arg(at, 8)
+                                     .arg(phase.name)
+                                     .arg(phase.durationNs / 1e6, 0, 'f', 1);
+        }
+    }
+}
+
+}
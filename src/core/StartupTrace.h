@@ -0,0 +1,35 @@
+// StartupTrace.h
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QString>
+
+// Timing of the startup phases, measured from the start of main(). Phases
+// are always recorded; print() writes them out when tracing is enabled
+// with --startup-trace.
+namespace StartupTrace {
+
+void start();
+void setEnabled(bool enabled);
+bool isEnabled();
+
+// Records a point in time, e.g. "window shown"
+void mark(const QString &phase);
+
+// Records how long a phase took, from construction to destruction
+class Scope
+{
+public:
+    explicit Scope(const QString &phase);
+    ~Scope();
+
+private:
+    QString m_phase;
+    qint64 m_startNs;
+};
+
+void print();
+
+}
+
+#endif // STARTUPTRACE_H
@@ -0,0 +1,327 @@
+// WatcherBackends.cpp
+#include "WatcherBackends.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTimer>
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <QSocketNotifier>
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+constexpr uint32_t kInotifyMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE
+                                  | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF
+                                  | IN_MOVE_SELF | IN_ONLYDIR;
+}
+
+InotifyBackend::InotifyBackend(QObject *parent)
+    : WatcherBackend(parent)
+    , m_fd(-1)
+    , m_notifier(nullptr)
+{
+}
+
+InotifyBackend::~InotifyBackend()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+void InotifyBackend::start()
+{
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        qWarning() << "inotify unavailable, workspace changes will not be reported";
+        return;
+    }
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &InotifyBackend::readEvents);
+}
+
+void InotifyBackend::addPath(const QString &path)
+{
+    if (m_fd < 0 || m_descriptors.contains(path)) {
+        return;
+    }
+
+    int wd = inotify_add_watch(m_fd, QFile::encodeName(path).constData(), kInotifyMask);
+    if (wd < 0) {
+        if (errno == ENOSPC) {
+            qWarning() << "inotify watch limit reached, not watching" << path;
+        }
+        return;
+    }
+    m_paths.insert(wd, path);
+    m_descriptors.insert(path, wd);
+}
+
+void InotifyBackend::removePath(const QString &path)
+{
+    int wd = m_descriptors.take(path);
+    if (wd > 0) {
+        inotify_rm_watch(m_fd, wd);
+        m_paths.remove(wd);
+    }
+}
+
+void InotifyBackend::readEvents()
+{
+    QVector<WorkspaceEvent> events;
+    QHash<quint32, int> moves;  // Cookie -> index of the IN_MOVED_FROM event
+
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    for (;;) {
+        ssize_t length = ::read(m_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+
+        for (char *p = buffer; p < buffer + length;) {
+            const auto *raw = reinterpret_cast<const struct inotify_event *>(p);
+            p += sizeof(struct inotify_event) + raw->len;
+
+            if (raw->mask & IN_Q_OVERFLOW) {
+                WorkspaceEvent event;
+                event.type = WorkspaceEvent::Rescan;
+                events.append(event);
+                continue;
+            }
+
+            QString directory = m_paths.value(raw->wd);
+            if (directory.isEmpty()) {
+                continue;
+            }
+
+            if (raw->mask & IN_IGNORED) {
+                // Watches removed through removePath() are already forgotten
+                m_paths.remove(raw->wd);
+                m_descriptors.remove(directory);
+                emit watchLost(directory);
+                continue;
+            }
+
+            WorkspaceEvent event;
+            event.isDirectory = raw->mask & IN_ISDIR;
+            event.path = raw->len > 0 ? directory + "/" + QFile::decodeName(raw->name)
+                                      : directory;
+
+            if (raw->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                event.type = WorkspaceEvent::Removed;
+                event.isDirectory = true;
+            } else if (raw->mask & IN_CREATE) {
+                event.type = WorkspaceEvent::Created;
+            } else if (raw->mask & IN_DELETE) {
+                event.type = WorkspaceEvent::Removed;
+            } else if (raw->mask & IN_MOVED_FROM) {
+                // Stays a removal unless the matching IN_MOVED_TO follows
+                event.type = WorkspaceEvent::Removed;
+                moves.insert(raw->cookie, events.size());
+            } else if (raw->mask & IN_MOVED_TO) {
+                auto from = moves.constFind(raw->cookie);
+                if (from != moves.constEnd()) {
+                    WorkspaceEvent &moved = events[*from];
+                    moved.type = WorkspaceEvent::Moved;
+                    moved.oldPath = moved.path;
+                    moved.path = event.path;
+                    moves.erase(from);
+                    continue;
+                }
+                event.type = WorkspaceEvent::Created;
+            } else {
+                event.type = WorkspaceEvent::Modified;
+            }
+            events.append(event);
+        }
+    }
+
+    if (!events.isEmpty()) {
+        emit eventsAvailable(events);
+    }
+}
+#endif
+
+PollingBackend::PollingBackend(QObject *parent)
+    : WatcherBackend(parent)
+    , m_watcher(nullptr)
+{
+}
+
+void PollingBackend::start()
+{
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this,
+            &PollingBackend::onDirectoryChanged);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &PollingBackend::onFileChanged);
+}
+
+void PollingBackend::addPath(const QString &path)
+{
+    QFileInfo info(path);
+    if (info.isDir()) {
+        m_listings.insert(path, list(path));
+    }
+    m_watcher->addPath(path);
+}
+
+void PollingBackend::removePath(const QString &path)
+{
+    m_listings.remove(path);
+    m_watcher->removePath(path);
+}
+
+QHash<QString, PollingBackend::Entry> PollingBackend::list(const QString &directory) const
+{
+    QHash<QString, Entry> entries;
+    const QFileInfoList infos = QDir(directory).entryInfoList(
+        QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden);
+    for (const QFileInfo &info : infos) {
+        entries.insert(info.fileName(), {info.size(), info.lastModified(), info.isDir()});
+    }
+    return entries;
+}
+
+void PollingBackend::onDirectoryChanged(const QString &directory)
+{
+    auto it = m_listings.find(directory);
+    if (it == m_listings.end()) {
+        return;
+    }
+
+    QVector<WorkspaceEvent> events;
+    QHash<QString, Entry> current = list(directory);
+
+    for (auto entry = current.cbegin(); entry != current.cend(); ++entry) {
+        auto previous = it->constFind(entry.key());
+        WorkspaceEvent event;
+        event.path = directory + "/" + entry.key();
+        event.isDirectory = entry->isDirectory;
+        if (previous == it->constEnd()) {
+            event.type = WorkspaceEvent::Created;
+        } else if (previous->size != entry->size
+                   || previous->lastModified != entry->lastModified) {
+            event.type = WorkspaceEvent::Modified;
+        } else {
+            continue;
+        }
+        events.append(event);
+    }
+
+    for (auto entry = it->cbegin(); entry != it->cend(); ++entry) {
+        if (!current.contains(entry.key())) {
+            WorkspaceEvent event;
+            event.type = WorkspaceEvent::Removed;
+            event.path = directory + "/" + entry.key();
+            event.isDirectory = entry->isDirectory;
+            events.append(event);
+        }
+    }
+
+    *it = current;
+    if (!events.isEmpty()) {
+        emit eventsAvailable(events);
+    }
+}
+
+void PollingBackend::onFileChanged(const QString &path)
+{
+    WorkspaceEvent event;
+    event.path = path;
+    if (QFileInfo::exists(path)) {
+        event.type = WorkspaceEvent::Modified;
+        // Rename-over saves drop the watch
+        if (!m_watcher->files().contains(path)) {
+            m_watcher->addPath(path);
+        }
+    } else {
+        event.type = WorkspaceEvent::Removed;
+    }
+    emit eventsAvailable({event});
+}
+
+ReplayBackend::ReplayBackend(QObject *parent)
+    : WatcherBackend(parent)
+    , m_realtime(true)
+    , m_next(0)
+{
+}
+
+bool ReplayBackend::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not load event stream:" << file.errorString();
+        return false;
+    }
+
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        qint64 elapsedMs = 0;
+        WorkspaceEvent event = WorkspaceEvent::fromJson(line, &elapsedMs);
+        m_events.append({elapsedMs, event});
+    }
+    return true;
+}
+
+void ReplayBackend::append(const WorkspaceEvent &event, qint64 elapsedMs)
+{
+    m_events.append({elapsedMs, event});
+}
+
+void ReplayBackend::replay()
+{
+    QMetaObject::invokeMethod(this, [this]() {
+        m_next = 0;
+        m_clock.start();
+        emitDue();
+    });
+}
+
+void ReplayBackend::dropWatch(const QString &path)
+{
+    QMetaObject::invokeMethod(this, [this, path]() {
+        if (m_watched.remove(path)) {
+            emit watchLost(path);
+        }
+    });
+}
+
+void ReplayBackend::addPath(const QString &path)
+{
+    m_watched.insert(path);
+}
+
+void ReplayBackend::removePath(const QString &path)
+{
+    m_watched.remove(path);
+}
+
+void ReplayBackend::emitDue()
+{
+    // Everything recorded up to now goes out as one raw batch, like a read
+    // from the kernel would
+    QVector<WorkspaceEvent> events;
+    while (m_next < m_events.size()
+           && (!m_realtime || m_events[m_next].first <= m_clock.elapsed())) {
+        events.append(m_events[m_next].second);
+        m_next++;
+    }
+    if (!events.isEmpty()) {
+        emit eventsAvailable(events);
+    }
+
+    if (m_next < m_events.size()) {
+        qint64 delay = m_events[m_next].first - m_clock.elapsed();
+        QTimer::singleShot(qMax<qint64>(0, delay), this, &ReplayBackend::emitDue);
+    } else {
+        emit replayFinished();
+    }
+}
@@ -0,0 +1,111 @@
+// WatcherBackends.h
+#ifndef WATCHERBACKENDS_H
+#define WATCHERBACKENDS_H
+
+#include <QHash>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFileSystemWatcher>
+#include <QSet>
+
+#include "WorkspaceWatcher.h"
+
+class QSocketNotifier;
+
+#ifdef Q_OS_LINUX
+// One inotify instance for every watched directory. Each directory costs a
+// single kernel watch and reports changes to the files inside it as well.
+class InotifyBackend : public WatcherBackend
+{
+    Q_OBJECT
+
+public:
+    explicit InotifyBackend(QObject *parent = nullptr);
+    ~InotifyBackend() override;
+
+    void start() override;
+    void addPath(const QString &path) override;
+    void removePath(const QString &path) override;
+    bool reportsFileChanges() const override { return true; }
+
+private:
+    int m_fd;
+    QSocketNotifier *m_notifier;
+    QHash<int, QString> m_paths;        // Watch descriptor -> directory
+    QHash<QString, int> m_descriptors;  // Directory -> watch descriptor
+
+    void readEvents();
+};
+#endif
+
+// Portable fallback on QFileSystemWatcher. Directory changes are turned into
+// events by diffing listings; files are watched individually.
+class PollingBackend : public WatcherBackend
+{
+    Q_OBJECT
+
+public:
+    explicit PollingBackend(QObject *parent = nullptr);
+
+    void start() override;
+    void addPath(const QString &path) override;
+    void removePath(const QString &path) override;
+
+private:
+    struct Entry {
+        qint64 size;
+        QDateTime lastModified;
+        bool isDirectory;
+    };
+
+    QFileSystemWatcher *m_watcher;
+    QHash<QString, QHash<QString, Entry>> m_listings;  // Directory -> name -> entry
+
+    QHash<QString, Entry> list(const QString &directory) const;
+    void onDirectoryChanged(const QString &directory);
+    void onFileChanged(const QString &path);
+};
+
+// Replays an event stream recorded with WorkspaceWatcher::startRecording(),
+// or events appended by hand, so consumers can be exercised without a real
+// file system.
+class ReplayBackend : public WatcherBackend
+{
+    Q_OBJECT
+
+public:
+    explicit ReplayBackend(QObject *parent = nullptr);
+
+    bool load(const QString &fileName);
+    void append(const WorkspaceEvent &event, qint64 elapsedMs = 0);
+
+    // Events keep their recorded spacing unless realtime is off, in which
+    // case they are delivered in one go
+    void setRealtime(bool realtime) { m_realtime = realtime; }
+
+    // Safe to call from any thread
+    void replay();
+    // Forget the watch on path as the system does when it is deleted; safe
+    // to call from any thread
+    void dropWatch(const QString &path);
+
+    void addPath(const QString &path) override;
+    void removePath(const QString &path) override;
+    bool reportsFileChanges() const override { return true; }
+
+    QSet<QString> watchedPaths() const { return m_watched; }
+
+signals:
+    void replayFinished();
+
+private:
+    QVector<QPair<qint64, WorkspaceEvent>> m_events;
+    QSet<QString> m_watched;
+    bool m_realtime;
+    int m_next;
+    QElapsedTimer m_clock;
+
+    void emitDue();
+};
+
+#endif // WATCHERBACKENDS_H
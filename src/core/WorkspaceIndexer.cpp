@@ -0,0 +1,604 @@
+// WorkspaceIndexer.cpp
+#include "WorkspaceIndexer.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+#include <atomic>
+
+namespace {
+constexpr quint32 kIndexMagic = 0x4d445749;  // "MDWI"
+constexpr quint16 kFormatVersion = 1;
+constexpr auto kStreamVersion = QDataStream::Qt_6_0;
+constexpr qint64 kMinEntrySize = sizeof(quint32) + 2 * sizeof(qint64);
+constexpr int kSaveDelayMs = 2000;
+// Kernel watches are a per-user resource; past this many directories,
+// changes deeper down wait for the next rescan
+constexpr int kMaxDirectoryWatches = 8192;
+
+bool isUnder(const QString &path, const QStringList &directories)
+{
+    for (const QString &directory : directories) {
+        if (path.startsWith(directory) && path.size() > directory.size()
+            && path.at(directory.size()) == '/') {
+            return true;
+        }
+    }
+    return false;
+}
+}
+
+// State of one walk, shared by its directory tasks
+struct WorkspaceIndexer::Walk {
+    WorkspaceIndexer *indexer = nullptr;
+    QThreadPool *pool = nullptr;
+    QStringList scope;            // Directories the walk started from
+    bool full = false;
+    std::atomic<int> pending{0};  // Directories queued or being listed
+    std::atomic<bool> cancelled{false};
+    QElapsedTimer timer;
+
+    QMutex mutex;
+    QHash<QString, FileEntry> files;
+    QStringList directories;      // Every directory listed
+};
+
+WorkspaceIndexer::WorkspaceIndexer(FileIoService *io, WorkspaceWatcher *workspace,
+                                   QObject *parent)
+    : QObject(parent)
+    , m_io(io)
+    , m_workspace(workspace)
+    , m_excludePatterns(defaultExcludePatterns())
+    , m_scanned(false)
+{
+    QDir().mkpath(QFileInfo(indexPath()).absolutePath());
+
+    // Walking competes with the GUI for the disk, not for the CPU
+    m_pool.setThreadPriority(QThread::LowPriority);
+
+    m_saveTimer = new QTimer(this);
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(kSaveDelayMs);
+    connect(m_saveTimer, &QTimer::timeout, this, &WorkspaceIndexer::save);
+}
+
+WorkspaceIndexer::~WorkspaceIndexer()
+{
+    for (const QString &directory : std::as_const(m_watchedDirectories)) {
+        m_workspace->unwatchDirectory(directory);
+    }
+
+    if (m_fullWalk) {
+        m_fullWalk->cancelled = true;
+    }
+    for (const auto &walk : std::as_const(m_subtreeWalks)) {
+        walk->cancelled = true;
+    }
+    m_pool.clear();
+    m_pool.waitForDone();
+
+    if (m_saveTimer->isActive()) {
+        save();
+    }
+}
+
+void WorkspaceIndexer::setRoots(const QStringList &roots)
+{
+    QStringList cleaned;
+    for (const QString &root : roots) {
+        QString path = QDir::cleanPath(QFileInfo(root).absoluteFilePath());
+        if (!cleaned.contains(path)) {
+            cleaned.append(path);
+        }
+    }
+    if (cleaned == m_roots) {
+        return;
+    }
+    m_roots = cleaned;
+    m_ignoreRules.clear();
+    subscribe();
+}
+
+void WorkspaceIndexer::setExcludePatterns(const QStringList &patterns)
+{
+    m_excludePatterns = patterns;
+    m_ignoreRules.clear();
+}
+
+QStringList WorkspaceIndexer::defaultExcludePatterns()
+{
+    return {".git/", ".hg/", ".svn/", "node_modules/", ".cache/", "__pycache__/"};
+}
+
+void WorkspaceIndexer::start()
+{
+    QtConcurrent::run(&WorkspaceIndexer::read, indexPath(), m_roots, m_excludePatterns)
+        .then(this, [this](const QHash<QString, FileEntry> &saved) {
+            // A walk that already finished is newer than the saved index
+            if (m_files.isEmpty() && !saved.isEmpty()) {
+                m_files = saved;
+                emit filesAdded(m_files.keys());
+                emit indexChanged();
+            }
+            rescan();
+        });
+}
+
+void WorkspaceIndexer::rescan()
+{
+    m_ignoreRules.clear();
+    walk(m_roots, true);
+}
+
+QVector<WorkspaceIndexer::FileEntry> WorkspaceIndexer::files() const
+{
+    QVector<FileEntry> entries;
+    entries.reserve(m_files.size());
+    for (const FileEntry &entry : m_files) {
+        entries.append(entry);
+    }
+    std::sort(entries.begin(), entries.end(), [](const FileEntry &a, const FileEntry &b) {
+        return a.path < b.path;
+    });
+    return entries;
+}
+
+QStringList WorkspaceIndexer::paths() const
+{
+    QStringList paths = m_files.keys();
+    paths.sort();
+    return paths;
+}
+
+bool WorkspaceIndexer::isExcluded(const QString &path, bool isDirectory) const
+{
+    QString root = rootOf(path);
+    if (root.isEmpty()) {
+        return true;
+    }
+
+    // Every directory on the way down can be excluded, and each one may
+    // bring a .gitignore for the levels below
+    QStringList parts = path.mid(root.size() + 1).split('/', Qt::SkipEmptyParts);
+    QString current = root;
+    for (qsizetype i = 0; i < parts.size(); ++i) {
+        IgnoreRules rules = rulesIn(root, current);
+        current += '/' + parts.at(i);
+        bool last = i == parts.size() - 1;
+        if (rules.isIgnored(current, last ? isDirectory : true)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WorkspaceIndexer::isMarkdownFile(const QString &path)
+{
+    return path.endsWith(".md", Qt::CaseInsensitive)
+           || path.endsWith(".markdown", Qt::CaseInsensitive);
+}
+
+void WorkspaceIndexer::subscribe()
+{
+    for (int id : std::as_const(m_subscriptions)) {
+        m_workspace->unsubscribe(id);
+    }
+    m_subscriptions.clear();
+
+    for (const QString &root : std::as_const(m_roots)) {
+        m_subscriptions.append(m_workspace->subscribe(
+            root, this, [this](const QVector<WorkspaceEvent> &events) {
+                onWorkspaceEvents(events);
+            }));
+    }
+}
+
+void WorkspaceIndexer::walk(const QStringList &directories, bool full)
+{
+    bool wasScanning = isScanning();
+
+    auto state = std::make_shared<Walk>();
+    state->indexer = this;
+    state->pool = &m_pool;
+    state->scope = directories;
+    state->full = full;
+    state->timer.start();
+
+    if (full) {
+        // Supersedes everything still running
+        if (m_fullWalk) {
+            m_fullWalk->cancelled = true;
+        }
+        for (const auto &walk : std::as_const(m_subtreeWalks)) {
+            walk->cancelled = true;
+        }
+        m_subtreeWalks.clear();
+        m_fullWalk = state;
+    } else {
+        m_subtreeWalks.append(state);
+    }
+
+    state->pending = directories.size();
+    for (const QString &directory : directories) {
+        IgnoreRules rules = rulesAbove(rootOf(directory), directory);
+        m_pool.start([state, directory, rules]() {
+            walkDirectory(state, directory, rules);
+        });
+    }
+    if (directories.isEmpty()) {
+        finishWalk(state);
+    }
+
+    if (!wasScanning) {
+        emit scanningChanged();
+    }
+}
+
+void WorkspaceIndexer::walkDirectory(const std::shared_ptr<Walk> &walk,
+                                     const QString &directory, const IgnoreRules &parentRules)
+{
+    if (!walk->cancelled) {
+        IgnoreRules rules = parentRules;
+        rules.addGitIgnore(directory);
+
+        QHash<QString, FileEntry> found;
+        QDirIterator it(directory, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot | QDir::Hidden);
+        while (it.hasNext() && !walk->cancelled) {
+            it.next();
+            QFileInfo info = it.fileInfo();
+            QString path = info.filePath();
+
+            if (info.isDir()) {
+                // Symlinked directories could lead back up the tree
+                if (info.isSymLink() || rules.isIgnored(path, true)) {
+                    continue;
+                }
+                walk->pending.fetch_add(1);
+                walk->pool->start([walk, path, rules]() {
+                    walkDirectory(walk, path, rules);
+                });
+            } else if (isMarkdownFile(path) && !rules.isIgnored(path, false)) {
+                found.insert(path, {path, info.size(), info.lastModified().toMSecsSinceEpoch()});
+            }
+        }
+
+        QMutexLocker locker(&walk->mutex);
+        walk->files.insert(found);
+        walk->directories.append(directory);
+    }
+
+    // The last directory finishes the walk
+    if (walk->pending.fetch_sub(1) == 1) {
+        QMetaObject::invokeMethod(walk->indexer, [walk]() {
+            walk->indexer->finishWalk(walk);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void WorkspaceIndexer::finishWalk(const std::shared_ptr<Walk> &walk)
+{
+    if (walk->cancelled) {
+        return;
+    }
+    if (walk == m_fullWalk) {
+        m_fullWalk.reset();
+    } else if (!m_subtreeWalks.removeOne(walk)) {
+        return;
+    }
+
+    applyChanges(walk->files, walk->scope);
+    updateWatches(walk->directories, walk->scope);
+
+    if (walk->full) {
+        m_scanned = true;
+        emit scanFinished(m_files.size(), walk->timer.elapsed());
+        save();
+    }
+    if (!isScanning()) {
+        emit scanningChanged();
+    }
+}
+
+void WorkspaceIndexer::applyChanges(const QHash<QString, FileEntry> &scanned,
+                                    const QStringList &scope)
+{
+    QStringList added;
+    QStringList removed;
+    QStringList changed;
+
+    for (auto it = m_files.begin(); it != m_files.end();) {
+        if (isUnder(it.key(), scope) && !scanned.contains(it.key())) {
+            removed.append(it.key());
+            it = m_files.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (const FileEntry &entry : scanned) {
+        auto it = m_files.find(entry.path);
+        if (it == m_files.end()) {
+            m_files.insert(entry.path, entry);
+            added.append(entry.path);
+        } else if (it->size != entry.size || it->lastModified != entry.lastModified) {
+            *it = entry;
+            changed.append(entry.path);
+        }
+    }
+
+    if (added.isEmpty() && removed.isEmpty() && changed.isEmpty()) {
+        return;
+    }
+    if (!removed.isEmpty()) {
+        emit filesRemoved(removed);
+    }
+    if (!added.isEmpty()) {
+        emit filesAdded(added);
+    }
+    if (!changed.isEmpty()) {
+        emit filesChanged(changed);
+    }
+    emit indexChanged();
+    m_saveTimer->start();
+}
+
+void WorkspaceIndexer::updateWatches(const QStringList &directories, const QStringList &scope)
+{
+    // Watches are not recursive, so every directory walked gets one and
+    // those that have gone from the walked scope are dropped
+    QSet<QString> listed(directories.cbegin(), directories.cend());
+    unwatchDirectories([&](const QString &directory) {
+        return (scope.contains(directory) || isUnder(directory, scope))
+               && !listed.contains(directory);
+    });
+
+    for (const QString &directory : directories) {
+        if (m_watchedDirectories.size() >= kMaxDirectoryWatches) {
+            break;
+        }
+        if (!m_watchedDirectories.contains(directory)) {
+            m_watchedDirectories.insert(directory);
+            m_workspace->watchDirectory(directory);
+        }
+    }
+}
+
+void WorkspaceIndexer::unwatchDirectories(const std::function<bool(const QString &)> &predicate)
+{
+    for (auto it = m_watchedDirectories.begin(); it != m_watchedDirectories.end();) {
+        if (predicate(*it)) {
+            m_workspace->unwatchDirectory(*it);
+            it = m_watchedDirectories.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void WorkspaceIndexer::onWorkspaceEvents(const QVector<WorkspaceEvent> &events)
+{
+    QStringList added;
+    QStringList removed;
+    QStringList changed;
+    QStringList walkDirectories;
+
+    auto remove = [&](const QString &path, bool isDirectory) {
+        if (!isDirectory) {
+            if (m_files.remove(path)) {
+                removed.append(path);
+            }
+            return;
+        }
+        for (auto it = m_files.begin(); it != m_files.end();) {
+            if (isUnder(it.key(), {path})) {
+                removed.append(it.key());
+                it = m_files.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        unwatchDirectories([&](const QString &directory) {
+            return directory == path || isUnder(directory, {path});
+        });
+        forgetIgnoreRules(path);
+    };
+
+    auto update = [&](const QString &path, bool isDirectory) {
+        if (isDirectory) {
+            if (!isExcluded(path, true)) {
+                walkDirectories.append(path);
+            }
+            return;
+        }
+        // New ignore rules can hide or reveal a whole subtree
+        if (path.endsWith("/.gitignore")) {
+            forgetIgnoreRules(QFileInfo(path).path());
+            walkDirectories.append(QFileInfo(path).path());
+            return;
+        }
+        if (!isMarkdownFile(path) || isExcluded(path, false)) {
+            return;
+        }
+
+        QFileInfo info(path);
+        if (!info.isFile()) {
+            remove(path, false);
+            return;
+        }
+        FileEntry entry{path, info.size(), info.lastModified().toMSecsSinceEpoch()};
+        auto it = m_files.find(path);
+        if (it == m_files.end()) {
+            m_files.insert(path, entry);
+            added.append(path);
+        } else if (it->size != entry.size || it->lastModified != entry.lastModified) {
+            *it = entry;
+            changed.append(path);
+        }
+    };
+
+    for (const WorkspaceEvent &event : events) {
+        switch (event.type) {
+            case WorkspaceEvent::Created:
+                update(event.path, event.isDirectory);
+                break;
+            case WorkspaceEvent::Modified:
+                // Directory mtimes change with their entries, which have
+                // events of their own
+                if (!event.isDirectory) {
+                    update(event.path, false);
+                }
+                break;
+            case WorkspaceEvent::Removed:
+                if (event.path.endsWith("/.gitignore")) {
+                    update(event.path, false);  // Rules change as for an edit
+                }
+                remove(event.path, event.isDirectory);
+                break;
+            case WorkspaceEvent::Moved:
+                remove(event.oldPath, event.isDirectory);
+                update(event.path, event.isDirectory);
+                break;
+            case WorkspaceEvent::Rescan:
+                rescan();
+                return;
+        }
+    }
+
+    if (!walkDirectories.isEmpty()) {
+        walkDirectories.removeDuplicates();
+        walk(walkDirectories, false);
+    }
+
+    if (added.isEmpty() && removed.isEmpty() && changed.isEmpty()) {
+        return;
+    }
+    if (!removed.isEmpty()) {
+        emit filesRemoved(removed);
+    }
+    if (!added.isEmpty()) {
+        emit filesAdded(added);
+    }
+    if (!changed.isEmpty()) {
+        emit filesChanged(changed);
+    }
+    emit indexChanged();
+    m_saveTimer->start();
+}
+
+QString WorkspaceIndexer::rootOf(const QString &path) const
+{
+    for (const QString &root : m_roots) {
+        if (path == root || isUnder(path, {root})) {
+            return root;
+        }
+    }
+    return QString();
+}
+
+IgnoreRules WorkspaceIndexer::rulesAbove(const QString &root, const QString &directory) const
+{
+    // The exclude patterns and the .gitignore files of the directories
+    // above; directory's own .gitignore is read by the walk
+    if (directory == root) {
+        IgnoreRules rules;
+        rules.addPatterns(root, m_excludePatterns);
+        return rules;
+    }
+    return rulesIn(root, QFileInfo(directory).path());
+}
+
+IgnoreRules WorkspaceIndexer::rulesIn(const QString &root, const QString &directory) const
+{
+    // Each .gitignore is read once, not again for every event below it
+    auto it = m_ignoreRules.constFind(directory);
+    if (it != m_ignoreRules.constEnd()) {
+        return *it;
+    }
+
+    IgnoreRules rules = rulesAbove(root, directory);
+    rules.addGitIgnore(directory);
+    m_ignoreRules.insert(directory, rules);
+    return rules;
+}
+
+void WorkspaceIndexer::forgetIgnoreRules(const QString &directory)
+{
+    for (auto it = m_ignoreRules.begin(); it != m_ignoreRules.end();) {
+        if (it.key() == directory || isUnder(it.key(), {directory})) {
+            it = m_ignoreRules.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void WorkspaceIndexer::save()
+{
+    m_saveTimer->stop();
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(kStreamVersion);
+    out << kIndexMagic << kFormatVersion << m_roots << m_excludePatterns;
+    out << quint32(m_files.size());
+    for (const FileEntry &entry : std::as_const(m_files)) {
+        out << entry.path << entry.size << entry.lastModified;
+    }
+
+    m_io->writeData(indexPath(), data);
+}
+
+QString WorkspaceIndexer::indexPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+           + "/workspace-index.bin";
+}
+
+QHash<QString, WorkspaceIndexer::FileEntry> WorkspaceIndexer::read(
+    const QString &fileName, const QStringList &roots, const QStringList &excludePatterns)
+{
+    QHash<QString, FileEntry> files;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return files;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(kStreamVersion);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    QStringList savedRoots;
+    QStringList savedPatterns;
+    quint32 count = 0;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != kIndexMagic || version != kFormatVersion) {
+        return files;
+    }
+    in >> savedRoots >> savedPatterns >> count;
+    // Indexed under different settings; the walk starts from scratch
+    if (in.status() != QDataStream::Ok || savedRoots != roots
+        || savedPatterns != excludePatterns) {
+        return files;
+    }
+
+    // A damaged count must not size the table; every entry takes at least
+    // an empty string and two integers
+    files.reserve(qMin<qint64>(count, (file.size() - file.pos()) / kMinEntrySize));
+    for (quint32 i = 0; i < count; ++i) {
+        FileEntry entry;
+        in >> entry.path >> entry.size >> entry.lastModified;
+        if (in.status() != QDataStream::Ok) {
+            return {};
+        }
+        files.insert(entry.path, entry);
+    }
+    return files;
+}
@@ -0,0 +1,122 @@
+// WorkspaceIndexer.h
+#ifndef WORKSPACEINDEXER_H
+#define WORKSPACEINDEXER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+#include <memory>
+
+#include "FileIoService.h"
+#include "IgnoreRules.h"
+#include "WorkspaceWatcher.h"
+
+// Index of the markdown files under the workspace roots, with size and
+// mtime. Roots are walked on a thread pool with one task per directory, so
+// idle threads pick up whatever directories are queued and a deep subtree
+// does not hold up the rest. Directories matched by .gitignore files or by
+// the exclude patterns are not entered.
+//
+// The index is saved on disk and loaded by start() before the first walk,
+// so it is usable right away at the next start. Afterwards it follows the
+// workspace watcher: every walked directory is registered with it, since
+// watches don't cover subdirectories, and new directories are walked as
+// they appear.
+class WorkspaceIndexer : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int fileCount READ fileCount NOTIFY indexChanged)
+    Q_PROPERTY(bool scanning READ isScanning NOTIFY scanningChanged)
+
+public:
+    struct FileEntry {
+        QString path;
+        qint64 size = -1;
+        qint64 lastModified = 0;  // Milliseconds since the epoch
+    };
+
+    WorkspaceIndexer(FileIoService *io, WorkspaceWatcher *workspace, QObject *parent = nullptr);
+    ~WorkspaceIndexer() override;
+
+    void setRoots(const QStringList &roots);
+    QStringList roots() const { return m_roots; }
+
+    // Globs in .gitignore syntax applied below every root
+    void setExcludePatterns(const QStringList &patterns);
+    QStringList excludePatterns() const { return m_excludePatterns; }
+    static QStringList defaultExcludePatterns();
+
+    // Loads the saved index, then walks the roots
+    void start();
+    Q_INVOKABLE void rescan();
+
+    int fileCount() const { return m_files.size(); }
+    bool isScanning() const { return m_fullWalk || !m_subtreeWalks.isEmpty(); }
+    // A walk of every root has finished; until then the index may be empty
+    // or only what was saved
+    bool hasScanned() const { return m_scanned; }
+    bool contains(const QString &path) const { return m_files.contains(path); }
+    FileEntry entry(const QString &path) const { return m_files.value(path); }
+    // Sorted by path
+    QVector<FileEntry> files() const;
+    Q_INVOKABLE QStringList paths() const;
+
+    bool isExcluded(const QString &path, bool isDirectory) const;
+    // The root path lies under, or an empty string
+    QString rootOf(const QString &path) const;
+
+    static bool isMarkdownFile(const QString &path);
+
+signals:
+    void indexChanged();
+    void filesAdded(const QStringList &paths);
+    void filesRemoved(const QStringList &paths);
+    void filesChanged(const QStringList &paths);
+    void scanningChanged();
+    void scanFinished(int fileCount, qint64 elapsedMs);
+
+private:
+    struct Walk;
+
+    FileIoService *m_io;
+    WorkspaceWatcher *m_workspace;
+    QThreadPool m_pool;
+    QStringList m_roots;
+    QStringList m_excludePatterns;
+    QHash<QString, FileEntry> m_files;
+    std::shared_ptr<Walk> m_fullWalk;
+    QVector<std::shared_ptr<Walk>> m_subtreeWalks;
+    bool m_scanned;
+    QVector<int> m_subscriptions;
+    QSet<QString> m_watchedDirectories;
+    // Rules for the entries of a directory, .gitignore files included
+    mutable QHash<QString, IgnoreRules> m_ignoreRules;
+    QTimer *m_saveTimer;
+
+    void subscribe();
+    void walk(const QStringList &directories, bool full);
+    void finishWalk(const std::shared_ptr<Walk> &walk);
+    void applyChanges(const QHash<QString, FileEntry> &scanned, const QStringList &scope);
+    void updateWatches(const QStringList &directories, const QStringList &scope);
+    void unwatchDirectories(const std::function<bool(const QString &)> &predicate);
+    void onWorkspaceEvents(const QVector<WorkspaceEvent> &events);
+    IgnoreRules rulesAbove(const QString &root, const QString &directory) const;
+    IgnoreRules rulesIn(const QString &root, const QString &directory) const;
+    void forgetIgnoreRules(const QString &directory);
+    void save();
+
+    static void walkDirectory(const std::shared_ptr<Walk> &walk, const QString &directory,
+                              const IgnoreRules &rules);
+    static QString indexPath();
+    static QHash<QString, FileEntry> read(const QString &fileName, const QStringList &roots,
+                                          const QStringList &excludePatterns);
+};
+
+#endif // WORKSPACEINDEXER_H
@@ -0,0 +1,387 @@
+// WorkspaceWatcher.cpp
+#include "WorkspaceWatcher.h"
+#include "WatcherBackends.h"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+namespace {
+const char *const kTypeNames[] = {"created", "modified", "removed", "moved", "rescan"};
+
+// Upper bound on pending events before a batch is delivered early
+constexpr int kMaxPendingEvents = 4096;
+}
+
+QByteArray WorkspaceEvent::toJson(qint64 elapsedMs) const
+{
+    QJsonObject object;
+    object["t"] = elapsedMs;
+    object["type"] = QString::fromLatin1(kTypeNames[type]);
+    object["path"] = path;
+    if (!oldPath.isEmpty()) {
+        object["oldPath"] = oldPath;
+    }
+    if (isDirectory) {
+        object["dir"] = true;
+    }
+    return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
+
+WorkspaceEvent WorkspaceEvent::fromJson(const QByteArray &line, qint64 *elapsedMs)
+{
+    QJsonObject object = QJsonDocument::fromJson(line).object();
+
+    WorkspaceEvent event;
+    QString typeName = object["type"].toString();
+    for (int type = Created; type <= Rescan; ++type) {
+        if (typeName == QLatin1String(kTypeNames[type])) {
+            event.type = Type(type);
+        }
+    }
+    event.path = object["path"].toString();
+    event.oldPath = object["oldPath"].toString();
+    event.isDirectory = object["dir"].toBool();
+    if (elapsedMs) {
+        *elapsedMs = object["t"].toInteger();
+    }
+    return event;
+}
+
+WorkspaceWatcher::WorkspaceWatcher(QObject *parent)
+    : QObject(parent)
+{
+#ifdef Q_OS_LINUX
+    init(new InotifyBackend);
+#else
+    init(new PollingBackend);
+#endif
+}
+
+WorkspaceWatcher::WorkspaceWatcher(WatcherBackend *backend, QObject *parent)
+    : QObject(parent)
+{
+    init(backend);
+}
+
+WorkspaceWatcher::~WorkspaceWatcher()
+{
+    stopRecording();
+    m_thread->quit();
+    m_thread->wait();
+}
+
+void WorkspaceWatcher::init(WatcherBackend *backend)
+{
+    qRegisterMetaType<WorkspaceEvent>();
+    qRegisterMetaType<QVector<WorkspaceEvent>>();
+
+    m_nextSubscriptionId = 1;
+    m_recording = nullptr;
+    m_recordingStart = 0;
+    m_receivedEvents = 0;
+    m_deliveredEvents = 0;
+
+    // Batches go out a fixed time after the first event, so a steady stream
+    // of changes is still delivered regularly
+    m_batchTimer = new QTimer(this);
+    m_batchTimer->setSingleShot(true);
+    m_batchTimer->setInterval(100);
+    connect(m_batchTimer, &QTimer::timeout, this, &WorkspaceWatcher::flush);
+
+    // The backend blocks on the kernel and parses events on its own thread
+    m_thread = new QThread(this);
+    m_thread->setObjectName("WorkspaceWatcher");
+    m_backend = backend;
+    m_backend->moveToThread(m_thread);
+    connect(m_thread, &QThread::finished, m_backend, &QObject::deleteLater);
+    connect(m_backend, &WatcherBackend::eventsAvailable, this,
+            &WorkspaceWatcher::onEventsAvailable, Qt::QueuedConnection);
+    connect(m_backend, &WatcherBackend::watchLost, this, [this](const QString &path) {
+        // Holders keep their references; the watch is set up again when the
+        // path comes back or is watched anew
+        if (m_watches.contains(path)) {
+            m_lostWatches.insert(path);
+        }
+    }, Qt::QueuedConnection);
+    m_thread->start();
+
+    WatcherBackend *target = m_backend;
+    QMetaObject::invokeMethod(target, [target]() { target->start(); });
+}
+
+void WorkspaceWatcher::watchDirectory(const QString &path)
+{
+    addWatch(QFileInfo(path).absoluteFilePath());
+}
+
+void WorkspaceWatcher::unwatchDirectory(const QString &path)
+{
+    removeWatch(QFileInfo(path).absoluteFilePath());
+}
+
+void WorkspaceWatcher::watchFile(const QString &path)
+{
+    QFileInfo info(path);
+    addWatch(info.absolutePath());
+    if (!m_backend->reportsFileChanges()) {
+        addWatch(info.absoluteFilePath());
+    }
+}
+
+void WorkspaceWatcher::unwatchFile(const QString &path)
+{
+    QFileInfo info(path);
+    removeWatch(info.absolutePath());
+    if (!m_backend->reportsFileChanges()) {
+        removeWatch(info.absoluteFilePath());
+    }
+}
+
+int WorkspaceWatcher::subscribe(const QString &pathPrefix, QObject *context, Callback callback)
+{
+    int id = m_nextSubscriptionId++;
+
+    Subscription subscription;
+    subscription.prefix = pathPrefix.isEmpty() ? QString()
+                                               : QFileInfo(pathPrefix).absoluteFilePath();
+    subscription.context = context;
+    subscription.callback = std::move(callback);
+    m_subscriptions.insert(id, subscription);
+
+    if (context) {
+        connect(context, &QObject::destroyed, this, [this, id]() {
+            unsubscribe(id);
+        });
+    }
+    return id;
+}
+
+void WorkspaceWatcher::unsubscribe(int subscriptionId)
+{
+    m_subscriptions.remove(subscriptionId);
+}
+
+void WorkspaceWatcher::setBatchInterval(int msecs)
+{
+    m_batchTimer->setInterval(msecs);
+}
+
+bool WorkspaceWatcher::startRecording(const QString &fileName)
+{
+    stopRecording();
+
+    m_recording = new QFile(fileName, this);
+    if (!m_recording->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Could not record workspace events:" << m_recording->errorString();
+        delete m_recording;
+        m_recording = nullptr;
+        return false;
+    }
+    m_recordingStart = QDateTime::currentMSecsSinceEpoch();
+    return true;
+}
+
+void WorkspaceWatcher::stopRecording()
+{
+    delete m_recording;
+    m_recording = nullptr;
+}
+
+void WorkspaceWatcher::addWatch(const QString &path)
+{
+    if (m_watches[path]++ > 0 && !m_lostWatches.remove(path)) {
+        return;
+    }
+
+    WatcherBackend *target = m_backend;
+    QMetaObject::invokeMethod(target, [target, path]() { target->addPath(path); });
+}
+
+void WorkspaceWatcher::removeWatch(const QString &path)
+{
+    auto it = m_watches.find(path);
+    if (it == m_watches.end() || --it.value() > 0) {
+        return;
+    }
+    m_watches.erase(it);
+    m_lostWatches.remove(path);
+
+    WatcherBackend *target = m_backend;
+    QMetaObject::invokeMethod(target, [target, path]() { target->removePath(path); });
+}
+
+void WorkspaceWatcher::rearmWatch(const QString &path)
+{
+    if (!m_lostWatches.remove(path)) {
+        return;
+    }
+    WatcherBackend *target = m_backend;
+    QMetaObject::invokeMethod(target, [target, path]() { target->addPath(path); });
+}
+
+void WorkspaceWatcher::onEventsAvailable(const QVector<WorkspaceEvent> &events)
+{
+    if (m_recording) {
+        record(events);
+    }
+
+    m_receivedEvents += events.size();
+    for (const WorkspaceEvent &event : events) {
+        if (event.type == WorkspaceEvent::Created || event.type == WorkspaceEvent::Moved) {
+            rearmWatch(event.path);
+        }
+        coalesce(event);
+    }
+
+    if (m_pending.size() >= kMaxPendingEvents) {
+        flush();
+    } else if (!m_batchTimer->isActive()) {
+        m_batchTimer->start();
+    }
+}
+
+void WorkspaceWatcher::coalesce(const WorkspaceEvent &event)
+{
+    auto append = [this](const WorkspaceEvent &e) {
+        m_pendingIndex.insert(e.path, m_pending.size());
+        m_pending.append(e);
+    };
+    // Dropped entries keep their slot with an empty path until the flush
+    auto drop = [this](const QString &path) {
+        int index = m_pendingIndex.take(path);
+        m_pending[index].path.clear();
+    };
+
+    if (event.type == WorkspaceEvent::Rescan) {
+        m_pending.append(event);
+        return;
+    }
+
+    if (event.type == WorkspaceEvent::Moved) {
+        WorkspaceEvent moved = event;
+        auto from = m_pendingIndex.constFind(event.oldPath);
+        if (from != m_pendingIndex.constEnd()) {
+            // Created and renamed within one batch is just a creation, and
+            // a chain of renames starts from the first name
+            const WorkspaceEvent &source = m_pending[*from];
+            if (source.type == WorkspaceEvent::Created) {
+                moved.type = WorkspaceEvent::Created;
+                moved.oldPath.clear();
+            } else if (source.type == WorkspaceEvent::Moved) {
+                moved.oldPath = source.oldPath;
+            }
+            drop(event.oldPath);
+            if (moved.oldPath == moved.path) {
+                moved.type = WorkspaceEvent::Modified;  // Renamed back
+                moved.oldPath.clear();
+            }
+        }
+        if (m_pendingIndex.contains(moved.path)) {
+            drop(moved.path);
+        }
+        append(moved);
+        return;
+    }
+
+    auto it = m_pendingIndex.constFind(event.path);
+    if (it == m_pendingIndex.constEnd()) {
+        append(event);
+        return;
+    }
+
+    WorkspaceEvent &pending = m_pending[*it];
+    switch (event.type) {
+        case WorkspaceEvent::Created:
+            // Deleted and recreated, as in a rename-over save
+            if (pending.type == WorkspaceEvent::Removed) {
+                pending.type = WorkspaceEvent::Modified;
+            }
+            break;
+        case WorkspaceEvent::Modified:
+            // Already covered by Created, Modified or Moved
+            break;
+        case WorkspaceEvent::Removed:
+            if (pending.type == WorkspaceEvent::Created) {
+                drop(event.path);
+            } else if (pending.type == WorkspaceEvent::Moved) {
+                // Renamed away and then deleted: the old path is gone
+                WorkspaceEvent removed = event;
+                removed.path = pending.oldPath;
+                drop(event.path);
+                if (!m_pendingIndex.contains(removed.path)) {
+                    append(removed);
+                }
+            } else {
+                pending.type = WorkspaceEvent::Removed;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void WorkspaceWatcher::flush()
+{
+    m_batchTimer->stop();
+
+    QVector<WorkspaceEvent> batch;
+    batch.reserve(m_pending.size());
+    for (const WorkspaceEvent &event : std::as_const(m_pending)) {
+        if (!event.path.isEmpty() || event.type == WorkspaceEvent::Rescan) {
+            batch.append(event);
+        }
+    }
+    m_pending.clear();
+    m_pendingIndex.clear();
+
+    if (batch.isEmpty()) {
+        return;
+    }
+
+    // Subscribers may unsubscribe from their callback
+    const QList<int> ids = m_subscriptions.keys();
+    for (int id : ids) {
+        auto it = m_subscriptions.constFind(id);
+        if (it == m_subscriptions.constEnd()) {
+            continue;
+        }
+
+        QVector<WorkspaceEvent> events;
+        for (const WorkspaceEvent &event : std::as_const(batch)) {
+            if (event.type == WorkspaceEvent::Rescan || matches(it->prefix, event.path)
+                || (!event.oldPath.isEmpty() && matches(it->prefix, event.oldPath))) {
+                events.append(event);
+            }
+        }
+
+        if (!events.isEmpty()) {
+            m_deliveredEvents += events.size();
+            Callback callback = it->callback;
+            callback(events);
+        }
+    }
+}
+
+void WorkspaceWatcher::record(const QVector<WorkspaceEvent> &events)
+{
+    qint64 elapsed = QDateTime::currentMSecsSinceEpoch() - m_recordingStart;
+    for (const WorkspaceEvent &event : events) {
+        m_recording->write(event.toJson(elapsed));
+        m_recording->write("\n");
+    }
+    m_recording->flush();
+}
+
+bool WorkspaceWatcher::matches(const QString &prefix, const QString &path)
+{
+    if (prefix.isEmpty() || path == prefix) {
+        return true;
+    }
+    if (!path.startsWith(prefix)) {
+        return false;
+    }
+    return prefix.endsWith(QLatin1Char('/')) || path.at(prefix.length()) == QLatin1Char('/');
+}
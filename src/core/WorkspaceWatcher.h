@@ -0,0 +1,136 @@
+// WorkspaceWatcher.h
+#ifndef WORKSPACEWATCHER_H
+#define WORKSPACEWATCHER_H
+
+#include <QObject>
+#include <QHash>
+#include <QMetaType>
+#include <QPointer>
+#include <QSet>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+
+class QFile;
+
+struct WorkspaceEvent {
+    enum Type {
+        Created,
+        Modified,
+        Removed,
+        Moved,   // oldPath was renamed to path
+        Rescan   // Events were lost; listeners should re-read what they show
+    };
+
+    Type type = Modified;
+    QString path;
+    QString oldPath;
+    bool isDirectory = false;
+
+    // Line format of recorded event streams
+    QByteArray toJson(qint64 elapsedMs) const;
+    static WorkspaceEvent fromJson(const QByteArray &line, qint64 *elapsedMs);
+};
+Q_DECLARE_METATYPE(WorkspaceEvent)
+
+// Source of raw file system events. Lives on the watcher thread; all calls
+// are made there.
+class WatcherBackend : public QObject
+{
+    Q_OBJECT
+
+public:
+    using QObject::QObject;
+
+    virtual void start() {}
+    virtual void addPath(const QString &path) = 0;
+    virtual void removePath(const QString &path) = 0;
+
+    // True if a directory watch also reports changes to the files in it
+    virtual bool reportsFileChanges() const { return false; }
+
+signals:
+    void eventsAvailable(const QVector<WorkspaceEvent> &events);
+    // The system dropped the watch on path, e.g. because it was deleted
+    void watchLost(const QString &path);
+};
+
+// One watcher for the whole workspace. Directories are watched only while
+// something is interested in them (a directory walked by the workspace
+// indexer, one listed in the explorer, the folder of an open document), so
+// trees outside the workspace don't use up inotify watches.
+//
+// Raw events are coalesced per path and delivered in batches to subscribers,
+// each of which sees only the events under its path prefix. Watches are not
+// recursive: a subscriber only hears about directories someone watches.
+class WorkspaceWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Callback = std::function<void(const QVector<WorkspaceEvent> &events)>;
+
+    // Uses inotify on Linux and QFileSystemWatcher elsewhere
+    explicit WorkspaceWatcher(QObject *parent = nullptr);
+    // Takes ownership of backend, e.g. a ReplayBackend
+    explicit WorkspaceWatcher(WatcherBackend *backend, QObject *parent = nullptr);
+    ~WorkspaceWatcher() override;
+
+    // Reference counted; a file watch is served by its directory if the
+    // backend allows it
+    void watchDirectory(const QString &path);
+    void unwatchDirectory(const QString &path);
+    void watchFile(const QString &path);
+    void unwatchFile(const QString &path);
+    int watchCount() const { return m_watches.size(); }
+
+    // The subscription ends when context is destroyed
+    int subscribe(const QString &pathPrefix, QObject *context, Callback callback);
+    void unsubscribe(int subscriptionId);
+
+    void setBatchInterval(int msecs);
+
+    // Record raw backend events as JSON lines for ReplayBackend
+    bool startRecording(const QString &fileName);
+    void stopRecording();
+
+    quint64 receivedEvents() const { return m_receivedEvents; }
+    quint64 deliveredEvents() const { return m_deliveredEvents; }
+
+private:
+    struct Subscription {
+        QString prefix;
+        QPointer<QObject> context;
+        Callback callback;
+    };
+
+    QThread *m_thread;
+    WatcherBackend *m_backend;
+    QHash<QString, int> m_watches;  // Backend paths, refcounted
+    QSet<QString> m_lostWatches;    // Still wanted, but dropped by the backend
+    QHash<int, Subscription> m_subscriptions;
+    int m_nextSubscriptionId;
+
+    QVector<WorkspaceEvent> m_pending;
+    QHash<QString, int> m_pendingIndex;  // Path -> index into m_pending
+    QTimer *m_batchTimer;
+
+    QFile *m_recording;
+    qint64 m_recordingStart;
+    quint64 m_receivedEvents;
+    quint64 m_deliveredEvents;
+
+    void init(WatcherBackend *backend);
+    void addWatch(const QString &path);
+    void removeWatch(const QString &path);
+    void rearmWatch(const QString &path);
+    void onEventsAvailable(const QVector<WorkspaceEvent> &events);
+    void coalesce(const WorkspaceEvent &event);
+    void flush();
+    void record(const QVector<WorkspaceEvent> &events);
+
+    static bool matches(const QString &prefix, const QString &path);
+};
+
+#endif // WORKSPACEWATCHER_H
@@ -1,22 +1,45 @@
 // main.cpp
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QQuickWindow>
 #include <QQmlApplicationEngine>
-#include <QQmlContext>
 #include <QDir>
+#include <QFileInfo>
+#include <QSettings>
 #include <QStandardPaths>
 #include <QtQml>
 #include <QDebug>
 
+#include "core/DocumentStore.h"
+#include "core/FileIoService.h"
+#include "core/WorkspaceWatcher.h"
 #include "core/DocumentManager.h"
+#include "core/DocumentFinder.h"
 #include "core/FileExplorerModel.h"
 #include "core/MarkdownRenderer.h"
 #include "core/EditorManager.h"
 #include "core/ThemeManager.h"
 #include "core/DocumentLinker.h"
+#include "core/DocumentLinksModel.h"
+#include "core/BacklinksModel.h"
+#include "core/HierarchyModel.h"
 #include "core/PdfExporter.h"
+#include "core/Prefetcher.h"
+#include "core/ServiceRegistry.h"
+#include "core/WorkspaceIndexer.h"
+#include "core/FuzzyFinderModel.h"
+#include "core/FullTextIndex.h"
+#include "core/LinkChecker.h"
+#include "core/LinkGraph.h"
+#include "core/SearchResultsModel.h"
+#include "core/RegexSearchModel.h"
+#include "core/StartupTrace.h"
+#include "core/ExplorerBenchmark.h"
+#include "QmlSingletons.h"
 
 int main(int argc, char *argv[])
 {
+    StartupTrace::start();
     QApplication app(argc, argv);
 
     // Set application properties
@@ -24,34 +47,190 @@ int main(int argc, char *argv[])
     app.setApplicationVersion("1.0.0");
     app.setOrganizationName("MDV-Qt");
     
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption startupTraceOption("startup-trace",
+                                          "Print how long each startup phase took.");
+    parser.addOption(startupTraceOption);
+    QCommandLineOption quitAfterStartupOption("quit-after-startup",
+                                              "Quit once startup has finished, for benchmarks.");
+    parser.addOption(quitAfterStartupOption);
+    QCommandLineOption scrollBenchmarkOption("explorer-scroll-benchmark",
+                                             "Measure explorer scrolling over a synthetic tree "
+                                             "with <entries> entries and exit.",
+                                             "entries", "100000");
+    parser.addOption(scrollBenchmarkOption);
+    QCommandLineOption checkLinksOption("check-links",
+                                        "Check the links of the markdown files under "
+                                        "<directory>, print the broken ones as JSON and exit.",
+                                        "directory");
+    parser.addOption(checkLinksOption);
+    QCommandLineOption checkLinksOutputOption("check-links-output",
+                                              "Write the --check-links report to <file>.",
+                                              "file");
+    parser.addOption(checkLinksOutputOption);
+    parser.process(app);
+    
+    if (parser.isSet(scrollBenchmarkOption)) {
+        return ExplorerBenchmark::runScroll(parser.value(scrollBenchmarkOption).toInt());
+    }
+    if (parser.isSet(checkLinksOption)) {
+        return LinkChecker::runCli(parser.value(checkLinksOption),
+                                   parser.value(checkLinksOutputOption));
+    }
+    StartupTrace::setEnabled(parser.isSet(startupTraceOption));
+    StartupTrace::mark("application created");
+    
     // Create the QQmlApplicationEngine
     QQmlApplicationEngine engine;
     
     // Create core components
-    DocumentManager *documentManager = new DocumentManager(&app);
+    DocumentStore *documentStore = new DocumentStore(&app);
+    FileIoService *fileIoService = new FileIoService(&app);
+    WorkspaceWatcher *workspaceWatcher = new WorkspaceWatcher(&app);
+    DocumentManager *documentManager = new DocumentManager(documentStore, fileIoService,
+                                                           workspaceWatcher, &app);
+    DocumentFinder *documentFinder = new DocumentFinder(documentStore, &app);
     FileExplorerModel *fileSystemModel = new FileExplorerModel(&app);
     MarkdownRenderer *markdownRenderer = new MarkdownRenderer(&app);
-    EditorManager *editorManager = new EditorManager(&app);
+    EditorManager *editorManager = new EditorManager(documentStore, &app);
     ThemeManager *themeManager = new ThemeManager(&app);
     DocumentLinker *documentLinker = new DocumentLinker(&app);
-    PdfExporter *pdfExporter = new PdfExporter(&app);
+    DocumentLinksModel *documentLinks = new DocumentLinksModel(documentStore, &app);
+    BacklinksModel *backlinks = new BacklinksModel(documentLinker, &app);
+    Prefetcher *prefetcher = new Prefetcher(documentStore, fileIoService, markdownRenderer, &app);
+    HierarchyModel *hierarchyModel = new HierarchyModel(fileIoService, &app);
+    FuzzyFinderModel *fuzzyFinder = new FuzzyFinderModel(&app);
+    SearchResultsModel *searchResults = new SearchResultsModel(&app);
+    RegexSearchModel *regexSearch = new RegexSearchModel(&app);
+    
+    // Services most sessions never use are created on first use
+    ServiceRegistry *services = new ServiceRegistry(&app);
+    services->registerService("pdfExporter", [](QObject *parent) {
+        return new PdfExporter(parent);
+    });
+    // The workspace is the folder open in the explorer unless roots are configured
+    services->registerService("workspaceIndexer", [fileIoService, workspaceWatcher, fileSystemModel,
+                                                   documentManager](QObject *parent) {
+        QSettings settings;
+        QStringList roots = settings.value("workspace/roots").toStringList();
+        if (roots.isEmpty() && !fileSystemModel->rootPath().isEmpty()) {
+            roots.append(fileSystemModel->rootPath());
+        }
+        if (roots.isEmpty() && !documentManager->currentDocument().isEmpty()) {
+            roots.append(QFileInfo(documentManager->currentDocument()).absolutePath());
+        }
+        auto *indexer = new WorkspaceIndexer(fileIoService, workspaceWatcher, parent);
+        indexer->setRoots(roots);
+        indexer->setExcludePatterns(settings.value("workspace/excludePatterns",
+                                                   WorkspaceIndexer::defaultExcludePatterns())
+                                        .toStringList());
+        indexer->start();
+        return indexer;
+    });
+    services->registerService("linkGraph", [fileIoService, services](QObject *parent) {
+        auto *graph = new LinkGraph(fileIoService,
+                                    services->get<WorkspaceIndexer>("workspaceIndexer"), parent);
+        graph->start();
+        return graph;
+    });
+    services->registerService("linkChecker", [fileIoService, services](QObject *parent) {
+        return new LinkChecker(fileIoService,
+                               services->get<WorkspaceIndexer>("workspaceIndexer"), parent);
+    });
+    services->registerService("fullTextIndex", [fileIoService, services](QObject *parent) {
+        auto *index = new FullTextIndex(fileIoService,
+                                        services->get<WorkspaceIndexer>("workspaceIndexer"),
+                                        parent);
+        index->start();
+        return index;
+    });
+
+    fileSystemModel->setWorkspaceWatcher(workspaceWatcher);
+    documentLinker->setWorkspaceWatcher(workspaceWatcher);
+    documentLinker->setDocumentStore(documentStore);
+    
+    // Back, forward and the links on screen are read and rendered ahead
+    markdownRenderer->setPrefetcher(prefetcher);
+    markdownRenderer->setDocumentStore(documentStore);
+    documentManager->setPrefetcher(prefetcher);
+    QObject::connect(documentManager, &DocumentManager::currentDocumentChanged, documentLinker,
+                     [documentManager, documentLinker]() {
+        if (!documentManager->currentDocument().isEmpty()) {
+            documentLinker->addToHistory(documentManager->currentDocument());
+        }
+    });
+    QObject::connect(documentLinker, &DocumentLinker::navigationHistoryChanged, prefetcher,
+                     [documentLinker, prefetcher]() {
+        prefetcher->setHistoryTargets({documentLinker->backPath(), documentLinker->forwardPath()});
+    });
+    // The hierarchy shows the folder open in the explorer
+    hierarchyModel->setWorkspaceWatcher(workspaceWatcher);
+    QObject::connect(fileSystemModel, &QFileSystemModel::rootPathChanged, hierarchyModel,
+                     &HierarchyModel::setRootPath);
+    hierarchyModel->start();
 
-    // Set up file system model
-    fileSystemModel->setRootPath(QDir::homePath());
+    // Set up file system model. Setting the root starts a scan of the home
+    // directory, which waits until the window is on screen.
     fileSystemModel->setFilter(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::AllDirs);
     fileSystemModel->setMarkdownOnly(true);
+    services->deferUntilFirstFrame("explorer root", [fileSystemModel]() {
+        fileSystemModel->setRootPath(QDir::homePath());
+    });
+    QObject::connect(services, &ServiceRegistry::serviceCreated, fuzzyFinder,
+                     [fuzzyFinder, regexSearch](const QString &name, QObject *service) {
+        if (name == "workspaceIndexer") {
+            fuzzyFinder->setIndexer(qobject_cast<WorkspaceIndexer *>(service));
+            regexSearch->setIndexer(qobject_cast<WorkspaceIndexer *>(service));
+        }
+    });
+    QObject::connect(services, &ServiceRegistry::serviceCreated, searchResults,
+                     [searchResults](const QString &name, QObject *service) {
+        if (name == "fullTextIndex") {
+            searchResults->setIndex(qobject_cast<FullTextIndex *>(service));
+        }
+    });
+    // The workspace is walked and indexed when a feature first needs it,
+    // not on every start
+    QObject::connect(fuzzyFinder, &FuzzyFinderModel::indexerNeeded, services, [services]() {
+        services->service("workspaceIndexer");
+    });
+    QObject::connect(regexSearch, &RegexSearchModel::indexerNeeded, services, [services]() {
+        services->service("workspaceIndexer");
+    });
+    QObject::connect(searchResults, &SearchResultsModel::indexNeeded, services, [services]() {
+        services->service("fullTextIndex");
+    });
+    QObject::connect(documentLinker, &DocumentLinker::linkGraphNeeded, services, [services]() {
+        services->service("linkGraph");
+    });
+    QObject::connect(services, &ServiceRegistry::serviceCreated, documentLinker,
+                     [documentLinker](const QString &name, QObject *service) {
+        if (name == "linkGraph") {
+            documentLinker->setLinkGraph(qobject_cast<LinkGraph *>(service));
+        }
+    });
 
-    // Expose core components to QML
-    engine.rootContext()->setContextProperty("documentManager", documentManager);
-    engine.rootContext()->setContextProperty("fileSystemModel", fileSystemModel);
-    engine.rootContext()->setContextProperty("markdownRenderer", markdownRenderer);
-    engine.rootContext()->setContextProperty("editorManager", editorManager);
-    engine.rootContext()->setContextProperty("themeManager", themeManager);
-    engine.rootContext()->setContextProperty("documentLinker", documentLinker);
-    engine.rootContext()->setContextProperty("pdfExporter", pdfExporter);
+    // Expose core components to QML as singletons of the MdViewer module
+    DocumentManagerSingleton::setInstance(documentManager);
+    DocumentFinderSingleton::setInstance(documentFinder);
+    FileSystemModelSingleton::setInstance(fileSystemModel);
+    MarkdownRendererSingleton::setInstance(markdownRenderer);
+    EditorManagerSingleton::setInstance(editorManager);
+    ThemeManagerSingleton::setInstance(themeManager);
+    DocumentLinkerSingleton::setInstance(documentLinker);
+    DocumentLinksSingleton::setInstance(documentLinks);
+    BacklinksSingleton::setInstance(backlinks);
+    PrefetcherSingleton::setInstance(prefetcher);
+    DocumentHierarchySingleton::setInstance(hierarchyModel);
+    FuzzyFinderSingleton::setInstance(fuzzyFinder);
+    FullTextSearchSingleton::setInstance(searchResults);
+    RegexSearchSingleton::setInstance(regexSearch);
+    ServicesSingleton::setInstance(services);
+    StartupTrace::mark("core components created");
     
-    // Load the main QML file
-    const QUrl url(QStringLiteral("qrc:/src/application/Main.qml"));
+    // Load the main QML file, compiled ahead of time into the module
     QObject::connect(
         &engine, &QQmlApplicationEngine::objectCreationFailed, &app,
         [](const QUrl &url) {
@@ -59,12 +238,31 @@ int main(int argc, char *argv[])
             QCoreApplication::exit(-1);
         },
         Qt::QueuedConnection);
-    engine.load(url);
+    {
+        StartupTrace::Scope scope("load QML");
+        engine.loadFromModule("MdViewer", "Main");
+    }
 
     if (engine.rootObjects().isEmpty()) {
         qDebug() << "No root objects created";
         return -1;
     }
+    
+    // Deferred startup work runs once the first frame is on screen
+    if (auto *window = qobject_cast<QQuickWindow *>(engine.rootObjects().first())) {
+        QObject::connect(window, &QQuickWindow::frameSwapped, services,
+                         &ServiceRegistry::firstFrameShown, Qt::QueuedConnection);
+    } else {
+        services->firstFrameShown();
+    }
+    QObject::connect(services, &ServiceRegistry::startupFinished, &app, &StartupTrace::print);
+    if (parser.isSet(quitAfterStartupOption)) {
+        QObject::connect(services, &ServiceRegistry::startupFinished, &app,
+                         &QCoreApplication::quit, Qt::QueuedConnection);
+    }
+
+    // Tabs of the previous run, once the window exists to show them
+    documentManager->restoreSession();
 
     return app.exec();
 }
\ No newline at end of file
@@ -0,0 +1,121 @@
+// tst_documentfinder.cpp
+#include <QtTest>
+#include <QRandomGenerator>
+
+#include "DocumentFinder.h"
+#include "DocumentStore.h"
+
+class TestDocumentFinder : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void editShiftsMatchesBehind();
+    void editErasesOverlappedMatches();
+    void editFindsMatchesAcrossIt();
+    void editsMatchFullScan();
+    void replaceAllSkipsOverlaps();
+
+private:
+    static QVector<qsizetype> matches(const DocumentFinder &finder);
+};
+
+QVector<qsizetype> TestDocumentFinder::matches(const DocumentFinder &finder)
+{
+    QVector<qsizetype> positions;
+    for (int i = 0; i < finder.matchCount(); ++i) {
+        positions.append(finder.matchPosition(i));
+    }
+    return positions;
+}
+
+void TestDocumentFinder::editShiftsMatchesBehind()
+{
+    DocumentStore store;
+    int id = store.open(QStringLiteral("/doc.md"), QStringLiteral("ab ab ab"));
+    DocumentFinder finder(&store);
+    finder.setDocumentId(id);
+    finder.setPattern(QStringLiteral("ab"));
+    QTRY_VERIFY(!finder.isScanning());
+    QCOMPARE(matches(finder), (QVector<qsizetype>{0, 3, 6}));
+
+    store.applyEdit(id, 3, 0, QStringLiteral("xx"));
+    QVERIFY(!finder.isScanning());
+    QCOMPARE(matches(finder), (QVector<qsizetype>{0, 5, 8}));
+}
+
+void TestDocumentFinder::editErasesOverlappedMatches()
+{
+    DocumentStore store;
+    int id = store.open(QStringLiteral("/doc.md"), QStringLiteral("ab ab ab"));
+    DocumentFinder finder(&store);
+    finder.setDocumentId(id);
+    finder.setPattern(QStringLiteral("ab"));
+    QTRY_VERIFY(!finder.isScanning());
+
+    // "ab a ab": the second match lost its "b", the third moved
+    store.applyEdit(id, 4, 1, QString());
+    QCOMPARE(matches(finder), (QVector<qsizetype>{0, 5}));
+}
+
+void TestDocumentFinder::editFindsMatchesAcrossIt()
+{
+    DocumentStore store;
+    int id = store.open(QStringLiteral("/doc.md"), QStringLiteral("xa bx ab"));
+    DocumentFinder finder(&store);
+    finder.setDocumentId(id);
+    finder.setPattern(QStringLiteral("AB"));
+    QTRY_VERIFY(!finder.isScanning());
+    QCOMPARE(matches(finder), (QVector<qsizetype>{6}));
+
+    // Removing the space joins "a" and "b"
+    store.applyEdit(id, 2, 1, QString());
+    QCOMPARE(matches(finder), (QVector<qsizetype>{1, 5}));
+}
+
+void TestDocumentFinder::editsMatchFullScan()
+{
+    DocumentStore store;
+    int id = store.open(QStringLiteral("/doc.md"), QStringLiteral("aaba abab baab aaaa"));
+    DocumentFinder finder(&store);
+    finder.setDocumentId(id);
+    finder.setPattern(QStringLiteral("aa"));
+    QTRY_VERIFY(!finder.isScanning());
+
+    // Overlapping matches make the window around each edit matter
+    QRandomGenerator random(42);
+    const QString pieces[] = {QStringLiteral("a"), QStringLiteral("aa"), QStringLiteral("b"),
+                              QStringLiteral("ab a"), QString()};
+    for (int i = 0; i < 200; ++i) {
+        qsizetype length = store.length(id);
+        qsizetype position = random.bounded(int(length) + 1);
+        qsizetype removed = random.bounded(int(qMin<qsizetype>(4, length - position)) + 1);
+        const QString &inserted = pieces[random.bounded(5)];
+        QVERIFY(store.applyEdit(id, position, removed, inserted));
+
+        QVERIFY(!finder.isScanning());
+        QCOMPARE(matches(finder), DocumentFinder::findAll(store.content(id),
+                                                          QStringLiteral("aa"),
+                                                          Qt::CaseInsensitive));
+    }
+}
+
+void TestDocumentFinder::replaceAllSkipsOverlaps()
+{
+    DocumentStore store;
+    int id = store.open(QStringLiteral("/doc.md"), QStringLiteral("aaaa b aa"));
+    DocumentFinder finder(&store);
+    finder.setDocumentId(id);
+    finder.setPattern(QStringLiteral("aa"));
+    QTRY_VERIFY(!finder.isScanning());
+    QCOMPARE(finder.matchCount(), 4);
+
+    QVariantMap edit = finder.replaceAll(QStringLiteral("c"));
+    QCOMPARE(edit.value("count").toInt(), 3);
+    QCOMPARE(edit.value("position").toInt(), 0);
+    QCOMPARE(store.content(id), QStringLiteral("cc b c"));
+    QCOMPARE(finder.matchCount(), 0);
+}
+
+QTEST_GUILESS_MAIN(TestDocumentFinder)
+#include "tst_documentfinder.moc"
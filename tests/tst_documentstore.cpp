@@ -0,0 +1,135 @@
+// tst_documentstore.cpp
+#include <QtTest>
+#include <QSignalSpy>
+
+#include "DocumentStore.h"
+
+class TestDocumentStore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void snapshotSurvivesLaterEdits();
+    void snapshotIsCachedPerRevision();
+    void setContentReportsDelta();
+    void spilledTextIsRequested();
+    void unspillRestoresText();
+    void restoreTakesChangedFile();
+};
+
+void TestDocumentStore::snapshotSurvivesLaterEdits()
+{
+    DocumentStore store;
+    int id = store.open(QStringLiteral("/doc.md"), QStringLiteral("one two"));
+    store.applyEdit(id, 3, 0, QStringLiteral(" and a half"));
+
+    DocumentSnapshot before = store.snapshot(id);
+    store.applyEdit(id, store.length(id), 0, QStringLiteral(" three"));
+    store.applyEdit(id, 0, 3, QStringLiteral("1"));
+
+    QCOMPARE(before.text(), QStringLiteral("one and a half two"));
+    QCOMPARE(before.length(), qsizetype(18));
+    QCOMPARE(store.content(id), QStringLiteral("1 and a half two three"));
+    QCOMPARE(store.snapshot(id).text(), store.content(id));
+}
+
+void TestDocumentStore::snapshotIsCachedPerRevision()
+{
+    DocumentStore store;
+    int id = store.open(QStringLiteral("/doc.md"), QStringLiteral("text"));
+
+    DocumentSnapshot first = store.snapshot(id);
+    QCOMPARE(store.snapshot(id).revision(), first.revision());
+
+    store.applyEdit(id, 4, 0, QStringLiteral("!"));
+    DocumentSnapshot second = store.snapshot(id);
+    QVERIFY(second.revision() > first.revision());
+    QCOMPARE(first.text(), QStringLiteral("text"));
+    QCOMPARE(second.text(), QStringLiteral("text!"));
+}
+
+void TestDocumentStore::setContentReportsDelta()
+{
+    DocumentStore store;
+    int id = store.open(QStringLiteral("/doc.md"), QStringLiteral("abc"));
+    store.applyEdit(id, 3, 0, QStringLiteral("def"));
+
+    QSignalSpy edited(&store, &DocumentStore::documentEdited);
+    QVERIFY(store.setContent(id, QStringLiteral("abXYef")));
+    QCOMPARE(store.content(id), QStringLiteral("abXYef"));
+
+    QCOMPARE(edited.count(), 1);
+    const QList<QVariant> arguments = edited.takeFirst();
+    QCOMPARE(arguments.at(2).value<qsizetype>(), qsizetype(2));  // position
+    QCOMPARE(arguments.at(3).value<qsizetype>(), qsizetype(2));  // removed "cd"
+    QCOMPARE(arguments.at(4).value<qsizetype>(), qsizetype(2));  // inserted "XY"
+}
+
+void TestDocumentStore::spilledTextIsRequested()
+{
+    DocumentStore store;
+    int id = store.open(QStringLiteral("/doc.md"), QStringLiteral("unsaved"));
+    store.applyEdit(id, 7, 0, QStringLiteral(" work"));
+    QVERIFY(store.compress(id));
+    QVERIFY(store.markSpilled(id, QStringLiteral("/nonexistent/doc.spill")));
+
+    // The spill file is not read by the accessors, only asked for
+    QSignalSpy requested(&store, &DocumentStore::restoreRequested);
+    QVERIFY(store.snapshot(id).isNull());
+    QVERIFY(!store.applyEdit(id, 0, 0, QStringLiteral("x")));
+    QCOMPARE(store.residency(id), DocumentStore::Spilled);
+    QCOMPARE(store.length(id), qsizetype(12));
+    QVERIFY(store.isModified(id));
+    QCOMPARE(requested.count(), 2);
+}
+
+void TestDocumentStore::unspillRestoresText()
+{
+    DocumentStore store;
+    int id = store.open(QStringLiteral("/doc.md"), QStringLiteral("abc"));
+    store.applyEdit(id, 3, 0, QStringLiteral("def"));
+    QVERIFY(store.compress(id));
+    QByteArray data = store.compressedData(id);
+    QVERIFY(store.markSpilled(id, QStringLiteral("/nonexistent/doc.spill")));
+
+    QVERIFY(!store.unspill(id, QByteArray("damaged")));
+    QCOMPARE(store.residency(id), DocumentStore::Spilled);
+    QVERIFY(store.unspill(id, data));
+    QCOMPARE(store.residency(id), DocumentStore::Resident);
+    QCOMPARE(store.content(id), QStringLiteral("abcdef"));
+}
+
+void TestDocumentStore::restoreTakesChangedFile()
+{
+    DocumentStore store;
+    int id = store.open(QStringLiteral("/doc.md"), QStringLiteral("on disk"));
+    quint64 revision = store.revision(id);
+    quint64 savedHash = store.savedHash(id);
+    QVERIFY(store.evict(id));
+
+    QSignalSpy requested(&store, &DocumentStore::restoreRequested);
+    QSignalSpy residency(&store, &DocumentStore::residencyChanged);
+    QVERIFY(store.content(id).isEmpty());
+    QCOMPARE(requested.count(), 1);
+
+    // Unchanged file: same revision and saved state
+    QVERIFY(!store.restore(id, QStringLiteral("on disk"), savedHash));
+    QCOMPARE(store.revision(id), revision);
+    QCOMPARE(residency.count(), 1);
+    QCOMPARE(residency.takeFirst().at(1).value<DocumentStore::Residency>(),
+             DocumentStore::Resident);
+
+    // Changed while evicted: a reload at a new revision, still clean
+    QVERIFY(store.evict(id));
+    residency.clear();
+    QVERIFY(store.restore(id, QStringLiteral("edited elsewhere"), savedHash + 1));
+    QVERIFY(store.revision(id) > revision);
+    QCOMPARE(store.savedHash(id), savedHash + 1);
+    QCOMPARE(store.contentHash(id), savedHash + 1);
+    QCOMPARE(store.content(id), QStringLiteral("edited elsewhere"));
+    QVERIFY(!store.isModified(id));
+    QCOMPARE(residency.count(), 1);
+}
+
+QTEST_GUILESS_MAIN(TestDocumentStore)
+#include "tst_documentstore.moc"
@@ -0,0 +1,182 @@
+// tst_fulltextindex.cpp
+#include <QtTest>
+#include <QBuffer>
+#include <QTemporaryDir>
+
+#include "FullTextIndex.h"
+#include "IndexSegment.h"
+
+namespace {
+IndexedDocument document(const QString &path, const QHash<QString, QVector<quint32>> &positions)
+{
+    IndexedDocument d;
+    d.path = path;
+    d.size = 100;
+    d.lastModified = 1700000000000;
+    d.positions = positions;
+    for (const QVector<quint32> &list : positions) {
+        d.tokenCount += list.size();
+    }
+    return d;
+}
+}
+
+class TestFullTextIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void segmentRoundTrip();
+    void varintBoundaries();
+    void segmentDocumentsSkipDeleted();
+    void parseQuery();
+    void readTextStopsAtCharacter();
+};
+
+void TestFullTextIndex::segmentRoundTrip()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    QString fileName = directory.filePath("segment");
+
+    QVector<IndexedDocument> documents = {
+        document("/w/a.md", {{"alpha", {0, 4}}, {"beta", {1}}, {"größe", {2}}}),
+        document("/w/b.md", {{"alpha", {3}}, {"alphabet", {0, 1, 2}}}),
+        document("/w/ü.md", {{"beta", {7}}})
+    };
+    QString error;
+    QVERIFY2(IndexSegment::write(fileName, documents, &error), qPrintable(error));
+
+    std::shared_ptr<IndexSegment> segment = IndexSegment::open(fileName, &error);
+    QVERIFY2(segment, qPrintable(error));
+    QCOMPARE(segment->documentCount(), quint32(3));
+    QCOMPARE(segment->termCount(), quint32(4));
+    QCOMPARE(segment->document(2).path, QStringLiteral("/w/ü.md"));
+    QCOMPARE(segment->document(1).tokenCount, quint32(4));
+    QCOMPARE(segment->document(0).lastModified, qint64(1700000000000));
+
+    QVector<IndexSegment::Posting> alpha = segment->postings("alpha");
+    QCOMPARE(alpha.size(), 2);
+    QCOMPARE(alpha.at(0).document, quint32(0));
+    QCOMPARE(alpha.at(0).positions, QVector<quint32>({0, 4}));
+    QCOMPARE(alpha.at(1).document, quint32(1));
+    QCOMPARE(alpha.at(1).positions, QVector<quint32>({3}));
+    QCOMPARE(segment->postings("größe").size(), 1);
+    QVERIFY(segment->postings("gamma").isEmpty());
+
+    QCOMPARE(segment->termsWithPrefix("alp", 10), QStringList({"alpha", "alphabet"}));
+    QCOMPARE(segment->termsWithPrefix("alp", 1), QStringList({"alpha"}));
+    QVERIFY(segment->termsWithPrefix("z", 10).isEmpty());
+}
+
+void TestFullTextIndex::varintBoundaries()
+{
+    // Deltas on both sides of each varint length, up to five bytes
+    const QVector<quint32> positions = {0, 127, 128, 16383, 16384, 2097151, 2097152,
+                                        268435455, 268435456, 0xffffffff};
+    QVector<IndexedDocument> documents;
+    for (int i = 0; i < 200; ++i) {
+        documents.append(document(QString("/w/%1.md").arg(i),
+                                  {{"common", {quint32(i)}}, {"edge", positions}}));
+    }
+    // A document id delta of 199 takes two bytes
+    documents.first().positions.insert("rare", {5});
+    documents.last().positions.insert("rare", {6});
+
+    QTemporaryDir directory;
+    QString fileName = directory.filePath("segment");
+    QVERIFY(IndexSegment::write(fileName, documents));
+    std::shared_ptr<IndexSegment> segment = IndexSegment::open(fileName);
+    QVERIFY(segment);
+
+    QVector<IndexSegment::Posting> edge = segment->postings("edge");
+    QCOMPARE(edge.size(), 200);
+    QCOMPARE(edge.last().document, quint32(199));
+    QCOMPARE(edge.last().positions, positions);
+
+    QVector<IndexSegment::Posting> rare = segment->postings("rare");
+    QCOMPARE(rare.size(), 2);
+    QCOMPARE(rare.at(1).document, quint32(199));
+    QCOMPARE(rare.at(1).positions, QVector<quint32>({6}));
+
+    QVector<IndexSegment::Posting> common = segment->postings("common");
+    QCOMPARE(common.size(), 200);
+    for (int i = 0; i < common.size(); ++i) {
+        QCOMPARE(common.at(i).document, quint32(i));
+        QCOMPARE(common.at(i).positions, QVector<quint32>({quint32(i)}));
+    }
+}
+
+void TestFullTextIndex::segmentDocumentsSkipDeleted()
+{
+    QVector<IndexedDocument> documents = {
+        document("/w/a.md", {{"one", {0}}, {"two", {1}}}),
+        document("/w/b.md", {{"two", {0}}}),
+        document("/w/c.md", {{"three", {0, 2}}})
+    };
+    QTemporaryDir directory;
+    QString fileName = directory.filePath("segment");
+    QVERIFY(IndexSegment::write(fileName, documents));
+    std::shared_ptr<IndexSegment> segment = IndexSegment::open(fileName);
+    QVERIFY(segment);
+
+    QVector<quint32> ids;
+    QVector<IndexedDocument> live = segment->documents({1}, &ids);
+    QCOMPARE(ids, QVector<quint32>({0, 2}));
+    QCOMPARE(live.size(), 2);
+    QCOMPARE(live.at(0).path, QStringLiteral("/w/a.md"));
+    QCOMPARE(live.at(0).positions, documents.at(0).positions);
+    QCOMPARE(live.at(1).positions, documents.at(2).positions);
+    QCOMPARE(live.at(1).tokenCount, quint32(2));
+}
+
+void TestFullTextIndex::parseQuery()
+{
+    using Clause = FullTextIndex::Clause;
+
+    QVector<Clause> clauses = FullTextIndex::parseQuery(
+        QStringLiteral("  Alpha \"Exact Phrase\" pre* foo-bar \"single\" \"unterminated words"));
+    QCOMPARE(clauses.size(), 6);
+    QCOMPARE(clauses.at(0).kind, Clause::Term);
+    QCOMPARE(clauses.at(0).terms, QStringList({"alpha"}));
+    QCOMPARE(clauses.at(1).kind, Clause::Phrase);
+    QCOMPARE(clauses.at(1).terms, QStringList({"exact", "phrase"}));
+    QCOMPARE(clauses.at(2).kind, Clause::Prefix);
+    QCOMPARE(clauses.at(2).terms, QStringList({"pre"}));
+    QCOMPARE(clauses.at(3).kind, Clause::Phrase);     // Indexed as adjacent tokens
+    QCOMPARE(clauses.at(3).terms, QStringList({"foo", "bar"}));
+    QCOMPARE(clauses.at(4).kind, Clause::Term);       // A one-word phrase
+    QCOMPARE(clauses.at(4).terms, QStringList({"single"}));
+    QCOMPARE(clauses.at(5).kind, Clause::Phrase);
+    QCOMPARE(clauses.at(5).terms, QStringList({"unterminated", "words"}));
+
+    QVERIFY(FullTextIndex::parseQuery(QStringLiteral("   ")).isEmpty());
+    QVERIFY(FullTextIndex::parseQuery(QStringLiteral("\"\" * --")).isEmpty());
+}
+
+void TestFullTextIndex::readTextStopsAtCharacter()
+{
+    // "a€b": the euro sign is three bytes, E2 82 AC
+    QByteArray utf8 = QStringLiteral("a€b").toUtf8();
+    QCOMPARE(utf8.size(), 5);
+
+    auto read = [&](qint64 maxBytes) {
+        QBuffer buffer(&utf8);
+        buffer.open(QIODevice::ReadOnly);
+        return FullTextIndex::readText(&buffer, maxBytes);
+    };
+    QCOMPARE(read(1), QStringLiteral("a"));
+    QCOMPARE(read(2), QStringLiteral("a"));           // Cut after the lead byte
+    QCOMPARE(read(3), QStringLiteral("a"));           // Cut before the last byte
+    QCOMPARE(read(4), QStringLiteral("a€"));
+    QCOMPARE(read(5), QStringLiteral("a€b"));
+    QCOMPARE(read(100), QStringLiteral("a€b"));
+
+    // A four-byte character turns into a surrogate pair, never half of one
+    utf8 = QStringLiteral("x\U0001F600").toUtf8();
+    QCOMPARE(read(4), QStringLiteral("x"));
+    QCOMPARE(read(5), QStringLiteral("x\U0001F600"));
+}
+
+QTEST_GUILESS_MAIN(TestFullTextIndex)
+#include "tst_fulltextindex.moc"
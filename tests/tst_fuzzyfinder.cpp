@@ -0,0 +1,158 @@
+// tst_fuzzyfinder.cpp
+#include <QtTest>
+
+#include "FuzzyFinder.h"
+
+class TestFuzzyFinder : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void charactersMatchInOrder();
+    void fileNameAndBoundariesScoreHigher();
+    void runsScoreHigherThanGaps();
+    void prefilterHasNoFalseMatches();
+    void narrowingMatchesFullSearch();
+    void addedPathEndsNarrowing();
+    void removedPathsAreSkipped();
+    void matchStartHidesPrefix();
+
+private:
+    static QStringList paths(const FuzzyFinder &finder, const QVector<FuzzyFinder::Match> &matches);
+};
+
+QStringList TestFuzzyFinder::paths(const FuzzyFinder &finder,
+                                   const QVector<FuzzyFinder::Match> &matches)
+{
+    QStringList result;
+    for (const FuzzyFinder::Match &match : matches) {
+        result.append(finder.path(match.entry));
+    }
+    return result;
+}
+
+void TestFuzzyFinder::charactersMatchInOrder()
+{
+    FuzzyFinder finder;
+    finder.add(QStringLiteral("src/main.cpp"));
+    finder.add(QStringLiteral("docs/readme.md"));
+
+    QCOMPARE(paths(finder, finder.search(QStringLiteral("mn"), 10)),
+             QStringList{QStringLiteral("src/main.cpp")});
+    QVERIFY(finder.search(QStringLiteral("nm"), 10).isEmpty());
+    // Case and whitespace in the query don't matter
+    QCOMPARE(paths(finder, finder.search(QStringLiteral("Read Me"), 10)),
+             QStringList{QStringLiteral("docs/readme.md")});
+}
+
+void TestFuzzyFinder::fileNameAndBoundariesScoreHigher()
+{
+    FuzzyFinder finder;
+    finder.add(QStringLiteral("spread/notes.md"));
+    finder.add(QStringLiteral("notes/readme.md"));
+    finder.add(QStringLiteral("notes/thread.md"));
+
+    // At the start of the file name, inside the file name, in a directory
+    QCOMPARE(paths(finder, finder.search(QStringLiteral("read"), 10)),
+             (QStringList{QStringLiteral("notes/readme.md"), QStringLiteral("notes/thread.md"),
+                          QStringLiteral("spread/notes.md")}));
+}
+
+void TestFuzzyFinder::runsScoreHigherThanGaps()
+{
+    FuzzyFinder finder;
+    finder.add(QStringLiteral("axbxc.md"));
+    finder.add(QStringLiteral("abc.md"));
+
+    QVector<FuzzyFinder::Match> matches = finder.search(QStringLiteral("abc"), 10);
+    QCOMPARE(paths(finder, matches),
+             (QStringList{QStringLiteral("abc.md"), QStringLiteral("axbxc.md")}));
+    QVERIFY(matches.at(0).score > matches.at(1).score);
+
+    // Equal scores go to the shorter path
+    finder.add(QStringLiteral("abc.markdown"));
+    QCOMPARE(paths(finder, finder.search(QStringLiteral("abc"), 1)),
+             QStringList{QStringLiteral("abc.md")});
+    QCOMPARE(finder.lastMatchCount(), 3);
+}
+
+void TestFuzzyFinder::prefilterHasNoFalseMatches()
+{
+    FuzzyFinder finder;
+    // Characters outside a-z, 0-9 and . - _ / share one mask bit
+    finder.add(QStringLiteral("notes/über.md"));
+    finder.add(QStringLiteral("notes/café.md"));
+
+    QVERIFY(finder.search(QStringLiteral("z"), 10).isEmpty());
+    QCOMPARE(paths(finder, finder.search(QStringLiteral("é"), 10)),
+             QStringList{QStringLiteral("notes/café.md")});
+}
+
+void TestFuzzyFinder::narrowingMatchesFullSearch()
+{
+    const QStringList all = {
+        QStringLiteral("src/main.cpp"), QStringLiteral("src/markdown.cpp"),
+        QStringLiteral("docs/manual.md"), QStringLiteral("docs/mail/inbox.md"),
+        QStringLiteral("notes/animal.md"), QStringLiteral("todo.md")
+    };
+    FuzzyFinder narrowing;
+    for (const QString &path : all) {
+        narrowing.add(path);
+    }
+
+    for (const QString &query : {QStringLiteral("m"), QStringLiteral("ma"), QStringLiteral("mai"),
+                                 QStringLiteral("main")}) {
+        FuzzyFinder fresh;
+        for (const QString &path : all) {
+            fresh.add(path);
+        }
+        QCOMPARE(paths(narrowing, narrowing.search(query, 10)),
+                 paths(fresh, fresh.search(query, 10)));
+    }
+}
+
+void TestFuzzyFinder::addedPathEndsNarrowing()
+{
+    FuzzyFinder finder;
+    finder.add(QStringLiteral("docs/manual.md"));
+    QCOMPARE(finder.search(QStringLiteral("ma"), 10).size(), 1);
+
+    // Not among the previous matches, but must be found
+    finder.add(QStringLiteral("docs/mall.md"));
+    QCOMPARE(paths(finder, finder.search(QStringLiteral("mal"), 10)),
+             (QStringList{QStringLiteral("docs/mall.md"), QStringLiteral("docs/manual.md")}));
+}
+
+void TestFuzzyFinder::removedPathsAreSkipped()
+{
+    FuzzyFinder finder;
+    for (int i = 0; i < 3000; ++i) {
+        finder.add(QStringLiteral("notes/note%1.md").arg(i));
+    }
+    finder.search(QStringLiteral("note1"), 10);
+
+    // Past half of the entries, the removed ones are compacted away
+    for (int i = 0; i < 3000; ++i) {
+        if (i != 1234) {
+            finder.remove(QStringLiteral("notes/note%1.md").arg(i));
+        }
+    }
+    QCOMPARE(finder.size(), 1);
+    QCOMPARE(paths(finder, finder.search(QStringLiteral("note1"), 10)),
+             QStringList{QStringLiteral("notes/note1234.md")});
+    QVERIFY(finder.search(QStringLiteral("note99"), 10).isEmpty());
+}
+
+void TestFuzzyFinder::matchStartHidesPrefix()
+{
+    FuzzyFinder finder;
+    finder.add(QStringLiteral("/home/user/notes/todo.md"), 11);
+
+    QVERIFY(finder.search(QStringLiteral("home"), 10).isEmpty());
+    QVector<FuzzyFinder::Match> matches = finder.search(QStringLiteral("todo"), 10);
+    QCOMPARE(matches.size(), 1);
+    QCOMPARE(finder.nameStart(matches.at(0).entry), qsizetype(17));
+}
+
+QTEST_APPLESS_MAIN(TestFuzzyFinder)
+#include "tst_fuzzyfinder.moc"
@@ -0,0 +1,221 @@
+// tst_linkchecker.cpp
+#include <QtTest>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+#include "FileIoService.h"
+#include "LinkChecker.h"
+#include "WatcherBackends.h"
+#include "WorkspaceIndexer.h"
+#include "WorkspaceWatcher.h"
+
+namespace {
+void writeFile(const QString &path, const QByteArray &text)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(text);
+    file.flush();
+    // Changes within the mtime resolution would look unchanged
+    static int step = 0;
+    QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(++step),
+                             QFileDevice::FileModificationTime));
+}
+}
+
+class TestLinkChecker : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void brokenLinksAreReported();
+    void unchangedDocumentsAreNotParsed();
+    void changedTargetHeadingsAreRead();
+    void cacheIsSavedBetweenRuns();
+    void emptyCheckKeepsCache();
+    void workspaceCheckWaitsForScan();
+
+private:
+    QTemporaryDir *m_workspace = nullptr;
+    QString m_root;
+
+    QString path(const QString &name) const { return m_root + '/' + name; }
+    QStringList documents() const { return {path("a.md"), path("b.md")}; }
+};
+
+void TestLinkChecker::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void TestLinkChecker::init()
+{
+    m_workspace = new QTemporaryDir;
+    QVERIFY(m_workspace->isValid());
+    m_root = QDir::cleanPath(m_workspace->path());
+    writeFile(path("a.md"), "[B](b.md)\n[Gone](missing.md)\n"
+                            "[Intro](b.md#intro) and [Nope](b.md#nope)\n");
+    writeFile(path("b.md"), "# Intro\n\nBack to [A](a.md)\n");
+}
+
+void TestLinkChecker::cleanup()
+{
+    delete m_workspace;
+    m_workspace = nullptr;
+}
+
+void TestLinkChecker::brokenLinksAreReported()
+{
+    FileIoService io;
+    LinkChecker checker(&io, nullptr);
+    checker.setCacheRoots({m_root});
+
+    LinkChecker::Report report = checker.check(documents());
+    QCOMPARE(report.documentCount, 2);
+    QCOMPARE(report.linkCount, 5);
+    QCOMPARE(report.parsedCount, 2);
+    QCOMPARE(report.issues.size(), 2);
+
+    const LinkChecker::Issue &missing = report.issues.at(0);
+    QCOMPARE(missing.source, path("a.md"));
+    QCOMPARE(missing.target, path("missing.md"));
+    QCOMPARE(missing.problem, LinkChecker::MissingFile);
+    QCOMPARE(missing.line, 2);
+
+    const LinkChecker::Issue &anchor = report.issues.at(1);
+    QCOMPARE(anchor.target, path("b.md"));
+    QCOMPARE(anchor.anchor, QStringLiteral("nope"));
+    QCOMPARE(anchor.problem, LinkChecker::MissingAnchor);
+
+    QCOMPARE(checker.brokenCount(), 2);
+    QCOMPARE(checker.issues().at(1).toMap().value("problem").toString(),
+             QStringLiteral("missing-anchor"));
+    io.waitForDone();
+}
+
+void TestLinkChecker::unchangedDocumentsAreNotParsed()
+{
+    FileIoService io;
+    LinkChecker checker(&io, nullptr);
+    checker.setCacheRoots({m_root});
+    checker.check(documents());
+
+    LinkChecker::Report report = checker.check(documents());
+    QCOMPARE(report.parsedCount, 0);
+    QCOMPARE(report.linkCount, 5);
+    QCOMPARE(report.issues.size(), 2);
+
+    // Only the changed document is parsed again
+    writeFile(path("a.md"), "[B](b.md)\n");
+    report = checker.check(documents());
+    QCOMPARE(report.parsedCount, 1);
+    QCOMPARE(report.linkCount, 2);
+    QVERIFY(report.issues.isEmpty());
+
+    // A file created since is no longer missing
+    writeFile(path("a.md"), "[Later](later.md)\n");
+    QCOMPARE(checker.check(documents()).issues.size(), 1);
+    writeFile(path("later.md"), "Here\n");
+    report = checker.check(documents());
+    QCOMPARE(report.parsedCount, 0);
+    QVERIFY(report.issues.isEmpty());
+    io.waitForDone();
+}
+
+void TestLinkChecker::changedTargetHeadingsAreRead()
+{
+    FileIoService io;
+    LinkChecker checker(&io, nullptr);
+    checker.setCacheRoots({m_root});
+
+    // b.md is only a target here, so its headings come from the target cache
+    QStringList sources{path("a.md")};
+    QCOMPARE(checker.check(sources).issues.size(), 2);
+    QCOMPARE(checker.check(sources).issues.size(), 2);
+
+    writeFile(path("b.md"), "# Intro\n\n## Nope\n");
+    writeFile(path("missing.md"), "Found\n");
+    LinkChecker::Report report = checker.check(sources);
+    QCOMPARE(report.parsedCount, 0);
+    QVERIFY(report.issues.isEmpty());
+    io.waitForDone();
+}
+
+void TestLinkChecker::cacheIsSavedBetweenRuns()
+{
+    FileIoService io;
+    {
+        LinkChecker checker(&io, nullptr);
+        checker.setCacheRoots({m_root});
+        QCOMPARE(checker.check(documents()).parsedCount, 2);
+        io.waitForDone();
+    }
+
+    LinkChecker checker(&io, nullptr);
+    checker.setCacheRoots({m_root});
+    LinkChecker::Report report = checker.check(documents());
+    QCOMPARE(report.parsedCount, 0);
+    QCOMPARE(report.issues.size(), 2);
+
+    // Other roots keep their own cache
+    checker.setCacheRoots({m_root, path("other")});
+    QCOMPARE(checker.check(documents()).parsedCount, 2);
+    io.waitForDone();
+}
+
+void TestLinkChecker::emptyCheckKeepsCache()
+{
+    FileIoService io;
+    {
+        LinkChecker checker(&io, nullptr);
+        checker.setCacheRoots({m_root});
+        checker.check(documents());
+        io.waitForDone();
+    }
+
+    // An empty check reports nothing and leaves the saved cache alone
+    LinkChecker checker(&io, nullptr);
+    checker.setCacheRoots({m_root});
+    LinkChecker::Report report = checker.check({});
+    QCOMPARE(report.documentCount, 0);
+    QVERIFY(report.issues.isEmpty());
+    io.waitForDone();
+
+    LinkChecker reloaded(&io, nullptr);
+    reloaded.setCacheRoots({m_root});
+    QCOMPARE(reloaded.check(documents()).parsedCount, 0);
+    QCOMPARE(checker.check(documents()).parsedCount, 0);
+    io.waitForDone();
+}
+
+void TestLinkChecker::workspaceCheckWaitsForScan()
+{
+    auto *backend = new ReplayBackend;
+    backend->setRealtime(false);
+    WorkspaceWatcher watcher(backend);
+    FileIoService io;
+    WorkspaceIndexer indexer(&io, &watcher);
+    indexer.setRoots({m_root});
+    LinkChecker checker(&io, &indexer);
+
+    // Started before the index has any paths
+    QSignalSpy finished(&checker, &LinkChecker::finished);
+    checker.checkWorkspace();
+    QVERIFY(checker.isRunning());
+    QTest::qWait(50);
+    QCOMPARE(finished.count(), 0);
+
+    indexer.rescan();
+    QVERIFY(finished.wait());
+    QVERIFY(!checker.isRunning());
+    QCOMPARE(checker.documentCount(), 2);
+    QCOMPARE(finished.at(0).at(1).toInt(), 2);
+    io.waitForDone();
+}
+
+QTEST_GUILESS_MAIN(TestLinkChecker)
+#include "tst_linkchecker.moc"
@@ -0,0 +1,218 @@
+// tst_linkgraph.cpp
+#include <QtTest>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+#include "FileIoService.h"
+#include "LinkGraph.h"
+#include "WatcherBackends.h"
+#include "WorkspaceIndexer.h"
+#include "WorkspaceWatcher.h"
+
+namespace {
+void writeFile(const QString &path, const QByteArray &text)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(text);
+}
+
+QStringList sourcesOf(const QVector<LinkGraph::Link> &links)
+{
+    QStringList sources;
+    for (const LinkGraph::Link &link : links) {
+        sources.append(link.source);
+    }
+    sources.sort();
+    return sources;
+}
+
+bool reported(const QSignalSpy &spy, const QString &path)
+{
+    for (const QList<QVariant> &arguments : spy) {
+        if (arguments.at(0).toStringList().contains(path)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString graphFile()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/link-graph.bin";
+}
+}
+
+class TestLinkGraph : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void linksAndBacklinks();
+    void updatedDocumentReplacesItsLinks();
+    void removedDocumentLosesItsLinks();
+    void pathsOutsideWorkspaceAreIgnored();
+    void savedGraphIsLoaded();
+
+private:
+    QTemporaryDir *m_workspace = nullptr;
+    QString m_root;
+    FileIoService *m_io = nullptr;
+    WorkspaceWatcher *m_watcher = nullptr;
+    WorkspaceIndexer *m_indexer = nullptr;
+
+    QString path(const QString &name) const { return m_root + '/' + name; }
+    // Starts a graph and waits until every document has been parsed
+    void build(LinkGraph &graph, int documents);
+};
+
+void TestLinkGraph::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void TestLinkGraph::init()
+{
+    QFile::remove(graphFile());
+
+    m_workspace = new QTemporaryDir;
+    QVERIFY(m_workspace->isValid());
+    m_root = QDir::cleanPath(m_workspace->path());
+    writeFile(path("a.md"), "[B](b.md) and [C](c.md)\n\n[Top](#top)\n");
+    writeFile(path("b.md"), "# B\n\nBack to [A](a.md)\n");
+    writeFile(path("c.md"), "No links here\n");
+
+    auto *backend = new ReplayBackend;
+    backend->setRealtime(false);
+    m_watcher = new WorkspaceWatcher(backend);
+    m_io = new FileIoService;
+    m_indexer = new WorkspaceIndexer(m_io, m_watcher);
+    m_indexer->setRoots({m_root});
+}
+
+void TestLinkGraph::cleanup()
+{
+    delete m_indexer;
+    delete m_io;
+    delete m_watcher;
+    delete m_workspace;
+    m_indexer = nullptr;
+    m_io = nullptr;
+    m_watcher = nullptr;
+    m_workspace = nullptr;
+}
+
+void TestLinkGraph::build(LinkGraph &graph, int documents)
+{
+    QSignalSpy ready(&graph, &LinkGraph::readyChanged);
+    graph.start();
+    QVERIFY(ready.wait());
+    m_indexer->rescan();
+    QTRY_COMPARE(graph.documentCount(), documents);
+}
+
+void TestLinkGraph::linksAndBacklinks()
+{
+    LinkGraph graph(m_io, m_indexer);
+    build(graph, 3);
+    QTRY_COMPARE(graph.linkCount(), 3);
+
+    // Links within a document are left out
+    QVector<LinkGraph::Link> links = graph.links(path("a.md"));
+    QCOMPARE(links.size(), 2);
+    QCOMPARE(links.at(0).target, path("b.md"));
+    QCOMPARE(links.at(0).text, QStringLiteral("B"));
+    QCOMPARE(links.at(1).target, path("c.md"));
+    QCOMPARE(links.at(1).line, 1);
+
+    QCOMPARE(sourcesOf(graph.backlinks(path("b.md"))), QStringList{path("a.md")});
+    QCOMPARE(sourcesOf(graph.backlinks(path("a.md"))), QStringList{path("b.md")});
+    QVERIFY(graph.backlinks(path("missing.md")).isEmpty());
+    QCOMPARE(graph.sources(), (QStringList{path("a.md"), path("b.md")}));
+}
+
+void TestLinkGraph::updatedDocumentReplacesItsLinks()
+{
+    LinkGraph graph(m_io, m_indexer);
+    build(graph, 3);
+    QSignalSpy changed(&graph, &LinkGraph::linksChanged);
+
+    writeFile(path("c.md"), "See [B](b.md)\n");
+    graph.updateDocument(path("c.md"));
+    QTRY_COMPARE(sourcesOf(graph.backlinks(path("b.md"))),
+                 (QStringList{path("a.md"), path("c.md")}));
+    QVERIFY(reported(changed, path("c.md")));
+
+    // The old links of a document parsed again are gone
+    writeFile(path("a.md"), "Only [C](c.md)\n");
+    graph.updateDocument(path("a.md"));
+    QTRY_COMPARE(sourcesOf(graph.backlinks(path("b.md"))), QStringList{path("c.md")});
+    QCOMPARE(sourcesOf(graph.backlinks(path("c.md"))), QStringList{path("a.md")});
+    QCOMPARE(graph.linkCount(), 3);
+}
+
+void TestLinkGraph::removedDocumentLosesItsLinks()
+{
+    LinkGraph graph(m_io, m_indexer);
+    build(graph, 3);
+
+    QVERIFY(QFile::remove(path("b.md")));
+    graph.updateDocument(path("b.md"));
+    QTRY_COMPARE(graph.documentCount(), 2);
+    QVERIFY(!graph.containsDocument(path("b.md")));
+    QVERIFY(graph.backlinks(path("a.md")).isEmpty());
+    // Links to it stay, as broken links
+    QCOMPARE(sourcesOf(graph.backlinks(path("b.md"))), QStringList{path("a.md")});
+}
+
+void TestLinkGraph::pathsOutsideWorkspaceAreIgnored()
+{
+    LinkGraph graph(m_io, m_indexer);
+    build(graph, 3);
+
+    QTemporaryDir outside;
+    QString elsewhere = QDir::cleanPath(outside.path()) + "/other.md";
+    writeFile(elsewhere, "[A](" + path("a.md").toUtf8() + ")\n");
+    writeFile(path("notes.txt"), "[A](a.md)\n");
+    QSignalSpy changed(&graph, &LinkGraph::linksChanged);
+    graph.updateDocument(elsewhere);
+    graph.updateDocument(path("notes.txt"));
+
+    QTest::qWait(100);
+    QVERIFY(!reported(changed, elsewhere));
+    QVERIFY(!reported(changed, path("notes.txt")));
+    QVERIFY(!graph.containsDocument(elsewhere));
+    QCOMPARE(sourcesOf(graph.backlinks(path("a.md"))), QStringList{path("b.md")});
+}
+
+void TestLinkGraph::savedGraphIsLoaded()
+{
+    {
+        LinkGraph graph(m_io, m_indexer);
+        build(graph, 3);
+        // Ids of paths no document links to any more are reclaimed on save
+        writeFile(path("a.md"), "[New](new.md)\n");
+        graph.updateDocument(path("a.md"));
+        QTRY_COMPARE(sourcesOf(graph.backlinks(path("new.md"))), QStringList{path("a.md")});
+        QTRY_VERIFY_WITH_TIMEOUT(QFile::exists(graphFile()), 10000);
+    }
+
+    // The links are there as soon as the graph is loaded
+    m_io->waitForDone();
+    LinkGraph loaded(m_io, m_indexer);
+    QSignalSpy ready(&loaded, &LinkGraph::readyChanged);
+    loaded.start();
+    QVERIFY(ready.wait());
+    QCOMPARE(loaded.documentCount(), 3);
+    QCOMPARE(loaded.linkCount(), 2);
+    QCOMPARE(sourcesOf(loaded.backlinks(path("new.md"))), QStringList{path("a.md")});
+    QCOMPARE(sourcesOf(loaded.backlinks(path("a.md"))), QStringList{path("b.md")});
+    QVERIFY(loaded.backlinks(path("c.md")).isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestLinkGraph)
+#include "tst_linkgraph.moc"
@@ -0,0 +1,158 @@
+// tst_piecetable.cpp
+#include <QtTest>
+#include <QRandomGenerator>
+
+#include "PieceTable.h"
+
+class TestPieceTable : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void insertAtPieceBoundaries();
+    void removeAtPieceBoundaries();
+    void removeAcrossPieces();
+    void midAcrossPieces();
+    void midOutOfRange();
+    void randomEditsMatchString();
+    void frozenCopyKeepsItsText();
+    void commonPrefixAndSuffix();
+};
+
+void TestPieceTable::insertAtPieceBoundaries()
+{
+    PieceTable table(QStringLiteral("hello world"));
+
+    table.insert(5, u",");           // Splits the original piece
+    table.insert(0, u">");           // Before the first piece
+    table.insert(table.length(), u"!");
+    table.insert(7, u" big");        // Right after the inserted ","
+    QCOMPARE(table.text(), QStringLiteral(">hello, big world!"));
+    QCOMPARE(table.length(), qsizetype(18));
+
+    // Typing extends the last added piece instead of adding one
+    int pieces = table.pieceCount();
+    table.insert(11, u"g");
+    table.insert(12, u"e");
+    QCOMPARE(table.text(), QStringLiteral(">hello, bigge world!"));
+    QCOMPARE(table.pieceCount(), pieces);
+}
+
+void TestPieceTable::removeAtPieceBoundaries()
+{
+    PieceTable table(QStringLiteral("abcdef"));
+    table.insert(3, u"XYZ");        // abc|XYZ|def
+    QCOMPARE(table.pieceCount(), 3);
+
+    table.remove(3, 3);             // Exactly the middle piece
+    QCOMPARE(table.text(), QStringLiteral("abcdef"));
+    QCOMPARE(table.pieceCount(), 2);
+
+    table.remove(0, 1);             // Start of the first piece
+    table.remove(1, 1);             // End of the first piece
+    table.remove(table.length() - 1, 1);
+    QCOMPARE(table.text(), QStringLiteral("bde"));
+}
+
+void TestPieceTable::removeAcrossPieces()
+{
+    PieceTable table(QStringLiteral("0123456789"));
+    table.insert(3, u"ab");
+    table.insert(8, u"cd");         // 012|ab|345|cd|6789
+    QCOMPARE(table.text(), QStringLiteral("012ab345cd6789"));
+
+    table.remove(4, 7);             // From inside "ab" to inside "6789"
+    QCOMPARE(table.text(), QStringLiteral("012a789"));
+
+    table.replace(2, 3, u"--");     // Replace across the remaining boundaries
+    QCOMPARE(table.text(), QStringLiteral("01--89"));
+    QCOMPARE(table.length(), qsizetype(6));
+}
+
+void TestPieceTable::midAcrossPieces()
+{
+    PieceTable table(QStringLiteral("abcdef"));
+    table.insert(2, u"12");
+    table.insert(6, u"34");         // ab|12|cd|34|ef
+    QString expected = QStringLiteral("ab12cd34ef");
+    QCOMPARE(table.text(), expected);
+
+    for (qsizetype position = 0; position < expected.length(); ++position) {
+        for (qsizetype length = 1; position + length <= expected.length(); ++length) {
+            QCOMPARE(table.mid(position, length), expected.mid(position, length));
+        }
+    }
+}
+
+void TestPieceTable::midOutOfRange()
+{
+    PieceTable table(QStringLiteral("abc"));
+    QCOMPARE(table.mid(1, 100), QStringLiteral("bc"));
+    QVERIFY(table.mid(3, 1).isEmpty());
+    QVERIFY(table.mid(-1, 2).isEmpty());
+    QVERIFY(table.mid(0, 0).isEmpty());
+    QVERIFY(PieceTable().mid(0, 1).isEmpty());
+}
+
+void TestPieceTable::randomEditsMatchString()
+{
+    QRandomGenerator random(42);
+    QString expected = QStringLiteral("The quick brown fox jumps over the lazy dog");
+    PieceTable table(expected);
+
+    for (int i = 0; i < 2000; ++i) {
+        qsizetype position = random.bounded(int(expected.length() + 1));
+        qsizetype removed = random.bounded(int(qMin<qsizetype>(5, expected.length() - position) + 1));
+        QString inserted = QString(random.bounded(4), QChar(u'a' + random.bounded(26)));
+
+        expected.replace(position, removed, inserted);
+        table.replace(position, removed, inserted);
+        if (i % 100 == 0) {
+            table.freeze();
+        }
+
+        QCOMPARE(table.length(), expected.length());
+        qsizetype from = random.bounded(int(expected.length() + 1));
+        QCOMPARE(table.mid(from, 7), expected.mid(from, 7));
+    }
+    QCOMPARE(table.text(), expected);
+
+    table.compact();
+    QCOMPARE(table.pieceCount(), expected.isEmpty() ? 0 : 1);
+    QCOMPARE(table.text(), expected);
+}
+
+void TestPieceTable::frozenCopyKeepsItsText()
+{
+    PieceTable table(QStringLiteral("base"));
+    table.insert(4, u" text");
+    table.freeze();
+    PieceTable copy = table;
+
+    table.insert(9, u" more");      // Would have extended the shared add buffer
+    table.remove(0, 4);
+    QCOMPARE(copy.text(), QStringLiteral("base text"));
+    QCOMPARE(table.text(), QStringLiteral(" text more"));
+
+    table.compact();
+    QCOMPARE(copy.text(), QStringLiteral("base text"));
+}
+
+void TestPieceTable::commonPrefixAndSuffix()
+{
+    PieceTable table(QStringLiteral("abcdef"));
+    table.insert(3, u"XY");         // abc|XY|def
+
+    QCOMPARE(table.commonPrefixLength(u"abcXYdef"), qsizetype(8));
+    QCOMPARE(table.commonPrefixLength(u"abcX"), qsizetype(4));
+    QCOMPARE(table.commonPrefixLength(u"abQ"), qsizetype(2));
+    QCOMPARE(table.commonPrefixLength(u""), qsizetype(0));
+
+    QCOMPARE(table.commonSuffixLength(u"Ydef", 100), qsizetype(4));
+    QCOMPARE(table.commonSuffixLength(u"--XYdef", 100), qsizetype(5));
+    QCOMPARE(table.commonSuffixLength(u"--XYdef", 3), qsizetype(3));
+    QCOMPARE(table.commonSuffixLength(u"deQ", 100), qsizetype(0));
+}
+
+QTEST_APPLESS_MAIN(TestPieceTable)
+#include "tst_piecetable.moc"
@@ -0,0 +1,55 @@
+// tst_regexsearch.cpp
+#include <QtTest>
+
+#include "RegexSearch.h"
+
+class TestRegexSearch : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void requiredLiteral_data();
+    void requiredLiteral();
+};
+
+void TestRegexSearch::requiredLiteral_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<QByteArray>("literal");
+
+    QTest::newRow("plain") << "needle" << QByteArray("needle");
+    QTest::newRow("escaped dot") << "a\\.b" << QByteArray("a.b");
+    QTest::newRow("optional char") << "colou?r" << QByteArray("colo");
+    QTest::newRow("star") << "abcx*yz" << QByteArray("abc");
+
+    // Counted repetitions end the run without leaking their bounds into it
+    QTest::newRow("{n}") << "ab{2}cd" << QByteArray("ab");
+    QTest::newRow("{n} after escape") << "\\d{4}-\\d{2}" << QByteArray("-");
+    QTest::newRow("{n,m}") << "xy{1,3}long" << QByteArray("long");
+    QTest::newRow("{0,m}") << "abc{0,3}de" << QByteArray("ab");
+    QTest::newRow("{n,}") << "key{2,}" << QByteArray("key");
+    QTest::newRow("literal brace") << "a{b}" << QByteArray("a{b}");
+    QTest::newRow("unclosed brace") << "fn{" << QByteArray("fn{");
+
+    QTest::newRow("class") << "foo[abc]+barbaz" << QByteArray("barbaz");
+    QTest::newRow("class with ]") << "[]x]yz" << QByteArray("yz");
+    QTest::newRow("negated class") << "[^a-z]{3}word" << QByteArray("word");
+
+    QTest::newRow("group") << "(foo)barbaz" << QByteArray("barbaz");
+    QTest::newRow("optional group") << "pre(fix)?post" << QByteArray("post");
+    QTest::newRow("grouped alternation") << "pre(a|b)postfix" << QByteArray("postfix");
+    QTest::newRow("top-level alternation") << "foo|barbaz" << QByteArray();
+    QTest::newRow("inline option") << "(?i)needle" << QByteArray();
+    QTest::newRow("only classes") << "\\w+\\s\\d" << QByteArray();
+}
+
+void TestRegexSearch::requiredLiteral()
+{
+    QFETCH(QString, pattern);
+    QFETCH(QByteArray, literal);
+
+    QCOMPARE(RegexSearch::requiredLiteral(pattern), literal);
+}
+
+QTEST_APPLESS_MAIN(TestRegexSearch)
+#include "tst_regexsearch.moc"
@@ -0,0 +1,330 @@
+// tst_workspacewatcher.cpp
+#include <QtTest>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+#include "FileIoService.h"
+#include "WatcherBackends.h"
+#include "WorkspaceIndexer.h"
+#include "WorkspaceWatcher.h"
+
+namespace {
+WorkspaceEvent event(WorkspaceEvent::Type type, const QString &path,
+                     const QString &oldPath = QString(), bool isDirectory = false)
+{
+    WorkspaceEvent e;
+    e.type = type;
+    e.path = path;
+    e.oldPath = oldPath;
+    e.isDirectory = isDirectory;
+    return e;
+}
+
+// The backend lives on the watcher thread once the watcher owns it
+void appendEvents(ReplayBackend *backend, const QVector<WorkspaceEvent> &events)
+{
+    QMetaObject::invokeMethod(backend, [backend, events]() {
+        for (const WorkspaceEvent &e : events) {
+            backend->append(e);
+        }
+    }, Qt::BlockingQueuedConnection);
+}
+
+QSet<QString> watchedPaths(ReplayBackend *backend)
+{
+    QSet<QString> paths;
+    QMetaObject::invokeMethod(backend, [backend, &paths]() {
+        paths = backend->watchedPaths();
+    }, Qt::BlockingQueuedConnection);
+    return paths;
+}
+}
+
+class TestWorkspaceWatcher : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void subscriptionsSeeTheirPrefix();
+    void eventsAreCoalesced();
+    void renameChainsKeepFirstPath();
+    void rescanReachesEverySubscriber();
+    void unsubscribeOnContextDestroyed();
+    void watchesAreReferenceCounted();
+    void lostWatchesAreRearmed();
+    void indexerWatchesWalkedDirectories();
+    void ignoreRulesFollowGitIgnoreEdits();
+};
+
+void TestWorkspaceWatcher::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void TestWorkspaceWatcher::subscriptionsSeeTheirPrefix()
+{
+    auto *backend = new ReplayBackend;
+    backend->setRealtime(false);
+    WorkspaceWatcher watcher(backend);
+    watcher.setBatchInterval(0);
+
+    QVector<WorkspaceEvent> all;
+    QVector<WorkspaceEvent> notes;
+    watcher.subscribe(QString(), this, [&](const QVector<WorkspaceEvent> &events) {
+        all += events;
+    });
+    watcher.subscribe("/w/notes", this, [&](const QVector<WorkspaceEvent> &events) {
+        notes += events;
+    });
+
+    appendEvents(backend, {
+        event(WorkspaceEvent::Modified, "/w/notes/a.md"),
+        event(WorkspaceEvent::Modified, "/w/notes-old/b.md"),  // Shares the prefix string only
+        event(WorkspaceEvent::Moved, "/w/archive/c.md", "/w/notes/c.md"),
+        event(WorkspaceEvent::Created, "/w/other.md")
+    });
+    backend->replay();
+
+    QTRY_COMPARE(all.size(), 4);
+    QCOMPARE(notes.size(), 2);
+    QCOMPARE(notes.at(0).path, QStringLiteral("/w/notes/a.md"));
+    QCOMPARE(notes.at(1).oldPath, QStringLiteral("/w/notes/c.md"));
+    QCOMPARE(watcher.receivedEvents(), quint64(4));
+    QCOMPARE(watcher.deliveredEvents(), quint64(6));
+}
+
+void TestWorkspaceWatcher::eventsAreCoalesced()
+{
+    auto *backend = new ReplayBackend;
+    backend->setRealtime(false);
+    WorkspaceWatcher watcher(backend);
+    watcher.setBatchInterval(0);
+
+    QVector<WorkspaceEvent> received;
+    watcher.subscribe(QString(), this, [&](const QVector<WorkspaceEvent> &events) {
+        received += events;
+    });
+
+    appendEvents(backend, {
+        event(WorkspaceEvent::Created, "/w/new.md"),
+        event(WorkspaceEvent::Modified, "/w/new.md"),        // Covered by Created
+        event(WorkspaceEvent::Created, "/w/tmp.md"),
+        event(WorkspaceEvent::Removed, "/w/tmp.md"),         // Never existed for listeners
+        event(WorkspaceEvent::Removed, "/w/saved.md"),
+        event(WorkspaceEvent::Created, "/w/saved.md"),       // Rename-over save
+        event(WorkspaceEvent::Created, "/w/draft.md"),
+        event(WorkspaceEvent::Moved, "/w/final.md", "/w/draft.md")
+    });
+    backend->replay();
+
+    QTRY_COMPARE(received.size(), 3);
+    QCOMPARE(received.at(0).type, WorkspaceEvent::Created);
+    QCOMPARE(received.at(0).path, QStringLiteral("/w/new.md"));
+    QCOMPARE(received.at(1).type, WorkspaceEvent::Modified);
+    QCOMPARE(received.at(1).path, QStringLiteral("/w/saved.md"));
+    QCOMPARE(received.at(2).type, WorkspaceEvent::Created);
+    QCOMPARE(received.at(2).path, QStringLiteral("/w/final.md"));
+    QVERIFY(received.at(2).oldPath.isEmpty());
+}
+
+void TestWorkspaceWatcher::renameChainsKeepFirstPath()
+{
+    auto *backend = new ReplayBackend;
+    backend->setRealtime(false);
+    WorkspaceWatcher watcher(backend);
+    watcher.setBatchInterval(0);
+
+    QVector<WorkspaceEvent> received;
+    watcher.subscribe(QString(), this, [&](const QVector<WorkspaceEvent> &events) {
+        received += events;
+    });
+
+    appendEvents(backend, {
+        event(WorkspaceEvent::Moved, "/w/b.md", "/w/a.md"),
+        event(WorkspaceEvent::Moved, "/w/c.md", "/w/b.md"),
+        event(WorkspaceEvent::Moved, "/w/y.md", "/w/x.md"),
+        event(WorkspaceEvent::Moved, "/w/x.md", "/w/y.md")   // Renamed back
+    });
+    backend->replay();
+
+    QTRY_COMPARE(received.size(), 2);
+    QCOMPARE(received.at(0).type, WorkspaceEvent::Moved);
+    QCOMPARE(received.at(0).path, QStringLiteral("/w/c.md"));
+    QCOMPARE(received.at(0).oldPath, QStringLiteral("/w/a.md"));
+    QCOMPARE(received.at(1).type, WorkspaceEvent::Modified);
+    QCOMPARE(received.at(1).path, QStringLiteral("/w/x.md"));
+}
+
+void TestWorkspaceWatcher::rescanReachesEverySubscriber()
+{
+    auto *backend = new ReplayBackend;
+    backend->setRealtime(false);
+    WorkspaceWatcher watcher(backend);
+    watcher.setBatchInterval(0);
+
+    int calls = 0;
+    watcher.subscribe("/w/a", this, [&](const QVector<WorkspaceEvent> &events) {
+        calls += events.size() == 1 && events.first().type == WorkspaceEvent::Rescan;
+    });
+    watcher.subscribe("/w/b", this, [&](const QVector<WorkspaceEvent> &events) {
+        calls += events.size() == 1 && events.first().type == WorkspaceEvent::Rescan;
+    });
+
+    appendEvents(backend, {event(WorkspaceEvent::Rescan, QString())});
+    backend->replay();
+
+    QTRY_COMPARE(calls, 2);
+}
+
+void TestWorkspaceWatcher::unsubscribeOnContextDestroyed()
+{
+    auto *backend = new ReplayBackend;
+    backend->setRealtime(false);
+    WorkspaceWatcher watcher(backend);
+    watcher.setBatchInterval(0);
+
+    int kept = 0;
+    int dropped = 0;
+    auto *context = new QObject;
+    watcher.subscribe(QString(), this, [&](const QVector<WorkspaceEvent> &) { kept++; });
+    watcher.subscribe(QString(), context, [&](const QVector<WorkspaceEvent> &) { dropped++; });
+    delete context;
+
+    appendEvents(backend, {event(WorkspaceEvent::Modified, "/w/a.md")});
+    backend->replay();
+
+    QTRY_COMPARE(kept, 1);
+    QCOMPARE(dropped, 0);
+}
+
+void TestWorkspaceWatcher::watchesAreReferenceCounted()
+{
+    auto *backend = new ReplayBackend;
+    WorkspaceWatcher watcher(backend);
+
+    watcher.watchDirectory("/w/docs");
+    watcher.watchFile("/w/docs/a.md");   // Served by the directory watch
+    QCOMPARE(watcher.watchCount(), 1);
+    QCOMPARE(watchedPaths(backend), QSet<QString>{"/w/docs"});
+
+    watcher.unwatchDirectory("/w/docs");
+    QCOMPARE(watchedPaths(backend), QSet<QString>{"/w/docs"});
+    watcher.unwatchFile("/w/docs/a.md");
+    QCOMPARE(watcher.watchCount(), 0);
+    QVERIFY(watchedPaths(backend).isEmpty());
+}
+
+void TestWorkspaceWatcher::lostWatchesAreRearmed()
+{
+    auto *backend = new ReplayBackend;
+    backend->setRealtime(false);
+    WorkspaceWatcher watcher(backend);
+    watcher.setBatchInterval(0);
+
+    // Deleted while watched: the reference stays, the backend watch is gone
+    watcher.watchDirectory("/w/docs");
+    backend->dropWatch("/w/docs");
+    QVERIFY(watchedPaths(backend).isEmpty());
+    QCoreApplication::processEvents();  // The report posted meanwhile
+    QCOMPARE(watcher.watchCount(), 1);
+
+    // Watching it again sets the backend watch up again
+    watcher.watchDirectory("/w/docs");
+    QCOMPARE(watchedPaths(backend), QSet<QString>{"/w/docs"});
+
+    // So does the directory coming back
+    backend->dropWatch("/w/docs");
+    QVERIFY(watchedPaths(backend).isEmpty());
+    QCoreApplication::processEvents();
+    appendEvents(backend, {event(WorkspaceEvent::Created, "/w/docs", QString(), true)});
+    backend->replay();
+    QTRY_COMPARE(watchedPaths(backend), QSet<QString>{"/w/docs"});
+
+    watcher.unwatchDirectory("/w/docs");
+    watcher.unwatchDirectory("/w/docs");
+    QCOMPARE(watcher.watchCount(), 0);
+    QVERIFY(watchedPaths(backend).isEmpty());
+}
+
+void TestWorkspaceWatcher::indexerWatchesWalkedDirectories()
+{
+    QTemporaryDir workspace;
+    QVERIFY(workspace.isValid());
+    QString root = workspace.path();
+    QVERIFY(QDir(root).mkpath("notes/deep"));
+    QVERIFY(QDir(root).mkpath("node_modules/pkg"));   // Excluded by default
+    QFile readme(root + "/notes/deep/readme.md");
+    QVERIFY(readme.open(QIODevice::WriteOnly));
+    readme.close();
+
+    auto *backend = new ReplayBackend;
+    backend->setRealtime(false);
+    WorkspaceWatcher watcher(backend);
+    watcher.setBatchInterval(0);
+    FileIoService io;
+    WorkspaceIndexer indexer(&io, &watcher);
+    indexer.setRoots({root});
+
+    QSignalSpy finished(&indexer, &WorkspaceIndexer::scanFinished);
+    indexer.rescan();
+    QVERIFY(finished.wait());
+    QCOMPARE(indexer.fileCount(), 1);
+
+    QSet<QString> watched = watchedPaths(backend);
+    QVERIFY(watched.contains(root));
+    QVERIFY(watched.contains(root + "/notes/deep"));
+    QVERIFY(!watched.contains(root + "/node_modules"));
+
+    // An event from the deep directory reaches the indexer's subscription
+    QFile added(root + "/notes/deep/added.md");
+    QVERIFY(added.open(QIODevice::WriteOnly));
+    added.close();
+    QSignalSpy filesAdded(&indexer, &WorkspaceIndexer::filesAdded);
+    appendEvents(backend, {event(WorkspaceEvent::Created, added.fileName())});
+    backend->replay();
+    QTRY_COMPARE(filesAdded.count(), 1);
+    QCOMPARE(indexer.fileCount(), 2);
+
+    // Removing a directory drops the watches below it
+    appendEvents(backend, {event(WorkspaceEvent::Removed, root + "/notes", QString(), true)});
+    backend->replay();
+    QTRY_VERIFY(!watchedPaths(backend).contains(root + "/notes/deep"));
+    QCOMPARE(indexer.fileCount(), 0);
+}
+
+void TestWorkspaceWatcher::ignoreRulesFollowGitIgnoreEdits()
+{
+    QTemporaryDir workspace;
+    QVERIFY(workspace.isValid());
+    QString root = workspace.path();
+    QVERIFY(QDir(root).mkpath("notes/drafts"));
+    QFile gitIgnore(root + "/notes/.gitignore");
+    QVERIFY(gitIgnore.open(QIODevice::WriteOnly));
+    gitIgnore.write("drafts/\n");
+    gitIgnore.close();
+
+    auto *backend = new ReplayBackend;
+    backend->setRealtime(false);
+    WorkspaceWatcher watcher(backend);
+    watcher.setBatchInterval(0);
+    FileIoService io;
+    WorkspaceIndexer indexer(&io, &watcher);
+    indexer.setRoots({root});
+
+    QString draft = root + "/notes/drafts/a.md";
+    QVERIFY(indexer.isExcluded(draft, false));
+    QVERIFY(!indexer.isExcluded(root + "/notes/a.md", false));
+
+    // The cached rules are dropped when the .gitignore changes
+    QVERIFY(gitIgnore.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    gitIgnore.close();
+    QVERIFY(indexer.isExcluded(draft, false));
+    appendEvents(backend, {event(WorkspaceEvent::Modified, gitIgnore.fileName())});
+    backend->replay();
+    QTRY_VERIFY(!indexer.isExcluded(draft, false));
+}
+
+QTEST_GUILESS_MAIN(TestWorkspaceWatcher)
+#include "tst_workspacewatcher.moc"